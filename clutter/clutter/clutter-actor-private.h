@@ -242,6 +242,11 @@ ClutterTransition *             _clutter_actor_create_transition
                                                                                          ...);
 ClutterTransition *             _clutter_actor_get_transition                           (ClutterActor *self,
                                                                                          GParamSpec   *pspec);
+gboolean                        _clutter_actor_supports_animated_value                  (ClutterActor *self,
+                                                                                         GParamSpec   *pspec);
+void                            _clutter_actor_set_animated_value                       (ClutterActor *self,
+                                                                                         GParamSpec   *pspec,
+                                                                                         double        value);
 
 gboolean                        _clutter_actor_foreach_child                            (ClutterActor *self,
                                                                                          ClutterForeachCallback callback,
@@ -11635,6 +11635,38 @@ clutter_actor_get_scale_gravity (ClutterActor *self)
   return clutter_anchor_coord_get_gravity (&info->scale_center);
 }
 
+static ClutterEffect *
+get_opacity_redraw_effect (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+  const GList *l;
+
+  if (priv->flatten_effect != NULL)
+    return priv->flatten_effect;
+
+  if (priv->effects == NULL)
+    return NULL;
+
+  /* the first enabled effect is the one painting the actor, so it is
+     the only one that needs to know about its opacity */
+  for (l = _clutter_meta_group_peek_metas (priv->effects);
+       l != NULL;
+       l = l->next)
+    {
+      ClutterActorMeta *meta = l->data;
+
+      if (!clutter_actor_meta_get_enabled (meta))
+        continue;
+
+      if (CLUTTER_IS_OFFSCREEN_EFFECT (meta))
+        return CLUTTER_EFFECT (meta);
+
+      break;
+    }
+
+  return NULL;
+}
+
 static inline void
 clutter_actor_set_opacity_internal (ClutterActor *self,
                                     guint8        opacity)
@@ -11645,16 +11677,17 @@ clutter_actor_set_opacity_internal (ClutterActor *self,
     {
       priv->opacity = opacity;
 
-      /* Queue a redraw from the flatten effect so that it can use
-         its cached image if available instead of having to redraw the
-         actual actor. If it doesn't end up using the FBO then the
-         effect is still able to continue the paint anyway. If there
-         is no flatten effect yet then this is equivalent to queueing
-         a full redraw */
+      /* Queue a redraw from the outermost offscreen effect (usually
+         the flatten effect) so that it can use its cached image if
+         available instead of having to redraw the actual actor; the
+         opacity is only applied when painting the cached image. If it
+         doesn't end up using the FBO then the effect is still able to
+         continue the paint anyway. If there is no offscreen effect then
+         this is equivalent to queueing a full redraw */
       _clutter_actor_queue_redraw_full (self,
                                         0, /* flags */
                                         NULL, /* clip */
-                                        priv->flatten_effect);
+                                        get_opacity_redraw_effect (self));
 
       g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_OPACITY]);
     }
@@ -15111,6 +15144,96 @@ clutter_animatable_iface_init (ClutterAnimatableIface *iface)
   iface->set_final_state = clutter_actor_set_final_state;
 }
 
+/*< private >
+ * _clutter_actor_supports_animated_value:
+ * @self: a #ClutterActor
+ * @pspec: the #GParamSpec of an animatable property of @self
+ *
+ * Checks whether @pspec can be set using _clutter_actor_set_animated_value(),
+ * bypassing the #ClutterAnimatable implementation of @self.
+ *
+ * Return value: %TRUE if the property is supported
+ */
+gboolean
+_clutter_actor_supports_animated_value (ClutterActor *self,
+                                        GParamSpec   *pspec)
+{
+  ClutterAnimatableIface *iface;
+
+  /* subclasses overriding the ClutterAnimatable implementation of
+   * ClutterActor must go through the generic code path
+   */
+  iface = CLUTTER_ANIMATABLE_GET_IFACE (self);
+  if (iface->set_final_state != clutter_actor_set_final_state ||
+      iface->interpolate_value != NULL)
+    return FALSE;
+
+  return pspec == obj_props[PROP_X] ||
+         pspec == obj_props[PROP_Y] ||
+         pspec == obj_props[PROP_OPACITY] ||
+         pspec == obj_props[PROP_TRANSLATION_X] ||
+         pspec == obj_props[PROP_TRANSLATION_Y] ||
+         pspec == obj_props[PROP_TRANSLATION_Z] ||
+         pspec == obj_props[PROP_SCALE_X] ||
+         pspec == obj_props[PROP_SCALE_Y] ||
+         pspec == obj_props[PROP_SCALE_Z] ||
+         pspec == obj_props[PROP_ROTATION_ANGLE_X] ||
+         pspec == obj_props[PROP_ROTATION_ANGLE_Y] ||
+         pspec == obj_props[PROP_ROTATION_ANGLE_Z];
+}
+
+/*< private >
+ * _clutter_actor_set_animated_value:
+ * @self: a #ClutterActor
+ * @pspec: a #GParamSpec supported by _clutter_actor_supports_animated_value()
+ * @value: the new value of the property
+ *
+ * Sets the value of an animated property directly, without going
+ * through #GValue and the #ClutterAnimatable interface.
+ */
+void
+_clutter_actor_set_animated_value (ClutterActor *self,
+                                   GParamSpec   *pspec,
+                                   double        value)
+{
+  switch (pspec->param_id)
+    {
+    case PROP_X:
+      clutter_actor_set_x_internal (self, value);
+      break;
+
+    case PROP_Y:
+      clutter_actor_set_y_internal (self, value);
+      break;
+
+    case PROP_OPACITY:
+      clutter_actor_set_opacity_internal (self, CLAMP (value, 0, 255));
+      break;
+
+    case PROP_TRANSLATION_X:
+    case PROP_TRANSLATION_Y:
+    case PROP_TRANSLATION_Z:
+      clutter_actor_set_translation_internal (self, value, pspec);
+      break;
+
+    case PROP_SCALE_X:
+    case PROP_SCALE_Y:
+    case PROP_SCALE_Z:
+      clutter_actor_set_scale_factor_internal (self, value, pspec);
+      break;
+
+    case PROP_ROTATION_ANGLE_X:
+    case PROP_ROTATION_ANGLE_Y:
+    case PROP_ROTATION_ANGLE_Z:
+      clutter_actor_set_rotation_angle_internal (self, value, pspec);
+      break;
+
+    default:
+      g_assert_not_reached ();
+      break;
+    }
+}
+
 /**
  * clutter_actor_transform_stage_point:
  * @self: A #ClutterActor
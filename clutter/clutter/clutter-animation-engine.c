@@ -0,0 +1,413 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * SECTION:clutter-animation-engine
+ * @short_description: Batched interpolation of core actor properties
+ *
+ * The animation engine is a fast path used by #ClutterPropertyTransition
+ * for the scalar transform properties of #ClutterActor (position,
+ * translation, scale, rotation and opacity).
+ *
+ * Instead of computing every frame through a #ClutterInterval and a
+ * #GValue, and then going through the #ClutterAnimatable and #GObject
+ * property machinery, transitions using the engine only record their
+ * progress and end points. While the master clock advances the timelines
+ * the engine is in "batch" mode; once all timelines have been advanced,
+ * every pending animation is interpolated in a single pass over a set of
+ * packed arrays, and the results are written directly into the actor
+ * state.
+ *
+ * Outside of a batch, updates are applied immediately, so the visible
+ * behaviour is the same as the generic code path. Inside a batch, the
+ * values are applied before emitting #ClutterTimeline::new-frame on
+ * timelines with handlers, so that the handlers see the same state as
+ * they would with the generic code path.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clutter-build-config.h"
+#endif
+
+#include "clutter-animation-engine.h"
+
+#include "clutter-actor-private.h"
+#include "clutter-debug.h"
+#include "clutter-private.h"
+
+#define SLOT_INVALID    (-1)
+
+struct _ClutterAnimationEngine
+{
+  /* number of used slots, and allocated size of each array */
+  guint n_slots;
+  guint size;
+
+  /* struct-of-arrays; the same index in each array describes
+   * a single animated property
+   */
+  ClutterActor **actors;
+  GParamSpec **pspecs;
+  gint **slot_refs;
+  double *initial;
+  double *final;
+  double *progress;
+  double *values;
+  guint8 *pending;
+
+  guint n_pending;
+  guint n_removed;
+
+  guint in_batch : 1;
+  guint in_flush : 1;
+};
+
+ClutterAnimationEngine *
+_clutter_animation_engine_get_default (void)
+{
+  static ClutterAnimationEngine *default_engine = NULL;
+
+  if (G_UNLIKELY (default_engine == NULL))
+    default_engine = g_new0 (ClutterAnimationEngine, 1);
+
+  return default_engine;
+}
+
+gboolean
+_clutter_animation_engine_is_enabled (void)
+{
+  return !(clutter_paint_debug_flags & CLUTTER_DEBUG_DISABLE_ANIMATION_ENGINE);
+}
+
+static void
+clutter_animation_engine_ensure_size (ClutterAnimationEngine *engine,
+                                      guint                   size)
+{
+  if (size <= engine->size)
+    return;
+
+  size = MAX (size, MAX (engine->size * 2, 16));
+
+  engine->actors = g_renew (ClutterActor *, engine->actors, size);
+  engine->pspecs = g_renew (GParamSpec *, engine->pspecs, size);
+  engine->slot_refs = g_renew (gint *, engine->slot_refs, size);
+  engine->initial = g_renew (double, engine->initial, size);
+  engine->final = g_renew (double, engine->final, size);
+  engine->progress = g_renew (double, engine->progress, size);
+  engine->values = g_renew (double, engine->values, size);
+  engine->pending = g_renew (guint8, engine->pending, size);
+
+  engine->size = size;
+}
+
+/*< private >
+ * _clutter_animation_engine_add:
+ * @engine: a #ClutterAnimationEngine
+ * @actor: the #ClutterActor being animated
+ * @pspec: the property of @actor being animated
+ * @slot_ref: location of the slot index, owned by the caller
+ *
+ * Adds an animated property to the engine. The index of the slot is
+ * stored in @slot_ref, and it will be updated by the engine whenever
+ * the slot is moved; it is reset to -1 once the slot is removed.
+ *
+ * The @pspec must be supported by _clutter_actor_set_animated_value().
+ */
+void
+_clutter_animation_engine_add (ClutterAnimationEngine *engine,
+                               ClutterActor           *actor,
+                               GParamSpec             *pspec,
+                               gint                   *slot_ref)
+{
+  guint slot;
+
+  g_return_if_fail (*slot_ref == SLOT_INVALID);
+
+  clutter_animation_engine_ensure_size (engine, engine->n_slots + 1);
+
+  slot = engine->n_slots++;
+
+  engine->actors[slot] = actor;
+  engine->pspecs[slot] = pspec;
+  engine->slot_refs[slot] = slot_ref;
+  engine->initial[slot] = 0.0;
+  engine->final[slot] = 0.0;
+  engine->progress[slot] = 0.0;
+  engine->values[slot] = 0.0;
+  engine->pending[slot] = FALSE;
+
+  *slot_ref = slot;
+
+  CLUTTER_NOTE (ANIMATION, "Added property '%s' of actor '%s' in slot %u",
+                pspec->name,
+                _clutter_actor_get_debug_name (actor),
+                slot);
+}
+
+static void
+clutter_animation_engine_move_slot (ClutterAnimationEngine *engine,
+                                    guint                   from,
+                                    guint                   to)
+{
+  engine->actors[to] = engine->actors[from];
+  engine->pspecs[to] = engine->pspecs[from];
+  engine->slot_refs[to] = engine->slot_refs[from];
+  engine->initial[to] = engine->initial[from];
+  engine->final[to] = engine->final[from];
+  engine->progress[to] = engine->progress[from];
+  engine->values[to] = engine->values[from];
+  engine->pending[to] = engine->pending[from];
+
+  if (engine->slot_refs[to] != NULL)
+    *engine->slot_refs[to] = to;
+}
+
+static void
+clutter_animation_engine_compact (ClutterAnimationEngine *engine)
+{
+  guint i = 0;
+
+  while (engine->n_removed > 0 && i < engine->n_slots)
+    {
+      if (engine->actors[i] != NULL)
+        {
+          i += 1;
+          continue;
+        }
+
+      engine->n_slots -= 1;
+      engine->n_removed -= 1;
+
+      if (i != engine->n_slots)
+        clutter_animation_engine_move_slot (engine, engine->n_slots, i);
+    }
+
+  engine->n_removed = 0;
+}
+
+/*< private >
+ * _clutter_animation_engine_remove:
+ * @engine: a #ClutterAnimationEngine
+ * @slot: the slot to remove
+ *
+ * Removes a slot previously added with _clutter_animation_engine_add().
+ * Any pending value is dropped; use _clutter_animation_engine_flush_slot()
+ * before removing the slot to apply it.
+ */
+void
+_clutter_animation_engine_remove (ClutterAnimationEngine *engine,
+                                  gint                    slot)
+{
+  g_return_if_fail (slot >= 0 && (guint) slot < engine->n_slots);
+
+  *engine->slot_refs[slot] = SLOT_INVALID;
+
+  if (engine->pending[slot])
+    engine->n_pending -= 1;
+
+  /* the slot arrays are being walked by the flush; just mark the
+   * slot as removed, and compact the arrays once we're done
+   */
+  if (engine->in_flush)
+    {
+      engine->actors[slot] = NULL;
+      engine->pspecs[slot] = NULL;
+      engine->slot_refs[slot] = NULL;
+      engine->pending[slot] = FALSE;
+      engine->n_removed += 1;
+      return;
+    }
+
+  engine->n_slots -= 1;
+
+  if ((guint) slot != engine->n_slots)
+    clutter_animation_engine_move_slot (engine, engine->n_slots, slot);
+}
+
+static inline void
+clutter_animation_engine_apply_slot (ClutterAnimationEngine *engine,
+                                     guint                   slot)
+{
+  engine->pending[slot] = FALSE;
+  engine->n_pending -= 1;
+
+  _clutter_actor_set_animated_value (engine->actors[slot],
+                                     engine->pspecs[slot],
+                                     engine->values[slot]);
+}
+
+/*< private >
+ * _clutter_animation_engine_update:
+ * @engine: a #ClutterAnimationEngine
+ * @slot: the slot to update
+ * @initial: the initial value of the interval
+ * @final: the final value of the interval
+ * @progress: the progress of the transition
+ *
+ * Updates the state of an animated property. If the engine is batching
+ * the updates the new value will be applied by the next call to
+ * _clutter_animation_engine_flush(); otherwise, it is applied immediately.
+ */
+void
+_clutter_animation_engine_update (ClutterAnimationEngine *engine,
+                                  gint                    slot,
+                                  double                  initial,
+                                  double                  final,
+                                  double                  progress)
+{
+  g_return_if_fail (slot >= 0 && (guint) slot < engine->n_slots);
+
+  engine->initial[slot] = initial;
+  engine->final[slot] = final;
+  engine->progress[slot] = progress;
+
+  if (!engine->pending[slot])
+    {
+      engine->pending[slot] = TRUE;
+      engine->n_pending += 1;
+    }
+
+  if (!engine->in_batch)
+    _clutter_animation_engine_flush_slot (engine, slot);
+}
+
+/*< private >
+ * _clutter_animation_engine_flush_slot:
+ * @engine: a #ClutterAnimationEngine
+ * @slot: the slot to flush
+ *
+ * Applies the pending value of @slot, if any, without waiting for the
+ * end of the current batch.
+ */
+void
+_clutter_animation_engine_flush_slot (ClutterAnimationEngine *engine,
+                                      gint                    slot)
+{
+  g_return_if_fail (slot >= 0 && (guint) slot < engine->n_slots);
+
+  if (!engine->pending[slot])
+    return;
+
+  engine->values[slot] = engine->initial[slot]
+                       + (engine->final[slot] - engine->initial[slot])
+                       * engine->progress[slot];
+
+  clutter_animation_engine_apply_slot (engine, slot);
+}
+
+/*< private >
+ * _clutter_animation_engine_begin_batch:
+ * @engine: a #ClutterAnimationEngine
+ *
+ * Starts batching the updates; this is called by the master clock
+ * before advancing the timelines.
+ */
+void
+_clutter_animation_engine_begin_batch (ClutterAnimationEngine *engine)
+{
+  engine->in_batch = TRUE;
+}
+
+static void
+clutter_animation_engine_apply_pending (ClutterAnimationEngine *engine)
+{
+  const double *initial, *final, *progress;
+  double *values;
+  guint i, n_slots;
+
+  if (engine->n_pending == 0 || engine->in_flush)
+    return;
+
+  n_slots = engine->n_slots;
+  initial = engine->initial;
+  final = engine->final;
+  progress = engine->progress;
+  values = engine->values;
+
+  /* this is a branch-free loop on packed arrays, which is cheaper than
+   * checking the pending flag on each slot
+   */
+  for (i = 0; i < n_slots; i++)
+    values[i] = initial[i] + (final[i] - initial[i]) * progress[i];
+
+  /* applying the values will emit notifications, and signal handlers
+   * are allowed to add or remove transitions; removed slots are
+   * compacted at the end, and new slots are not pending yet
+   */
+  engine->in_flush = TRUE;
+
+  for (i = 0; i < n_slots && engine->n_pending > 0; i++)
+    {
+      if (engine->pending[i])
+        clutter_animation_engine_apply_slot (engine, i);
+    }
+
+  engine->in_flush = FALSE;
+
+  if (engine->n_removed > 0)
+    clutter_animation_engine_compact (engine);
+}
+
+/*< private >
+ * _clutter_animation_engine_sync:
+ * @engine: a #ClutterAnimationEngine
+ *
+ * Applies the values computed so far in the current batch, without
+ * ending it. This is called before emitting the #ClutterTimeline::new-frame
+ * signal on timelines with handlers, so that they see the values of
+ * the timelines advanced before them, like they would outside of the
+ * engine.
+ */
+void
+_clutter_animation_engine_sync (ClutterAnimationEngine *engine)
+{
+  if (!engine->in_batch)
+    return;
+
+  clutter_animation_engine_apply_pending (engine);
+}
+
+/*< private >
+ * _clutter_animation_engine_flush:
+ * @engine: a #ClutterAnimationEngine
+ *
+ * Interpolates all the pending animations and writes the results into
+ * the actors, then stops batching the updates.
+ */
+void
+_clutter_animation_engine_flush (ClutterAnimationEngine *engine)
+{
+  engine->in_batch = FALSE;
+
+  clutter_animation_engine_apply_pending (engine);
+}
+
+/*< private >
+ * _clutter_animation_engine_get_n_animations:
+ * @engine: a #ClutterAnimationEngine
+ *
+ * Retrieves the number of animated properties handled by the engine.
+ *
+ * Return value: the number of animated properties
+ */
+guint
+_clutter_animation_engine_get_n_animations (ClutterAnimationEngine *engine)
+{
+  return engine->n_slots - engine->n_removed;
+}
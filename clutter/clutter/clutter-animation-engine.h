@@ -0,0 +1,57 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CLUTTER_ANIMATION_ENGINE_H__
+#define __CLUTTER_ANIMATION_ENGINE_H__
+
+#include <clutter/clutter-actor.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ClutterAnimationEngine  ClutterAnimationEngine;
+
+CLUTTER_AVAILABLE_IN_MUTTER
+ClutterAnimationEngine *        _clutter_animation_engine_get_default           (void);
+
+gboolean                        _clutter_animation_engine_is_enabled            (void);
+
+void                            _clutter_animation_engine_add                   (ClutterAnimationEngine *engine,
+                                                                                 ClutterActor           *actor,
+                                                                                 GParamSpec             *pspec,
+                                                                                 gint                   *slot_ref);
+void                            _clutter_animation_engine_remove                (ClutterAnimationEngine *engine,
+                                                                                 gint                    slot);
+void                            _clutter_animation_engine_update                (ClutterAnimationEngine *engine,
+                                                                                 gint                    slot,
+                                                                                 double                  initial,
+                                                                                 double                  final,
+                                                                                 double                  progress);
+void                            _clutter_animation_engine_flush_slot            (ClutterAnimationEngine *engine,
+                                                                                 gint                    slot);
+
+void                            _clutter_animation_engine_begin_batch           (ClutterAnimationEngine *engine);
+void                            _clutter_animation_engine_sync                  (ClutterAnimationEngine *engine);
+void                            _clutter_animation_engine_flush                 (ClutterAnimationEngine *engine);
+
+CLUTTER_AVAILABLE_IN_MUTTER
+guint                           _clutter_animation_engine_get_n_animations      (ClutterAnimationEngine *engine);
+
+G_END_DECLS
+
+#endif /* __CLUTTER_ANIMATION_ENGINE_H__ */
@@ -39,6 +39,12 @@
  * See [canvas.c](https://git.gnome.org/browse/clutter/tree/examples/canvas.c?h=clutter-1.18)
  * for an example of how to use #ClutterCanvas.
  *
+ * Large canvases can take a long time to draw. If the #ClutterCanvas:draw-async
+ * property is set, the #ClutterCanvas::draw signal is emitted from a worker
+ * thread instead, and the previous contents of the canvas are painted until
+ * the new ones are ready. Invalidating the canvas again while it is being
+ * drawn schedules a single new draw once the current one completes.
+ *
  * #ClutterCanvas is available since Clutter 1.10.
  */
 
@@ -65,6 +71,8 @@
 #include "clutter-private.h"
 #include "clutter-settings.h"
 
+typedef struct _ClutterCanvasDrawJob    ClutterCanvasDrawJob;
+
 struct _ClutterCanvasPrivate
 {
   cairo_t *cr;
@@ -76,6 +84,28 @@ struct _ClutterCanvasPrivate
   gboolean dirty;
 
   CoglBitmap *buffer;
+
+  /* asynchronous drawing */
+  gboolean draw_async;
+  gboolean redraw_pending;
+  ClutterCanvasDrawJob *draw_job;
+
+  /* the surface holding the data of buffer, and the spare one that
+   * will be used by the next draw
+   */
+  cairo_surface_t *front_surface;
+  cairo_surface_t *back_surface;
+};
+
+struct _ClutterCanvasDrawJob
+{
+  ClutterCanvas *canvas;
+
+  cairo_surface_t *surface;
+  int width;
+  int height;
+
+  volatile gint cancelled;
 };
 
 enum
@@ -84,6 +114,7 @@ enum
 
   PROP_WIDTH,
   PROP_HEIGHT,
+  PROP_DRAW_ASYNC,
 
   LAST_PROP
 };
@@ -99,6 +130,11 @@ enum
 
 static guint canvas_signals[LAST_SIGNAL] = { 0, };
 
+static GThreadPool *draw_thread_pool = NULL;
+static GList       *completed_draw_jobs = NULL;
+static guint        completed_draw_jobs_idle = 0;
+static GMutex       completed_draw_jobs_mutex;
+
 static void clutter_content_iface_init (ClutterContentIface *iface);
 
 G_DEFINE_TYPE_WITH_CODE (ClutterCanvas, clutter_canvas, G_TYPE_OBJECT,
@@ -133,6 +169,9 @@ clutter_canvas_finalize (GObject *gobject)
 {
   ClutterCanvasPrivate *priv = CLUTTER_CANVAS (gobject)->priv;
 
+  /* a draw job holds a reference on the canvas */
+  g_assert (priv->draw_job == NULL);
+
   if (priv->buffer != NULL)
     {
       cogl_object_unref (priv->buffer);
@@ -140,6 +179,8 @@ clutter_canvas_finalize (GObject *gobject)
     }
 
   g_clear_pointer (&priv->texture, cogl_object_unref);
+  g_clear_pointer (&priv->front_surface, cairo_surface_destroy);
+  g_clear_pointer (&priv->back_surface, cairo_surface_destroy);
 
   G_OBJECT_CLASS (clutter_canvas_parent_class)->finalize (gobject);
 }
@@ -180,6 +221,11 @@ clutter_canvas_set_property (GObject      *gobject,
       }
       break;
 
+    case PROP_DRAW_ASYNC:
+      clutter_canvas_set_draw_async (CLUTTER_CANVAS (gobject),
+                                     g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
       break;
@@ -204,6 +250,10 @@ clutter_canvas_get_property (GObject    *gobject,
       g_value_set_int (value, priv->height);
       break;
 
+    case PROP_DRAW_ASYNC:
+      g_value_set_boolean (value, priv->draw_async);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
       break;
@@ -247,6 +297,23 @@ clutter_canvas_class_init (ClutterCanvasClass *klass)
                       G_PARAM_READWRITE |
                       G_PARAM_STATIC_STRINGS);
 
+  /**
+   * ClutterCanvas:draw-async:
+   *
+   * Whether the #ClutterCanvas::draw signal should be emitted from a
+   * worker thread.
+   *
+   * Handlers of the #ClutterCanvas::draw signal of a canvas drawn
+   * asynchronously must only use the Cairo context they are given,
+   * and data that is safe to access from another thread.
+   */
+  obj_props[PROP_DRAW_ASYNC] =
+    g_param_spec_boolean ("draw-async",
+                          P_("Draw Asynchronously"),
+                          P_("Whether the canvas is drawn in a worker thread"),
+                          FALSE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS);
 
   /**
    * ClutterCanvas::draw:
@@ -258,6 +325,9 @@ clutter_canvas_class_init (ClutterCanvasClass *klass)
    * The #ClutterCanvas::draw signal is emitted each time a canvas is
    * invalidated.
    *
+   * If #ClutterCanvas:draw-async is set, the signal is emitted from a
+   * worker thread.
+   *
    * It is safe to connect multiple handlers to this signal: each
    * handler invocation will be automatically protected by cairo_save()
    * and cairo_restore() pairs.
@@ -421,12 +491,257 @@ clutter_canvas_emit_draw (ClutterCanvas *self)
   cairo_surface_destroy (surface);
 }
 
+static void
+clutter_canvas_draw_job_free (ClutterCanvasDrawJob *job)
+{
+  g_clear_pointer (&job->surface, cairo_surface_destroy);
+  g_object_unref (job->canvas);
+
+  g_slice_free (ClutterCanvasDrawJob, job);
+}
+
+static void clutter_canvas_start_draw_job (ClutterCanvas *self);
+
+static void
+clutter_canvas_complete_draw_job (ClutterCanvasDrawJob *job)
+{
+  ClutterCanvas *self = job->canvas;
+  ClutterCanvasPrivate *priv = self->priv;
+  CoglContext *ctx;
+
+  if (g_atomic_int_get (&job->cancelled) || priv->draw_job != job)
+    {
+      CLUTTER_NOTE (MISC, "Discarding cancelled draw of canvas %p", self);
+      clutter_canvas_draw_job_free (job);
+      return;
+    }
+
+  priv->draw_job = NULL;
+
+  /* the current buffer points to the data of the front surface, so it
+   * has to go before the front surface can be drawn again
+   */
+  if (priv->buffer != NULL)
+    {
+      cogl_object_unref (priv->buffer);
+      priv->buffer = NULL;
+    }
+
+  g_clear_pointer (&priv->back_surface, cairo_surface_destroy);
+  priv->back_surface = priv->front_surface;
+  priv->front_surface = job->surface;
+  job->surface = NULL;
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  priv->buffer =
+    cogl_bitmap_new_for_data (ctx,
+                              job->width,
+                              job->height,
+                              CLUTTER_CAIRO_FORMAT_ARGB32,
+                              cairo_image_surface_get_stride (priv->front_surface),
+                              cairo_image_surface_get_data (priv->front_surface));
+  priv->dirty = TRUE;
+
+  _clutter_content_queue_redraw (CLUTTER_CONTENT (self));
+
+  /* coalesce all the invalidations that happened while drawing */
+  if (priv->redraw_pending)
+    {
+      priv->redraw_pending = FALSE;
+      clutter_canvas_start_draw_job (self);
+    }
+
+  clutter_canvas_draw_job_free (job);
+}
+
+static gboolean
+clutter_canvas_complete_draw_jobs (gpointer user_data)
+{
+  GList *jobs, *l;
+
+  g_mutex_lock (&completed_draw_jobs_mutex);
+  jobs = g_list_reverse (completed_draw_jobs);
+  completed_draw_jobs = NULL;
+  completed_draw_jobs_idle = 0;
+  g_mutex_unlock (&completed_draw_jobs_mutex);
+
+  for (l = jobs; l != NULL; l = l->next)
+    clutter_canvas_complete_draw_job (l->data);
+
+  g_list_free (jobs);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+clutter_canvas_thread_draw (gpointer data,
+                            gpointer pool_data)
+{
+  ClutterCanvasDrawJob *job = data;
+
+  if (!g_atomic_int_get (&job->cancelled))
+    {
+      cairo_t *cr;
+      gboolean res;
+
+      cr = cairo_create (job->surface);
+
+      /* the surface may hold the contents of an older draw */
+      cairo_save (cr);
+      cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+      cairo_paint (cr);
+      cairo_restore (cr);
+
+      g_signal_emit (job->canvas, canvas_signals[DRAW], 0,
+                     cr, job->width, job->height,
+                     &res);
+
+#ifdef CLUTTER_ENABLE_DEBUG
+      if (_clutter_diagnostic_enabled () && cairo_status (cr))
+        {
+          g_warning ("Drawing failed for <ClutterCanvas>[%p]: %s",
+                     job->canvas,
+                     cairo_status_to_string (cairo_status (cr)));
+        }
+#endif
+
+      cairo_destroy (cr);
+
+      cairo_surface_flush (job->surface);
+    }
+
+  /* the job is completed in the main thread even when cancelled, so
+   * that the canvas is released there
+   */
+  g_mutex_lock (&completed_draw_jobs_mutex);
+
+  completed_draw_jobs = g_list_prepend (completed_draw_jobs, job);
+
+  if (completed_draw_jobs_idle == 0)
+    completed_draw_jobs_idle =
+      clutter_threads_add_idle_full (G_PRIORITY_DEFAULT,
+                                     clutter_canvas_complete_draw_jobs,
+                                     NULL,
+                                     NULL);
+
+  g_mutex_unlock (&completed_draw_jobs_mutex);
+}
+
+static void
+clutter_canvas_cancel_draw_job (ClutterCanvas *self)
+{
+  ClutterCanvasPrivate *priv = self->priv;
+
+  if (priv->draw_job == NULL)
+    return;
+
+  CLUTTER_NOTE (MISC, "Cancelling the draw of canvas %p", self);
+
+  g_atomic_int_set (&priv->draw_job->cancelled, TRUE);
+  priv->draw_job = NULL;
+  priv->redraw_pending = FALSE;
+}
+
+static void
+clutter_canvas_start_draw_job (ClutterCanvas *self)
+{
+  ClutterCanvasPrivate *priv = self->priv;
+  ClutterCanvasDrawJob *job;
+
+  g_assert (priv->draw_job == NULL);
+  g_assert (priv->height > 0 && priv->width > 0);
+
+  job = g_slice_new0 (ClutterCanvasDrawJob);
+  job->canvas = g_object_ref (self);
+  job->width = priv->width;
+  job->height = priv->height;
+
+  /* reuse the spare surface if it still has the right size */
+  if (priv->back_surface != NULL &&
+      cairo_image_surface_get_width (priv->back_surface) == job->width &&
+      cairo_image_surface_get_height (priv->back_surface) == job->height)
+    {
+      job->surface = priv->back_surface;
+      priv->back_surface = NULL;
+    }
+  else
+    {
+      g_clear_pointer (&priv->back_surface, cairo_surface_destroy);
+
+      CLUTTER_NOTE (MISC, "Creating Cairo surface with size %d x %d",
+                    job->width, job->height);
+
+      job->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                                 job->width,
+                                                 job->height);
+    }
+
+  priv->draw_job = job;
+
+  if (G_UNLIKELY (draw_thread_pool == NULL))
+    {
+      /* This apparently can't fail if exclusive == FALSE */
+      draw_thread_pool =
+        g_thread_pool_new (clutter_canvas_thread_draw, NULL,
+                           CLAMP (g_get_num_processors (), 1, 4),
+                           FALSE,
+                           NULL);
+    }
+
+  g_thread_pool_push (draw_thread_pool, job, NULL);
+}
+
+static void
+clutter_canvas_invalidate_async (ClutterCanvas *self)
+{
+  ClutterCanvasPrivate *priv = self->priv;
+
+  if (priv->width <= 0 || priv->height <= 0)
+    {
+      clutter_canvas_cancel_draw_job (self);
+
+      if (priv->buffer != NULL)
+        {
+          cogl_object_unref (priv->buffer);
+          priv->buffer = NULL;
+        }
+
+      g_clear_pointer (&priv->front_surface, cairo_surface_destroy);
+      return;
+    }
+
+  if (priv->draw_job != NULL)
+    {
+      /* if the size is the same, let the current draw complete, so that
+       * something new is painted, and draw again after it; otherwise the
+       * current draw is useless
+       */
+      if (priv->draw_job->width == priv->width &&
+          priv->draw_job->height == priv->height)
+        {
+          priv->redraw_pending = TRUE;
+          return;
+        }
+
+      clutter_canvas_cancel_draw_job (self);
+    }
+
+  /* keep painting the current buffer until the new one is ready */
+  clutter_canvas_start_draw_job (self);
+}
+
 static void
 clutter_canvas_invalidate (ClutterContent *content)
 {
   ClutterCanvas *self = CLUTTER_CANVAS (content);
   ClutterCanvasPrivate *priv = self->priv;
 
+  if (priv->draw_async)
+    {
+      clutter_canvas_invalidate_async (self);
+      return;
+    }
+
   if (priv->buffer != NULL)
     {
       cogl_object_unref (priv->buffer);
@@ -562,3 +877,72 @@ clutter_canvas_set_size (ClutterCanvas *canvas,
 
   return clutter_canvas_invalidate_internal (canvas, width, height);
 }
+
+/**
+ * clutter_canvas_set_draw_async:
+ * @canvas: a #ClutterCanvas
+ * @draw_async: whether to draw @canvas in a worker thread
+ *
+ * Sets whether the #ClutterCanvas::draw signal of @canvas should be
+ * emitted from a worker thread.
+ *
+ * When drawing asynchronously, the previous contents of @canvas are
+ * painted until the new ones are ready, and the handlers of the
+ * #ClutterCanvas::draw signal must only use the Cairo context they
+ * are given and data that is safe to access from another thread.
+ */
+void
+clutter_canvas_set_draw_async (ClutterCanvas *canvas,
+                               gboolean       draw_async)
+{
+  ClutterCanvasPrivate *priv;
+  gboolean was_drawing;
+
+  g_return_if_fail (CLUTTER_IS_CANVAS (canvas));
+
+  priv = canvas->priv;
+
+  draw_async = !!draw_async;
+  if (priv->draw_async == draw_async)
+    return;
+
+  priv->draw_async = draw_async;
+
+  if (!priv->draw_async)
+    {
+      was_drawing = priv->draw_job != NULL || priv->front_surface != NULL;
+
+      clutter_canvas_cancel_draw_job (canvas);
+      g_clear_pointer (&priv->back_surface, cairo_surface_destroy);
+
+      /* the current buffer points to the data of the front surface;
+       * draw it again synchronously, into a buffer of its own
+       */
+      if (priv->front_surface != NULL)
+        {
+          g_clear_pointer (&priv->buffer, cogl_object_unref);
+          g_clear_pointer (&priv->front_surface, cairo_surface_destroy);
+        }
+
+      if (was_drawing)
+        clutter_content_invalidate (CLUTTER_CONTENT (canvas));
+    }
+
+  g_object_notify_by_pspec (G_OBJECT (canvas), obj_props[PROP_DRAW_ASYNC]);
+}
+
+/**
+ * clutter_canvas_get_draw_async:
+ * @canvas: a #ClutterCanvas
+ *
+ * Retrieves whether @canvas is drawn in a worker thread.
+ *
+ * Return value: %TRUE if @canvas is drawn asynchronously
+ */
+gboolean
+clutter_canvas_get_draw_async (ClutterCanvas *canvas)
+{
+  g_return_val_if_fail (CLUTTER_IS_CANVAS (canvas), FALSE);
+
+  return canvas->priv->draw_async;
+}
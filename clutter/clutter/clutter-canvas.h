@@ -101,6 +101,12 @@ void                    clutter_canvas_set_scale_factor         (ClutterCanvas *
 CLUTTER_AVAILABLE_IN_1_18
 int                     clutter_canvas_get_scale_factor         (ClutterCanvas *canvas);
 
+CLUTTER_AVAILABLE_IN_MUTTER
+void                    clutter_canvas_set_draw_async           (ClutterCanvas *canvas,
+                                                                 gboolean       draw_async);
+CLUTTER_AVAILABLE_IN_MUTTER
+gboolean                clutter_canvas_get_draw_async           (ClutterCanvas *canvas);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_CANVAS_H__ */
@@ -34,6 +34,14 @@
  * the presence of support for FBOs in the underlying GL or GLES
  * implementation.
  *
+ * By default, the clone paints its source every time it is painted. When
+ * many clones of complex actors are visible at the same time, like window
+ * previews in an overview, the #ClutterClone:use-snapshot property can be
+ * set: the clone will then render its source once into a texture, scaled
+ * down to the size of the clone, and paint that texture until the source
+ * queues a redraw. Only a few snapshots are updated during each frame;
+ * the others keep showing their previous contents until the next one.
+ *
  * #ClutterClone is available since Clutter 1.0
  */
 
@@ -41,20 +49,39 @@
 #include "clutter-build-config.h"
 #endif
 
+#include <math.h>
+
 #define CLUTTER_ENABLE_EXPERIMENTAL_API
 #include "clutter-actor-private.h"
+#include "clutter-backend.h"
 #include "clutter-clone.h"
 #include "clutter-debug.h"
 #include "clutter-main.h"
+#include "clutter-offscreen-pool.h"
 #include "clutter-paint-volume-private.h"
 #include "clutter-private.h"
 
 #include "cogl/cogl.h"
 
+/* the maximum number of snapshots updated during a single frame */
+#define MAX_SNAPSHOT_UPDATES_PER_FRAME  4
+
 struct _ClutterClonePrivate
 {
   ClutterActor *clone_source;
   gulong source_destroy_id;
+  gulong source_redraw_id;
+
+  CoglTexture *snapshot_texture;
+  CoglOffscreen *snapshot_offscreen;
+  CoglPipeline *snapshot_pipeline;
+
+  /* the area of the source covered by the snapshot */
+  ClutterActorBox snapshot_box;
+
+  guint use_snapshot   : 1;
+  guint snapshot_dirty : 1;
+  guint in_snapshot    : 1;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (ClutterClone, clutter_clone, CLUTTER_TYPE_ACTOR)
@@ -64,12 +91,18 @@ enum
   PROP_0,
 
   PROP_SOURCE,
+  PROP_USE_SNAPSHOT,
 
   PROP_LAST
 };
 
 static GParamSpec *obj_props[PROP_LAST];
 
+/* the clones whose snapshot update was deferred to the next frame */
+static GList *deferred_snapshots = NULL;
+static guint n_snapshot_updates = 0;
+static guint snapshot_repaint_id = 0;
+
 static void clutter_clone_set_source_internal (ClutterClone *clone,
 					       ClutterActor *source);
 static void
@@ -154,18 +187,12 @@ clutter_clone_apply_transform (ClutterActor *self, CoglMatrix *matrix)
 }
 
 static void
-clutter_clone_paint (ClutterActor *actor)
+clutter_clone_paint_source (ClutterClone *self,
+                            guint8        opacity)
 {
-  ClutterClone *self = CLUTTER_CLONE (actor);
   ClutterClonePrivate *priv = self->priv;
   gboolean was_unmapped = FALSE;
 
-  if (priv->clone_source == NULL)
-    return;
-
-  CLUTTER_NOTE (PAINT, "painting clone actor '%s'",
-                _clutter_actor_get_debug_name (actor));
-
   /* The final bits of magic:
    * - We need to override the paint opacity of the actor with our own
    *   opacity.
@@ -175,8 +202,7 @@ clutter_clone_paint (ClutterActor *actor)
    *   the clone source actor.
    */
   _clutter_actor_set_in_clone_paint (priv->clone_source, TRUE);
-  clutter_actor_set_opacity_override (priv->clone_source,
-                                       clutter_actor_get_paint_opacity (actor));
+  clutter_actor_set_opacity_override (priv->clone_source, opacity);
   _clutter_actor_set_enable_model_view_transform (priv->clone_source, FALSE);
 
   if (!clutter_actor_is_mapped (priv->clone_source))
@@ -203,6 +229,244 @@ clutter_clone_paint (ClutterActor *actor)
   _clutter_actor_set_in_clone_paint (priv->clone_source, FALSE);
 }
 
+static void
+clutter_clone_release_snapshot (ClutterClone *self)
+{
+  ClutterClonePrivate *priv = self->priv;
+
+  if (priv->snapshot_texture != NULL)
+    {
+      _clutter_offscreen_pool_release (_clutter_offscreen_pool_get_default (),
+                                       priv->snapshot_texture,
+                                       priv->snapshot_offscreen);
+      priv->snapshot_texture = NULL;
+      priv->snapshot_offscreen = NULL;
+    }
+
+  if (priv->snapshot_pipeline != NULL)
+    {
+      cogl_object_unref (priv->snapshot_pipeline);
+      priv->snapshot_pipeline = NULL;
+    }
+
+  deferred_snapshots = g_list_remove (deferred_snapshots, self);
+
+  priv->snapshot_dirty = TRUE;
+}
+
+static gboolean
+clutter_clone_snapshot_repaint_func (gpointer user_data)
+{
+  GList *deferred = deferred_snapshots;
+  GList *l;
+
+  /* a new frame, a new budget */
+  n_snapshot_updates = 0;
+
+  deferred_snapshots = NULL;
+
+  for (l = deferred; l != NULL; l = l->next)
+    clutter_actor_queue_redraw (l->data);
+
+  g_list_free (deferred);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+clutter_clone_defer_snapshot (ClutterClone *self)
+{
+  if (g_list_find (deferred_snapshots, self) == NULL)
+    deferred_snapshots = g_list_prepend (deferred_snapshots, self);
+}
+
+static gboolean
+clutter_clone_update_snapshot (ClutterClone *self)
+{
+  ClutterClonePrivate *priv = self->priv;
+  ClutterActor *actor = CLUTTER_ACTOR (self);
+  const ClutterPaintVolume *volume;
+  CoglFramebuffer *framebuffer;
+  ClutterActorBox box, source_box;
+  ClutterVertex origin;
+  float x_scale, y_scale;
+  int width, height;
+
+  if (!clutter_actor_is_realized (priv->clone_source))
+    return FALSE;
+
+  /* the snapshot covers the paint volume of the source, so that things
+   * like shadows are not cut out; if there isn't one, we fall back to
+   * the allocation of the source
+   */
+  clutter_actor_get_allocation_box (priv->clone_source, &source_box);
+  volume = clutter_actor_get_paint_volume (priv->clone_source);
+  if (volume != NULL)
+    {
+      clutter_paint_volume_get_origin (volume, &origin);
+      priv->snapshot_box.x1 = origin.x;
+      priv->snapshot_box.y1 = origin.y;
+      priv->snapshot_box.x2 = origin.x + clutter_paint_volume_get_width (volume);
+      priv->snapshot_box.y2 = origin.y + clutter_paint_volume_get_height (volume);
+    }
+  else
+    {
+      priv->snapshot_box.x1 = 0.f;
+      priv->snapshot_box.y1 = 0.f;
+      priv->snapshot_box.x2 = clutter_actor_box_get_width (&source_box);
+      priv->snapshot_box.y2 = clutter_actor_box_get_height (&source_box);
+    }
+
+  if (clutter_actor_box_get_area (&priv->snapshot_box) <= 0.f)
+    return FALSE;
+
+  /* render the source at the size of the clone, but never upscale it */
+  clutter_actor_get_allocation_box (actor, &box);
+  x_scale = y_scale = 1.f;
+  if (clutter_actor_box_get_width (&source_box) > 0.f)
+    x_scale = clutter_actor_box_get_width (&box)
+            / clutter_actor_box_get_width (&source_box);
+  if (clutter_actor_box_get_height (&source_box) > 0.f)
+    y_scale = clutter_actor_box_get_height (&box)
+            / clutter_actor_box_get_height (&source_box);
+
+  x_scale = CLAMP (x_scale, 0.f, 1.f);
+  y_scale = CLAMP (y_scale, 0.f, 1.f);
+
+  width = MAX (1, (int) ceilf (clutter_actor_box_get_width (&priv->snapshot_box) * x_scale));
+  height = MAX (1, (int) ceilf (clutter_actor_box_get_height (&priv->snapshot_box) * y_scale));
+
+  if (priv->snapshot_texture != NULL &&
+      (cogl_texture_get_width (priv->snapshot_texture) != width ||
+       cogl_texture_get_height (priv->snapshot_texture) != height))
+    clutter_clone_release_snapshot (self);
+
+  if (priv->snapshot_texture == NULL)
+    {
+      CoglContext *ctx =
+        clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+      if (!_clutter_offscreen_pool_acquire (_clutter_offscreen_pool_get_default (),
+                                            width, height,
+                                            &priv->snapshot_texture,
+                                            &priv->snapshot_offscreen))
+        return FALSE;
+
+      priv->snapshot_pipeline = cogl_pipeline_new (ctx);
+      cogl_pipeline_set_layer_texture (priv->snapshot_pipeline, 0,
+                                       priv->snapshot_texture);
+      cogl_pipeline_set_layer_filters (priv->snapshot_pipeline, 0,
+                                       COGL_PIPELINE_FILTER_LINEAR,
+                                       COGL_PIPELINE_FILTER_LINEAR);
+    }
+
+  CLUTTER_NOTE (PAINT, "updating the %dx%d snapshot of clone actor '%s'",
+                width, height,
+                _clutter_actor_get_debug_name (actor));
+
+  framebuffer = COGL_FRAMEBUFFER (priv->snapshot_offscreen);
+
+  cogl_push_framebuffer (framebuffer);
+
+  cogl_framebuffer_identity_matrix (framebuffer);
+  cogl_framebuffer_orthographic (framebuffer,
+                                 priv->snapshot_box.x1,
+                                 priv->snapshot_box.y1,
+                                 priv->snapshot_box.x2,
+                                 priv->snapshot_box.y2,
+                                 -1000, 1000);
+  cogl_framebuffer_clear4f (framebuffer, COGL_BUFFER_BIT_COLOR, 0, 0, 0, 0);
+
+  /* the opacity of the clone is applied when painting the snapshot, so
+   * that changing it does not require rendering the source again
+   */
+  priv->in_snapshot = TRUE;
+  clutter_clone_paint_source (self, 255);
+  priv->in_snapshot = FALSE;
+
+  cogl_pop_framebuffer ();
+
+  priv->snapshot_dirty = FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+clutter_clone_paint_snapshot (ClutterClone *self)
+{
+  ClutterClonePrivate *priv = self->priv;
+  CoglFramebuffer *framebuffer;
+  guint8 paint_opacity;
+
+  if (priv->snapshot_dirty || priv->snapshot_texture == NULL)
+    {
+      if (n_snapshot_updates >= MAX_SNAPSHOT_UPDATES_PER_FRAME)
+        {
+          /* keep showing the previous contents, if we have any, and
+           * try again during the next frame
+           */
+          clutter_clone_defer_snapshot (self);
+
+          if (priv->snapshot_texture == NULL)
+            return FALSE;
+        }
+      else
+        {
+          n_snapshot_updates += 1;
+
+          if (!clutter_clone_update_snapshot (self))
+            return FALSE;
+        }
+    }
+
+  paint_opacity = clutter_actor_get_paint_opacity (CLUTTER_ACTOR (self));
+
+  cogl_pipeline_set_color4ub (priv->snapshot_pipeline,
+                              paint_opacity,
+                              paint_opacity,
+                              paint_opacity,
+                              paint_opacity);
+
+  framebuffer = cogl_get_draw_framebuffer ();
+  cogl_framebuffer_draw_textured_rectangle (framebuffer,
+                                            priv->snapshot_pipeline,
+                                            priv->snapshot_box.x1,
+                                            priv->snapshot_box.y1,
+                                            priv->snapshot_box.x2,
+                                            priv->snapshot_box.y2,
+                                            0.0, 0.0,
+                                            1.0, 1.0);
+
+  return TRUE;
+}
+
+static void
+clutter_clone_paint (ClutterActor *actor)
+{
+  ClutterClone *self = CLUTTER_CLONE (actor);
+  ClutterClonePrivate *priv = self->priv;
+
+  if (priv->clone_source == NULL)
+    return;
+
+  CLUTTER_NOTE (PAINT, "painting clone actor '%s'",
+                _clutter_actor_get_debug_name (actor));
+
+  if (priv->use_snapshot && clutter_clone_paint_snapshot (self))
+    return;
+
+  clutter_clone_paint_source (self, clutter_actor_get_paint_opacity (actor));
+}
+
+static void
+clutter_clone_unmap (ClutterActor *actor)
+{
+  CLUTTER_ACTOR_CLASS (clutter_clone_parent_class)->unmap (actor);
+
+  /* give the snapshot back while the clone cannot be seen */
+  clutter_clone_release_snapshot (CLUTTER_CLONE (actor));
+}
+
 static gboolean
 clutter_clone_get_paint_volume (ClutterActor       *actor,
                                 ClutterPaintVolume *volume)
@@ -246,11 +510,19 @@ clutter_clone_allocate (ClutterActor           *self,
 {
   ClutterClonePrivate *priv = CLUTTER_CLONE (self)->priv;
   ClutterActorClass *parent_class;
+  float old_width, old_height;
+
+  clutter_actor_get_size (self, &old_width, &old_height);
 
   /* chain up */
   parent_class = CLUTTER_ACTOR_CLASS (clutter_clone_parent_class);
   parent_class->allocate (self, box, flags);
 
+  /* the resolution of the snapshot depends on our size */
+  if (old_width != clutter_actor_box_get_width (box) ||
+      old_height != clutter_actor_box_get_height (box))
+    priv->snapshot_dirty = TRUE;
+
   if (priv->clone_source == NULL)
     return;
 
@@ -285,6 +557,10 @@ clutter_clone_set_property (GObject      *gobject,
       clutter_clone_set_source (self, g_value_get_object (value));
       break;
 
+    case PROP_USE_SNAPSHOT:
+      clutter_clone_set_use_snapshot (self, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
       break;
@@ -305,6 +581,10 @@ clutter_clone_get_property (GObject    *gobject,
       g_value_set_object (value, priv->clone_source);
       break;
 
+    case PROP_USE_SNAPSHOT:
+      g_value_set_boolean (value, priv->use_snapshot);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
       break;
@@ -315,6 +595,7 @@ static void
 clutter_clone_dispose (GObject *gobject)
 {
   clutter_clone_set_source_internal (CLUTTER_CLONE (gobject), NULL);
+  clutter_clone_release_snapshot (CLUTTER_CLONE (gobject));
 
   G_OBJECT_CLASS (clutter_clone_parent_class)->dispose (gobject);
 }
@@ -332,6 +613,7 @@ clutter_clone_class_init (ClutterCloneClass *klass)
   actor_class->get_preferred_height = clutter_clone_get_preferred_height;
   actor_class->allocate = clutter_clone_allocate;
   actor_class->has_overlaps = clutter_clone_has_overlaps;
+  actor_class->unmap = clutter_clone_unmap;
 
   gobject_class->dispose = clutter_clone_dispose;
   gobject_class->set_property = clutter_clone_set_property;
@@ -352,6 +634,20 @@ clutter_clone_class_init (ClutterCloneClass *klass)
                          G_PARAM_CONSTRUCT |
                          CLUTTER_PARAM_READWRITE);
 
+  /**
+   * ClutterClone:use-snapshot:
+   *
+   * Whether the clone should paint a cached snapshot of the source,
+   * updated only when the source queues a redraw, instead of painting
+   * the source directly.
+   */
+  obj_props[PROP_USE_SNAPSHOT] =
+    g_param_spec_boolean ("use-snapshot",
+                          P_("Use Snapshot"),
+                          P_("Whether to paint a cached snapshot of the source"),
+                          FALSE,
+                          CLUTTER_PARAM_READWRITE);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, obj_props);
 }
 
@@ -359,6 +655,7 @@ static void
 clutter_clone_init (ClutterClone *self)
 {
   self->priv = clutter_clone_get_instance_private (self);
+  self->priv->snapshot_dirty = TRUE;
 }
 
 /**
@@ -384,6 +681,20 @@ on_source_destroyed (ClutterActor *source,
   clutter_clone_set_source_internal (self, NULL);
 }
 
+static void
+on_source_queue_redraw (ClutterActor *source,
+                        ClutterActor *origin,
+                        ClutterClone *self)
+{
+  ClutterClonePrivate *priv = self->priv;
+
+  /* painting the source into the snapshot must not invalidate it */
+  if (priv->in_snapshot)
+    return;
+
+  priv->snapshot_dirty = TRUE;
+}
+
 static void
 clutter_clone_set_source_internal (ClutterClone *self,
 				   ClutterActor *source)
@@ -397,6 +708,12 @@ clutter_clone_set_source_internal (ClutterClone *self,
     {
       g_signal_handler_disconnect (priv->clone_source, priv->source_destroy_id);
       priv->source_destroy_id = 0;
+      if (priv->source_redraw_id != 0)
+        {
+          g_signal_handler_disconnect (priv->clone_source,
+                                       priv->source_redraw_id);
+          priv->source_redraw_id = 0;
+        }
       _clutter_actor_detach_clone (priv->clone_source, CLUTTER_ACTOR (self));
       g_object_unref (priv->clone_source);
       priv->clone_source = NULL;
@@ -408,8 +725,14 @@ clutter_clone_set_source_internal (ClutterClone *self,
       _clutter_actor_attach_clone (priv->clone_source, CLUTTER_ACTOR (self));
       priv->source_destroy_id = g_signal_connect (priv->clone_source, "destroy",
                                                   G_CALLBACK (on_source_destroyed), self);
+      if (priv->use_snapshot)
+        priv->source_redraw_id =
+          g_signal_connect (priv->clone_source, "queue-redraw",
+                            G_CALLBACK (on_source_queue_redraw), self);
     }
 
+  priv->snapshot_dirty = TRUE;
+
   g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_SOURCE]);
 
   clutter_actor_queue_relayout (CLUTTER_ACTOR (self));
@@ -452,3 +775,79 @@ clutter_clone_get_source (ClutterClone *self)
 
   return self->priv->clone_source;
 }
+
+/**
+ * clutter_clone_set_use_snapshot:
+ * @self: a #ClutterClone
+ * @use_snapshot: whether to paint a snapshot of the source
+ *
+ * Sets whether @self should render its source into a texture, scaled
+ * down to the size of @self, and paint that texture until the source
+ * queues a redraw, instead of painting the source every time.
+ *
+ * This is useful when many clones of complex actors are visible at
+ * the same time, at the cost of the memory used by the snapshots and
+ * of the snapshots lagging behind their sources by a few frames when
+ * many of them need to be updated at once.
+ */
+void
+clutter_clone_set_use_snapshot (ClutterClone *self,
+                                gboolean      use_snapshot)
+{
+  ClutterClonePrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_CLONE (self));
+
+  priv = self->priv;
+
+  use_snapshot = !!use_snapshot;
+  if (priv->use_snapshot == use_snapshot)
+    return;
+
+  priv->use_snapshot = use_snapshot;
+
+  if (priv->use_snapshot)
+    {
+      if (snapshot_repaint_id == 0)
+        snapshot_repaint_id =
+          clutter_threads_add_repaint_func_full (CLUTTER_REPAINT_FLAGS_POST_PAINT,
+                                                 clutter_clone_snapshot_repaint_func,
+                                                 NULL, NULL);
+
+      if (priv->clone_source != NULL)
+        priv->source_redraw_id =
+          g_signal_connect (priv->clone_source, "queue-redraw",
+                            G_CALLBACK (on_source_queue_redraw), self);
+    }
+  else
+    {
+      if (priv->source_redraw_id != 0)
+        {
+          g_signal_handler_disconnect (priv->clone_source,
+                                       priv->source_redraw_id);
+          priv->source_redraw_id = 0;
+        }
+
+      clutter_clone_release_snapshot (self);
+    }
+
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (self));
+
+  g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_USE_SNAPSHOT]);
+}
+
+/**
+ * clutter_clone_get_use_snapshot:
+ * @self: a #ClutterClone
+ *
+ * Retrieves whether @self paints a snapshot of its source.
+ *
+ * Return value: %TRUE if the clone paints a snapshot of its source
+ */
+gboolean
+clutter_clone_get_use_snapshot (ClutterClone *self)
+{
+  g_return_val_if_fail (CLUTTER_IS_CLONE (self), FALSE);
+
+  return self->priv->use_snapshot;
+}
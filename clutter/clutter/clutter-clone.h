@@ -89,6 +89,12 @@ void            clutter_clone_set_source        (ClutterClone *self,
 CLUTTER_AVAILABLE_IN_1_0
 ClutterActor *  clutter_clone_get_source        (ClutterClone *self);
 
+CLUTTER_AVAILABLE_IN_MUTTER
+void            clutter_clone_set_use_snapshot  (ClutterClone *self,
+                                                 gboolean      use_snapshot);
+CLUTTER_AVAILABLE_IN_MUTTER
+gboolean        clutter_clone_get_use_snapshot  (ClutterClone *self);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_CLONE_H__ */
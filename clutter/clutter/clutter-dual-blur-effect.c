@@ -0,0 +1,681 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SECTION:clutter-dual-blur-effect
+ * @short_description: A blur effect for large radii
+ * @see_also: #ClutterBlurEffect, #ClutterOffscreenEffect
+ *
+ * #ClutterDualBlurEffect is a sub-class of #ClutterOffscreenEffect that
+ * blurs an actor and its contents using the "dual filter" technique:
+ * the offscreen image of the actor is progressively downsampled into a
+ * chain of smaller render targets, and then upsampled back, applying a
+ * small Kawase-style filter at each step.
+ *
+ * Since most of the passes happen at a fraction of the resolution of
+ * the actor, large blur radii are much cheaper than stacking multiple
+ * #ClutterBlurEffect instances. The blurred result is kept until the
+ * actor is redrawn or the radius changes, so painting a static blurred
+ * actor only costs a single textured quad.
+ */
+
+#define CLUTTER_DUAL_BLUR_EFFECT_CLASS(klass)   (G_TYPE_CHECK_CLASS_CAST ((klass), CLUTTER_TYPE_DUAL_BLUR_EFFECT, ClutterDualBlurEffectClass))
+#define CLUTTER_IS_DUAL_BLUR_EFFECT_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), CLUTTER_TYPE_DUAL_BLUR_EFFECT))
+#define CLUTTER_DUAL_BLUR_EFFECT_GET_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS ((obj), CLUTTER_TYPE_DUAL_BLUR_EFFECT, ClutterDualBlurEffectClass))
+
+#ifdef HAVE_CONFIG_H
+#include "clutter-build-config.h"
+#endif
+
+#include <math.h>
+
+#include "clutter-dual-blur-effect.h"
+
+#include "cogl/cogl.h"
+
+#include "clutter-debug.h"
+#include "clutter-offscreen-effect.h"
+#include "clutter-offscreen-pool.h"
+#include "clutter-private.h"
+
+/* the maximum number of downsampling steps */
+#define MAX_LEVELS      6
+
+#define MAX_RADIUS      256.0f
+
+static const gchar *dual_blur_glsl_declarations =
+"uniform vec2 half_pixel;\n";
+
+static const gchar *downsample_glsl_shader =
+"  vec2 uv = cogl_tex_coord.st;\n"
+"  cogl_texel = texture2D (cogl_sampler, uv) * 4.0;\n"
+"  cogl_texel += texture2D (cogl_sampler, uv - half_pixel);\n"
+"  cogl_texel += texture2D (cogl_sampler, uv + half_pixel);\n"
+"  cogl_texel += texture2D (cogl_sampler, uv + vec2 (half_pixel.x, -half_pixel.y));\n"
+"  cogl_texel += texture2D (cogl_sampler, uv - vec2 (half_pixel.x, -half_pixel.y));\n"
+"  cogl_texel /= 8.0;\n";
+
+static const gchar *upsample_glsl_shader =
+"  vec2 uv = cogl_tex_coord.st;\n"
+"  cogl_texel = texture2D (cogl_sampler, uv + vec2 (-half_pixel.x * 2.0, 0.0));\n"
+"  cogl_texel += texture2D (cogl_sampler, uv + vec2 (-half_pixel.x, half_pixel.y)) * 2.0;\n"
+"  cogl_texel += texture2D (cogl_sampler, uv + vec2 (0.0, half_pixel.y * 2.0));\n"
+"  cogl_texel += texture2D (cogl_sampler, uv + vec2 (half_pixel.x, half_pixel.y)) * 2.0;\n"
+"  cogl_texel += texture2D (cogl_sampler, uv + vec2 (half_pixel.x * 2.0, 0.0));\n"
+"  cogl_texel += texture2D (cogl_sampler, uv + vec2 (half_pixel.x, -half_pixel.y)) * 2.0;\n"
+"  cogl_texel += texture2D (cogl_sampler, uv + vec2 (0.0, -half_pixel.y * 2.0));\n"
+"  cogl_texel += texture2D (cogl_sampler, uv + vec2 (-half_pixel.x, -half_pixel.y)) * 2.0;\n"
+"  cogl_texel /= 12.0;\n";
+
+typedef struct _BlurLevel
+{
+  CoglTexture *texture;
+  CoglOffscreen *offscreen;
+
+  int width;
+  int height;
+} BlurLevel;
+
+struct _ClutterDualBlurEffect
+{
+  ClutterOffscreenEffect parent_instance;
+
+  /* a back pointer to our actor, so that we can query it */
+  ClutterActor *actor;
+
+  float radius;
+
+  gint tex_width;
+  gint tex_height;
+
+  /* the number of levels used for the current radius, and
+   * the sampling offset applied at each level
+   */
+  int n_levels;
+  float offset;
+
+  /* level 0 is the offscreen texture of the actor */
+  BlurLevel levels[MAX_LEVELS + 1];
+
+  CoglPipeline *downsample_pipeline;
+  gint downsample_uniform;
+
+  CoglPipeline *upsample_pipeline;
+  gint upsample_uniform;
+
+  CoglPipeline *pipeline;
+  gint pipeline_uniform;
+
+  guint blur_dirty : 1;
+};
+
+struct _ClutterDualBlurEffectClass
+{
+  ClutterOffscreenEffectClass parent_class;
+
+  CoglPipeline *base_downsample_pipeline;
+  CoglPipeline *base_upsample_pipeline;
+};
+
+enum
+{
+  PROP_0,
+
+  PROP_RADIUS,
+
+  PROP_LAST
+};
+
+static GParamSpec *obj_props[PROP_LAST];
+
+G_DEFINE_TYPE (ClutterDualBlurEffect,
+               clutter_dual_blur_effect,
+               CLUTTER_TYPE_OFFSCREEN_EFFECT);
+
+static int
+get_padding (ClutterDualBlurEffect *self)
+{
+  return (int) ceilf (self->radius * 2.0f);
+}
+
+static void
+release_levels (ClutterDualBlurEffect *self)
+{
+  ClutterOffscreenPool *pool = _clutter_offscreen_pool_get_default ();
+  int i;
+
+  for (i = 1; i <= MAX_LEVELS; i++)
+    {
+      BlurLevel *level = &self->levels[i];
+
+      if (level->texture == NULL)
+        continue;
+
+      _clutter_offscreen_pool_release (pool, level->texture, level->offscreen);
+
+      level->texture = NULL;
+      level->offscreen = NULL;
+      level->width = 0;
+      level->height = 0;
+    }
+
+  self->blur_dirty = TRUE;
+}
+
+static gboolean
+ensure_levels (ClutterDualBlurEffect *self)
+{
+  ClutterOffscreenPool *pool = _clutter_offscreen_pool_get_default ();
+  int i;
+
+  for (i = 1; i <= MAX_LEVELS; i++)
+    {
+      BlurLevel *level = &self->levels[i];
+      int width = MAX (self->tex_width >> i, 1);
+      int height = MAX (self->tex_height >> i, 1);
+
+      /* release the levels we don't need anymore, as well as the
+       * ones with the wrong size
+       */
+      if (level->texture != NULL &&
+          (i > self->n_levels ||
+           level->width != width ||
+           level->height != height))
+        {
+          _clutter_offscreen_pool_release (pool,
+                                           level->texture,
+                                           level->offscreen);
+          level->texture = NULL;
+          level->offscreen = NULL;
+        }
+
+      if (i > self->n_levels || level->texture != NULL)
+        continue;
+
+      if (!_clutter_offscreen_pool_acquire (pool, width, height,
+                                            &level->texture,
+                                            &level->offscreen))
+        return FALSE;
+
+      level->width = width;
+      level->height = height;
+    }
+
+  return TRUE;
+}
+
+static void
+update_n_levels (ClutterDualBlurEffect *self)
+{
+  int n_levels = 1;
+
+  /* each level doubles the size of the kernel; the remainder is
+   * covered by increasing the sampling offset, between 1 and 2
+   */
+  while (n_levels < MAX_LEVELS && (1 << (n_levels + 1)) <= self->radius)
+    n_levels += 1;
+
+  self->n_levels = n_levels;
+  self->offset = MAX (self->radius / (1 << n_levels), 1.0f);
+}
+
+static void
+set_half_pixel (CoglPipeline *pipeline,
+                gint          uniform,
+                CoglTexture  *source,
+                float         offset)
+{
+  float half_pixel[2];
+
+  if (uniform < 0)
+    return;
+
+  half_pixel[0] = offset * 0.5f / cogl_texture_get_width (source);
+  half_pixel[1] = offset * 0.5f / cogl_texture_get_height (source);
+
+  cogl_pipeline_set_uniform_float (pipeline, uniform,
+                                   2, /* n_components */
+                                   1, /* count */
+                                   half_pixel);
+}
+
+static void
+blur_pass (CoglPipeline *pipeline,
+           gint          uniform,
+           CoglTexture  *source,
+           BlurLevel    *target,
+           float         offset)
+{
+  CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (target->offscreen);
+
+  cogl_pipeline_set_layer_texture (pipeline, 0, source);
+  set_half_pixel (pipeline, uniform, source, offset);
+
+  cogl_framebuffer_identity_matrix (framebuffer);
+  cogl_framebuffer_orthographic (framebuffer,
+                                 0, 0,
+                                 target->width, target->height,
+                                 -1, 100);
+  cogl_framebuffer_clear4f (framebuffer, COGL_BUFFER_BIT_COLOR, 0, 0, 0, 0);
+  cogl_framebuffer_draw_textured_rectangle (framebuffer, pipeline,
+                                            0, 0,
+                                            target->width, target->height,
+                                            0.0, 0.0,
+                                            1.0, 1.0);
+}
+
+static gboolean
+update_blur (ClutterDualBlurEffect *self,
+             CoglTexture           *source)
+{
+  int i;
+
+  if (!ensure_levels (self))
+    return FALSE;
+
+  self->levels[0].texture = source;
+
+  /* downsample the actor through the chain... */
+  for (i = 1; i <= self->n_levels; i++)
+    blur_pass (self->downsample_pipeline,
+               self->downsample_uniform,
+               self->levels[i - 1].texture,
+               &self->levels[i],
+               self->offset);
+
+  /* ...and upsample it back, up to the first level; the last pass
+   * is done when painting the target
+   */
+  for (i = self->n_levels - 1; i >= 1; i--)
+    blur_pass (self->upsample_pipeline,
+               self->upsample_uniform,
+               self->levels[i + 1].texture,
+               &self->levels[i],
+               self->offset);
+
+  self->levels[0].texture = NULL;
+
+  cogl_pipeline_set_layer_texture (self->pipeline, 0, self->levels[1].texture);
+  set_half_pixel (self->pipeline, self->pipeline_uniform,
+                  self->levels[1].texture,
+                  self->offset);
+
+  self->blur_dirty = FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+clutter_dual_blur_effect_pre_paint (ClutterEffect *effect)
+{
+  ClutterDualBlurEffect *self = CLUTTER_DUAL_BLUR_EFFECT (effect);
+  ClutterEffectClass *parent_class;
+
+  if (!clutter_actor_meta_get_enabled (CLUTTER_ACTOR_META (effect)))
+    return FALSE;
+
+  self->actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect));
+  if (self->actor == NULL)
+    return FALSE;
+
+  if (!clutter_feature_available (CLUTTER_FEATURE_SHADERS_GLSL))
+    {
+      /* if we don't have support for GLSL shaders then we
+       * forcibly disable the ActorMeta
+       */
+      g_warning ("Unable to use the DualBlurEffect: the graphics hardware "
+                 "or the current GL driver does not implement support "
+                 "for the GLSL shading language.");
+      clutter_actor_meta_set_enabled (CLUTTER_ACTOR_META (effect), FALSE);
+      return FALSE;
+    }
+
+  parent_class = CLUTTER_EFFECT_CLASS (clutter_dual_blur_effect_parent_class);
+  if (parent_class->pre_paint (effect))
+    {
+      ClutterOffscreenEffect *offscreen_effect =
+        CLUTTER_OFFSCREEN_EFFECT (effect);
+      CoglHandle texture;
+
+      texture = clutter_offscreen_effect_get_texture (offscreen_effect);
+      self->tex_width = cogl_texture_get_width (texture);
+      self->tex_height = cogl_texture_get_height (texture);
+
+      /* the actor is being redrawn, so the blurred image is stale */
+      self->blur_dirty = TRUE;
+
+      return TRUE;
+    }
+  else
+    return FALSE;
+}
+
+static void
+clutter_dual_blur_effect_paint_target (ClutterOffscreenEffect *effect)
+{
+  ClutterDualBlurEffect *self = CLUTTER_DUAL_BLUR_EFFECT (effect);
+  ClutterOffscreenEffectClass *parent_class;
+  guint8 paint_opacity;
+
+  parent_class =
+    CLUTTER_OFFSCREEN_EFFECT_CLASS (clutter_dual_blur_effect_parent_class);
+
+  if (self->radius <= 0.f)
+    {
+      parent_class->paint_target (effect);
+      return;
+    }
+
+  if (self->blur_dirty)
+    {
+      CoglHandle texture = clutter_offscreen_effect_get_texture (effect);
+
+      if (texture == NULL || !update_blur (self, texture))
+        {
+          parent_class->paint_target (effect);
+          return;
+        }
+    }
+
+  paint_opacity = clutter_actor_get_paint_opacity (self->actor);
+
+  cogl_pipeline_set_color4ub (self->pipeline,
+                              paint_opacity,
+                              paint_opacity,
+                              paint_opacity,
+                              paint_opacity);
+  cogl_push_source (self->pipeline);
+
+  /* the last upsampling pass goes straight to the screen */
+  cogl_rectangle (0, 0, self->tex_width, self->tex_height);
+
+  cogl_pop_source ();
+}
+
+static gboolean
+clutter_dual_blur_effect_get_paint_volume (ClutterEffect      *effect,
+                                           ClutterPaintVolume *volume)
+{
+  ClutterDualBlurEffect *self = CLUTTER_DUAL_BLUR_EFFECT (effect);
+  gfloat cur_width, cur_height;
+  ClutterVertex origin;
+  int padding;
+
+  padding = get_padding (self);
+
+  clutter_paint_volume_get_origin (volume, &origin);
+  cur_width = clutter_paint_volume_get_width (volume);
+  cur_height = clutter_paint_volume_get_height (volume);
+
+  origin.x -= padding;
+  origin.y -= padding;
+  cur_width += 2 * padding;
+  cur_height += 2 * padding;
+  clutter_paint_volume_set_origin (volume, &origin);
+  clutter_paint_volume_set_width (volume, cur_width);
+  clutter_paint_volume_set_height (volume, cur_height);
+
+  return TRUE;
+}
+
+static void
+clutter_dual_blur_effect_set_actor (ClutterActorMeta *meta,
+                                    ClutterActor     *actor)
+{
+  ClutterDualBlurEffect *self = CLUTTER_DUAL_BLUR_EFFECT (meta);
+  ClutterActorMetaClass *meta_class;
+
+  meta_class = CLUTTER_ACTOR_META_CLASS (clutter_dual_blur_effect_parent_class);
+  meta_class->set_actor (meta, actor);
+
+  release_levels (self);
+}
+
+static void
+clutter_dual_blur_effect_dispose (GObject *gobject)
+{
+  ClutterDualBlurEffect *self = CLUTTER_DUAL_BLUR_EFFECT (gobject);
+
+  release_levels (self);
+
+  g_clear_pointer (&self->downsample_pipeline, cogl_object_unref);
+  g_clear_pointer (&self->upsample_pipeline, cogl_object_unref);
+  g_clear_pointer (&self->pipeline, cogl_object_unref);
+
+  G_OBJECT_CLASS (clutter_dual_blur_effect_parent_class)->dispose (gobject);
+}
+
+static void
+clutter_dual_blur_effect_set_property (GObject      *gobject,
+                                       guint         prop_id,
+                                       const GValue *value,
+                                       GParamSpec   *pspec)
+{
+  ClutterDualBlurEffect *self = CLUTTER_DUAL_BLUR_EFFECT (gobject);
+
+  switch (prop_id)
+    {
+    case PROP_RADIUS:
+      clutter_dual_blur_effect_set_radius (self, g_value_get_float (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+clutter_dual_blur_effect_get_property (GObject    *gobject,
+                                       guint       prop_id,
+                                       GValue     *value,
+                                       GParamSpec *pspec)
+{
+  ClutterDualBlurEffect *self = CLUTTER_DUAL_BLUR_EFFECT (gobject);
+
+  switch (prop_id)
+    {
+    case PROP_RADIUS:
+      g_value_set_float (value, self->radius);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
+      break;
+    }
+}
+
+static CoglPipeline *
+create_base_pipeline (CoglContext *ctx,
+                      const char  *shader)
+{
+  CoglPipeline *pipeline;
+  CoglSnippet *snippet;
+
+  pipeline = cogl_pipeline_new (ctx);
+
+  snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_TEXTURE_LOOKUP,
+                              dual_blur_glsl_declarations,
+                              NULL);
+  cogl_snippet_set_replace (snippet, shader);
+  cogl_pipeline_add_layer_snippet (pipeline, 0, snippet);
+  cogl_object_unref (snippet);
+
+  cogl_pipeline_set_layer_null_texture (pipeline,
+                                        0, /* layer number */
+                                        COGL_TEXTURE_TYPE_2D);
+
+  /* the filters rely on bilinear filtering to sample four texels
+   * at a time, and must not sample outside of the texture
+   */
+  cogl_pipeline_set_layer_filters (pipeline,
+                                   0, /* layer number */
+                                   COGL_PIPELINE_FILTER_LINEAR,
+                                   COGL_PIPELINE_FILTER_LINEAR);
+  cogl_pipeline_set_layer_wrap_mode (pipeline,
+                                     0, /* layer number */
+                                     COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE);
+
+  return pipeline;
+}
+
+static void
+clutter_dual_blur_effect_class_init (ClutterDualBlurEffectClass *klass)
+{
+  ClutterActorMetaClass *meta_class = CLUTTER_ACTOR_META_CLASS (klass);
+  ClutterEffectClass *effect_class = CLUTTER_EFFECT_CLASS (klass);
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  ClutterOffscreenEffectClass *offscreen_class;
+
+  gobject_class->dispose = clutter_dual_blur_effect_dispose;
+  gobject_class->set_property = clutter_dual_blur_effect_set_property;
+  gobject_class->get_property = clutter_dual_blur_effect_get_property;
+
+  meta_class->set_actor = clutter_dual_blur_effect_set_actor;
+
+  effect_class->pre_paint = clutter_dual_blur_effect_pre_paint;
+  effect_class->get_paint_volume = clutter_dual_blur_effect_get_paint_volume;
+
+  offscreen_class = CLUTTER_OFFSCREEN_EFFECT_CLASS (klass);
+  offscreen_class->paint_target = clutter_dual_blur_effect_paint_target;
+
+  /**
+   * ClutterDualBlurEffect:radius:
+   *
+   * The radius of the blur, in pixels.
+   */
+  obj_props[PROP_RADIUS] =
+    g_param_spec_float ("radius",
+                        P_("Radius"),
+                        P_("The radius of the blur"),
+                        0.0f, MAX_RADIUS,
+                        8.0f,
+                        CLUTTER_PARAM_READWRITE);
+
+  g_object_class_install_properties (gobject_class, PROP_LAST, obj_props);
+}
+
+static void
+clutter_dual_blur_effect_init (ClutterDualBlurEffect *self)
+{
+  ClutterDualBlurEffectClass *klass = CLUTTER_DUAL_BLUR_EFFECT_GET_CLASS (self);
+
+  if (G_UNLIKELY (klass->base_downsample_pipeline == NULL))
+    {
+      CoglContext *ctx =
+        clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+      klass->base_downsample_pipeline =
+        create_base_pipeline (ctx, downsample_glsl_shader);
+      klass->base_upsample_pipeline =
+        create_base_pipeline (ctx, upsample_glsl_shader);
+    }
+
+  self->downsample_pipeline = cogl_pipeline_copy (klass->base_downsample_pipeline);
+  self->downsample_uniform =
+    cogl_pipeline_get_uniform_location (self->downsample_pipeline, "half_pixel");
+
+  self->upsample_pipeline = cogl_pipeline_copy (klass->base_upsample_pipeline);
+  self->upsample_uniform =
+    cogl_pipeline_get_uniform_location (self->upsample_pipeline, "half_pixel");
+
+  self->pipeline = cogl_pipeline_copy (klass->base_upsample_pipeline);
+  self->pipeline_uniform =
+    cogl_pipeline_get_uniform_location (self->pipeline, "half_pixel");
+
+  self->radius = 8.0f;
+  self->blur_dirty = TRUE;
+
+  update_n_levels (self);
+}
+
+/**
+ * clutter_dual_blur_effect_new:
+ * @radius: the radius of the blur, in pixels
+ *
+ * Creates a new #ClutterDualBlurEffect to be used with
+ * clutter_actor_add_effect()
+ *
+ * Return value: the newly created #ClutterDualBlurEffect or %NULL
+ */
+ClutterEffect *
+clutter_dual_blur_effect_new (float radius)
+{
+  g_return_val_if_fail (radius >= 0.0f && radius <= MAX_RADIUS, NULL);
+
+  return g_object_new (CLUTTER_TYPE_DUAL_BLUR_EFFECT,
+                       "radius", radius,
+                       NULL);
+}
+
+/**
+ * clutter_dual_blur_effect_set_radius:
+ * @effect: a #ClutterDualBlurEffect
+ * @radius: the radius of the blur, in pixels
+ *
+ * Sets the radius of the blur. Changing the radius does not require
+ * the actor to be redrawn, only the cached offscreen image to be
+ * blurred again.
+ */
+void
+clutter_dual_blur_effect_set_radius (ClutterDualBlurEffect *effect,
+                                     float                  radius)
+{
+  ClutterActor *actor;
+
+  g_return_if_fail (CLUTTER_IS_DUAL_BLUR_EFFECT (effect));
+  g_return_if_fail (radius >= 0.0f && radius <= MAX_RADIUS);
+
+  if (fabsf (effect->radius - radius) < 0.00001f)
+    return;
+
+  actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (effect));
+
+  /* the padding of the paint volume depends on the radius, so the
+   * actor needs a full redraw when the padding changes; otherwise
+   * we can blur the cached offscreen image again
+   */
+  if (actor != NULL && get_padding (effect) != (int) ceilf (radius * 2.0f))
+    clutter_actor_queue_redraw (actor);
+  else
+    clutter_effect_queue_repaint (CLUTTER_EFFECT (effect));
+
+  effect->radius = radius;
+  effect->blur_dirty = TRUE;
+
+  update_n_levels (effect);
+
+  g_object_notify_by_pspec (G_OBJECT (effect), obj_props[PROP_RADIUS]);
+}
+
+/**
+ * clutter_dual_blur_effect_get_radius:
+ * @effect: a #ClutterDualBlurEffect
+ *
+ * Retrieves the radius of the blur.
+ *
+ * Return value: the radius, in pixels
+ */
+float
+clutter_dual_blur_effect_get_radius (ClutterDualBlurEffect *effect)
+{
+  g_return_val_if_fail (CLUTTER_IS_DUAL_BLUR_EFFECT (effect), 0.0f);
+
+  return effect->radius;
+}
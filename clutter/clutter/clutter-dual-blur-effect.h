@@ -0,0 +1,58 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CLUTTER_DUAL_BLUR_EFFECT_H__
+#define __CLUTTER_DUAL_BLUR_EFFECT_H__
+
+#if !defined(__CLUTTER_H_INSIDE__) && !defined(CLUTTER_COMPILATION)
+#error "Only <clutter/clutter.h> can be included directly."
+#endif
+
+#include <clutter/clutter-effect.h>
+
+G_BEGIN_DECLS
+
+#define CLUTTER_TYPE_DUAL_BLUR_EFFECT           (clutter_dual_blur_effect_get_type ())
+#define CLUTTER_DUAL_BLUR_EFFECT(obj)           (G_TYPE_CHECK_INSTANCE_CAST ((obj), CLUTTER_TYPE_DUAL_BLUR_EFFECT, ClutterDualBlurEffect))
+#define CLUTTER_IS_DUAL_BLUR_EFFECT(obj)        (G_TYPE_CHECK_INSTANCE_TYPE ((obj), CLUTTER_TYPE_DUAL_BLUR_EFFECT))
+
+/**
+ * ClutterDualBlurEffect:
+ *
+ * #ClutterDualBlurEffect is an opaque structure
+ * whose members cannot be accessed directly
+ */
+typedef struct _ClutterDualBlurEffect           ClutterDualBlurEffect;
+typedef struct _ClutterDualBlurEffectClass      ClutterDualBlurEffectClass;
+
+CLUTTER_AVAILABLE_IN_MUTTER
+GType clutter_dual_blur_effect_get_type (void) G_GNUC_CONST;
+
+CLUTTER_AVAILABLE_IN_MUTTER
+ClutterEffect * clutter_dual_blur_effect_new            (float                  radius);
+
+CLUTTER_AVAILABLE_IN_MUTTER
+void            clutter_dual_blur_effect_set_radius     (ClutterDualBlurEffect *effect,
+                                                         float                  radius);
+CLUTTER_AVAILABLE_IN_MUTTER
+float           clutter_dual_blur_effect_get_radius     (ClutterDualBlurEffect *effect);
+
+G_END_DECLS
+
+#endif /* __CLUTTER_DUAL_BLUR_EFFECT_H__ */
@@ -35,6 +35,7 @@
 
 #include "clutter-master-clock.h"
 #include "clutter-master-clock-default.h"
+#include "clutter-animation-engine.h"
 #include "clutter-debug.h"
 #include "clutter-private.h"
 #include "clutter-stage-manager-private.h"
@@ -382,6 +383,7 @@ master_clock_process_events (ClutterMasterClockDefault *master_clock,
 static void
 master_clock_advance_timelines (ClutterMasterClockDefault *master_clock)
 {
+  ClutterAnimationEngine *engine = _clutter_animation_engine_get_default ();
   GSList *timelines, *l;
 #ifdef CLUTTER_ENABLE_DEBUG
   gint64 start = g_get_monotonic_time ();
@@ -410,9 +412,17 @@ master_clock_advance_timelines (ClutterMasterClockDefault *master_clock)
   timelines = g_slist_copy (master_clock->timelines);
   g_slist_foreach (timelines, (GFunc) g_object_ref, NULL);
 
+  /* transitions of the core actor properties only record their state
+   * while the timelines are advanced; the animation engine interpolates
+   * and applies all of them at once when flushed
+   */
+  _clutter_animation_engine_begin_batch (engine);
+
   for (l = timelines; l != NULL; l = l->next)
     _clutter_timeline_do_tick (l->data, master_clock->cur_tick / 1000);
 
+  _clutter_animation_engine_flush (engine);
+
   g_slist_foreach (timelines, (GFunc) g_object_unref, NULL);
   g_slist_free (timelines);
 
@@ -72,6 +72,7 @@
 
 #include "clutter-actor-private.h"
 #include "clutter-debug.h"
+#include "clutter-offscreen-pool.h"
 #include "clutter-private.h"
 #include "clutter-stage-private.h"
 
@@ -105,12 +106,59 @@ struct _ClutterOffscreenEffectPrivate
      and it won't cause a redraw to be queued on the parent's
      children. */
   CoglMatrix last_matrix_drawn;
+
+  /* whether the texture and the offscreen are owned by the shared
+     pool of render targets */
+  guint is_pooled : 1;
 };
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (ClutterOffscreenEffect,
                                      clutter_offscreen_effect,
                                      CLUTTER_TYPE_EFFECT)
 
+static void
+clutter_offscreen_effect_real_release_fbo (ClutterOffscreenEffect *self)
+{
+  ClutterOffscreenEffectPrivate *priv = self->priv;
+
+  if (priv->is_pooled)
+    {
+      _clutter_offscreen_pool_release (_clutter_offscreen_pool_get_default (),
+                                       priv->texture,
+                                       priv->offscreen);
+      priv->texture = NULL;
+      priv->offscreen = NULL;
+      priv->is_pooled = FALSE;
+      return;
+    }
+
+  if (priv->offscreen != NULL)
+    {
+      cogl_handle_unref (priv->offscreen);
+      priv->offscreen = NULL;
+    }
+
+  if (priv->texture != NULL)
+    {
+      cogl_handle_unref (priv->texture);
+      priv->texture = NULL;
+    }
+}
+
+static void
+clutter_offscreen_effect_release_fbo (ClutterOffscreenEffect *self)
+{
+  ClutterOffscreenEffectPrivate *priv = self->priv;
+
+  clutter_offscreen_effect_real_release_fbo (self);
+
+  if (priv->target != NULL)
+    cogl_pipeline_set_layer_texture (priv->target, 0, NULL);
+
+  priv->fbo_width = 0;
+  priv->fbo_height = 0;
+}
+
 static void
 clutter_offscreen_effect_set_actor (ClutterActorMeta *meta,
                                     ClutterActor     *actor)
@@ -123,11 +171,7 @@ clutter_offscreen_effect_set_actor (ClutterActorMeta *meta,
   meta_class->set_actor (meta, actor);
 
   /* clear out the previous state */
-  if (priv->offscreen != NULL)
-    {
-      cogl_handle_unref (priv->offscreen);
-      priv->offscreen = NULL;
-    }
+  clutter_offscreen_effect_release_fbo (self);
 
   /* we keep a back pointer here, to avoid going through the ActorMeta */
   priv->actor = clutter_actor_meta_get_actor (meta);
@@ -180,10 +224,38 @@ update_fbo (ClutterEffect *effect, int fbo_width, int fbo_height)
                                        COGL_PIPELINE_FILTER_NEAREST);
     }
 
-  if (priv->texture != NULL)
+  clutter_offscreen_effect_real_release_fbo (self);
+
+  /* sub-classes providing their own textures cannot share the
+     render targets with other effects */
+  if (CLUTTER_OFFSCREEN_EFFECT_GET_CLASS (self)->create_texture ==
+      clutter_offscreen_effect_real_create_texture)
     {
-      cogl_handle_unref (priv->texture);
-      priv->texture = NULL;
+      CoglTexture *texture;
+      CoglOffscreen *offscreen;
+
+      if (!_clutter_offscreen_pool_acquire (_clutter_offscreen_pool_get_default (),
+                                            fbo_width, fbo_height,
+                                            &texture, &offscreen))
+        {
+          g_warning ("%s: Unable to create an Offscreen buffer", G_STRLOC);
+
+          priv->fbo_width = 0;
+          priv->fbo_height = 0;
+
+          return FALSE;
+        }
+
+      priv->texture = texture;
+      priv->offscreen = offscreen;
+      priv->is_pooled = TRUE;
+
+      cogl_pipeline_set_layer_texture (priv->target, 0, priv->texture);
+
+      priv->fbo_width = fbo_width;
+      priv->fbo_height = fbo_height;
+
+      return TRUE;
     }
 
   priv->texture =
@@ -196,9 +268,6 @@ update_fbo (ClutterEffect *effect, int fbo_width, int fbo_height)
   priv->fbo_width = fbo_width;
   priv->fbo_height = fbo_height;
 
-  if (priv->offscreen != NULL)
-    cogl_handle_unref (priv->offscreen);
-
   priv->offscreen = cogl_offscreen_new_to_texture (priv->texture);
   if (priv->offscreen == NULL)
     {
@@ -451,15 +520,11 @@ clutter_offscreen_effect_finalize (GObject *gobject)
   ClutterOffscreenEffect *self = CLUTTER_OFFSCREEN_EFFECT (gobject);
   ClutterOffscreenEffectPrivate *priv = self->priv;
 
-  if (priv->offscreen)
-    cogl_handle_unref (priv->offscreen);
+  clutter_offscreen_effect_real_release_fbo (self);
 
   if (priv->target)
     cogl_handle_unref (priv->target);
 
-  if (priv->texture)
-    cogl_handle_unref (priv->texture);
-
   G_OBJECT_CLASS (clutter_offscreen_effect_parent_class)->finalize (gobject);
 }
 
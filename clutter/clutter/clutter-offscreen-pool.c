@@ -0,0 +1,347 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * SECTION:clutter-offscreen-pool
+ * @short_description: Shared pool of offscreen render targets
+ *
+ * The offscreen pool keeps the textures and framebuffers released by
+ * the offscreen effects around, so that effects being created, resized
+ * or destroyed in quick succession (e.g. when the window previews of an
+ * overview are animated) do not need to allocate new render targets
+ * each time.
+ *
+ * Free render targets are grouped in buckets by size. They are evicted
+ * in least recently released order when the memory held by the pool
+ * exceeds its budget, and in any case after they have not been used
+ * for a while.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clutter-build-config.h"
+#endif
+
+#include "clutter-offscreen-pool.h"
+
+#include "clutter-debug.h"
+#include "clutter-private.h"
+
+/* the maximum amount of memory kept by free render targets */
+#define POOL_MAX_FREE_BYTES     (64 * 1024 * 1024)
+
+/* the amount of time after which a free render target is evicted */
+#define POOL_MAX_IDLE_TIME_S    3
+
+typedef struct _PoolEntry
+{
+  CoglTexture *texture;
+  CoglOffscreen *offscreen;
+
+  int width;
+  int height;
+  gsize n_bytes;
+
+  gint64 release_time;
+
+  /* links inside the bucket and the LRU queue */
+  GList bucket_link;
+  GList lru_link;
+} PoolEntry;
+
+struct _ClutterOffscreenPool
+{
+  /* size key -> GQueue of free PoolEntry */
+  GHashTable *buckets;
+
+  /* free entries; the most recently released at the head */
+  GQueue lru;
+
+  /* texture -> PoolEntry, for the entries currently in use */
+  GHashTable *used;
+
+  gsize used_bytes;
+  gsize free_bytes;
+
+  guint n_hits;
+  guint n_misses;
+
+  guint evict_id;
+};
+
+static inline gpointer
+bucket_key (int width,
+            int height)
+{
+  return GUINT_TO_POINTER (((guint) width << 16) | ((guint) height & 0xffff));
+}
+
+static void
+pool_entry_free (PoolEntry *entry)
+{
+  cogl_handle_unref (entry->offscreen);
+  cogl_handle_unref (entry->texture);
+
+  g_slice_free (PoolEntry, entry);
+}
+
+ClutterOffscreenPool *
+_clutter_offscreen_pool_get_default (void)
+{
+  static ClutterOffscreenPool *default_pool = NULL;
+
+  if (G_UNLIKELY (default_pool == NULL))
+    {
+      default_pool = g_new0 (ClutterOffscreenPool, 1);
+      default_pool->buckets =
+        g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_queue_free);
+      default_pool->used = g_hash_table_new (NULL, NULL);
+      g_queue_init (&default_pool->lru);
+    }
+
+  return default_pool;
+}
+
+static void
+clutter_offscreen_pool_evict (ClutterOffscreenPool *pool,
+                              PoolEntry            *entry)
+{
+  GQueue *bucket;
+
+  bucket = g_hash_table_lookup (pool->buckets,
+                                bucket_key (entry->width, entry->height));
+  g_assert (bucket != NULL);
+
+  g_queue_unlink (bucket, &entry->bucket_link);
+  if (g_queue_is_empty (bucket))
+    g_hash_table_remove (pool->buckets,
+                         bucket_key (entry->width, entry->height));
+
+  g_queue_unlink (&pool->lru, &entry->lru_link);
+
+  pool->free_bytes -= entry->n_bytes;
+
+  CLUTTER_NOTE (PAINT, "Evicting %dx%d offscreen from the pool "
+                "(free: %" G_GSIZE_FORMAT " bytes)",
+                entry->width, entry->height,
+                pool->free_bytes);
+
+  pool_entry_free (entry);
+}
+
+static gboolean
+clutter_offscreen_pool_evict_idle (gpointer user_data)
+{
+  ClutterOffscreenPool *pool = user_data;
+  gint64 now = g_get_monotonic_time ();
+  gint64 max_idle_time = POOL_MAX_IDLE_TIME_S * G_USEC_PER_SEC;
+
+  while (!g_queue_is_empty (&pool->lru))
+    {
+      PoolEntry *entry = pool->lru.tail->data;
+
+      if (now - entry->release_time < max_idle_time)
+        break;
+
+      clutter_offscreen_pool_evict (pool, entry);
+    }
+
+  if (g_queue_is_empty (&pool->lru))
+    {
+      pool->evict_id = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+/*< private >
+ * _clutter_offscreen_pool_acquire:
+ * @pool: a #ClutterOffscreenPool
+ * @width: the width of the render target
+ * @height: the height of the render target
+ * @texture: (out): return location for the texture
+ * @offscreen: (out): return location for the framebuffer
+ *
+ * Retrieves a render target of the given size, either by reusing a
+ * free one or by allocating a new one. The render target must be given
+ * back using _clutter_offscreen_pool_release().
+ *
+ * Return value: %TRUE if a render target could be allocated
+ */
+gboolean
+_clutter_offscreen_pool_acquire (ClutterOffscreenPool  *pool,
+                                 int                    width,
+                                 int                    height,
+                                 CoglTexture          **texture,
+                                 CoglOffscreen        **offscreen)
+{
+  PoolEntry *entry;
+  GQueue *bucket;
+
+  width = MAX (width, 1);
+  height = MAX (height, 1);
+
+  bucket = g_hash_table_lookup (pool->buckets, bucket_key (width, height));
+  if (bucket != NULL)
+    {
+      entry = bucket->head->data;
+
+      g_queue_unlink (bucket, &entry->bucket_link);
+      if (g_queue_is_empty (bucket))
+        g_hash_table_remove (pool->buckets, bucket_key (width, height));
+
+      g_queue_unlink (&pool->lru, &entry->lru_link);
+
+      pool->free_bytes -= entry->n_bytes;
+      pool->n_hits += 1;
+    }
+  else
+    {
+      CoglHandle tex, fbo;
+
+      tex = cogl_texture_new_with_size (width, height,
+                                        COGL_TEXTURE_NO_SLICING,
+                                        COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+      if (tex == NULL)
+        return FALSE;
+
+      fbo = cogl_offscreen_new_to_texture (tex);
+      if (fbo == NULL)
+        {
+          cogl_handle_unref (tex);
+          return FALSE;
+        }
+
+      entry = g_slice_new0 (PoolEntry);
+      entry->texture = tex;
+      entry->offscreen = fbo;
+      entry->width = width;
+      entry->height = height;
+      entry->n_bytes = (gsize) width * height * 4;
+      entry->bucket_link.data = entry;
+      entry->lru_link.data = entry;
+
+      pool->n_misses += 1;
+    }
+
+  pool->used_bytes += entry->n_bytes;
+  g_hash_table_insert (pool->used, entry->texture, entry);
+
+  CLUTTER_NOTE (PAINT, "Acquired %dx%d offscreen from the pool "
+                "(used: %" G_GSIZE_FORMAT " bytes, free: %" G_GSIZE_FORMAT
+                " bytes, hits: %u, misses: %u)",
+                width, height,
+                pool->used_bytes, pool->free_bytes,
+                pool->n_hits, pool->n_misses);
+
+  *texture = entry->texture;
+  *offscreen = entry->offscreen;
+
+  return TRUE;
+}
+
+/*< private >
+ * _clutter_offscreen_pool_release:
+ * @pool: a #ClutterOffscreenPool
+ * @texture: a texture returned by _clutter_offscreen_pool_acquire()
+ * @offscreen: the framebuffer returned with @texture
+ *
+ * Gives a render target back to the pool.
+ */
+void
+_clutter_offscreen_pool_release (ClutterOffscreenPool *pool,
+                                 CoglTexture          *texture,
+                                 CoglOffscreen        *offscreen)
+{
+  PoolEntry *entry;
+  GQueue *bucket;
+  gpointer key;
+
+  entry = g_hash_table_lookup (pool->used, texture);
+  g_return_if_fail (entry != NULL && entry->offscreen == offscreen);
+
+  g_hash_table_remove (pool->used, texture);
+  pool->used_bytes -= entry->n_bytes;
+
+  key = bucket_key (entry->width, entry->height);
+  bucket = g_hash_table_lookup (pool->buckets, key);
+  if (bucket == NULL)
+    {
+      bucket = g_queue_new ();
+      g_hash_table_insert (pool->buckets, key, bucket);
+    }
+
+  entry->release_time = g_get_monotonic_time ();
+
+  g_queue_push_head_link (bucket, &entry->bucket_link);
+  g_queue_push_head_link (&pool->lru, &entry->lru_link);
+
+  pool->free_bytes += entry->n_bytes;
+
+  _clutter_offscreen_pool_trim (pool, POOL_MAX_FREE_BYTES);
+
+  if (pool->evict_id == 0 && !g_queue_is_empty (&pool->lru))
+    {
+      pool->evict_id =
+        g_timeout_add_seconds (POOL_MAX_IDLE_TIME_S,
+                               clutter_offscreen_pool_evict_idle,
+                               pool);
+      g_source_set_name_by_id (pool->evict_id,
+                               "[clutter] clutter_offscreen_pool_evict_idle");
+    }
+}
+
+/*< private >
+ * _clutter_offscreen_pool_trim:
+ * @pool: a #ClutterOffscreenPool
+ * @max_free_bytes: the amount of memory the free render targets can use
+ *
+ * Evicts the least recently released render targets until the
+ * memory used by the free ones is below @max_free_bytes.
+ */
+void
+_clutter_offscreen_pool_trim (ClutterOffscreenPool *pool,
+                              gsize                 max_free_bytes)
+{
+  while (pool->free_bytes > max_free_bytes &&
+         !g_queue_is_empty (&pool->lru))
+    clutter_offscreen_pool_evict (pool, pool->lru.tail->data);
+}
+
+/*< private >
+ * _clutter_offscreen_pool_get_usage:
+ * @pool: a #ClutterOffscreenPool
+ * @used_bytes: (out) (allow-none): return location for the memory used
+ *   by the render targets in use
+ * @free_bytes: (out) (allow-none): return location for the memory used
+ *   by the free render targets
+ *
+ * Retrieves the amount of texture memory accounted by the pool.
+ */
+void
+_clutter_offscreen_pool_get_usage (ClutterOffscreenPool *pool,
+                                   gsize                *used_bytes,
+                                   gsize                *free_bytes)
+{
+  if (used_bytes != NULL)
+    *used_bytes = pool->used_bytes;
+
+  if (free_bytes != NULL)
+    *free_bytes = pool->free_bytes;
+}
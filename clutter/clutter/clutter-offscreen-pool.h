@@ -0,0 +1,57 @@
+/*
+ * Clutter.
+ *
+ * An OpenGL based 'interactive canvas' library.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CLUTTER_OFFSCREEN_POOL_H__
+#define __CLUTTER_OFFSCREEN_POOL_H__
+
+#include <cogl/cogl.h>
+#include <glib.h>
+
+#include <clutter/clutter-macros.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ClutterOffscreenPool    ClutterOffscreenPool;
+
+CLUTTER_AVAILABLE_IN_MUTTER
+ClutterOffscreenPool *  _clutter_offscreen_pool_get_default     (void);
+
+CLUTTER_AVAILABLE_IN_MUTTER
+gboolean                _clutter_offscreen_pool_acquire         (ClutterOffscreenPool  *pool,
+                                                                 int                    width,
+                                                                 int                    height,
+                                                                 CoglTexture          **texture,
+                                                                 CoglOffscreen        **offscreen);
+CLUTTER_AVAILABLE_IN_MUTTER
+void                    _clutter_offscreen_pool_release         (ClutterOffscreenPool  *pool,
+                                                                 CoglTexture           *texture,
+                                                                 CoglOffscreen         *offscreen);
+
+CLUTTER_AVAILABLE_IN_MUTTER
+void                    _clutter_offscreen_pool_trim            (ClutterOffscreenPool  *pool,
+                                                                 gsize                  max_free_bytes);
+
+CLUTTER_AVAILABLE_IN_MUTTER
+void                    _clutter_offscreen_pool_get_usage       (ClutterOffscreenPool  *pool,
+                                                                 gsize                 *used_bytes,
+                                                                 gsize                 *free_bytes);
+
+G_END_DECLS
+
+#endif /* __CLUTTER_OFFSCREEN_POOL_H__ */
@@ -36,7 +36,9 @@
 
 #include "clutter-property-transition.h"
 
+#include "clutter-actor-private.h"
 #include "clutter-animatable.h"
+#include "clutter-animation-engine.h"
 #include "clutter-debug.h"
 #include "clutter-interval.h"
 #include "clutter-private.h"
@@ -47,6 +49,9 @@ struct _ClutterPropertyTransitionPrivate
   char *property_name;
 
   GParamSpec *pspec;
+
+  /* the slot inside the animation engine, or -1 */
+  gint engine_slot;
 };
 
 enum
@@ -60,6 +65,8 @@ enum
 
 static GParamSpec *obj_props[PROP_LAST] = { NULL, };
 
+static guint new_frame_signal_id = 0;
+
 G_DEFINE_TYPE_WITH_PRIVATE (ClutterPropertyTransition, clutter_property_transition, CLUTTER_TYPE_TRANSITION)
 
 static inline void
@@ -94,6 +101,122 @@ clutter_property_transition_ensure_interval (ClutterPropertyTransition *transiti
     }
 }
 
+static inline gboolean
+clutter_property_transition_can_use_engine (ClutterPropertyTransition *transition,
+                                            ClutterAnimatable         *animatable,
+                                            ClutterInterval           *interval)
+{
+  ClutterPropertyTransitionPrivate *priv = transition->priv;
+  GType value_type;
+
+  if (!CLUTTER_IS_ACTOR (animatable) || priv->pspec == NULL)
+    return FALSE;
+
+  if (!_clutter_animation_engine_is_enabled ())
+    return FALSE;
+
+  /* sub-classes of ClutterInterval can override the interpolation */
+  if (interval == NULL || G_OBJECT_TYPE (interval) != CLUTTER_TYPE_INTERVAL)
+    return FALSE;
+
+  value_type = clutter_interval_get_value_type (interval);
+  if (value_type != G_PARAM_SPEC_VALUE_TYPE (priv->pspec))
+    return FALSE;
+
+  if (value_type != G_TYPE_FLOAT &&
+      value_type != G_TYPE_DOUBLE &&
+      value_type != G_TYPE_UINT)
+    return FALSE;
+
+  return _clutter_actor_supports_animated_value (CLUTTER_ACTOR (animatable),
+                                                 priv->pspec);
+}
+
+static inline double
+get_value_as_double (const GValue *value)
+{
+  switch (G_VALUE_TYPE (value))
+    {
+    case G_TYPE_FLOAT:
+      return g_value_get_float (value);
+
+    case G_TYPE_DOUBLE:
+      return g_value_get_double (value);
+
+    case G_TYPE_UINT:
+      return g_value_get_uint (value);
+
+    default:
+      g_assert_not_reached ();
+    }
+
+  return 0.0;
+}
+
+static void
+clutter_property_transition_release_engine_slot (ClutterPropertyTransition *transition)
+{
+  ClutterPropertyTransitionPrivate *priv = transition->priv;
+  ClutterAnimationEngine *engine;
+
+  if (priv->engine_slot < 0)
+    return;
+
+  engine = _clutter_animation_engine_get_default ();
+
+  /* make sure the last computed value reaches the actor */
+  _clutter_animation_engine_flush_slot (engine, priv->engine_slot);
+
+  if (priv->engine_slot >= 0)
+    _clutter_animation_engine_remove (engine, priv->engine_slot);
+}
+
+static gboolean
+clutter_property_transition_compute_value_fast (ClutterPropertyTransition *transition,
+                                                ClutterAnimatable         *animatable,
+                                                ClutterInterval           *interval,
+                                                gdouble                    progress)
+{
+  ClutterPropertyTransitionPrivate *priv = transition->priv;
+  ClutterTimeline *timeline = CLUTTER_TIMELINE (transition);
+  ClutterAnimationEngine *engine;
+  gint64 elapsed;
+
+  if (!clutter_property_transition_can_use_engine (transition, animatable, interval))
+    {
+      clutter_property_transition_release_engine_slot (transition);
+      return FALSE;
+    }
+
+  engine = _clutter_animation_engine_get_default ();
+
+  if (priv->engine_slot < 0)
+    _clutter_animation_engine_add (engine,
+                                   CLUTTER_ACTOR (animatable),
+                                   priv->pspec,
+                                   &priv->engine_slot);
+
+  _clutter_animation_engine_update (engine,
+                                    priv->engine_slot,
+                                    get_value_as_double (clutter_interval_peek_initial_value (interval)),
+                                    get_value_as_double (clutter_interval_peek_final_value (interval)),
+                                    progress);
+
+  /* the ::new-frame handlers running after this one, as well as the
+   * ::completed and ::stopped signal handlers, expect to see the new
+   * state of the property, so we cannot wait for the end of the batch
+   */
+  elapsed = clutter_timeline_get_elapsed_time (timeline);
+  if (clutter_timeline_get_direction (timeline) == CLUTTER_TIMELINE_FORWARD
+      ? elapsed >= clutter_timeline_get_duration (timeline)
+      : elapsed <= 0)
+    _clutter_animation_engine_flush_slot (engine, priv->engine_slot);
+  else if (g_signal_has_handler_pending (timeline, new_frame_signal_id, 0, TRUE))
+    _clutter_animation_engine_flush_slot (engine, priv->engine_slot);
+
+  return TRUE;
+}
+
 static void
 clutter_property_transition_attached (ClutterTransition *transition,
                                       ClutterAnimatable *animatable)
@@ -125,7 +248,9 @@ clutter_property_transition_detached (ClutterTransition *transition,
   ClutterPropertyTransition *self = CLUTTER_PROPERTY_TRANSITION (transition);
   ClutterPropertyTransitionPrivate *priv = self->priv;
 
-  priv->pspec = NULL; 
+  clutter_property_transition_release_engine_slot (self);
+
+  priv->pspec = NULL;
 }
 
 static void
@@ -146,6 +271,11 @@ clutter_property_transition_compute_value (ClutterTransition *transition,
 
   clutter_property_transition_ensure_interval (self, animatable, interval);
 
+  /* use the batched fast path for the core actor properties */
+  if (clutter_property_transition_compute_value_fast (self, animatable,
+                                                      interval, progress))
+    return;
+
   p_type = G_PARAM_SPEC_VALUE_TYPE (priv->pspec);
   i_type = clutter_interval_get_value_type (interval);
 
@@ -238,6 +368,8 @@ clutter_property_transition_finalize (GObject *gobject)
 
   priv = CLUTTER_PROPERTY_TRANSITION (gobject)->priv;
 
+  clutter_property_transition_release_engine_slot (CLUTTER_PROPERTY_TRANSITION (gobject));
+
   g_free (priv->property_name);
 
   G_OBJECT_CLASS (clutter_property_transition_parent_class)->finalize (gobject);
@@ -272,12 +404,15 @@ clutter_property_transition_class_init (ClutterPropertyTransitionClass *klass)
                          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
   g_object_class_install_properties (gobject_class, PROP_LAST, obj_props);
+
+  new_frame_signal_id = g_signal_lookup ("new-frame", CLUTTER_TYPE_TIMELINE);
 }
 
 static void
 clutter_property_transition_init (ClutterPropertyTransition *self)
 {
   self->priv = clutter_property_transition_get_instance_private (self);
+  self->priv->engine_slot = -1;
 }
 
 /**
@@ -322,6 +457,8 @@ clutter_property_transition_set_property_name (ClutterPropertyTransition *transi
   if (g_strcmp0 (priv->property_name, property_name) == 0)
     return;
 
+  clutter_property_transition_release_engine_slot (transition);
+
   g_free (priv->property_name);
   priv->property_name = g_strdup (property_name);
   priv->pspec = NULL;
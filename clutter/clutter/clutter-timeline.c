@@ -99,6 +99,7 @@
 
 #include "clutter-timeline.h"
 
+#include "clutter-animation-engine.h"
 #include "clutter-debug.h"
 #include "clutter-easing.h"
 #include "clutter-enum-types.h"
@@ -960,6 +961,12 @@ emit_frame_signal (ClutterTimeline *timeline)
 
   CLUTTER_NOTE (SCHEDULER, "Emitting ::new-frame signal on timeline[%p]", timeline);
 
+  /* the handlers expect to see the state set by the timelines that
+   * have been advanced before this one
+   */
+  if (g_signal_has_handler_pending (timeline, timeline_signals[NEW_FRAME], 0, TRUE))
+    _clutter_animation_engine_sync (_clutter_animation_engine_get_default ());
+
   g_signal_emit (timeline, timeline_signals[NEW_FRAME], 0, elapsed);
 }
 
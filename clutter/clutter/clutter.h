@@ -59,6 +59,7 @@
 #include "clutter-device-manager.h"
 #include "clutter-drag-action.h"
 #include "clutter-drop-action.h"
+#include "clutter-dual-blur-effect.h"
 #include "clutter-effect.h"
 #include "clutter-enums.h"
 #include "clutter-enum-types.h"
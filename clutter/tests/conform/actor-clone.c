@@ -0,0 +1,205 @@
+#include <clutter/clutter.h>
+
+/* the number of snapshots ClutterClone updates during a frame */
+#define MAX_SNAPSHOT_UPDATES_PER_FRAME  4
+
+typedef struct
+{
+  ClutterActor *stage;
+
+  /* the snapshots updated during the current frame */
+  guint n_updates;
+
+  /* the snapshots updated during each painted frame */
+  GArray *updates_per_frame;
+
+  gboolean was_painted;
+} SnapshotData;
+
+static void
+on_source_paint (ClutterActor *source,
+                 SnapshotData *data)
+{
+  /* the snapshot of a clone is rendered into an offscreen framebuffer;
+   * a clone without a snapshot paints its source on the stage
+   */
+  if (clutter_actor_is_in_clone_paint (source) &&
+      cogl_is_offscreen (cogl_get_draw_framebuffer ()))
+    data->n_updates += 1;
+}
+
+static void
+on_stage_after_paint (ClutterStage *stage,
+                      SnapshotData *data)
+{
+  g_array_append_val (data->updates_per_frame, data->n_updates);
+  data->n_updates = 0;
+
+  data->was_painted = TRUE;
+}
+
+static void
+snapshot_data_init (SnapshotData *data)
+{
+  data->stage = clutter_test_get_stage ();
+  data->updates_per_frame = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  g_signal_connect (data->stage, "after-paint",
+                    G_CALLBACK (on_stage_after_paint),
+                    data);
+}
+
+static void
+snapshot_data_clear (SnapshotData *data)
+{
+  g_signal_handlers_disconnect_by_func (data->stage,
+                                        on_stage_after_paint,
+                                        data);
+  g_array_free (data->updates_per_frame, TRUE);
+}
+
+static guint
+paint_frame (SnapshotData *data)
+{
+  data->was_painted = FALSE;
+
+  clutter_actor_show (data->stage);
+  clutter_actor_queue_redraw (data->stage);
+
+  while (!data->was_painted)
+    g_main_context_iteration (NULL, TRUE);
+
+  return g_array_index (data->updates_per_frame, guint,
+                        data->updates_per_frame->len - 1);
+}
+
+static ClutterActor *
+create_source (SnapshotData *data)
+{
+  ClutterActor *source;
+
+  source = clutter_actor_new ();
+  clutter_actor_set_background_color (source, CLUTTER_COLOR_Red);
+  clutter_actor_set_size (source, 100, 100);
+  clutter_actor_add_child (data->stage, source);
+
+  g_signal_connect (source, "paint",
+                    G_CALLBACK (on_source_paint),
+                    data);
+
+  return source;
+}
+
+static ClutterActor *
+create_snapshot_clone (SnapshotData *data,
+                       ClutterActor *source,
+                       float         x)
+{
+  ClutterActor *clone;
+
+  clone = clutter_clone_new (source);
+  clutter_clone_set_use_snapshot (CLUTTER_CLONE (clone), TRUE);
+  g_assert (clutter_clone_get_use_snapshot (CLUTTER_CLONE (clone)));
+
+  /* a scaled down clone */
+  clutter_actor_set_position (clone, x, 0);
+  clutter_actor_set_size (clone, 50, 50);
+  clutter_actor_add_child (data->stage, clone);
+
+  return clone;
+}
+
+static void
+actor_clone_snapshot (void)
+{
+  SnapshotData data = { NULL, };
+  ClutterActor *source, *clone;
+  ClutterPoint point;
+  ClutterColor color;
+
+  snapshot_data_init (&data);
+
+  source = create_source (&data);
+  clone = create_snapshot_clone (&data, source, 200);
+
+  clutter_point_init (&point, 225, 25);
+  g_assert (clutter_test_check_color_at_point (data.stage, &point,
+                                               CLUTTER_COLOR_Red,
+                                               &color));
+
+  /* the snapshot has been rendered once... */
+  g_assert_cmpuint (paint_frame (&data), ==, 0);
+  g_assert_cmpuint (data.updates_per_frame->len, >=, 2);
+  g_assert_cmpuint (g_array_index (data.updates_per_frame, guint, 0), ==, 1);
+
+  /* ...and it is not rendered again while the source does not change */
+  g_assert_cmpuint (paint_frame (&data), ==, 0);
+  g_assert_cmpuint (paint_frame (&data), ==, 0);
+
+  /* a redraw queued on the source refreshes the snapshot */
+  clutter_actor_queue_redraw (source);
+  g_assert_cmpuint (paint_frame (&data), ==, 1);
+  g_assert_cmpuint (paint_frame (&data), ==, 0);
+
+  /* and so does changing the source */
+  clutter_actor_set_background_color (source, CLUTTER_COLOR_Blue);
+  g_assert (clutter_test_check_color_at_point (data.stage, &point,
+                                               CLUTTER_COLOR_Blue,
+                                               &color));
+
+  /* going back to painting the source must keep working */
+  clutter_clone_set_use_snapshot (CLUTTER_CLONE (clone), FALSE);
+  clutter_actor_set_background_color (source, CLUTTER_COLOR_Green);
+  g_assert (clutter_test_check_color_at_point (data.stage, &point,
+                                               CLUTTER_COLOR_Green,
+                                               &color));
+
+  /* without a snapshot nothing is rendered offscreen */
+  g_assert_cmpuint (paint_frame (&data), ==, 0);
+
+  clutter_actor_destroy (clone);
+  clutter_actor_destroy (source);
+
+  snapshot_data_clear (&data);
+}
+
+static void
+actor_clone_snapshot_budget (void)
+{
+  SnapshotData data = { NULL, };
+  ClutterActor *source;
+  ClutterActor *clones[MAX_SNAPSHOT_UPDATES_PER_FRAME + 2];
+  guint i;
+
+  snapshot_data_init (&data);
+
+  source = create_source (&data);
+
+  for (i = 0; i < G_N_ELEMENTS (clones); i++)
+    clones[i] = create_snapshot_clone (&data, source, 100 + i * 60);
+
+  /* only a few snapshots are updated during a frame; the others are
+   * updated during the next one
+   */
+  g_assert_cmpuint (paint_frame (&data), ==, MAX_SNAPSHOT_UPDATES_PER_FRAME);
+  g_assert_cmpuint (paint_frame (&data), ==, 2);
+  g_assert_cmpuint (paint_frame (&data), ==, 0);
+
+  /* the same goes when all of them become dirty at once */
+  clutter_actor_queue_redraw (source);
+  g_assert_cmpuint (paint_frame (&data), ==, MAX_SNAPSHOT_UPDATES_PER_FRAME);
+  g_assert_cmpuint (paint_frame (&data), ==, 2);
+  g_assert_cmpuint (paint_frame (&data), ==, 0);
+
+  for (i = 0; i < G_N_ELEMENTS (clones); i++)
+    clutter_actor_destroy (clones[i]);
+
+  clutter_actor_destroy (source);
+
+  snapshot_data_clear (&data);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/actor/clone/snapshot", actor_clone_snapshot)
+  CLUTTER_TEST_UNIT ("/actor/clone/snapshot-budget", actor_clone_snapshot_budget)
+)
@@ -0,0 +1,176 @@
+#define CLUTTER_DISABLE_DEPRECATION_WARNINGS
+#include <clutter/clutter.h>
+
+typedef struct
+{
+  ClutterActor *stage;
+  ClutterActor *actor;
+  ClutterEffect *effect;
+
+  int n_paints;
+} BlurData;
+
+static void
+on_actor_paint (ClutterActor *actor,
+                BlurData     *data)
+{
+  data->n_paints += 1;
+}
+
+static void
+get_color_at (BlurData     *data,
+              float         x,
+              float         y,
+              ClutterColor *color)
+{
+  ClutterPoint point;
+
+  clutter_point_init (&point, x, y);
+
+  clutter_actor_queue_redraw (data->stage);
+  clutter_test_check_color_at_point (data->stage, &point,
+                                     CLUTTER_COLOR_Black,
+                                     color);
+
+  if (g_test_verbose ())
+    g_print ("Color at %.0f, %.0f: #%02x%02x%02x\n",
+             x, y,
+             color->red, color->green, color->blue);
+}
+
+static void
+assert_gray_in_range (const ClutterColor *color,
+                      guint8              min,
+                      guint8              max)
+{
+  g_assert_cmpint (color->red, >=, min);
+  g_assert_cmpint (color->red, <=, max);
+  g_assert_cmpint (color->green, ==, color->red);
+  g_assert_cmpint (color->blue, ==, color->red);
+}
+
+static gboolean
+blur_data_init (BlurData *data,
+                float     radius)
+{
+  if (!clutter_feature_available (CLUTTER_FEATURE_SHADERS_GLSL))
+    return FALSE;
+
+  data->stage = clutter_test_get_stage ();
+  clutter_actor_set_background_color (data->stage, CLUTTER_COLOR_Black);
+
+  /* a white square on a black stage */
+  data->actor = clutter_actor_new ();
+  clutter_actor_set_background_color (data->actor, CLUTTER_COLOR_White);
+  clutter_actor_set_position (data->actor, 50, 50);
+  clutter_actor_set_size (data->actor, 100, 100);
+  clutter_actor_add_child (data->stage, data->actor);
+
+  g_signal_connect (data->actor, "paint",
+                    G_CALLBACK (on_actor_paint),
+                    data);
+
+  data->effect = clutter_dual_blur_effect_new (radius);
+  clutter_actor_add_effect (data->actor, data->effect);
+
+  return TRUE;
+}
+
+static void
+actor_dual_blur_effect_no_radius (void)
+{
+  BlurData data = { NULL, };
+  ClutterColor color;
+
+  if (!blur_data_init (&data, 0.0f))
+    return;
+
+  /* without a radius the actor is painted unchanged */
+  get_color_at (&data, 100, 100, &color);
+  assert_gray_in_range (&color, 0xff, 0xff);
+
+  get_color_at (&data, 51, 100, &color);
+  assert_gray_in_range (&color, 0xff, 0xff);
+
+  get_color_at (&data, 46, 100, &color);
+  assert_gray_in_range (&color, 0x00, 0x00);
+
+  clutter_actor_destroy (data.actor);
+}
+
+static void
+actor_dual_blur_effect_blur (void)
+{
+  BlurData data = { NULL, };
+  ClutterColor color;
+
+  if (!blur_data_init (&data, 8.0f))
+    return;
+
+  /* the inside of the actor, far from the edges, is untouched */
+  get_color_at (&data, 100, 100, &color);
+  assert_gray_in_range (&color, 0xf0, 0xff);
+
+  /* the edges are smoothed on both sides */
+  get_color_at (&data, 52, 100, &color);
+  assert_gray_in_range (&color, 0x10, 0xf0);
+
+  get_color_at (&data, 47, 100, &color);
+  assert_gray_in_range (&color, 0x10, 0xf0);
+
+  /* and nothing is painted past the padding of the paint volume */
+  get_color_at (&data, 10, 100, &color);
+  assert_gray_in_range (&color, 0x00, 0x00);
+
+  clutter_actor_destroy (data.actor);
+}
+
+static void
+actor_dual_blur_effect_radius (void)
+{
+  BlurData data = { NULL, };
+  ClutterColor before, after;
+  int n_paints;
+
+  if (!blur_data_init (&data, 8.0f))
+    return;
+
+  get_color_at (&data, 47, 100, &before);
+  assert_gray_in_range (&before, 0x10, 0xf0);
+
+  n_paints = data.n_paints;
+  g_assert_cmpint (n_paints, >, 0);
+
+  /* changing the radius without changing the padding re-blurs the
+   * cached image of the actor, without painting the actor again
+   */
+  clutter_dual_blur_effect_set_radius (CLUTTER_DUAL_BLUR_EFFECT (data.effect), 7.6f);
+  g_assert_cmpfloat (clutter_dual_blur_effect_get_radius (CLUTTER_DUAL_BLUR_EFFECT (data.effect)), ==, 7.6f);
+
+  get_color_at (&data, 47, 100, &after);
+  assert_gray_in_range (&after, 0x10, 0xf0);
+  g_assert_cmpint (data.n_paints, ==, n_paints);
+
+  get_color_at (&data, 100, 100, &after);
+  assert_gray_in_range (&after, 0xf0, 0xff);
+
+  /* a smaller padding needs the actor to be painted again, and
+   * nothing is painted past the new padding
+   */
+  clutter_dual_blur_effect_set_radius (CLUTTER_DUAL_BLUR_EFFECT (data.effect), 2.0f);
+
+  get_color_at (&data, 42, 100, &after);
+  assert_gray_in_range (&after, 0x00, 0x00);
+  g_assert_cmpint (data.n_paints, >, n_paints);
+
+  get_color_at (&data, 100, 100, &after);
+  assert_gray_in_range (&after, 0xf0, 0xff);
+
+  clutter_actor_destroy (data.actor);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/actor/dual-blur-effect/no-radius", actor_dual_blur_effect_no_radius)
+  CLUTTER_TEST_UNIT ("/actor/dual-blur-effect/blur", actor_dual_blur_effect_blur)
+  CLUTTER_TEST_UNIT ("/actor/dual-blur-effect/radius", actor_dual_blur_effect_radius)
+)
@@ -0,0 +1,193 @@
+#include <clutter/clutter.h>
+
+#include "clutter/clutter-offscreen-pool.h"
+
+#define TARGET_BYTES(w,h)       ((gsize) (w) * (h) * 4)
+
+static void
+actor_offscreen_pool_reuse (void)
+{
+  ClutterOffscreenPool *pool = _clutter_offscreen_pool_get_default ();
+  CoglTexture *texture, *small_texture, *reused;
+  CoglOffscreen *offscreen, *small_offscreen, *reused_offscreen;
+  gsize used_bytes, free_bytes;
+
+  /* start from an empty pool */
+  _clutter_offscreen_pool_trim (pool, 0);
+  _clutter_offscreen_pool_get_usage (pool, &used_bytes, &free_bytes);
+  g_assert_cmpuint (free_bytes, ==, 0);
+
+  g_assert (_clutter_offscreen_pool_acquire (pool, 64, 64,
+                                             &texture, &offscreen));
+  g_assert_cmpint (cogl_texture_get_width (texture), ==, 64);
+  g_assert_cmpint (cogl_texture_get_height (texture), ==, 64);
+
+  /* keep the texture alive, so that a new allocation cannot end up
+   * at the same address once the pool lets go of it
+   */
+  cogl_object_ref (texture);
+
+  _clutter_offscreen_pool_get_usage (pool, &used_bytes, &free_bytes);
+  g_assert_cmpuint (used_bytes, ==, TARGET_BYTES (64, 64));
+  g_assert_cmpuint (free_bytes, ==, 0);
+
+  _clutter_offscreen_pool_release (pool, texture, offscreen);
+
+  _clutter_offscreen_pool_get_usage (pool, &used_bytes, &free_bytes);
+  g_assert_cmpuint (used_bytes, ==, 0);
+  g_assert_cmpuint (free_bytes, ==, TARGET_BYTES (64, 64));
+
+  /* a render target of the same size is reused */
+  g_assert (_clutter_offscreen_pool_acquire (pool, 64, 64,
+                                             &reused, &reused_offscreen));
+  g_assert (reused == texture);
+  g_assert (reused_offscreen == offscreen);
+
+  _clutter_offscreen_pool_get_usage (pool, &used_bytes, &free_bytes);
+  g_assert_cmpuint (used_bytes, ==, TARGET_BYTES (64, 64));
+  g_assert_cmpuint (free_bytes, ==, 0);
+
+  /* a different size needs a new one */
+  g_assert (_clutter_offscreen_pool_acquire (pool, 32, 32,
+                                             &small_texture, &small_offscreen));
+  g_assert (small_texture != texture);
+  g_assert_cmpint (cogl_texture_get_width (small_texture), ==, 32);
+  cogl_object_ref (small_texture);
+
+  _clutter_offscreen_pool_get_usage (pool, &used_bytes, &free_bytes);
+  g_assert_cmpuint (used_bytes, ==, TARGET_BYTES (64, 64) + TARGET_BYTES (32, 32));
+
+  _clutter_offscreen_pool_release (pool, reused, reused_offscreen);
+  _clutter_offscreen_pool_release (pool, small_texture, small_offscreen);
+
+  _clutter_offscreen_pool_get_usage (pool, &used_bytes, &free_bytes);
+  g_assert_cmpuint (used_bytes, ==, 0);
+  g_assert_cmpuint (free_bytes, ==, TARGET_BYTES (64, 64) + TARGET_BYTES (32, 32));
+
+  cogl_object_unref (small_texture);
+  cogl_object_unref (texture);
+
+  _clutter_offscreen_pool_trim (pool, 0);
+}
+
+static void
+actor_offscreen_pool_trim (void)
+{
+  ClutterOffscreenPool *pool = _clutter_offscreen_pool_get_default ();
+  CoglTexture *large_texture, *small_texture, *texture;
+  CoglOffscreen *large_offscreen, *small_offscreen, *offscreen;
+  gsize used_bytes, free_bytes;
+
+  _clutter_offscreen_pool_trim (pool, 0);
+
+  g_assert (_clutter_offscreen_pool_acquire (pool, 64, 64,
+                                             &large_texture,
+                                             &large_offscreen));
+  g_assert (_clutter_offscreen_pool_acquire (pool, 32, 32,
+                                             &small_texture,
+                                             &small_offscreen));
+  cogl_object_ref (large_texture);
+  cogl_object_ref (small_texture);
+
+  /* the large render target is the least recently released one */
+  _clutter_offscreen_pool_release (pool, large_texture, large_offscreen);
+  _clutter_offscreen_pool_release (pool, small_texture, small_offscreen);
+
+  /* trimming to the size of the small target evicts the large one */
+  _clutter_offscreen_pool_trim (pool, TARGET_BYTES (32, 32));
+
+  _clutter_offscreen_pool_get_usage (pool, &used_bytes, &free_bytes);
+  g_assert_cmpuint (used_bytes, ==, 0);
+  g_assert_cmpuint (free_bytes, ==, TARGET_BYTES (32, 32));
+
+  g_assert (_clutter_offscreen_pool_acquire (pool, 64, 64,
+                                             &texture, &offscreen));
+  g_assert (texture != large_texture);
+  _clutter_offscreen_pool_release (pool, texture, offscreen);
+
+  g_assert (_clutter_offscreen_pool_acquire (pool, 32, 32,
+                                             &texture, &offscreen));
+  g_assert (texture == small_texture);
+  _clutter_offscreen_pool_release (pool, texture, offscreen);
+
+  /* trimming to nothing empties the pool */
+  _clutter_offscreen_pool_trim (pool, 0);
+
+  _clutter_offscreen_pool_get_usage (pool, &used_bytes, &free_bytes);
+  g_assert_cmpuint (used_bytes, ==, 0);
+  g_assert_cmpuint (free_bytes, ==, 0);
+
+  g_assert (_clutter_offscreen_pool_acquire (pool, 32, 32,
+                                             &texture, &offscreen));
+  g_assert (texture != small_texture);
+  _clutter_offscreen_pool_release (pool, texture, offscreen);
+
+  cogl_object_unref (small_texture);
+  cogl_object_unref (large_texture);
+
+  _clutter_offscreen_pool_trim (pool, 0);
+}
+
+static void
+actor_offscreen_pool_effect (void)
+{
+  ClutterActor *stage = clutter_test_get_stage ();
+  ClutterActor *first, *second;
+  ClutterEffect *effect;
+  CoglHandle texture;
+  ClutterPoint point;
+  ClutterColor color;
+
+  _clutter_offscreen_pool_trim (_clutter_offscreen_pool_get_default (), 0);
+
+  first = clutter_actor_new ();
+  clutter_actor_set_background_color (first, CLUTTER_COLOR_Red);
+  clutter_actor_set_size (first, 100, 100);
+  clutter_actor_add_child (stage, first);
+
+  second = clutter_actor_new ();
+  clutter_actor_set_background_color (second, CLUTTER_COLOR_Red);
+  clutter_actor_set_position (second, 200, 0);
+  clutter_actor_set_size (second, 100, 100);
+  clutter_actor_add_child (stage, second);
+
+  effect = clutter_desaturate_effect_new (0.0);
+  g_object_ref (effect);
+  clutter_actor_add_effect (first, effect);
+
+  clutter_point_init (&point, 50, 50);
+  g_assert (clutter_test_check_color_at_point (stage, &point,
+                                               CLUTTER_COLOR_Red,
+                                               &color));
+
+  texture = clutter_offscreen_effect_get_texture (CLUTTER_OFFSCREEN_EFFECT (effect));
+  g_assert (texture != NULL);
+  cogl_object_ref (texture);
+
+  /* moving the effect to an actor of the same size reuses the render
+   * target it gave back to the pool
+   */
+  clutter_actor_remove_effect (first, effect);
+  clutter_actor_add_effect (second, effect);
+
+  clutter_point_init (&point, 250, 50);
+  g_assert (clutter_test_check_color_at_point (stage, &point,
+                                               CLUTTER_COLOR_Red,
+                                               &color));
+
+  g_assert (clutter_offscreen_effect_get_texture (CLUTTER_OFFSCREEN_EFFECT (effect)) == texture);
+
+  cogl_object_unref (texture);
+  g_object_unref (effect);
+
+  clutter_actor_destroy (second);
+  clutter_actor_destroy (first);
+
+  _clutter_offscreen_pool_trim (_clutter_offscreen_pool_get_default (), 0);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/actor/offscreen/pool/reuse", actor_offscreen_pool_reuse)
+  CLUTTER_TEST_UNIT ("/actor/offscreen/pool/trim", actor_offscreen_pool_trim)
+  CLUTTER_TEST_UNIT ("/actor/offscreen/pool/effect", actor_offscreen_pool_effect)
+)
@@ -0,0 +1,275 @@
+#include <math.h>
+#include <clutter/clutter.h>
+
+#include "clutter/clutter-animation-engine.h"
+
+typedef struct
+{
+  ClutterActor *actor;
+  ClutterTransition *transition;
+
+  guint n_animations;
+
+  guint n_frames;
+  guint n_intermediate;
+  float last_value;
+} IntermediateData;
+
+static void
+on_transition_stopped (ClutterActor *actor,
+                       const char   *name,
+                       gboolean      is_finished)
+{
+  if (g_test_verbose ())
+    g_print ("Transition '%s' stopped (finished: %s)\n",
+             name,
+             is_finished ? "yes" : "no");
+}
+
+static void
+actor_transitions_final_state (void)
+{
+  ClutterActor *stage = clutter_test_get_stage ();
+  ClutterActor *actor;
+  float translation_x;
+  double angle;
+
+  actor = clutter_actor_new ();
+  clutter_actor_set_size (actor, 100, 100);
+  clutter_actor_add_child (stage, actor);
+
+  g_signal_connect (actor, "transition-stopped",
+                    G_CALLBACK (on_transition_stopped),
+                    NULL);
+  g_signal_connect (actor, "transitions-completed",
+                    G_CALLBACK (clutter_main_quit),
+                    NULL);
+
+  clutter_actor_save_easing_state (actor);
+  clutter_actor_set_easing_duration (actor, 100);
+  clutter_actor_set_easing_mode (actor, CLUTTER_EASE_OUT_BACK);
+
+  /* all of these go through the animation engine */
+  clutter_actor_set_x (actor, 200);
+  clutter_actor_set_y (actor, 150);
+  clutter_actor_set_opacity (actor, 64);
+  clutter_actor_set_scale (actor, 2.0, 0.5);
+  clutter_actor_set_translation (actor, 10, 20, 0);
+  clutter_actor_set_rotation_angle (actor, CLUTTER_Z_AXIS, 90.0);
+
+  /* while this uses the generic code path */
+  clutter_actor_set_width (actor, 50);
+
+  clutter_actor_restore_easing_state (actor);
+
+  clutter_actor_show (stage);
+  clutter_main ();
+
+  g_assert_cmpfloat (clutter_actor_get_x (actor), ==, 200);
+  g_assert_cmpfloat (clutter_actor_get_y (actor), ==, 150);
+  g_assert_cmpfloat (clutter_actor_get_width (actor), ==, 50);
+  g_assert_cmpint (clutter_actor_get_opacity (actor), ==, 64);
+
+  clutter_actor_get_translation (actor, &translation_x, NULL, NULL);
+  g_assert_cmpfloat (translation_x, ==, 10);
+
+  angle = clutter_actor_get_rotation_angle (actor, CLUTTER_Z_AXIS);
+  g_assert_cmpfloat (angle, ==, 90.0);
+
+  g_object_get (actor, "scale-x", &angle, NULL);
+  g_assert_cmpfloat (angle, ==, 2.0);
+
+  clutter_actor_destroy (actor);
+}
+
+static void
+actor_transitions_remove (void)
+{
+  ClutterActor *stage = clutter_test_get_stage ();
+  ClutterTransition *transition;
+  ClutterActor *actor;
+
+  actor = clutter_actor_new ();
+  clutter_actor_add_child (stage, actor);
+
+  clutter_actor_save_easing_state (actor);
+  clutter_actor_set_easing_duration (actor, 200);
+  clutter_actor_set_easing_mode (actor, CLUTTER_LINEAR);
+  clutter_actor_set_x (actor, 100);
+  clutter_actor_restore_easing_state (actor);
+
+  transition = clutter_actor_get_transition (actor, "x");
+  g_assert (CLUTTER_IS_PROPERTY_TRANSITION (transition));
+
+  /* removing a transition that has not been advanced yet must
+   * not leave a dangling slot inside the engine
+   */
+  clutter_actor_remove_transition (actor, "x");
+  g_assert_null (clutter_actor_get_transition (actor, "x"));
+
+  clutter_actor_destroy (actor);
+}
+
+static void
+check_intermediate_value (IntermediateData *data)
+{
+  ClutterAnimationEngine *engine = _clutter_animation_engine_get_default ();
+  double progress;
+  float value;
+
+  /* the transition is in the batched animation engine */
+  g_assert_cmpuint (_clutter_animation_engine_get_n_animations (engine),
+                    ==,
+                    data->n_animations + 1);
+
+  progress = clutter_timeline_get_progress (CLUTTER_TIMELINE (data->transition));
+  value = clutter_actor_get_x (data->actor);
+
+  if (g_test_verbose ())
+    g_print ("Frame %u: progress %.3f, x %.3f\n",
+             data->n_frames, progress, value);
+
+  /* the value seen by the handlers is the one of the current frame */
+  g_assert_cmpfloat (fabs (value - 100.0 * progress), <, 0.01);
+  g_assert_cmpfloat (value, >=, data->last_value);
+
+  if (value > 0.0 && value < 100.0)
+    data->n_intermediate += 1;
+
+  data->n_frames += 1;
+  data->last_value = value;
+}
+
+static void
+on_transition_new_frame (ClutterTimeline  *timeline,
+                         int               elapsed,
+                         IntermediateData *data)
+{
+  check_intermediate_value (data);
+}
+
+static void
+on_observer_new_frame (ClutterTimeline  *timeline,
+                       int               elapsed,
+                       IntermediateData *data)
+{
+  /* the transition has not been advanced yet, or it is done */
+  if (data->transition == NULL ||
+      !clutter_timeline_is_playing (CLUTTER_TIMELINE (data->transition)) ||
+      clutter_timeline_get_elapsed_time (CLUTTER_TIMELINE (data->transition)) == 0)
+    return;
+
+  check_intermediate_value (data);
+}
+
+static void
+on_transitions_completed (ClutterActor     *actor,
+                          IntermediateData *data)
+{
+  data->transition = NULL;
+
+  clutter_main_quit ();
+}
+
+static ClutterTransition *
+start_intermediate_transition (IntermediateData *data)
+{
+  ClutterActor *stage = clutter_test_get_stage ();
+  ClutterTransition *transition;
+
+  data->actor = clutter_actor_new ();
+  clutter_actor_set_size (data->actor, 100, 100);
+  clutter_actor_add_child (stage, data->actor);
+
+  g_signal_connect (data->actor, "transitions-completed",
+                    G_CALLBACK (on_transitions_completed),
+                    data);
+
+  data->n_animations =
+    _clutter_animation_engine_get_n_animations (_clutter_animation_engine_get_default ());
+
+  clutter_actor_save_easing_state (data->actor);
+  clutter_actor_set_easing_duration (data->actor, 500);
+  clutter_actor_set_easing_mode (data->actor, CLUTTER_LINEAR);
+  clutter_actor_set_x (data->actor, 100);
+  clutter_actor_restore_easing_state (data->actor);
+
+  transition = clutter_actor_get_transition (data->actor, "x");
+  g_assert (CLUTTER_IS_PROPERTY_TRANSITION (transition));
+
+  data->transition = transition;
+
+  return transition;
+}
+
+static void
+finish_intermediate_transition (IntermediateData *data)
+{
+  ClutterAnimationEngine *engine = _clutter_animation_engine_get_default ();
+
+  g_assert_cmpuint (data->n_frames, >, 0);
+  g_assert_cmpuint (data->n_intermediate, >, 0);
+
+  g_assert_cmpfloat (clutter_actor_get_x (data->actor), ==, 100);
+
+  /* the slot is released once the transition is done */
+  g_assert_cmpuint (_clutter_animation_engine_get_n_animations (engine),
+                    ==,
+                    data->n_animations);
+
+  clutter_actor_destroy (data->actor);
+}
+
+static void
+actor_transitions_intermediate (void)
+{
+  IntermediateData data = { NULL, };
+  ClutterTransition *transition;
+
+  transition = start_intermediate_transition (&data);
+
+  /* handlers running after the transition see the value it has
+   * just computed, even if the engine is batching the updates
+   */
+  g_signal_connect_after (transition, "new-frame",
+                          G_CALLBACK (on_transition_new_frame),
+                          &data);
+
+  clutter_actor_show (clutter_test_get_stage ());
+  clutter_main ();
+
+  finish_intermediate_transition (&data);
+}
+
+static void
+actor_transitions_intermediate_other_timeline (void)
+{
+  IntermediateData data = { NULL, };
+  ClutterTimeline *observer;
+
+  /* timelines are advanced in the reverse order in which they have
+   * been started, so the observer is advanced after the transition
+   */
+  observer = clutter_timeline_new (1000);
+  g_signal_connect (observer, "new-frame",
+                    G_CALLBACK (on_observer_new_frame),
+                    &data);
+  clutter_timeline_start (observer);
+
+  start_intermediate_transition (&data);
+
+  clutter_actor_show (clutter_test_get_stage ());
+  clutter_main ();
+
+  clutter_timeline_stop (observer);
+  g_object_unref (observer);
+
+  finish_intermediate_transition (&data);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/actor/transitions/final-state", actor_transitions_final_state)
+  CLUTTER_TEST_UNIT ("/actor/transitions/remove", actor_transitions_remove)
+  CLUTTER_TEST_UNIT ("/actor/transitions/intermediate", actor_transitions_intermediate)
+  CLUTTER_TEST_UNIT ("/actor/transitions/intermediate-other-timeline", actor_transitions_intermediate_other_timeline)
+)
@@ -0,0 +1,246 @@
+#include <clutter/clutter.h>
+
+typedef struct
+{
+  ClutterActor *stage;
+  ClutterActor *actor;
+  ClutterContent *canvas;
+
+  /* the color used by the next draw */
+  const ClutterColor *color;
+
+  /* held by the test to keep the draws from completing */
+  GMutex gate;
+
+  GMutex lock;
+  GCond cond;
+  GThread *draw_thread;
+  int n_started;
+  int n_finished;
+} DrawAsyncData;
+
+static gboolean
+on_canvas_draw (ClutterCanvas *canvas,
+                cairo_t       *cr,
+                int            width,
+                int            height,
+                DrawAsyncData *data)
+{
+  const ClutterColor *color;
+
+  g_mutex_lock (&data->lock);
+  data->draw_thread = g_thread_self ();
+  data->n_started += 1;
+  color = data->color;
+  g_cond_signal (&data->cond);
+  g_mutex_unlock (&data->lock);
+
+  g_mutex_lock (&data->gate);
+  g_mutex_unlock (&data->gate);
+
+  clutter_cairo_set_source_color (cr, color);
+  cairo_paint (cr);
+
+  g_mutex_lock (&data->lock);
+  data->n_finished += 1;
+  g_mutex_unlock (&data->lock);
+
+  return TRUE;
+}
+
+static void
+set_draw_color (DrawAsyncData      *data,
+                const ClutterColor *color)
+{
+  g_mutex_lock (&data->lock);
+  data->color = color;
+  g_mutex_unlock (&data->lock);
+}
+
+static void
+wait_for_started_draws (DrawAsyncData *data,
+                        int            n_started)
+{
+  g_mutex_lock (&data->lock);
+  while (data->n_started < n_started)
+    g_cond_wait (&data->cond, &data->lock);
+  g_mutex_unlock (&data->lock);
+}
+
+static int
+get_started_draws (DrawAsyncData *data)
+{
+  int n_started;
+
+  g_mutex_lock (&data->lock);
+  n_started = data->n_started;
+  g_mutex_unlock (&data->lock);
+
+  return n_started;
+}
+
+static void
+wait_for_finished_draws (DrawAsyncData *data,
+                         int            n_finished)
+{
+  g_mutex_lock (&data->lock);
+
+  while (data->n_finished < n_finished)
+    {
+      g_mutex_unlock (&data->lock);
+
+      /* the completed draws are applied from the main loop */
+      while (g_main_context_pending (NULL))
+        g_main_context_iteration (NULL, FALSE);
+
+      g_usleep (1000);
+
+      g_mutex_lock (&data->lock);
+    }
+
+  g_mutex_unlock (&data->lock);
+}
+
+static gboolean
+wait_for_color (ClutterActor       *stage,
+                const ClutterPoint *point,
+                const ClutterColor *expected)
+{
+  ClutterColor color;
+  int i;
+
+  /* the last draw is applied in an idle, which can run after the
+   * next paint
+   */
+  for (i = 0; i < 10; i++)
+    {
+      clutter_actor_queue_redraw (stage);
+
+      if (clutter_test_check_color_at_point (stage, point, expected, &color))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+draw_async_data_init (DrawAsyncData *data)
+{
+  g_mutex_init (&data->gate);
+  g_mutex_init (&data->lock);
+  g_cond_init (&data->cond);
+
+  data->stage = clutter_test_get_stage ();
+
+  data->canvas = clutter_canvas_new ();
+  clutter_canvas_set_draw_async (CLUTTER_CANVAS (data->canvas), TRUE);
+  g_assert (clutter_canvas_get_draw_async (CLUTTER_CANVAS (data->canvas)));
+  g_signal_connect (data->canvas, "draw",
+                    G_CALLBACK (on_canvas_draw),
+                    data);
+
+  data->actor = clutter_actor_new ();
+  clutter_actor_set_size (data->actor, 64, 64);
+  clutter_actor_set_content (data->actor, data->canvas);
+  clutter_actor_add_child (data->stage, data->actor);
+}
+
+static void
+draw_async_data_clear (DrawAsyncData *data)
+{
+  clutter_actor_destroy (data->actor);
+  g_object_unref (data->canvas);
+
+  g_cond_clear (&data->cond);
+  g_mutex_clear (&data->lock);
+  g_mutex_clear (&data->gate);
+}
+
+static void
+canvas_draw_async (void)
+{
+  DrawAsyncData data = { NULL, };
+  ClutterPoint point;
+  ClutterColor color;
+
+  draw_async_data_init (&data);
+  clutter_point_init (&point, 32, 32);
+
+  g_mutex_lock (&data.gate);
+
+  set_draw_color (&data, CLUTTER_COLOR_Red);
+  clutter_canvas_set_size (CLUTTER_CANVAS (data.canvas), 64, 64);
+
+  /* the draw happens in a worker thread... */
+  wait_for_started_draws (&data, 1);
+  g_assert (data.draw_thread != g_thread_self ());
+
+  /* ... and the previous contents are painted until it completes */
+  clutter_actor_queue_redraw (data.stage);
+  g_assert (!clutter_test_check_color_at_point (data.stage, &point,
+                                                CLUTTER_COLOR_Red,
+                                                &color));
+
+  /* invalidating the canvas while it is being drawn does not start
+   * a new draw right away, and the invalidations are coalesced
+   */
+  set_draw_color (&data, CLUTTER_COLOR_Green);
+  clutter_content_invalidate (data.canvas);
+  clutter_content_invalidate (data.canvas);
+
+  while (g_main_context_pending (NULL))
+    g_main_context_iteration (NULL, FALSE);
+
+  g_assert_cmpint (get_started_draws (&data), ==, 1);
+
+  /* once the first draw completes, a single new one is started */
+  g_mutex_unlock (&data.gate);
+
+  wait_for_finished_draws (&data, 2);
+  g_assert (wait_for_color (data.stage, &point, CLUTTER_COLOR_Green));
+
+  g_assert_cmpint (get_started_draws (&data), ==, 2);
+
+  draw_async_data_clear (&data);
+}
+
+static void
+canvas_draw_async_resize (void)
+{
+  DrawAsyncData data = { NULL, };
+  ClutterPoint point;
+
+  draw_async_data_init (&data);
+
+  g_mutex_lock (&data.gate);
+
+  set_draw_color (&data, CLUTTER_COLOR_Red);
+  clutter_canvas_set_size (CLUTTER_CANVAS (data.canvas), 64, 64);
+  wait_for_started_draws (&data, 1);
+
+  /* a size change cancels the running draw, and starts a new one
+   * without waiting for it to complete
+   */
+  set_draw_color (&data, CLUTTER_COLOR_Green);
+  clutter_canvas_set_size (CLUTTER_CANVAS (data.canvas), 32, 32);
+
+  g_mutex_unlock (&data.gate);
+
+  wait_for_finished_draws (&data, 2);
+
+  /* the result of the cancelled draw is discarded */
+  clutter_point_init (&point, 16, 16);
+  g_assert (wait_for_color (data.stage, &point, CLUTTER_COLOR_Green));
+
+  clutter_point_init (&point, 48, 48);
+  g_assert (wait_for_color (data.stage, &point, CLUTTER_COLOR_Green));
+
+  g_assert_cmpint (get_started_draws (&data), ==, 2);
+
+  draw_async_data_clear (&data);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/canvas/draw-async", canvas_draw_async)
+  CLUTTER_TEST_UNIT ("/canvas/draw-async/resize", canvas_draw_async_resize)
+)
@@ -62,7 +62,9 @@ test_shader_effects_main (int argc, char *argv[])
   clutter_text_set_line_alignment (CLUTTER_TEXT (label), PANGO_ALIGN_CENTER);
   clutter_actor_set_position (label, 336, 275);
   clutter_actor_set_size (label, 500, 100);
+  clutter_actor_add_effect_with_name (label, "dual-blur", clutter_dual_blur_effect_new (0.0));
   clutter_actor_animate_with_timeline (label, CLUTTER_LINEAR, timeline,
+                                       "@effects.dual-blur.radius", 32.0,
                                        "rotation-angle-z", 360.0,
                                        "fixed::anchor-x", 86.0,
                                        "fixed::anchor-y", 125.0,
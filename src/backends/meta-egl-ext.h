@@ -99,4 +99,40 @@ typedef EGLBoolean (EGLAPIENTRYP PFNEGLSTREAMCONSUMERRELEASEATTRIBNVPROC) (EGLDi
 #define EGL_WAYLAND_EGLSTREAM_WL              0x334B
 #endif /* EGL_WL_wayland_eglstream */
 
+#ifndef EGL_EXT_image_dma_buf_import
+#define EGL_EXT_image_dma_buf_import 1
+#define EGL_LINUX_DMA_BUF_EXT                 0x3270
+#define EGL_LINUX_DRM_FOURCC_EXT              0x3271
+#define EGL_DMA_BUF_PLANE0_FD_EXT             0x3272
+#define EGL_DMA_BUF_PLANE0_OFFSET_EXT         0x3273
+#define EGL_DMA_BUF_PLANE0_PITCH_EXT          0x3274
+#define EGL_DMA_BUF_PLANE1_FD_EXT             0x3275
+#define EGL_DMA_BUF_PLANE1_OFFSET_EXT         0x3276
+#define EGL_DMA_BUF_PLANE1_PITCH_EXT          0x3277
+#define EGL_DMA_BUF_PLANE2_FD_EXT             0x3278
+#define EGL_DMA_BUF_PLANE2_OFFSET_EXT         0x3279
+#define EGL_DMA_BUF_PLANE2_PITCH_EXT          0x327A
+#endif /* EGL_EXT_image_dma_buf_import */
+
+#ifndef EGL_EXT_image_dma_buf_import_modifiers
+#define EGL_EXT_image_dma_buf_import_modifiers 1
+#define EGL_DMA_BUF_PLANE3_FD_EXT             0x3440
+#define EGL_DMA_BUF_PLANE3_OFFSET_EXT         0x3441
+#define EGL_DMA_BUF_PLANE3_PITCH_EXT          0x3442
+#define EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT    0x3443
+#define EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT    0x3444
+#define EGL_DMA_BUF_PLANE1_MODIFIER_LO_EXT    0x3445
+#define EGL_DMA_BUF_PLANE1_MODIFIER_HI_EXT    0x3446
+#define EGL_DMA_BUF_PLANE2_MODIFIER_LO_EXT    0x3447
+#define EGL_DMA_BUF_PLANE2_MODIFIER_HI_EXT    0x3448
+#define EGL_DMA_BUF_PLANE3_MODIFIER_LO_EXT    0x3449
+#define EGL_DMA_BUF_PLANE3_MODIFIER_HI_EXT    0x344A
+typedef EGLBoolean (EGLAPIENTRYP PFNEGLQUERYDMABUFFORMATSEXTPROC) (EGLDisplay dpy, EGLint max_formats, EGLint *formats, EGLint *num_formats);
+typedef EGLBoolean (EGLAPIENTRYP PFNEGLQUERYDMABUFMODIFIERSEXTPROC) (EGLDisplay dpy, EGLint format, EGLint max_modifiers, EGLuint64KHR *modifiers, EGLBoolean *external_only, EGLint *num_modifiers);
+#ifdef EGL_EGLEXT_PROTOTYPES
+EGLAPI EGLBoolean EGLAPIENTRY eglQueryDmaBufFormatsEXT (EGLDisplay dpy, EGLint max_formats, EGLint *formats, EGLint *num_formats);
+EGLAPI EGLBoolean EGLAPIENTRY eglQueryDmaBufModifiersEXT (EGLDisplay dpy, EGLint format, EGLint max_modifiers, EGLuint64KHR *modifiers, EGLBoolean *external_only, EGLint *num_modifiers);
+#endif
+#endif /* EGL_EXT_image_dma_buf_import_modifiers */
+
 #endif /* META_EGL_EXT_H */
@@ -46,6 +46,9 @@ struct _MetaEgl
 
   PFNEGLQUERYWAYLANDBUFFERWL eglQueryWaylandBufferWL;
 
+  PFNEGLQUERYDMABUFFORMATSEXTPROC eglQueryDmaBufFormatsEXT;
+  PFNEGLQUERYDMABUFMODIFIERSEXTPROC eglQueryDmaBufModifiersEXT;
+
   PFNEGLQUERYDEVICESEXTPROC eglQueryDevicesEXT;
   PFNEGLQUERYDEVICESTRINGEXTPROC eglQueryDeviceStringEXT;
 
@@ -412,6 +415,51 @@ meta_egl_query_wayland_buffer (MetaEgl            *egl,
   return TRUE;
 }
 
+gboolean
+meta_egl_query_dma_buf_formats (MetaEgl    *egl,
+                                EGLDisplay  display,
+                                EGLint      max_formats,
+                                EGLint     *formats,
+                                EGLint     *num_formats,
+                                GError    **error)
+{
+  if (!is_egl_proc_valid (egl->eglQueryDmaBufFormatsEXT, error))
+    return FALSE;
+
+  if (!egl->eglQueryDmaBufFormatsEXT (display, max_formats, formats,
+                                      num_formats))
+    {
+      set_egl_error (error);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+gboolean
+meta_egl_query_dma_buf_modifiers (MetaEgl      *egl,
+                                  EGLDisplay    display,
+                                  EGLint        format,
+                                  EGLint        max_modifiers,
+                                  EGLuint64KHR *modifiers,
+                                  EGLBoolean   *external_only,
+                                  EGLint       *num_modifiers,
+                                  GError      **error)
+{
+  if (!is_egl_proc_valid (egl->eglQueryDmaBufModifiersEXT, error))
+    return FALSE;
+
+  if (!egl->eglQueryDmaBufModifiersEXT (display, format, max_modifiers,
+                                        modifiers, external_only,
+                                        num_modifiers))
+    {
+      set_egl_error (error);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
 gboolean
 meta_egl_query_devices (MetaEgl      *egl,
                         EGLint        max_devices,
@@ -733,6 +781,9 @@ meta_egl_constructed (GObject *object)
 
   GET_EGL_PROC_ADDR (eglQueryWaylandBufferWL);
 
+  GET_EGL_PROC_ADDR (eglQueryDmaBufFormatsEXT);
+  GET_EGL_PROC_ADDR (eglQueryDmaBufModifiersEXT);
+
   GET_EGL_PROC_ADDR (eglQueryDevicesEXT);
   GET_EGL_PROC_ADDR (eglQueryDeviceStringEXT);
 
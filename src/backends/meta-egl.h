@@ -84,6 +84,22 @@ gboolean meta_egl_query_wayland_buffer (MetaEgl            *egl,
                                         EGLint             *value,
                                         GError            **error);
 
+gboolean meta_egl_query_dma_buf_formats (MetaEgl    *egl,
+                                         EGLDisplay  display,
+                                         EGLint      max_formats,
+                                         EGLint     *formats,
+                                         EGLint     *num_formats,
+                                         GError    **error);
+
+gboolean meta_egl_query_dma_buf_modifiers (MetaEgl      *egl,
+                                           EGLDisplay    display,
+                                           EGLint        format,
+                                           EGLint        max_modifiers,
+                                           EGLuint64KHR *modifiers,
+                                           EGLBoolean   *external_only,
+                                           EGLint       *num_modifiers,
+                                           GError      **error);
+
 gboolean meta_egl_query_devices (MetaEgl      *egl,
                                  EGLint        max_devices,
                                  EGLDeviceEXT *devices,
@@ -61,8 +61,27 @@
  */
 #define HW_CURSOR_BUFFER_COUNT 3
 
+/* Cursor buffers are shared by all sprites showing the same image, and
+ * kept around for reuse once unused, up to this many of them.
+ */
+#define MAX_CACHED_CURSOR_BOS 32
+
 static GQuark quark_cursor_sprite = 0;
 
+typedef struct _MetaCursorGbmBo
+{
+  int ref_count;
+  struct gbm_bo *bo;
+
+  /* The image the buffer was filled with, or NULL if imported */
+  GBytes *pixels;
+  uint32_t gbm_format;
+  uint width;
+  uint height;
+
+  GList lru_link;
+} MetaCursorGbmBo;
+
 struct _MetaCursorRendererNativePrivate
 {
   gboolean hw_state_invalidated;
@@ -77,7 +96,22 @@ struct _MetaCursorRendererNativePrivate
 
   uint64_t cursor_width;
   uint64_t cursor_height;
+
+  /* Uploaded cursor images, least recently used first in the queue */
+  GHashTable *bo_cache;
+  GQueue bo_cache_lru;
+
+  /* The hotspot last set on each CRTC, by CRTC id; sprites showing the
+   * same image share a buffer, but not necessarily the hotspot.
+   */
+  GHashTable *crtc_hotspots;
 };
+
+typedef struct _MetaCursorHotspot
+{
+  int x;
+  int y;
+} MetaCursorHotspot;
 typedef struct _MetaCursorRendererNativePrivate MetaCursorRendererNativePrivate;
 
 typedef enum _MetaCursorGbmBoState
@@ -91,7 +125,7 @@ typedef struct _MetaCursorNativePrivate
 {
   guint active_bo;
   MetaCursorGbmBoState pending_bo_state;
-  struct gbm_bo *bos[HW_CURSOR_BUFFER_COUNT];
+  MetaCursorGbmBo *bos[HW_CURSOR_BUFFER_COUNT];
 } MetaCursorNativePrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (MetaCursorRendererNative, meta_cursor_renderer_native, META_TYPE_CURSOR_RENDERER);
@@ -99,6 +133,93 @@ G_DEFINE_TYPE_WITH_PRIVATE (MetaCursorRendererNative, meta_cursor_renderer_nativ
 static MetaCursorNativePrivate *
 ensure_cursor_priv (MetaCursorSprite *cursor_sprite);
 
+static MetaCursorGbmBo *
+cursor_gbm_bo_new (struct gbm_bo *bo,
+                   GBytes        *pixels,
+                   uint32_t       gbm_format,
+                   uint           width,
+                   uint           height)
+{
+  MetaCursorGbmBo *cursor_bo;
+
+  cursor_bo = g_slice_new0 (MetaCursorGbmBo);
+  cursor_bo->ref_count = 1;
+  cursor_bo->bo = bo;
+  cursor_bo->pixels = pixels;
+  cursor_bo->gbm_format = gbm_format;
+  cursor_bo->width = width;
+  cursor_bo->height = height;
+  cursor_bo->lru_link.data = cursor_bo;
+
+  return cursor_bo;
+}
+
+static MetaCursorGbmBo *
+cursor_gbm_bo_ref (MetaCursorGbmBo *cursor_bo)
+{
+  cursor_bo->ref_count++;
+  return cursor_bo;
+}
+
+static void
+cursor_gbm_bo_unref (MetaCursorGbmBo *cursor_bo)
+{
+  cursor_bo->ref_count--;
+  if (cursor_bo->ref_count > 0)
+    return;
+
+  gbm_bo_destroy (cursor_bo->bo);
+  if (cursor_bo->pixels)
+    g_bytes_unref (cursor_bo->pixels);
+  g_slice_free (MetaCursorGbmBo, cursor_bo);
+}
+
+static guint
+cursor_gbm_bo_hash (gconstpointer key)
+{
+  const MetaCursorGbmBo *cursor_bo = key;
+
+  return (g_bytes_hash (cursor_bo->pixels) ^
+          cursor_bo->gbm_format ^
+          (cursor_bo->width << 16 | cursor_bo->height));
+}
+
+static gboolean
+cursor_gbm_bo_equal (gconstpointer a,
+                     gconstpointer b)
+{
+  const MetaCursorGbmBo *cursor_bo_a = a;
+  const MetaCursorGbmBo *cursor_bo_b = b;
+
+  return (cursor_bo_a->gbm_format == cursor_bo_b->gbm_format &&
+          cursor_bo_a->width == cursor_bo_b->width &&
+          cursor_bo_a->height == cursor_bo_b->height &&
+          g_bytes_equal (cursor_bo_a->pixels, cursor_bo_b->pixels));
+}
+
+static void
+trim_cursor_gbm_bo_cache (MetaCursorRendererNative *native)
+{
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+  GList *l;
+
+  l = priv->bo_cache_lru.head;
+  while (l && g_hash_table_size (priv->bo_cache) > MAX_CACHED_CURSOR_BOS)
+    {
+      MetaCursorGbmBo *cursor_bo = l->data;
+
+      l = l->next;
+
+      /* Still used by a cursor sprite */
+      if (cursor_bo->ref_count > 1)
+        continue;
+
+      g_queue_unlink (&priv->bo_cache_lru, &cursor_bo->lru_link);
+      g_hash_table_remove (priv->bo_cache, cursor_bo);
+    }
+}
+
 static void
 meta_cursor_renderer_native_finalize (GObject *object)
 {
@@ -108,6 +229,11 @@ meta_cursor_renderer_native_finalize (GObject *object)
   if (priv->animation_timeout_id)
     g_source_remove (priv->animation_timeout_id);
 
+  while (priv->bo_cache_lru.head)
+    g_queue_unlink (&priv->bo_cache_lru, priv->bo_cache_lru.head);
+  g_hash_table_destroy (priv->bo_cache);
+  g_hash_table_destroy (priv->crtc_hotspots);
+
   G_OBJECT_CLASS (meta_cursor_renderer_native_parent_class)->finalize (object);
 }
 
@@ -131,7 +257,10 @@ get_pending_cursor_sprite_gbm_bo (MetaCursorSprite *cursor_sprite)
     return NULL;
 
   pending_bo = get_pending_cursor_sprite_gbm_bo_index (cursor_sprite);
-  return cursor_priv->bos[pending_bo];
+  if (!cursor_priv->bos[pending_bo])
+    return NULL;
+
+  return cursor_priv->bos[pending_bo]->bo;
 }
 
 static struct gbm_bo *
@@ -140,15 +269,15 @@ get_active_cursor_sprite_gbm_bo (MetaCursorSprite *cursor_sprite)
   MetaCursorNativePrivate *cursor_priv =
     g_object_get_qdata (G_OBJECT (cursor_sprite), quark_cursor_sprite);
 
-  if (!cursor_priv)
+  if (!cursor_priv || !cursor_priv->bos[cursor_priv->active_bo])
     return NULL;
 
-  return cursor_priv->bos[cursor_priv->active_bo];
+  return cursor_priv->bos[cursor_priv->active_bo]->bo;
 }
 
 static void
 set_pending_cursor_sprite_gbm_bo (MetaCursorSprite *cursor_sprite,
-                                  struct gbm_bo    *bo)
+                                  MetaCursorGbmBo  *cursor_bo)
 {
   MetaCursorNativePrivate *cursor_priv;
   guint pending_bo;
@@ -156,7 +285,9 @@ set_pending_cursor_sprite_gbm_bo (MetaCursorSprite *cursor_sprite,
   cursor_priv = ensure_cursor_priv (cursor_sprite);
 
   pending_bo = get_pending_cursor_sprite_gbm_bo_index (cursor_sprite);
-  cursor_priv->bos[pending_bo] = bo;
+  g_clear_pointer (&cursor_priv->bos[pending_bo],
+                   (GDestroyNotify) cursor_gbm_bo_unref);
+  cursor_priv->bos[pending_bo] = cursor_bo;
   cursor_priv->pending_bo_state = META_CURSOR_GBM_BO_STATE_SET;
 }
 
@@ -171,6 +302,7 @@ set_crtc_cursor (MetaCursorRendererNative *native,
     {
       MetaCursorNativePrivate *cursor_priv =
         g_object_get_qdata (G_OBJECT (cursor_sprite), quark_cursor_sprite);
+      MetaCursorHotspot *hotspot;
       struct gbm_bo *bo;
       union gbm_bo_handle handle;
       int hot_x, hot_y;
@@ -180,23 +312,40 @@ set_crtc_cursor (MetaCursorRendererNative *native,
       else
         bo = get_active_cursor_sprite_gbm_bo (cursor_sprite);
 
-      if (!priv->hw_state_invalidated && bo == crtc->cursor_renderer_private)
-        return;
-
-      crtc->cursor_renderer_private = bo;
-
-      handle = gbm_bo_get_handle (bo);
       meta_cursor_sprite_get_hotspot (cursor_sprite, &hot_x, &hot_y);
 
-      if (drmModeSetCursor2 (priv->drm_fd, crtc->crtc_id, handle.u32,
-                             priv->cursor_width, priv->cursor_height,
-                             hot_x, hot_y) < 0)
+      hotspot = g_hash_table_lookup (priv->crtc_hotspots,
+                                     GINT_TO_POINTER (crtc->crtc_id));
+      if (!hotspot)
+        {
+          hotspot = g_new0 (MetaCursorHotspot, 1);
+          g_hash_table_insert (priv->crtc_hotspots,
+                               GINT_TO_POINTER (crtc->crtc_id), hotspot);
+        }
+
+      /* Cached buffers are shared, so the pending one may well be the
+       * one already shown, possibly with another hotspot.
+       */
+      if (priv->hw_state_invalidated ||
+          bo != crtc->cursor_renderer_private ||
+          hot_x != hotspot->x || hot_y != hotspot->y)
         {
-          g_warning ("drmModeSetCursor2 failed with (%s), "
-                     "drawing cursor with OpenGL from now on",
-                     strerror (errno));
-          priv->has_hw_cursor = FALSE;
-          priv->hw_cursor_broken = TRUE;
+          crtc->cursor_renderer_private = bo;
+          hotspot->x = hot_x;
+          hotspot->y = hot_y;
+
+          handle = gbm_bo_get_handle (bo);
+
+          if (drmModeSetCursor2 (priv->drm_fd, crtc->crtc_id, handle.u32,
+                                 priv->cursor_width, priv->cursor_height,
+                                 hot_x, hot_y) < 0)
+            {
+              g_warning ("drmModeSetCursor2 failed with (%s), "
+                         "drawing cursor with OpenGL from now on",
+                         strerror (errno));
+              priv->has_hw_cursor = FALSE;
+              priv->hw_cursor_broken = TRUE;
+            }
         }
 
       if (cursor_priv->pending_bo_state == META_CURSOR_GBM_BO_STATE_SET)
@@ -566,7 +715,7 @@ cursor_priv_free (gpointer data)
     return;
 
   for (i = 0; i < HW_CURSOR_BUFFER_COUNT; i++)
-    g_clear_pointer (&cursor_priv->bos[0], (GDestroyNotify) gbm_bo_destroy);
+    g_clear_pointer (&cursor_priv->bos[i], (GDestroyNotify) cursor_gbm_bo_unref);
   g_slice_free (MetaCursorNativePrivate, cursor_priv);
 }
 
@@ -613,30 +762,66 @@ load_cursor_sprite_gbm_buffer (MetaCursorRendererNative *native,
   if (gbm_device_is_format_supported (priv->gbm, gbm_format,
                                       GBM_BO_USE_CURSOR | GBM_BO_USE_WRITE))
     {
-      struct gbm_bo *bo;
-      uint8_t buf[4 * cursor_width * cursor_height];
+      MetaCursorGbmBo *cursor_bo;
+      MetaCursorGbmBo key;
+      uint8_t *image;
       uint i;
 
-      bo = gbm_bo_create (priv->gbm, cursor_width, cursor_height,
-                          gbm_format, GBM_BO_USE_CURSOR | GBM_BO_USE_WRITE);
-      if (!bo)
+      image = g_malloc (width * height * 4);
+      for (i = 0; i < height; i++)
+        memcpy (image + i * width * 4, pixels + i * rowstride, width * 4);
+
+      key = (MetaCursorGbmBo) {
+        .pixels = g_bytes_new_take (image, width * height * 4),
+        .gbm_format = gbm_format,
+        .width = width,
+        .height = height,
+      };
+
+      /* Animated cursors cycle through the same frames, and clients
+       * often switch between a few images; only upload each once.
+       */
+      cursor_bo = g_hash_table_lookup (priv->bo_cache, &key);
+      if (cursor_bo)
         {
-          meta_warning ("Failed to allocate HW cursor buffer\n");
-          return;
+          g_bytes_unref (key.pixels);
+          g_queue_unlink (&priv->bo_cache_lru, &cursor_bo->lru_link);
         }
-
-      memset (buf, 0, sizeof(buf));
-      for (i = 0; i < height; i++)
-        memcpy (buf + i * 4 * cursor_width, pixels + i * rowstride, width * 4);
-      if (gbm_bo_write (bo, buf, cursor_width * cursor_height * 4) != 0)
+      else
         {
-          meta_warning ("Failed to write cursors buffer data: %s",
-                        g_strerror (errno));
-          gbm_bo_destroy (bo);
-          return;
+          struct gbm_bo *bo;
+          uint8_t buf[4 * cursor_width * cursor_height];
+
+          bo = gbm_bo_create (priv->gbm, cursor_width, cursor_height,
+                              gbm_format, GBM_BO_USE_CURSOR | GBM_BO_USE_WRITE);
+          if (!bo)
+            {
+              meta_warning ("Failed to allocate HW cursor buffer\n");
+              g_bytes_unref (key.pixels);
+              return;
+            }
+
+          memset (buf, 0, sizeof(buf));
+          for (i = 0; i < height; i++)
+            memcpy (buf + i * 4 * cursor_width, image + i * width * 4, width * 4);
+          if (gbm_bo_write (bo, buf, cursor_width * cursor_height * 4) != 0)
+            {
+              meta_warning ("Failed to write cursors buffer data: %s",
+                            g_strerror (errno));
+              gbm_bo_destroy (bo);
+              g_bytes_unref (key.pixels);
+              return;
+            }
+
+          cursor_bo = cursor_gbm_bo_new (bo, key.pixels,
+                                         gbm_format, width, height);
+          g_hash_table_add (priv->bo_cache, cursor_bo);
         }
 
-      set_pending_cursor_sprite_gbm_bo (cursor_sprite, bo);
+      g_queue_push_tail_link (&priv->bo_cache_lru, &cursor_bo->lru_link);
+      set_pending_cursor_sprite_gbm_bo (cursor_sprite,
+                                        cursor_gbm_bo_ref (cursor_bo));
+      trim_cursor_gbm_bo_cache (native);
     }
   else
     {
@@ -656,7 +841,7 @@ invalidate_pending_cursor_sprite_gbm_bo (MetaCursorSprite *cursor_sprite)
 
   pending_bo = get_pending_cursor_sprite_gbm_bo_index (cursor_sprite);
   g_clear_pointer (&cursor_priv->bos[pending_bo],
-                   (GDestroyNotify) gbm_bo_destroy);
+                   (GDestroyNotify) cursor_gbm_bo_unref);
   cursor_priv->pending_bo_state = META_CURSOR_GBM_BO_STATE_INVALIDATED;
 }
 
@@ -753,7 +938,10 @@ meta_cursor_renderer_native_realize_cursor_from_wl_buffer (MetaCursorRenderer *r
           return;
         }
 
-      set_pending_cursor_sprite_gbm_bo (cursor_sprite, bo);
+      set_pending_cursor_sprite_gbm_bo (cursor_sprite,
+                                        cursor_gbm_bo_new (bo, NULL,
+                                                           GBM_FORMAT_ARGB8888,
+                                                           width, height));
     }
 }
 #endif
@@ -830,6 +1018,13 @@ meta_cursor_renderer_native_init (MetaCursorRendererNative *native)
 
   priv->hw_state_invalidated = TRUE;
 
+  priv->bo_cache = g_hash_table_new_full (cursor_gbm_bo_hash,
+                                          cursor_gbm_bo_equal,
+                                          NULL,
+                                          (GDestroyNotify) cursor_gbm_bo_unref);
+  g_queue_init (&priv->bo_cache_lru);
+  priv->crtc_hotspots = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
 #if defined(CLUTTER_WINDOWING_EGL)
   if (clutter_check_windowing_backend (CLUTTER_WINDOWING_EGL))
     {
@@ -1058,6 +1058,12 @@ on_presented (ClutterStage     *stage,
 
       for (l = compositor->windows; l; l = l->next)
         meta_window_actor_frame_complete (l->data, frame_info, presentation_time);
+
+#ifdef HAVE_WAYLAND
+      if (meta_is_wayland_compositor ())
+        meta_wayland_compositor_presented (meta_wayland_compositor_get_default (),
+                                           frame_info);
+#endif
     }
 }
 
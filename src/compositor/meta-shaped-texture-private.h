@@ -39,7 +39,16 @@ void meta_shaped_texture_set_snippet (MetaShapedTexture *stex,
 void meta_shaped_texture_set_fallback_size (MetaShapedTexture *stex,
                                             guint              fallback_width,
                                             guint              fallback_height);
+void meta_shaped_texture_set_viewport_src_rect (MetaShapedTexture *stex,
+                                                ClutterRect       *src_rect);
+void meta_shaped_texture_reset_viewport_src_rect (MetaShapedTexture *stex);
+void meta_shaped_texture_set_viewport_dst_size (MetaShapedTexture *stex,
+                                                int                dst_width,
+                                                int                dst_height);
+void meta_shaped_texture_reset_viewport_dst_size (MetaShapedTexture *stex);
 gboolean meta_shaped_texture_is_obscured (MetaShapedTexture *self);
+gboolean meta_shaped_texture_update_region (MetaShapedTexture *stex,
+                                            cairo_region_t    *region);
 cairo_region_t * meta_shaped_texture_get_opaque_region (MetaShapedTexture *stex);
 
 #endif
@@ -30,6 +30,7 @@
 #include <meta/meta-shaped-texture.h>
 #include "meta-shaped-texture-private.h"
 
+#include <math.h>
 #include <cogl/cogl.h>
 #include <gdk/gdk.h> /* for gdk_rectangle_intersect() */
 
@@ -95,6 +96,17 @@ struct _MetaShapedTexturePrivate
   guint tex_width, tex_height;
   guint fallback_width, fallback_height;
 
+  /* The wp_viewporter source rectangle, in texture pixels, and the
+   * destination size, in the coordinate space of the actor. */
+  gboolean has_viewport_src_rect;
+  ClutterRect viewport_src_rect;
+  gboolean has_viewport_dst_size;
+  int viewport_dst_width, viewport_dst_height;
+
+  /* The size the texture is painted at, which is the texture size unless
+   * a viewport is set. */
+  int dst_width, dst_height;
+
   guint create_mipmaps : 1;
 };
 
@@ -149,8 +161,8 @@ set_unobscured_region (MetaShapedTexture *self,
 
       if (priv->texture)
         {
-          width = priv->tex_width;
-          height = priv->tex_height;
+          width = priv->dst_width;
+          height = priv->dst_height;
         }
       else
         {
@@ -297,23 +309,102 @@ get_unblended_pipeline (MetaShapedTexture *stex,
 }
 
 static void
-paint_clipped_rectangle (CoglFramebuffer       *fb,
-                         CoglPipeline          *pipeline,
-                         cairo_rectangle_int_t *rect,
-                         ClutterActorBox       *alloc)
+update_size (MetaShapedTexture *stex)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+  int dst_width, dst_height;
+
+  if (priv->has_viewport_dst_size)
+    {
+      dst_width = priv->viewport_dst_width;
+      dst_height = priv->viewport_dst_height;
+    }
+  else if (priv->has_viewport_src_rect)
+    {
+      dst_width = (int) ceilf (priv->viewport_src_rect.size.width);
+      dst_height = (int) ceilf (priv->viewport_src_rect.size.height);
+    }
+  else
+    {
+      dst_width = priv->tex_width;
+      dst_height = priv->tex_height;
+    }
+
+  if (priv->dst_width != dst_width ||
+      priv->dst_height != dst_height)
+    {
+      priv->dst_width = dst_width;
+      priv->dst_height = dst_height;
+      clutter_actor_queue_relayout (CLUTTER_ACTOR (stex));
+      g_signal_emit (stex, signals[SIZE_CHANGED], 0);
+    }
+}
+
+/* Returns the part of the texture that is painted, in normalized
+ * texture coordinates. */
+static void
+get_source_rect (MetaShapedTexture *stex,
+                 ClutterRect       *src_rect)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+
+  if (priv->has_viewport_src_rect && priv->tex_width && priv->tex_height)
+    {
+      src_rect->origin.x = priv->viewport_src_rect.origin.x / priv->tex_width;
+      src_rect->origin.y = priv->viewport_src_rect.origin.y / priv->tex_height;
+      src_rect->size.width = priv->viewport_src_rect.size.width / priv->tex_width;
+      src_rect->size.height = priv->viewport_src_rect.size.height / priv->tex_height;
+    }
+  else
+    {
+      *src_rect = (ClutterRect) {
+        .size.width = 1.0,
+        .size.height = 1.0,
+      };
+    }
+}
+
+static gboolean
+is_viewport_scaled (MetaShapedTexture *stex)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+  float src_width, src_height;
+
+  if (priv->has_viewport_src_rect)
+    {
+      src_width = priv->viewport_src_rect.size.width;
+      src_height = priv->viewport_src_rect.size.height;
+    }
+  else
+    {
+      src_width = priv->tex_width;
+      src_height = priv->tex_height;
+    }
+
+  return (src_width != priv->dst_width ||
+          src_height != priv->dst_height);
+}
+
+static void
+paint_rectangle (CoglFramebuffer *fb,
+                 CoglPipeline    *pipeline,
+                 float            x1,
+                 float            y1,
+                 float            x2,
+                 float            y2,
+                 ClutterActorBox *alloc,
+                 ClutterRect     *src_rect)
 {
   float coords[8];
-  float x1, y1, x2, y2;
+  float alloc_width, alloc_height;
 
-  x1 = rect->x;
-  y1 = rect->y;
-  x2 = rect->x + rect->width;
-  y2 = rect->y + rect->height;
+  alloc_width = alloc->x2 - alloc->x1;
+  alloc_height = alloc->y2 - alloc->y1;
 
-  coords[0] = rect->x / (alloc->x2 - alloc->x1);
-  coords[1] = rect->y / (alloc->y2 - alloc->y1);
-  coords[2] = (rect->x + rect->width) / (alloc->x2 - alloc->x1);
-  coords[3] = (rect->y + rect->height) / (alloc->y2 - alloc->y1);
+  coords[0] = src_rect->origin.x + x1 / alloc_width * src_rect->size.width;
+  coords[1] = src_rect->origin.y + y1 / alloc_height * src_rect->size.height;
+  coords[2] = src_rect->origin.x + x2 / alloc_width * src_rect->size.width;
+  coords[3] = src_rect->origin.y + y2 / alloc_height * src_rect->size.height;
 
   coords[4] = coords[0];
   coords[5] = coords[1];
@@ -325,6 +416,19 @@ paint_clipped_rectangle (CoglFramebuffer       *fb,
                                                  &coords[0], 8);
 }
 
+static void
+paint_clipped_rectangle (CoglFramebuffer       *fb,
+                         CoglPipeline          *pipeline,
+                         cairo_rectangle_int_t *rect,
+                         ClutterActorBox       *alloc,
+                         ClutterRect           *src_rect)
+{
+  paint_rectangle (fb, pipeline,
+                   rect->x, rect->y,
+                   rect->x + rect->width, rect->y + rect->height,
+                   alloc, src_rect);
+}
+
 static void
 set_cogl_texture (MetaShapedTexture *stex,
                   CoglTexture       *cogl_tex)
@@ -359,8 +463,7 @@ set_cogl_texture (MetaShapedTexture *stex,
       priv->tex_width = width;
       priv->tex_height = height;
       meta_shaped_texture_set_mask_texture (stex, NULL);
-      clutter_actor_queue_relayout (CLUTTER_ACTOR (stex));
-      g_signal_emit (stex, signals[SIZE_CHANGED], 0);
+      update_size (stex);
     }
 
   /* NB: We don't queue a redraw of the actor here because we don't
@@ -378,12 +481,14 @@ meta_shaped_texture_paint (ClutterActor *actor)
   MetaShapedTexture *stex = (MetaShapedTexture *) actor;
   MetaShapedTexturePrivate *priv = stex->priv;
   guint tex_width, tex_height;
+  int dst_width, dst_height;
   guchar opacity;
   CoglContext *ctx;
   CoglFramebuffer *fb;
   CoglTexture *paint_tex;
   ClutterActorBox alloc;
   CoglPipelineFilter filter;
+  ClutterRect src_rect;
 
   if (priv->clip_region && cairo_region_is_empty (priv->clip_region))
     return;
@@ -405,8 +510,11 @@ meta_shaped_texture_paint (ClutterActor *actor)
    * if that was the case, set the clutter texture quality to HIGH.
    * Setting the texture quality to high without SGIS_generate_mipmap
    * support for TFP textures will result in fallbacks to XGetImage.
+   *
+   * The tower picks its level assuming the texture is painted at its
+   * own size, so skip it when a viewport scales the texture.
    */
-  if (priv->create_mipmaps)
+  if (priv->create_mipmaps && !is_viewport_scaled (stex))
     paint_tex = meta_texture_tower_get_paint_texture (priv->paint_tower);
   else
     paint_tex = COGL_TEXTURE (priv->texture);
@@ -420,7 +528,15 @@ meta_shaped_texture_paint (ClutterActor *actor)
   if (tex_width == 0 || tex_height == 0) /* no contents yet */
     return;
 
-  cairo_rectangle_int_t tex_rect = { 0, 0, tex_width, tex_height };
+  dst_width = priv->dst_width;
+  dst_height = priv->dst_height;
+
+  if (dst_width == 0 || dst_height == 0)
+    return;
+
+  cairo_rectangle_int_t tex_rect = { 0, 0, dst_width, dst_height };
+
+  get_source_rect (stex, &src_rect);
 
   /* Use nearest-pixel interpolation if the texture is unscaled. This
    * improves performance, especially with software rendering.
@@ -428,7 +544,8 @@ meta_shaped_texture_paint (ClutterActor *actor)
 
   filter = COGL_PIPELINE_FILTER_LINEAR;
 
-  if (meta_actor_painting_untransformed (tex_width, tex_height, NULL, NULL))
+  if (!is_viewport_scaled (stex) &&
+      meta_actor_painting_untransformed (dst_width, dst_height, NULL, NULL))
     filter = COGL_PIPELINE_FILTER_NEAREST;
 
   ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
@@ -503,7 +620,8 @@ meta_shaped_texture_paint (ClutterActor *actor)
             {
               cairo_rectangle_int_t rect;
               cairo_region_get_rectangle (region, i, &rect);
-              paint_clipped_rectangle (fb, opaque_pipeline, &rect, &alloc);
+              paint_clipped_rectangle (fb, opaque_pipeline, &rect, &alloc,
+                                       &src_rect);
             }
         }
 
@@ -556,16 +674,18 @@ meta_shaped_texture_paint (ClutterActor *actor)
               if (!gdk_rectangle_intersect (&tex_rect, &rect, &rect))
                 continue;
 
-              paint_clipped_rectangle (fb, blended_pipeline, &rect, &alloc);
+              paint_clipped_rectangle (fb, blended_pipeline, &rect, &alloc,
+                                       &src_rect);
             }
         }
       else
         {
           /* 3) blended_region is NULL. Do a full paint. */
-          cogl_framebuffer_draw_rectangle (fb, blended_pipeline,
-                                           0, 0,
-                                           alloc.x2 - alloc.x1,
-                                           alloc.y2 - alloc.y1);
+          paint_rectangle (fb, blended_pipeline,
+                           0, 0,
+                           alloc.x2 - alloc.x1,
+                           alloc.y2 - alloc.y1,
+                           &alloc, &src_rect);
         }
     }
 
@@ -583,7 +703,7 @@ meta_shaped_texture_get_preferred_width (ClutterActor *self,
   guint width;
 
   if (priv->texture)
-    width = priv->tex_width;
+    width = priv->dst_width;
   else
     width = priv->fallback_width;
 
@@ -603,7 +723,7 @@ meta_shaped_texture_get_preferred_height (ClutterActor *self,
   guint height;
 
   if (priv->texture)
-    height = priv->tex_height;
+    height = priv->dst_height;
   else
     height = priv->fallback_height;
 
@@ -727,6 +847,62 @@ meta_shaped_texture_is_obscured (MetaShapedTexture *self)
     return FALSE;
 }
 
+/* Transforms a rectangle in texture coordinates to the coordinate space
+ * the texture is painted in, rounding outwards.
+ */
+static void
+texture_rect_to_dst_rect (MetaShapedTexture     *stex,
+                          cairo_rectangle_int_t *rect)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+  ClutterRect src_rect;
+  float x1, y1, x2, y2;
+  float scale_x, scale_y;
+
+  if (priv->has_viewport_src_rect)
+    src_rect = priv->viewport_src_rect;
+  else
+    src_rect = (ClutterRect) {
+      .size.width = priv->tex_width,
+      .size.height = priv->tex_height,
+    };
+
+  x1 = rect->x;
+  y1 = rect->y;
+  x2 = rect->x + rect->width;
+  y2 = rect->y + rect->height;
+
+  /* With linear filtering, damaged texels bleed into the pixels around
+   * them when the texture is scaled. */
+  if (is_viewport_scaled (stex))
+    {
+      x1 -= 1;
+      y1 -= 1;
+      x2 += 1;
+      y2 += 1;
+    }
+
+  scale_x = priv->dst_width / src_rect.size.width;
+  scale_y = priv->dst_height / src_rect.size.height;
+
+  x1 = floorf ((x1 - src_rect.origin.x) * scale_x);
+  y1 = floorf ((y1 - src_rect.origin.y) * scale_y);
+  x2 = ceilf ((x2 - src_rect.origin.x) * scale_x);
+  y2 = ceilf ((y2 - src_rect.origin.y) * scale_y);
+
+  x1 = CLAMP (x1, 0, priv->dst_width);
+  y1 = CLAMP (y1, 0, priv->dst_height);
+  x2 = CLAMP (x2, 0, priv->dst_width);
+  y2 = CLAMP (y2, 0, priv->dst_height);
+
+  *rect = (cairo_rectangle_int_t) {
+    .x = (int) x1,
+    .y = (int) y1,
+    .width = (int) (x2 - x1),
+    .height = (int) (y2 - y1),
+  };
+}
+
 /**
  * meta_shaped_texture_update_area:
  * @stex: #MetaShapedTexture
@@ -735,8 +911,8 @@ meta_shaped_texture_is_obscured (MetaShapedTexture *self)
  * @width: the width of the damaged area
  * @height: the height of the damaged area
  *
- * Repairs the damaged area indicated by @x, @y, @width and @height
- * and potentially queues a redraw.
+ * Repairs the damaged area indicated by @x, @y, @width and @height,
+ * given in texture coordinates, and potentially queues a redraw.
  *
  * Return value: Whether a redraw have been queued or not
  */
@@ -749,7 +925,7 @@ meta_shaped_texture_update_area (MetaShapedTexture *stex,
 {
   MetaShapedTexturePrivate *priv;
   cairo_region_t *unobscured_region;
-  const cairo_rectangle_int_t clip = { x, y, width, height };
+  cairo_rectangle_int_t clip = { x, y, width, height };
 
   priv = stex->priv;
 
@@ -758,6 +934,9 @@ meta_shaped_texture_update_area (MetaShapedTexture *stex,
 
   meta_texture_tower_update_area (priv->paint_tower, x, y, width, height);
 
+  if (priv->has_viewport_src_rect || priv->has_viewport_dst_size)
+    texture_rect_to_dst_rect (stex, &clip);
+
   unobscured_region = effective_unobscured_region (stex);
   if (unobscured_region)
     {
@@ -788,6 +967,67 @@ meta_shaped_texture_update_area (MetaShapedTexture *stex,
     }
 }
 
+/**
+ * meta_shaped_texture_update_region: (skip)
+ * @stex: #MetaShapedTexture
+ * @region: the damaged region, in texture coordinates
+ *
+ * Like meta_shaped_texture_update_area(), but for a whole region at once,
+ * queueing at most one redraw, clipped to the extents of the unobscured
+ * part of @region.
+ *
+ * Return value: Whether a redraw have been queued or not
+ */
+gboolean
+meta_shaped_texture_update_region (MetaShapedTexture *stex,
+                                   cairo_region_t    *region)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+  cairo_region_t *unobscured_region;
+  cairo_region_t *damage_region;
+  cairo_rectangle_int_t damage_rect;
+  int i, n_rectangles;
+
+  if (priv->texture == NULL)
+    return FALSE;
+
+  n_rectangles = cairo_region_num_rectangles (region);
+  if (n_rectangles == 0)
+    return FALSE;
+
+  damage_region = cairo_region_create ();
+  for (i = 0; i < n_rectangles; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, i, &rect);
+      meta_texture_tower_update_area (priv->paint_tower,
+                                      rect.x, rect.y,
+                                      rect.width, rect.height);
+
+      if (priv->has_viewport_src_rect || priv->has_viewport_dst_size)
+        texture_rect_to_dst_rect (stex, &rect);
+
+      cairo_region_union_rectangle (damage_region, &rect);
+    }
+
+  unobscured_region = effective_unobscured_region (stex);
+  if (unobscured_region)
+    cairo_region_intersect (damage_region, unobscured_region);
+
+  if (cairo_region_is_empty (damage_region))
+    {
+      cairo_region_destroy (damage_region);
+      return FALSE;
+    }
+
+  cairo_region_get_extents (damage_region, &damage_rect);
+  cairo_region_destroy (damage_region);
+
+  clutter_actor_queue_redraw_with_clip (CLUTTER_ACTOR (stex), &damage_rect);
+  return TRUE;
+}
+
 /**
  * meta_shaped_texture_set_texture:
  * @stex: The #MetaShapedTexture
@@ -986,6 +1226,67 @@ meta_shaped_texture_get_image (MetaShapedTexture     *stex,
   return surface;
 }
 
+void
+meta_shaped_texture_set_viewport_src_rect (MetaShapedTexture *stex,
+                                           ClutterRect       *src_rect)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+
+  if (priv->has_viewport_src_rect &&
+      clutter_rect_equals (&priv->viewport_src_rect, src_rect))
+    return;
+
+  priv->has_viewport_src_rect = TRUE;
+  priv->viewport_src_rect = *src_rect;
+  update_size (stex);
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (stex));
+}
+
+void
+meta_shaped_texture_reset_viewport_src_rect (MetaShapedTexture *stex)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+
+  if (!priv->has_viewport_src_rect)
+    return;
+
+  priv->has_viewport_src_rect = FALSE;
+  update_size (stex);
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (stex));
+}
+
+void
+meta_shaped_texture_set_viewport_dst_size (MetaShapedTexture *stex,
+                                           int                dst_width,
+                                           int                dst_height)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+
+  if (priv->has_viewport_dst_size &&
+      priv->viewport_dst_width == dst_width &&
+      priv->viewport_dst_height == dst_height)
+    return;
+
+  priv->has_viewport_dst_size = TRUE;
+  priv->viewport_dst_width = dst_width;
+  priv->viewport_dst_height = dst_height;
+  update_size (stex);
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (stex));
+}
+
+void
+meta_shaped_texture_reset_viewport_dst_size (MetaShapedTexture *stex)
+{
+  MetaShapedTexturePrivate *priv = stex->priv;
+
+  if (!priv->has_viewport_dst_size)
+    return;
+
+  priv->has_viewport_dst_size = FALSE;
+  update_size (stex);
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (stex));
+}
+
 void
 meta_shaped_texture_set_fallback_size (MetaShapedTexture *self,
                                        guint              fallback_width,
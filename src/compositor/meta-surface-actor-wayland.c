@@ -38,10 +38,18 @@
 #include "backends/meta-backend-private.h"
 #include "compositor/region-utils.h"
 
+/* Frame callbacks of surfaces that are not painted, because they are
+ * unmapped, off-screen or completely obscured, are sent at this interval
+ * instead of after every paint; roughly every sixth frame at 60 Hz, like
+ * the _NET_WM_FRAME_DRAWN throttling of obscured X11 windows.
+ */
+#define HIDDEN_FRAME_CALLBACK_INTERVAL_MS 100
+
 struct _MetaSurfaceActorWaylandPrivate
 {
   MetaWaylandSurface *surface;
   struct wl_list frame_callback_list;
+  guint hidden_frame_callbacks_id;
 };
 typedef struct _MetaSurfaceActorWaylandPrivate MetaSurfaceActorWaylandPrivate;
 
@@ -133,15 +141,12 @@ meta_surface_actor_wayland_get_subsurface_rect (MetaSurfaceActorWayland *self,
                                                 MetaRectangle           *rect)
 {
   MetaWaylandSurface *surface = meta_surface_actor_wayland_get_surface (self);
-  MetaWaylandBuffer *buffer = meta_wayland_surface_get_buffer (surface);
-  CoglTexture *texture;
   MetaWindow *toplevel_window;
   int geometry_scale;
   float x, y;
 
   g_assert (surface);
 
-  texture = buffer->texture;
   toplevel_window = meta_wayland_surface_get_toplevel_window (surface);
   geometry_scale = meta_window_wayland_get_geometry_scale (toplevel_window);
 
@@ -149,8 +154,8 @@ meta_surface_actor_wayland_get_subsurface_rect (MetaSurfaceActorWayland *self,
   *rect = (MetaRectangle) {
     .x = x / geometry_scale,
     .y = y / geometry_scale,
-    .width = cogl_texture_get_width (texture) / surface->scale,
-    .height = cogl_texture_get_height (texture) / surface->scale,
+    .width = meta_wayland_surface_get_width (surface),
+    .height = meta_wayland_surface_get_height (surface),
   };
 }
 
@@ -296,6 +301,65 @@ meta_surface_actor_wayland_is_on_monitor (MetaSurfaceActorWayland *self,
   return is_on_monitor;
 }
 
+static gboolean
+is_hidden (MetaSurfaceActorWayland *self)
+{
+  return (!clutter_actor_is_mapped (CLUTTER_ACTOR (self)) ||
+          meta_surface_actor_is_obscured (META_SURFACE_ACTOR (self)));
+}
+
+static gboolean
+send_hidden_frame_callbacks (gpointer data)
+{
+  MetaSurfaceActorWayland *self = data;
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+  MetaWaylandFrameCallback *cb, *next;
+  uint32_t time_ms = g_get_monotonic_time () / 1000;
+
+  priv->hidden_frame_callbacks_id = 0;
+
+  wl_list_for_each_safe (cb, next, &priv->frame_callback_list, link)
+    {
+      wl_callback_send_done (cb->resource, time_ms);
+      wl_resource_destroy (cb->resource);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_hidden_frame_callbacks (MetaSurfaceActorWayland *self)
+{
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+
+  if (priv->hidden_frame_callbacks_id != 0 ||
+      wl_list_empty (&priv->frame_callback_list))
+    return;
+
+  priv->hidden_frame_callbacks_id =
+    g_timeout_add_full (META_PRIORITY_REDRAW,
+                        HIDDEN_FRAME_CALLBACK_INTERVAL_MS,
+                        send_hidden_frame_callbacks,
+                        self, NULL);
+  g_source_set_name_by_id (priv->hidden_frame_callbacks_id,
+                           "[mutter] send_hidden_frame_callbacks");
+}
+
+static void
+unqueue_hidden_frame_callbacks (MetaSurfaceActorWayland *self)
+{
+  MetaSurfaceActorWaylandPrivate *priv =
+    meta_surface_actor_wayland_get_instance_private (self);
+
+  if (priv->hidden_frame_callbacks_id != 0)
+    {
+      g_source_remove (priv->hidden_frame_callbacks_id);
+      priv->hidden_frame_callbacks_id = 0;
+    }
+}
+
 void
 meta_surface_actor_wayland_add_frame_callbacks (MetaSurfaceActorWayland *self,
                                                 struct wl_list *frame_callbacks)
@@ -303,6 +367,11 @@ meta_surface_actor_wayland_add_frame_callbacks (MetaSurfaceActorWayland *self,
   MetaSurfaceActorWaylandPrivate *priv = meta_surface_actor_wayland_get_instance_private (self);
 
   wl_list_insert_list (&priv->frame_callback_list, frame_callbacks);
+
+  /* The callbacks are sent when the actor is painted, which won't happen
+   * for a hidden surface. */
+  if (is_hidden (self))
+    queue_hidden_frame_callbacks (self);
 }
 
 static MetaWindow *
@@ -386,8 +455,19 @@ meta_surface_actor_wayland_paint (ClutterActor *actor)
     {
       MetaWaylandCompositor *compositor = priv->surface->compositor;
 
-      wl_list_insert_list (&compositor->frame_callbacks, &priv->frame_callback_list);
-      wl_list_init (&priv->frame_callback_list);
+      /* Painting a completely obscured actor draws nothing, so don't let
+       * the client render at full rate for it. */
+      if (meta_surface_actor_is_obscured (META_SURFACE_ACTOR (self)))
+        {
+          queue_hidden_frame_callbacks (self);
+        }
+      else
+        {
+          wl_list_insert_list (&compositor->frame_callbacks,
+                               &priv->frame_callback_list);
+          wl_list_init (&priv->frame_callback_list);
+          unqueue_hidden_frame_callbacks (self);
+        }
     }
 
   CLUTTER_ACTOR_CLASS (meta_surface_actor_wayland_parent_class)->paint (actor);
@@ -404,6 +484,7 @@ meta_surface_actor_wayland_dispose (GObject *object)
     meta_surface_actor_get_texture (META_SURFACE_ACTOR (self));
 
   meta_shaped_texture_set_texture (stex, NULL);
+  unqueue_hidden_frame_callbacks (self);
   if (priv->surface)
     {
       g_object_remove_weak_pointer (G_OBJECT (priv->surface),
@@ -441,9 +522,23 @@ meta_surface_actor_wayland_class_init (MetaSurfaceActorWaylandClass *klass)
   object_class->dispose = meta_surface_actor_wayland_dispose;
 }
 
+static void
+meta_surface_actor_wayland_mapped_notify (GObject    *object,
+                                          GParamSpec *pspec,
+                                          gpointer    user_data)
+{
+  MetaSurfaceActorWayland *self = META_SURFACE_ACTOR_WAYLAND (object);
+
+  if (!clutter_actor_is_mapped (CLUTTER_ACTOR (self)))
+    queue_hidden_frame_callbacks (self);
+}
+
 static void
 meta_surface_actor_wayland_init (MetaSurfaceActorWayland *self)
 {
+  g_signal_connect (self, "notify::mapped",
+                    G_CALLBACK (meta_surface_actor_wayland_mapped_notify),
+                    NULL);
 }
 
 MetaSurfaceActor *
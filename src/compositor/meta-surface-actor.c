@@ -285,6 +285,49 @@ meta_surface_actor_process_damage (MetaSurfaceActor *self,
     meta_surface_actor_update_area (self, x, y, width, height);
 }
 
+/**
+ * meta_surface_actor_process_damage_region:
+ * @self: a #MetaSurfaceActor
+ * @region: the damaged region, in texture coordinates
+ *
+ * Processes the damage of a whole region at once; unlike calling
+ * meta_surface_actor_process_damage() for each of its rectangles, this
+ * queues a single redraw.
+ */
+void
+meta_surface_actor_process_damage_region (MetaSurfaceActor *self,
+                                          cairo_region_t   *region)
+{
+  MetaSurfaceActorPrivate *priv = self->priv;
+  int i, n_rectangles;
+
+  if (is_frozen (self))
+    {
+      /* See meta_surface_actor_process_damage() */
+      if (!priv->pending_damage)
+        priv->pending_damage = cairo_region_copy (region);
+      else
+        cairo_region_union (priv->pending_damage, region);
+      return;
+    }
+
+  n_rectangles = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rectangles; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, i, &rect);
+      META_SURFACE_ACTOR_GET_CLASS (self)->process_damage (self,
+                                                           rect.x, rect.y,
+                                                           rect.width,
+                                                           rect.height);
+    }
+
+  if (meta_surface_actor_is_visible (self) &&
+      meta_shaped_texture_update_region (priv->texture, region))
+    g_signal_emit (self, signals[REPAINT_SCHEDULED], 0);
+}
+
 void
 meta_surface_actor_pre_paint (MetaSurfaceActor *self)
 {
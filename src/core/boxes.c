@@ -31,6 +31,7 @@
 #include "boxes-private.h"
 #include <meta/util.h>
 #include <X11/Xutil.h>  /* Just for the definition of the various gravities */
+#include <string.h>
 
 /* It would make sense to use GSlice here, but until we clean up the
  * rest of this file and the internal API to use these functions, we
@@ -423,119 +424,141 @@ meta_rectangle_resize_with_gravity (const MetaRectangle *old_rect,
   rect->height = new_height;
 }
 
-/* Not so simple helper function for get_minimal_spanning_set_for_region() */
+/* The region and edge computations below work on contiguous arrays of
+ * rectangles and edges, which are only turned into lists of individually
+ * allocated elements when handing the result back to the caller.
+ */
+static void
+reverse_array (GArray *array)
+{
+  guint element_size = g_array_get_element_size (array);
+  guint8 tmp[sizeof (MetaEdge)];
+  guint i, j;
+
+  g_assert (element_size <= sizeof (tmp));
+
+  if (array->len < 2)
+    return;
+
+  for (i = 0, j = array->len - 1; i < j; i++, j--)
+    {
+      guint8 *a = (guint8 *) array->data + i * element_size;
+      guint8 *b = (guint8 *) array->data + j * element_size;
+
+      memcpy (tmp, a, element_size);
+      memcpy (a, b, element_size);
+      memcpy (b, tmp, element_size);
+    }
+}
+
 static GList*
-merge_spanning_rects_in_region (GList *region)
+rect_array_to_list (GArray *rects)
+{
+  GList *ret = NULL;
+  int i;
+
+  for (i = (int) rects->len - 1; i >= 0; i--)
+    {
+      MetaRectangle *rect = g_new (MetaRectangle, 1);
+      *rect = g_array_index (rects, MetaRectangle, i);
+      ret = g_list_prepend (ret, rect);
+    }
+
+  return ret;
+}
+
+/* Not so simple helper function for get_minimal_spanning_set_for_region() */
+static void
+merge_spanning_rects_in_region (GArray *region)
 {
   /* NOTE FOR ANY OPTIMIZATION PEOPLE OUT THERE: Please see the
    * documentation of get_minimal_spanning_set_for_region() for performance
    * considerations that also apply to this function.
    */
 
-  GList* compare;
-  compare = region;
+  MetaRectangle *rects = (MetaRectangle *) region->data;
+  guint i, j, n_kept;
 
-  if (region == NULL)
+  if (region->len == 0)
     {
       meta_warning ("Region to merge was empty!  Either you have a some "
                     "pathological STRUT list or there's a bug somewhere!\n");
-      return NULL;
+      return;
     }
 
-  while (compare && compare->next)
+  /* Rectangles merged into another one get a zero width, and are skipped
+   * until they are all dropped at the end; the result depends on the
+   * order in which the rectangles are compared, so that is kept as is.
+   */
+  for (i = 0; i + 1 < region->len; i++)
     {
-      MetaRectangle *a = compare->data;
-      GList *other = compare->next;
+      MetaRectangle *a = &rects[i];
+
+      if (a->width == 0)
+        continue;
 
       g_assert (a->width > 0 && a->height > 0);
 
-      while (other)
+      for (j = i + 1; j < region->len; j++)
         {
-          MetaRectangle *b = other->data;
-          GList *delete_me = NULL;
+          MetaRectangle *b = &rects[j];
+          gboolean merged = FALSE;
+
+          if (b->width == 0)
+            continue;
 
           g_assert (b->width > 0 && b->height > 0);
 
           /* If a contains b, just remove b */
           if (meta_rectangle_contains_rect (a, b))
             {
-              delete_me = other;
-            }
-          /* If b contains a, just remove a */
-          else if (meta_rectangle_contains_rect (a, b))
-            {
-              delete_me = compare;
+              merged = TRUE;
             }
           /* If a and b might be mergeable horizontally */
           else if (a->y == b->y && a->height == b->height)
             {
-              /* If a and b overlap */
-              if (meta_rectangle_overlap (a, b))
+              /* If a and b overlap or are adjacent */
+              if (meta_rectangle_overlap (a, b) ||
+                  a->x + a->width == b->x || a->x == b->x + b->width)
                 {
                   int new_x = MIN (a->x, b->x);
                   a->width = MAX (a->x + a->width, b->x + b->width) - new_x;
                   a->x = new_x;
-                  delete_me = other;
-                }
-              /* If a and b are adjacent */
-              else if (a->x + a->width == b->x || a->x == b->x + b->width)
-                {
-                  int new_x = MIN (a->x, b->x);
-                  a->width = MAX (a->x + a->width, b->x + b->width) - new_x;
-                  a->x = new_x;
-                  delete_me = other;
+                  merged = TRUE;
                 }
             }
           /* If a and b might be mergeable vertically */
           else if (a->x == b->x && a->width == b->width)
             {
-              /* If a and b overlap */
-              if (meta_rectangle_overlap (a, b))
-                {
-                  int new_y = MIN (a->y, b->y);
-                  a->height = MAX (a->y + a->height, b->y + b->height) - new_y;
-                  a->y = new_y;
-                  delete_me = other;
-                }
-              /* If a and b are adjacent */
-              else if (a->y + a->height == b->y || a->y == b->y + b->height)
+              /* If a and b overlap or are adjacent */
+              if (meta_rectangle_overlap (a, b) ||
+                  a->y + a->height == b->y || a->y == b->y + b->height)
                 {
                   int new_y = MIN (a->y, b->y);
                   a->height = MAX (a->y + a->height, b->y + b->height) - new_y;
                   a->y = new_y;
-                  delete_me = other;
-                }
-            }
-
-          other = other->next;
-
-          /* Delete any rectangle in the list that is no longer wanted */
-          if (delete_me != NULL)
-            {
-              /* Deleting the rect we compare others to is a little tricker */
-              if (compare == delete_me)
-                {
-                  compare = compare->next;
-                  other = compare->next;
-                  a = compare->data;
+                  merged = TRUE;
                 }
-
-              /* Okay, we can free it now */
-              g_free (delete_me->data);
-              region = g_list_delete_link (region, delete_me);
             }
 
+          if (merged)
+            b->width = 0;
         }
-
-      compare = compare->next;
     }
 
-  return region;
+  /* Now drop the rectangles that were merged */
+  n_kept = 0;
+  for (i = 0; i < region->len; i++)
+    {
+      if (rects[i].width != 0)
+        rects[n_kept++] = rects[i];
+    }
+  g_array_set_size (region, n_kept);
 }
 
 /* Simple helper function for get_minimal_spanning_set_for_region()... */
 static gint
-compare_rect_areas (gconstpointer a, gconstpointer b)
+compare_rect_areas (gconstpointer a, gconstpointer b, gpointer user_data)
 {
   const MetaRectangle *a_rect = (gconstpointer) a;
   const MetaRectangle *b_rect = (gconstpointer) b;
@@ -591,46 +614,26 @@ meta_rectangle_get_minimal_spanning_set_for_region (
   const MetaRectangle *basic_rect,
   const GSList  *all_struts)
 {
-  /* NOTE FOR OPTIMIZERS: This function *might* be somewhat slow,
-   * especially due to the call to merge_spanning_rects_in_region() (which
-   * is O(n^2) where n is the size of the list generated in this function).
-   * This is made more onerous due to the fact that it involves a fair
-   * number of memory allocation and deallocation calls.  However, n is 1
-   * for default installations of Gnome (because partial struts aren't used
-   * by default and only partial struts increase the size of the spanning
-   * set generated).  With one partial strut, n will be 2 or 3.  With 2
-   * partial struts, n will probably be 4 or 5.  So, n probably isn't large
-   * enough to make this worth bothering.  Further, it is only called from
-   * workspace.c:ensure_work_areas_validated (at least as of the time of
-   * writing this comment), which in turn should only be called if the
-   * strut list changes or the screen or monitor size changes.  If it ever
-   * does show up on profiles (most likely because people start using
-   * ridiculously huge numbers of partial struts), possible optimizations
-   * include:
+  /* NOTE FOR OPTIMIZERS: The splitting below is linear in the number of
+   * rectangles for each strut, and the merging done by
+   * merge_spanning_rects_in_region() is O(n^2) where n is the number of
+   * rectangles generated here.  Both work in place on contiguous arrays,
+   * without allocating anything per rectangle; only the final list handed
+   * back to the caller is allocated.  n is 1 for a monitor without partial
+   * struts, and stays small (a few dozens) even for walls of monitors with
+   * docks and panels on each of them.  This is called from
+   * workspace.c:ensure_work_areas_validated() each time the strut list or
+   * the monitor layout changes, for every workspace.
    *
-   * (1) rewrite merge_spanning_rects_in_region() to be O(n) or O(nlogn).
-   *     I'm not totally sure it's possible, but with a couple copies of
-   *     the list and sorting them appropriately, I believe it might be.
-   * (2) only call merge_spanning_rects_in_region() with a subset of the
-   *     full list of rectangles.  I believe from some of my preliminary
-   *     debugging and thinking about it that it is possible to figure out
-   *     apriori groups of rectangles which are only merge candidates with
-   *     each other.  (See testboxes.c:get_screen_region() when which==2
-   *     and track the steps of this function carefully to see what gave
-   *     me the hint that this might work)
-   * (3) figure out how to avoid merge_spanning_rects_in_region().  I think
-   *     it might be possible to modify this function to make that
-   *     possible, and I spent just a little while thinking about it, but n
-   *     wasn't large enough to convince me to care yet.
-   * (4) Some of the stuff Rob mentioned at http://mail.gnome.org/archives\
-   *     /metacity-devel-list/2005-November/msg00028.html.  (Sorry for the
-   *     URL splitting.)
+   * The merge must compare the rectangles in the order the list based
+   * implementation did, as its result depends on it; the same goes for
+   * the order the rectangles are generated in.
    */
 
+  GArray        *rects;
+  GArray        *splits;
   GList         *ret;
-  GList         *tmp_list;
   const GSList  *strut_iter;
-  MetaRectangle *temp_rect;
 
   /* The algorithm is basically as follows:
    *   Initialize rectangle_set to basic_rect
@@ -643,78 +646,83 @@ meta_rectangle_get_minimal_spanning_set_for_region (
    *         splitting
    */
 
-  temp_rect = g_new (MetaRectangle, 1);
-  *temp_rect = *basic_rect;
-  ret = g_list_prepend (NULL, temp_rect);
+  rects = g_array_sized_new (FALSE, FALSE, sizeof (MetaRectangle), 16);
+  splits = g_array_sized_new (FALSE, FALSE, sizeof (MetaRectangle), 16);
+
+  g_array_append_val (rects, *basic_rect);
 
   for (strut_iter = all_struts; strut_iter; strut_iter = strut_iter->next)
     {
-      GList *rect_iter;
       MetaStrut *strut = (MetaStrut*)strut_iter->data;
       MetaRectangle *strut_rect = &strut->rect;
+      gboolean strut_aligns = check_strut_align (strut, basic_rect);
+      GArray *tmp;
+      guint i;
 
-      tmp_list = ret;
-      ret = NULL;
-      rect_iter = tmp_list;
-      while (rect_iter)
+      g_array_set_size (splits, 0);
+
+      for (i = 0; i < rects->len; i++)
         {
-          MetaRectangle *rect = (MetaRectangle*) rect_iter->data;
+          const MetaRectangle *rect = &g_array_index (rects, MetaRectangle, i);
+          MetaRectangle piece;
 
-          if (!meta_rectangle_overlap (strut_rect, rect) ||
-              !check_strut_align (strut, basic_rect))
-            ret = g_list_prepend (ret, rect);
-          else
+          if (!meta_rectangle_overlap (strut_rect, rect) || !strut_aligns)
             {
-              /* If there is area in rect left of strut */
-              if (BOX_LEFT (*rect) < BOX_LEFT (*strut_rect))
-                {
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
-                  temp_rect->width = BOX_LEFT (*strut_rect) - BOX_LEFT (*rect);
-                  ret = g_list_prepend (ret, temp_rect);
-                }
-              /* If there is area in rect right of strut */
-              if (BOX_RIGHT (*rect) > BOX_RIGHT (*strut_rect))
-                {
-                  int new_x;
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
-                  new_x = BOX_RIGHT (*strut_rect);
-                  temp_rect->width = BOX_RIGHT(*rect) - new_x;
-                  temp_rect->x = new_x;
-                  ret = g_list_prepend (ret, temp_rect);
-                }
-              /* If there is area in rect above strut */
-              if (BOX_TOP (*rect) < BOX_TOP (*strut_rect))
-                {
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
-                  temp_rect->height = BOX_TOP (*strut_rect) - BOX_TOP (*rect);
-                  ret = g_list_prepend (ret, temp_rect);
-                }
-              /* If there is area in rect below strut */
-              if (BOX_BOTTOM (*rect) > BOX_BOTTOM (*strut_rect))
-                {
-                  int new_y;
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
-                  new_y = BOX_BOTTOM (*strut_rect);
-                  temp_rect->height = BOX_BOTTOM (*rect) - new_y;
-                  temp_rect->y = new_y;
-                  ret = g_list_prepend (ret, temp_rect);
-                }
-              g_free (rect);
+              g_array_append_val (splits, *rect);
+              continue;
+            }
+
+          /* If there is area in rect left of strut */
+          if (BOX_LEFT (*rect) < BOX_LEFT (*strut_rect))
+            {
+              piece = *rect;
+              piece.width = BOX_LEFT (*strut_rect) - BOX_LEFT (*rect);
+              g_array_append_val (splits, piece);
+            }
+          /* If there is area in rect right of strut */
+          if (BOX_RIGHT (*rect) > BOX_RIGHT (*strut_rect))
+            {
+              piece = *rect;
+              piece.x = BOX_RIGHT (*strut_rect);
+              piece.width = BOX_RIGHT (*rect) - piece.x;
+              g_array_append_val (splits, piece);
+            }
+          /* If there is area in rect above strut */
+          if (BOX_TOP (*rect) < BOX_TOP (*strut_rect))
+            {
+              piece = *rect;
+              piece.height = BOX_TOP (*strut_rect) - BOX_TOP (*rect);
+              g_array_append_val (splits, piece);
+            }
+          /* If there is area in rect below strut */
+          if (BOX_BOTTOM (*rect) > BOX_BOTTOM (*strut_rect))
+            {
+              piece = *rect;
+              piece.y = BOX_BOTTOM (*strut_rect);
+              piece.height = BOX_BOTTOM (*rect) - piece.y;
+              g_array_append_val (splits, piece);
             }
-          rect_iter = rect_iter->next;
         }
-      g_list_free (tmp_list);
+
+      /* The rectangle set used to be a list built by prepending */
+      reverse_array (splits);
+
+      tmp = rects;
+      rects = splits;
+      splits = tmp;
     }
 
   /* Sort by maximal area, just because I feel like it... */
-  ret = g_list_sort (ret, compare_rect_areas);
+  g_qsort_with_data (rects->data, rects->len, sizeof (MetaRectangle),
+                     compare_rect_areas, NULL);
 
   /* Merge rectangles if possible so that the list really is minimal */
-  ret = merge_spanning_rects_in_region (ret);
+  merge_spanning_rects_in_region (rects);
+
+  ret = rect_array_to_list (rects);
+
+  g_array_free (rects, TRUE);
+  g_array_free (splits, TRUE);
 
   return ret;
 }
@@ -1240,84 +1248,60 @@ meta_rectangle_edge_aligns (const MetaRectangle *rect, const MetaEdge *edge)
     }
 }
 
-static GList*
-get_rect_minus_overlap (const GList   *rect_in_list,
-                        MetaRectangle *overlap)
+/* Replace the contents of pieces with the parts of rect that are outside
+ * of overlap
+ */
+static void
+get_rect_minus_overlap (const MetaRectangle *rect,
+                        const MetaRectangle *overlap,
+                        GArray              *pieces)
 {
-  MetaRectangle *temp;
-  MetaRectangle *rect = rect_in_list->data;
-  GList *ret = NULL;
+  MetaRectangle temp;
+
+  g_array_set_size (pieces, 0);
 
   if (BOX_LEFT (*rect) < BOX_LEFT (*overlap))
     {
-      temp = g_new (MetaRectangle, 1);
-      *temp = *rect;
-      temp->width = BOX_LEFT (*overlap) - BOX_LEFT (*rect);
-      ret = g_list_prepend (ret, temp);
+      temp = *rect;
+      temp.width = BOX_LEFT (*overlap) - BOX_LEFT (*rect);
+      g_array_append_val (pieces, temp);
     }
   if (BOX_RIGHT (*rect) > BOX_RIGHT (*overlap))
     {
-      temp = g_new (MetaRectangle, 1);
-      *temp = *rect;
-      temp->x = BOX_RIGHT (*overlap);
-      temp->width = BOX_RIGHT (*rect) - BOX_RIGHT (*overlap);
-      ret = g_list_prepend (ret, temp);
+      temp = *rect;
+      temp.x = BOX_RIGHT (*overlap);
+      temp.width = BOX_RIGHT (*rect) - BOX_RIGHT (*overlap);
+      g_array_append_val (pieces, temp);
     }
   if (BOX_TOP (*rect) < BOX_TOP (*overlap))
     {
-      temp = g_new (MetaRectangle, 1);
-      temp->x      = overlap->x;
-      temp->width  = overlap->width;
-      temp->y      = BOX_TOP (*rect);
-      temp->height = BOX_TOP (*overlap) - BOX_TOP (*rect);
-      ret = g_list_prepend (ret, temp);
+      temp.x      = overlap->x;
+      temp.width  = overlap->width;
+      temp.y      = BOX_TOP (*rect);
+      temp.height = BOX_TOP (*overlap) - BOX_TOP (*rect);
+      g_array_append_val (pieces, temp);
     }
   if (BOX_BOTTOM (*rect) > BOX_BOTTOM (*overlap))
     {
-      temp = g_new (MetaRectangle, 1);
-      temp->x      = overlap->x;
-      temp->width  = overlap->width;
-      temp->y      = BOX_BOTTOM (*overlap);
-      temp->height = BOX_BOTTOM (*rect) - BOX_BOTTOM (*overlap);
-      ret = g_list_prepend (ret, temp);
+      temp.x      = overlap->x;
+      temp.width  = overlap->width;
+      temp.y      = BOX_BOTTOM (*overlap);
+      temp.height = BOX_BOTTOM (*rect) - BOX_BOTTOM (*overlap);
+      g_array_append_val (pieces, temp);
     }
 
-  return ret;
+  /* The pieces used to be prepended to a list */
+  reverse_array (pieces);
 }
 
-static GList*
-replace_rect_with_list (GList *old_element,
-                        GList *new_list)
+/* Replace the rectangle at index in rects with the ones in replacement */
+static void
+replace_rect_with_array (GArray *rects,
+                         guint   index,
+                         GArray *replacement)
 {
-  GList *ret;
-  g_assert (old_element != NULL);
-
-  if (!new_list)
-    {
-      /* If there is no new list, just remove the old_element */
-      ret = g_list_remove_link (old_element, old_element);
-    }
-  else
-    {
-      /* Fix up the prev and next pointers everywhere */
-      ret = new_list;
-      if (old_element->prev)
-        {
-          old_element->prev->next = new_list;
-          new_list->prev = old_element->prev;
-        }
-      if (old_element->next)
-        {
-          GList *tmp = g_list_last (new_list);
-          old_element->next->prev = tmp;
-          tmp->next = old_element->next;
-        }
-    }
-
-  /* Free the old_element and return the appropriate "next" point */
-  g_free (old_element->data);
-  g_list_free_1 (old_element);
-  return ret;
+  g_array_remove_index (rects, index);
+  g_array_insert_vals (rects, index, replacement->data, replacement->len);
 }
 
 /* Make a copy of the strut list, make sure that copy only contains parts
@@ -1326,79 +1310,74 @@ replace_rect_with_list (GList *old_element,
  * that aren't disjoint in a way that the overlapping part is only included
  * once, so it's not really magic...).
  */
-static GList*
+static GArray*
 get_disjoint_strut_rect_list_in_region (const GSList        *old_struts,
                                         const MetaRectangle *region)
 {
-  GList *strut_rects;
-  GList *tmp;
+  GArray *strut_rects;
+  GArray *leftover;
+  guint tmp;
+
+  strut_rects = g_array_new (FALSE, FALSE, sizeof (MetaRectangle));
+  leftover = g_array_new (FALSE, FALSE, sizeof (MetaRectangle));
 
   /* First, copy the list */
-  strut_rects = NULL;
   while (old_struts)
     {
-      MetaRectangle *cur = &((MetaStrut*)old_struts->data)->rect;
-      MetaRectangle *copy = g_new (MetaRectangle, 1);
-      *copy = *cur;
-      if (meta_rectangle_intersect (copy, region, copy))
-        strut_rects = g_list_prepend (strut_rects, copy);
-      else
-        g_free (copy);
+      MetaRectangle copy = ((MetaStrut*)old_struts->data)->rect;
+
+      if (meta_rectangle_intersect (&copy, region, &copy))
+        g_array_append_val (strut_rects, copy);
 
       old_struts = old_struts->next;
     }
 
+  /* The copy used to be built by prepending */
+  reverse_array (strut_rects);
+
   /* Now, loop over the list and check for intersections, fixing things up
    * where they do intersect.
    */
-  tmp = strut_rects;
-  while (tmp)
+  for (tmp = 0; tmp < strut_rects->len; tmp++)
     {
-      GList *compare;
+      guint compare = tmp + 1;
 
-      MetaRectangle *cur = tmp->data;
-
-      compare = tmp->next;
-      while (compare)
+      while (compare < strut_rects->len)
         {
-          MetaRectangle *comp = compare->data;
+          MetaRectangle cur = g_array_index (strut_rects, MetaRectangle, tmp);
+          MetaRectangle comp = g_array_index (strut_rects, MetaRectangle, compare);
           MetaRectangle overlap;
 
-          if (meta_rectangle_intersect (cur, comp, &overlap))
+          if (!meta_rectangle_intersect (&cur, &comp, &overlap))
             {
-              /* Get a list of rectangles for each strut that don't overlap
-               * the intersection region.
-               */
-              GList *cur_leftover  = get_rect_minus_overlap (tmp,  &overlap);
-              GList *comp_leftover = get_rect_minus_overlap (compare, &overlap);
+              compare++;
+              continue;
+            }
 
-              /* Add the intersection region to cur_leftover */
-              MetaRectangle *overlap_allocated = g_new (MetaRectangle, 1);
-              *overlap_allocated = overlap;
-              cur_leftover = g_list_prepend (cur_leftover, overlap_allocated);
+          /* Replace cur with the intersection region followed by the
+           * parts of cur that don't overlap it.
+           */
+          get_rect_minus_overlap (&cur, &overlap, leftover);
+          g_array_prepend_val (leftover, overlap);
 
-              /* Fix up tmp, compare, and cur -- maybe struts too */
-              if (strut_rects == tmp)
-                {
-                  strut_rects = replace_rect_with_list (tmp, cur_leftover);
-                  tmp = strut_rects;
-                }
-              else
-                tmp   = replace_rect_with_list (tmp,     cur_leftover);
-              compare = replace_rect_with_list (compare, comp_leftover);
+          replace_rect_with_array (strut_rects, tmp, leftover);
+          compare += leftover->len - 1;
 
-              if (compare == NULL)
-                break;
+          /* Replace comp with its parts that don't overlap it */
+          get_rect_minus_overlap (&comp, &overlap, leftover);
 
-              cur = tmp->data;
-            }
+          replace_rect_with_array (strut_rects, compare, leftover);
 
-          compare = compare->next;
+          /* The rectangle following the replaced ones is not compared to
+           * the intersection region, as was the case with the list based
+           * implementation.
+           */
+          compare++;
         }
-
-      tmp = tmp->next;
     }
 
+  g_array_free (leftover, TRUE);
+
   return strut_rects;
 }
 
@@ -1564,63 +1543,60 @@ rectangle_and_edge_intersection (const MetaRectangle *rect,
   return intersect;
 }
 
-/* Add all edges of the given rect to cur_edges and return the result.  If
- * rect_is_internal is false, the side types are switched (LEFT<->RIGHT and
- * TOP<->BOTTOM).
+/* Append all edges of the given rect to edges.  If rect_is_internal is
+ * false, the side types are switched (LEFT<->RIGHT and TOP<->BOTTOM).
  */
-static GList*
-add_edges (GList               *cur_edges,
+static void
+add_edges (GArray              *edges,
            const MetaRectangle *rect,
            gboolean             rect_is_internal)
 {
-  MetaEdge *temp_edge;
+  MetaEdge temp_edge;
   int i;
 
   for (i=0; i<4; i++)
     {
-      temp_edge = g_new (MetaEdge, 1);
-      temp_edge->rect = *rect;
+      temp_edge.rect = *rect;
       switch (i)
         {
         case 0:
-          temp_edge->side_type =
+          temp_edge.side_type =
             rect_is_internal ? META_SIDE_LEFT : META_SIDE_RIGHT;
-          temp_edge->rect.width = 0;
+          temp_edge.rect.width = 0;
           break;
         case 1:
-          temp_edge->side_type =
+          temp_edge.side_type =
             rect_is_internal ? META_SIDE_RIGHT : META_SIDE_LEFT;
-          temp_edge->rect.x     += temp_edge->rect.width;
-          temp_edge->rect.width  = 0;
+          temp_edge.rect.x     += temp_edge.rect.width;
+          temp_edge.rect.width  = 0;
           break;
         case 2:
-          temp_edge->side_type =
+          temp_edge.side_type =
             rect_is_internal ? META_SIDE_TOP : META_SIDE_BOTTOM;
-          temp_edge->rect.height = 0;
+          temp_edge.rect.height = 0;
           break;
         case 3:
-          temp_edge->side_type =
+          temp_edge.side_type =
             rect_is_internal ? META_SIDE_BOTTOM : META_SIDE_TOP;
-          temp_edge->rect.y      += temp_edge->rect.height;
-          temp_edge->rect.height  = 0;
+          temp_edge.rect.y      += temp_edge.rect.height;
+          temp_edge.rect.height  = 0;
           break;
         }
-      temp_edge->edge_type = META_EDGE_SCREEN;
-      cur_edges = g_list_prepend (cur_edges, temp_edge);
+      temp_edge.edge_type = META_EDGE_SCREEN;
+      g_array_append_val (edges, temp_edge);
     }
-
-  return cur_edges;
 }
 
-/* Remove any part of old_edge that intersects remove and add any resulting
- * edges to cur_list.  Return cur_list when finished.
+/* Compute the parts of old_edge that do not intersect remove, and return
+ * how many of them there are.
  */
-static GList*
-split_edge (GList *cur_list,
-            const MetaEdge *old_edge,
-            const MetaEdge *remove)
+static int
+get_edge_splits (const MetaEdge *old_edge,
+                 const MetaEdge *remove,
+                 MetaEdge        splits[2])
 {
-  MetaEdge *temp_edge;
+  int n_splits = 0;
+
   switch (old_edge->side_type)
     {
     case META_SIDE_LEFT:
@@ -1628,20 +1604,18 @@ split_edge (GList *cur_list,
       g_assert (meta_rectangle_vert_overlap (&old_edge->rect, &remove->rect));
       if (BOX_TOP (old_edge->rect)  < BOX_TOP (remove->rect))
         {
-          temp_edge = g_new (MetaEdge, 1);
-          *temp_edge = *old_edge;
-          temp_edge->rect.height = BOX_TOP (remove->rect)
-                                 - BOX_TOP (old_edge->rect);
-          cur_list = g_list_prepend (cur_list, temp_edge);
+          splits[n_splits] = *old_edge;
+          splits[n_splits].rect.height = BOX_TOP (remove->rect)
+                                       - BOX_TOP (old_edge->rect);
+          n_splits++;
         }
       if (BOX_BOTTOM (old_edge->rect) > BOX_BOTTOM (remove->rect))
         {
-          temp_edge = g_new (MetaEdge, 1);
-          *temp_edge = *old_edge;
-          temp_edge->rect.y      = BOX_BOTTOM (remove->rect);
-          temp_edge->rect.height = BOX_BOTTOM (old_edge->rect)
-                                 - BOX_BOTTOM (remove->rect);
-          cur_list = g_list_prepend (cur_list, temp_edge);
+          splits[n_splits] = *old_edge;
+          splits[n_splits].rect.y      = BOX_BOTTOM (remove->rect);
+          splits[n_splits].rect.height = BOX_BOTTOM (old_edge->rect)
+                                       - BOX_BOTTOM (remove->rect);
+          n_splits++;
         }
       break;
     case META_SIDE_TOP:
@@ -1649,35 +1623,90 @@ split_edge (GList *cur_list,
       g_assert (meta_rectangle_horiz_overlap (&old_edge->rect, &remove->rect));
       if (BOX_LEFT (old_edge->rect)  < BOX_LEFT (remove->rect))
         {
-          temp_edge = g_new (MetaEdge, 1);
-          *temp_edge = *old_edge;
-          temp_edge->rect.width = BOX_LEFT (remove->rect)
-                                - BOX_LEFT (old_edge->rect);
-          cur_list = g_list_prepend (cur_list, temp_edge);
+          splits[n_splits] = *old_edge;
+          splits[n_splits].rect.width = BOX_LEFT (remove->rect)
+                                      - BOX_LEFT (old_edge->rect);
+          n_splits++;
         }
       if (BOX_RIGHT (old_edge->rect) > BOX_RIGHT (remove->rect))
         {
-          temp_edge = g_new (MetaEdge, 1);
-          *temp_edge = *old_edge;
-          temp_edge->rect.x     = BOX_RIGHT (remove->rect);
-          temp_edge->rect.width = BOX_RIGHT (old_edge->rect)
-                                - BOX_RIGHT (remove->rect);
-          cur_list = g_list_prepend (cur_list, temp_edge);
+          splits[n_splits] = *old_edge;
+          splits[n_splits].rect.x     = BOX_RIGHT (remove->rect);
+          splits[n_splits].rect.width = BOX_RIGHT (old_edge->rect)
+                                      - BOX_RIGHT (remove->rect);
+          n_splits++;
         }
       break;
     default:
       g_assert_not_reached ();
     }
 
+  return n_splits;
+}
+
+/* Remove any part of old_edge that intersects remove and add any resulting
+ * edges to cur_list.  Return cur_list when finished.
+ */
+static GList*
+split_edge (GList *cur_list,
+            const MetaEdge *old_edge,
+            const MetaEdge *remove)
+{
+  MetaEdge splits[2];
+  int n_splits, i;
+
+  n_splits = get_edge_splits (old_edge, remove, splits);
+  for (i = 0; i < n_splits; i++)
+    cur_list = g_list_prepend (cur_list, g_memdup (&splits[i], sizeof (MetaEdge)));
+
   return cur_list;
 }
 
+/* Edges in the arrays used by meta_rectangle_find_onscreen_edges() are
+ * removed by giving them a negative width, and dropped all at once later.
+ */
+#define EDGE_IS_REMOVED(edge) ((edge)->rect.width < 0)
+
+static void
+remove_edge (MetaEdge *edge)
+{
+  edge->rect.width = -1;
+}
+
+static void
+drop_removed_edges (GArray *edges)
+{
+  MetaEdge *data = (MetaEdge *) edges->data;
+  guint i, n_kept = 0;
+
+  for (i = 0; i < edges->len; i++)
+    {
+      if (!EDGE_IS_REMOVED (&data[i]))
+        data[n_kept++] = data[i];
+    }
+  g_array_set_size (edges, n_kept);
+}
+
+/* Same as split_edge(), but appending to an array of edges */
+static void
+split_edge_into_array (GArray         *edges,
+                       const MetaEdge *old_edge,
+                       const MetaEdge *remove)
+{
+  MetaEdge splits[2];
+  int n_splits;
+
+  n_splits = get_edge_splits (old_edge, remove, splits);
+  g_array_append_vals (edges, splits, n_splits);
+}
+
 /* Split up edge and remove preliminary edges from strut_edges depending on
- * if and how rect and edge intersect.
+ * if and how rect and edge intersect.  Both arrays are in reverse order
+ * (see meta_rectangle_find_onscreen_edges()).
  */
 static void
 fix_up_edges (MetaRectangle *rect,         MetaEdge *edge,
-              GList         **strut_edges, GList    **edge_splits,
+              GArray        *strut_edges,  GArray   *edge_splits,
               gboolean      *edge_needs_removal)
 {
   MetaEdge overlap;
@@ -1689,7 +1718,7 @@ fix_up_edges (MetaRectangle *rect,         MetaEdge *edge,
   if (handle_type == 0 || handle_type == 1)
     {
       /* Put the result of removing overlap from edge into edge_splits */
-      *edge_splits = split_edge (*edge_splits, edge, &overlap);
+      split_edge_into_array (edge_splits, edge, &overlap);
       *edge_needs_removal = TRUE;
     }
 
@@ -1697,25 +1726,21 @@ fix_up_edges (MetaRectangle *rect,         MetaEdge *edge,
     {
       /* Remove the overlap from strut_edges */
       /* First, loop over the edges of the strut */
-      GList *tmp = *strut_edges;
-      while (tmp)
+      int i;
+
+      for (i = (int) strut_edges->len - 1; i >= 0; i--)
         {
-          MetaEdge *cur = tmp->data;
+          MetaEdge cur = g_array_index (strut_edges, MetaEdge, i);
+
           /* If this is the edge that overlaps, then we need to split it */
-          if (edges_overlap (cur, &overlap))
+          if (!EDGE_IS_REMOVED (&cur) && edges_overlap (&cur, &overlap))
             {
-              GList *delete_me = tmp;
-
               /* Split this edge into some new ones */
-              *strut_edges = split_edge (*strut_edges, cur, &overlap);
+              split_edge_into_array (strut_edges, &cur, &overlap);
 
               /* Delete the old one */
-              tmp = tmp->next;
-              g_free (cur);
-              *strut_edges = g_list_delete_link (*strut_edges, delete_me);
+              remove_edge (&g_array_index (strut_edges, MetaEdge, i));
             }
-          else
-            tmp = tmp->next;
         }
     }
 }
@@ -1799,9 +1824,11 @@ meta_rectangle_find_onscreen_edges (const MetaRectangle *basic_rect,
                                     const GSList        *all_struts)
 {
   GList        *ret;
-  GList        *fixed_strut_rects;
-  GList        *edge_iter;
-  const GList  *strut_rect_iter;
+  GArray       *fixed_strut_rects;
+  GArray       *edges;
+  GArray       *new_strut_edges;
+  guint         strut_index;
+  int           i;
 
   /* The algorithm is basically as follows:
    *   Make sure the struts are disjoint
@@ -1816,6 +1843,11 @@ meta_rectangle_find_onscreen_edges (const MetaRectangle *basic_rect,
    *         edge_set and the preliminary edge for the strut will need to
    *         be split
    *     Add any remaining "preliminary" strut edges to the edge_set
+   *
+   * The edge sets are kept in arrays ordered the other way around from
+   * the lists they used to be, so that new edges, which used to be
+   * prepended, are appended; this keeps the order of edges that compare
+   * as equal when sorting the result.
    */
 
   /* Make sure the struts are disjoint */
@@ -1823,55 +1855,52 @@ meta_rectangle_find_onscreen_edges (const MetaRectangle *basic_rect,
     get_disjoint_strut_rect_list_in_region (all_struts, basic_rect);
 
   /* Start off the list with the edges of basic_rect */
-  ret = add_edges (NULL, basic_rect, TRUE);
+  edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge));
+  add_edges (edges, basic_rect, TRUE);
 
-  strut_rect_iter = fixed_strut_rects;
-  while (strut_rect_iter)
+  new_strut_edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge));
+
+  for (strut_index = 0; strut_index < fixed_strut_rects->len; strut_index++)
     {
-      MetaRectangle *strut_rect = (MetaRectangle*) strut_rect_iter->data;
+      MetaRectangle *strut_rect =
+        &g_array_index (fixed_strut_rects, MetaRectangle, strut_index);
 
       /* Get the new possible edges we may need to add from the strut */
-      GList *new_strut_edges = add_edges (NULL, strut_rect, FALSE);
+      g_array_set_size (new_strut_edges, 0);
+      add_edges (new_strut_edges, strut_rect, FALSE);
 
-      edge_iter = ret;
-      while (edge_iter)
+      /* Edges split during this loop are appended past the ones we visit */
+      for (i = (int) edges->len - 1; i >= 0; i--)
         {
-          MetaEdge *cur_edge = edge_iter->data;
-          GList *splits_of_cur_edge = NULL;
+          MetaEdge cur_edge = g_array_index (edges, MetaEdge, i);
           gboolean edge_needs_removal = FALSE;
 
-          fix_up_edges (strut_rect,       cur_edge,
-                        &new_strut_edges, &splits_of_cur_edge,
+          fix_up_edges (strut_rect,      &cur_edge,
+                        new_strut_edges, edges,
                         &edge_needs_removal);
 
+          /* Delete the old edge; the new split parts were added already */
           if (edge_needs_removal)
-            {
-              /* Delete the old edge */
-              GList *delete_me = edge_iter;
-              edge_iter = edge_iter->next;
-              g_free (cur_edge);
-              ret = g_list_delete_link (ret, delete_me);
-
-              /* Add the new split parts of the edge */
-              ret = g_list_concat (splits_of_cur_edge, ret);
-            }
-          else
-            {
-              edge_iter = edge_iter->next;
-            }
-
-          /* edge_iter was already advanced above */
+            remove_edge (&g_array_index (edges, MetaEdge, i));
         }
 
-      ret = g_list_concat (new_strut_edges, ret);
-      strut_rect_iter = strut_rect_iter->next;
+      drop_removed_edges (edges);
+      drop_removed_edges (new_strut_edges);
+
+      g_array_append_vals (edges, new_strut_edges->data, new_strut_edges->len);
     }
 
-  /* Sort the list */
+  /* Build the list in the original order, and sort it */
+  ret = NULL;
+  for (i = 0; i < (int) edges->len; i++)
+    ret = g_list_prepend (ret, g_memdup (&g_array_index (edges, MetaEdge, i),
+                                         sizeof (MetaEdge)));
+
   ret = g_list_sort (ret, meta_rectangle_edge_cmp);
 
-  /* Free the fixed struts list */
-  meta_rectangle_free_list_and_elements (fixed_strut_rects);
+  g_array_free (new_strut_edges, TRUE);
+  g_array_free (edges, TRUE);
+  g_array_free (fixed_strut_rects, TRUE);
 
   return ret;
 }
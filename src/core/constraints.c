@@ -32,6 +32,7 @@
 #include "backends/meta-monitor-manager-private.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #if 0
@@ -142,6 +143,11 @@ typedef struct
    */
   GList  *usable_screen_region;
   GList  *usable_monitor_region;
+
+  /* Set while the user moves or resizes the window; see
+   * get_constraint_cache()
+   */
+  MetaConstraintCache *cache;
 } ConstraintInfo;
 
 static gboolean do_screen_and_monitor_relative_constraints (MetaWindow     *window,
@@ -216,22 +222,66 @@ typedef gboolean (* ConstraintFunc) (MetaWindow         *window,
 typedef struct {
   ConstraintFunc func;
   const char* name;
+
+  /* FALSE for the constraints which never change anything in a move
+   * done by the user; those are not even called for such moves.
+   */
+  gboolean applies_to_user_move;
 } Constraint;
 
 static const Constraint all_constraints[] = {
-  {constrain_custom_rule,        "constrain_custom_rule"},
-  {constrain_modal_dialog,       "constrain_modal_dialog"},
-  {constrain_maximization,       "constrain_maximization"},
-  {constrain_tiling,             "constrain_tiling"},
-  {constrain_fullscreen,         "constrain_fullscreen"},
-  {constrain_size_increments,    "constrain_size_increments"},
-  {constrain_size_limits,        "constrain_size_limits"},
-  {constrain_aspect_ratio,       "constrain_aspect_ratio"},
-  {constrain_to_single_monitor,  "constrain_to_single_monitor"},
-  {constrain_fully_onscreen,     "constrain_fully_onscreen"},
-  {constrain_titlebar_visible,   "constrain_titlebar_visible"},
-  {constrain_partially_onscreen, "constrain_partially_onscreen"},
-  {NULL,                         NULL}
+  {constrain_custom_rule,        "constrain_custom_rule",        TRUE},
+  {constrain_modal_dialog,       "constrain_modal_dialog",       TRUE},
+  {constrain_maximization,       "constrain_maximization",       TRUE},
+  {constrain_tiling,             "constrain_tiling",             TRUE},
+  {constrain_fullscreen,         "constrain_fullscreen",         TRUE},
+  {constrain_size_increments,    "constrain_size_increments",    FALSE},
+  {constrain_size_limits,        "constrain_size_limits",        FALSE},
+  {constrain_aspect_ratio,       "constrain_aspect_ratio",       FALSE},
+  {constrain_to_single_monitor,  "constrain_to_single_monitor",  FALSE},
+  {constrain_fully_onscreen,     "constrain_fully_onscreen",     FALSE},
+  {constrain_titlebar_visible,   "constrain_titlebar_visible",   TRUE},
+  {constrain_partially_onscreen, "constrain_partially_onscreen", TRUE},
+  {NULL,                         NULL,                           FALSE}
+};
+
+#define N_CONSTRAINTS (G_N_ELEMENTS (all_constraints) - 1)
+
+/* A copy of the usable screen region, expanded by the given amounts */
+typedef struct
+{
+  int    amounts[6];
+  GList *region;
+} ExpandedRegion;
+
+/* The parts of the constraint environment which do not depend on the
+ * position of the window, kept between the motion events of a move or
+ * resize done by the user.
+ */
+struct _MetaConstraintCache
+{
+  MetaWindow         *window;
+  MetaWorkspace      *workspace;
+  MetaWorkspace      *window_workspace;
+  gboolean            on_all_workspaces;
+
+  GList              *usable_screen_region;
+
+  /* The monitor the window was last constrained on */
+  MetaLogicalMonitor *logical_monitor;
+  MetaRectangle       work_area_monitor;
+  GList              *usable_monitor_region;
+
+  /* Regions used by constrain_titlebar_visible() and
+   * constrain_partially_onscreen() for moves
+   */
+  ExpandedRegion      titlebar_region;
+  ExpandedRegion      onscreen_region;
+
+  /* Time spent in each constraint, only measured in verbose mode */
+  GTimer             *timer;
+  guint               n_calls[N_CONSTRAINTS];
+  double              time_spent[N_CONSTRAINTS];
 };
 
 static gboolean
@@ -240,15 +290,37 @@ do_all_constraints (MetaWindow         *window,
                     ConstraintPriority  priority,
                     gboolean            check_only)
 {
+  MetaConstraintCache *cache = info->cache;
   const Constraint *constraint;
   gboolean          satisfied;
+  gboolean          user_move;
+
+  user_move = info->is_user_action && info->action_type == ACTION_MOVE;
 
   constraint = &all_constraints[0];
   satisfied = TRUE;
   while (constraint->func != NULL)
     {
-      satisfied = satisfied &&
-                  (*constraint->func) (window, info, priority, check_only);
+      if (user_move && !constraint->applies_to_user_move)
+        {
+          ++constraint;
+          continue;
+        }
+
+      if (cache && cache->timer && satisfied)
+        {
+          int i = constraint - all_constraints;
+
+          g_timer_start (cache->timer);
+          satisfied = (*constraint->func) (window, info, priority, check_only);
+          cache->time_spent[i] += g_timer_elapsed (cache->timer, NULL);
+          cache->n_calls[i]++;
+        }
+      else
+        {
+          satisfied = satisfied &&
+                      (*constraint->func) (window, info, priority, check_only);
+        }
 
       if (!check_only)
         {
@@ -273,6 +345,141 @@ do_all_constraints (MetaWindow         *window,
   return TRUE;
 }
 
+static void
+expanded_region_clear (ExpandedRegion *expanded)
+{
+  meta_rectangle_free_list_and_elements (expanded->region);
+  expanded->region = NULL;
+}
+
+static void
+constraint_cache_free (MetaConstraintCache *cache)
+{
+  if (cache->timer)
+    {
+      guint i;
+
+      for (i = 0; i < N_CONSTRAINTS; i++)
+        meta_topic (META_DEBUG_GEOMETRY,
+                    "%s: %u calls, %.1f us in total during the grab\n",
+                    all_constraints[i].name, cache->n_calls[i],
+                    cache->time_spent[i] * 1e6);
+
+      g_timer_destroy (cache->timer);
+    }
+
+  expanded_region_clear (&cache->titlebar_region);
+  expanded_region_clear (&cache->onscreen_region);
+  g_free (cache);
+}
+
+/**
+ * meta_display_cleanup_constraint_cache:
+ * @display: a #MetaDisplay
+ *
+ * Drops the constraint data kept for the window being moved or resized
+ * by the user; needs to be called when the grab ends, and whenever the
+ * work areas or the monitors it was computed from change.
+ */
+void
+meta_display_cleanup_constraint_cache (MetaDisplay *display)
+{
+  if (display->grab_constraint_cache == NULL)
+    return;
+
+  constraint_cache_free (display->grab_constraint_cache);
+  display->grab_constraint_cache = NULL;
+}
+
+/* Returns the cache to use for this constraint run, or NULL if the
+ * window is not being moved or resized by the user. The cache is
+ * created on the first motion event of the grab.
+ */
+static MetaConstraintCache *
+get_constraint_cache (MetaWindow          *window,
+                      MetaMoveResizeFlags  flags)
+{
+  MetaDisplay *display = window->display;
+  MetaConstraintCache *cache;
+
+  /* Fullscreen windows use the fullscreen monitors rather than the
+   * monitor they are on, so keep it simple and don't cache anything.
+   */
+  if (!(flags & META_MOVE_RESIZE_USER_ACTION) ||
+      window != display->grab_window ||
+      !(meta_grab_op_is_moving (display->grab_op) ||
+        meta_grab_op_is_resizing (display->grab_op)) ||
+      window->fullscreen)
+    return NULL;
+
+  cache = display->grab_constraint_cache;
+  if (cache &&
+      (cache->window != window ||
+       cache->workspace != window->screen->active_workspace ||
+       cache->window_workspace != window->workspace ||
+       cache->on_all_workspaces != window->on_all_workspaces))
+    {
+      meta_display_cleanup_constraint_cache (display);
+      cache = NULL;
+    }
+
+  if (cache == NULL)
+    {
+      cache = g_new0 (MetaConstraintCache, 1);
+      cache->window = window;
+      cache->workspace = window->screen->active_workspace;
+      cache->window_workspace = window->workspace;
+      cache->on_all_workspaces = window->on_all_workspaces;
+      cache->usable_screen_region =
+        meta_workspace_get_onscreen_region (cache->workspace);
+
+      if (meta_is_verbose ())
+        cache->timer = g_timer_new ();
+
+      display->grab_constraint_cache = cache;
+    }
+
+  return cache;
+}
+
+/* Returns the usable screen region expanded by the given amounts, like
+ * meta_rectangle_expand_region_conditionally() does, reusing the last
+ * region if the amounts did not change; they only depend on the size of
+ * the window, which does not change during a move.
+ */
+static GList *
+get_expanded_region (MetaConstraintCache *cache,
+                     ExpandedRegion      *expanded,
+                     int                  left_expand,
+                     int                  right_expand,
+                     int                  top_expand,
+                     int                  bottom_expand,
+                     int                  min_x,
+                     int                  min_y)
+{
+  int amounts[6] = { left_expand, right_expand, top_expand, bottom_expand,
+                     min_x, min_y };
+
+  if (expanded->region &&
+      memcmp (expanded->amounts, amounts, sizeof (amounts)) == 0)
+    return expanded->region;
+
+  expanded_region_clear (expanded);
+
+  memcpy (expanded->amounts, amounts, sizeof (amounts));
+  expanded->region = g_list_copy_deep (cache->usable_screen_region,
+                                       (GCopyFunc) meta_rectangle_copy, NULL);
+  meta_rectangle_expand_region_conditionally (expanded->region,
+                                              left_expand,
+                                              right_expand,
+                                              top_expand,
+                                              bottom_expand,
+                                              min_x,
+                                              min_y);
+
+  return expanded->region;
+}
+
 void
 meta_window_constrain (MetaWindow          *window,
                        MetaMoveResizeFlags  flags,
@@ -290,6 +497,7 @@ meta_window_constrain (MetaWindow          *window,
               orig->x, orig->y, orig->width, orig->height,
               new->x,  new->y,  new->width,  new->height);
 
+  info.cache = get_constraint_cache (window, flags);
   setup_constraint_info (&info,
                          window,
                          flags,
@@ -390,33 +598,57 @@ setup_constraint_info (ConstraintInfo      *info,
   logical_monitor =
     meta_monitor_manager_get_logical_monitor_from_rect (monitor_manager,
                                                         &info->current);
-  meta_window_get_work_area_for_logical_monitor (window,
-                                                 logical_monitor,
-                                                 &info->work_area_monitor);
+  cur_workspace = window->screen->active_workspace;
 
-  if (!window->fullscreen || !meta_window_has_fullscreen_monitors (window))
+  if (info->cache)
     {
+      MetaConstraintCache *cache = info->cache;
+
+      if (cache->logical_monitor != logical_monitor)
+        {
+          cache->logical_monitor = logical_monitor;
+          meta_window_get_work_area_for_logical_monitor (window,
+                                                         logical_monitor,
+                                                         &cache->work_area_monitor);
+          cache->usable_monitor_region =
+            meta_workspace_get_onmonitor_region (cur_workspace,
+                                                 logical_monitor);
+        }
+
+      info->work_area_monitor = cache->work_area_monitor;
       info->entire_monitor = logical_monitor->rect;
+      info->usable_screen_region = cache->usable_screen_region;
+      info->usable_monitor_region = cache->usable_monitor_region;
     }
   else
     {
-      info->entire_monitor = window->fullscreen_monitors.top->rect;
-      meta_rectangle_union (&info->entire_monitor,
-                            &window->fullscreen_monitors.bottom->rect,
-                            &info->entire_monitor);
-      meta_rectangle_union (&info->entire_monitor,
-                            &window->fullscreen_monitors.left->rect,
-                            &info->entire_monitor);
-      meta_rectangle_union (&info->entire_monitor,
-                            &window->fullscreen_monitors.right->rect,
-                            &info->entire_monitor);
-    }
+      meta_window_get_work_area_for_logical_monitor (window,
+                                                     logical_monitor,
+                                                     &info->work_area_monitor);
 
-  cur_workspace = window->screen->active_workspace;
-  info->usable_screen_region   =
-    meta_workspace_get_onscreen_region (cur_workspace);
-  info->usable_monitor_region =
-    meta_workspace_get_onmonitor_region (cur_workspace, logical_monitor);
+      if (!window->fullscreen || !meta_window_has_fullscreen_monitors (window))
+        {
+          info->entire_monitor = logical_monitor->rect;
+        }
+      else
+        {
+          info->entire_monitor = window->fullscreen_monitors.top->rect;
+          meta_rectangle_union (&info->entire_monitor,
+                                &window->fullscreen_monitors.bottom->rect,
+                                &info->entire_monitor);
+          meta_rectangle_union (&info->entire_monitor,
+                                &window->fullscreen_monitors.left->rect,
+                                &info->entire_monitor);
+          meta_rectangle_union (&info->entire_monitor,
+                                &window->fullscreen_monitors.right->rect,
+                                &info->entire_monitor);
+        }
+
+      info->usable_screen_region   =
+        meta_workspace_get_onscreen_region (cur_workspace);
+      info->usable_monitor_region =
+        meta_workspace_get_onmonitor_region (cur_workspace, logical_monitor);
+    }
 
   /* Log all this information for debugging */
   meta_topic (META_DEBUG_GEOMETRY,
@@ -533,8 +765,8 @@ place_window_if_needed(MetaWindow     *window,
                        .083 * info->work_area_monitor.height;
             }
 
-          /* idle_move_resize() uses the unconstrained_rect, so make sure it
-           * uses the placed coordinates (bug #556696).
+          /* process_move_resize_queue() uses the unconstrained_rect, so
+           * make sure it uses the placed coordinates (bug #556696).
            */
           window->unconstrained_rect = info->current;
 
@@ -1570,6 +1802,27 @@ constrain_titlebar_visible (MetaWindow         *window,
   else
     bottom_amount = vert_amount_offscreen;
 
+  /* During a move by the user, the expanded region is the same for
+   * every motion event.
+   */
+  if (info->cache && info->action_type == ACTION_MOVE)
+    {
+      GList *region =
+        get_expanded_region (info->cache,
+                             &info->cache->titlebar_region,
+                             horiz_amount_offscreen,
+                             horiz_amount_offscreen,
+                             0, /* Don't let titlebar off */
+                             bottom_amount,
+                             horiz_amount_onscreen,
+                             vert_amount_onscreen);
+
+      return do_screen_and_monitor_relative_constraints (window,
+                                                         region,
+                                                         info,
+                                                         check_only);
+    }
+
   /* Extend the region, have a helper function handle the constraint,
    * then return the region to its original size.
    */
@@ -1649,6 +1902,24 @@ constrain_partially_onscreen (MetaWindow         *window,
   else
     bottom_amount = vert_amount_offscreen;
 
+  if (info->cache && info->action_type == ACTION_MOVE)
+    {
+      GList *region =
+        get_expanded_region (info->cache,
+                             &info->cache->onscreen_region,
+                             horiz_amount_offscreen,
+                             horiz_amount_offscreen,
+                             top_amount,
+                             bottom_amount,
+                             horiz_amount_onscreen,
+                             vert_amount_onscreen);
+
+      return do_screen_and_monitor_relative_constraints (window,
+                                                         region,
+                                                         info,
+                                                         check_only);
+    }
+
   /* Extend the region, have a helper function handle the constraint,
    * then return the region to its original size.
    */
@@ -37,6 +37,7 @@
 #include "keybindings-private.h"
 #include "startup-notification-private.h"
 #include "meta-gesture-tracker-private.h"
+#include "edge-cache.h"
 #include <meta/prefs.h>
 #include <meta/barrier.h>
 #include <clutter/clutter.h>
@@ -54,6 +55,7 @@ typedef struct _MetaGroupPropHooks  MetaGroupPropHooks;
 typedef struct _MetaWindowPropHooks MetaWindowPropHooks;
 
 typedef struct MetaEdgeResistanceData MetaEdgeResistanceData;
+typedef struct _MetaConstraintCache MetaConstraintCache;
 
 typedef enum {
   META_LIST_DEFAULT                   = 0,      /* normal windows */
@@ -223,8 +225,14 @@ struct _MetaDisplay
   gboolean    grab_threshold_movement_reached; /* raise_on_click == FALSE.    */
   GTimeVal    grab_last_moveresize_time;
   MetaEdgeResistanceData *grab_edge_resistance_data;
+  MetaConstraintCache *grab_constraint_cache;
   unsigned int grab_last_user_action_was_snap;
 
+  /* Window edges of the active workspace, kept up to date between grabs */
+  MetaEdgeCache *edge_cache;
+  guint       edge_cache_later;
+  gboolean    edge_cache_dirty;
+
   /* we use property updates as sentinels for certain window focus events
    * to avoid some race conditions on EnterNotify events
    */
@@ -253,6 +261,12 @@ struct _MetaDisplay
   GHashTable *prop_hooks;
   int n_prop_hooks;
 
+  /* Replies requested ahead of managing the existing windows at startup,
+   * managed by window-x11.c and xprops.c
+   */
+  GHashTable *prefetched_window_attributes;
+  GHashTable *prefetched_properties;
+
   /* Managed by group-props.c */
   MetaGroupPropHooks *group_prop_hooks;
 
@@ -407,8 +421,11 @@ void meta_display_grab_focus_window_button   (MetaDisplay *display,
 void meta_display_ungrab_focus_window_button (MetaDisplay *display,
                                               MetaWindow  *window);
 
-/* Next function is defined in edge-resistance.c */
+/* Next functions are defined in edge-resistance.c */
 void meta_display_cleanup_edges              (MetaDisplay *display);
+void meta_display_cleanup_constraint_cache   (MetaDisplay *display);
+void meta_display_queue_edge_cache_update    (MetaDisplay *display);
+void meta_display_free_edge_cache            (MetaDisplay *display);
 
 /* make a request to ensure the event serial has changed */
 void     meta_display_increment_event_serial (MetaDisplay *display);
@@ -705,6 +705,10 @@ meta_display_open (void)
 
   display->grab_edge_resistance_data = NULL;
 
+  display->edge_cache = meta_edge_cache_new ();
+  display->edge_cache_later = 0;
+  display->edge_cache_dirty = TRUE;
+
   {
     int major, minor;
 
@@ -1135,6 +1139,9 @@ meta_display_close (MetaDisplay *display,
     meta_screen_free (display->screen, timestamp);
   display->screen = NULL;
 
+  meta_display_free_edge_cache (display);
+  meta_display_cleanup_constraint_cache (display);
+
   /* Must be after all calls to meta_window_unmanage() since they
    * unregister windows
    */
@@ -1992,6 +1999,8 @@ meta_display_end_grab_op (MetaDisplay *display,
    * up to date. */
   display->grab_op = META_GRAB_OP_NONE;
 
+  meta_display_cleanup_constraint_cache (display);
+
   if (display->event_route == META_EVENT_ROUTE_WINDOW_OP)
     {
       /* Clear out the edge cache */
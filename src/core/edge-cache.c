@@ -0,0 +1,825 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * SECTION:edge-cache
+ * @short_description: Persistent cache of window edges
+ *
+ * Edge resistance needs the visible parts of the edges of every window
+ * on the active workspace, sorted by position. Computing them means
+ * clipping the edges of each window by all the windows above it, which
+ * is too slow to do from scratch at the start of every grab when there
+ * are many windows.
+ *
+ * #MetaEdgeCache keeps the edges of each window around, along with the
+ * windows that were found to clip them, and only recomputes them when
+ * the window or one of those windows changed. The sorted edge arrays
+ * are kept around as well, so that starting a grab only needs to take
+ * out the edges of the grabbed window and put back the parts of the
+ * edges it was hiding.
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "edge-cache.h"
+#include "boxes-private.h"
+#include "spatial-index.h"
+
+typedef struct _Clipper
+{
+  gpointer window;
+  MetaRectangle rect;
+} Clipper;
+
+typedef struct _CachedWindow
+{
+  gpointer window;
+  MetaRectangle rect;
+  gboolean has_edges;
+
+  /* Position in the last update, from bottom to top */
+  guint stack_position;
+  guint update_stamp;
+
+  /* Whether the edges must be recomputed whatever the clippers are */
+  gboolean needs_edges;
+
+  /* Whether the window is to be looked at again in this update */
+  gboolean queued;
+
+  /* Windows above this one which can hide parts of its edges, from
+   * bottom to top, as of when edges were computed
+   */
+  GArray *clippers;
+  GList *edges;
+} CachedWindow;
+
+struct _MetaEdgeCache
+{
+  MetaRectangle screen_rect;
+
+  /* window -> CachedWindow */
+  GHashTable *windows;
+
+  /* CachedWindow -> rect */
+  MetaSpatialIndex *index;
+
+  /* The edges of all windows, sorted */
+  GArray *left_right_edges;
+  GArray *top_bottom_edges;
+
+  guint update_stamp;
+};
+
+static void
+cached_window_free (CachedWindow *cw)
+{
+  g_array_free (cw->clippers, TRUE);
+  meta_rectangle_free_list_and_elements (cw->edges);
+  g_slice_free (CachedWindow, cw);
+}
+
+MetaEdgeCache *
+meta_edge_cache_new (void)
+{
+  MetaEdgeCache *cache;
+
+  cache = g_new0 (MetaEdgeCache, 1);
+  cache->windows = g_hash_table_new_full (NULL, NULL, NULL,
+                                          (GDestroyNotify) cached_window_free);
+  cache->index = meta_spatial_index_new ();
+  cache->left_right_edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  cache->top_bottom_edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+
+  return cache;
+}
+
+void
+meta_edge_cache_free (MetaEdgeCache *cache)
+{
+  g_array_free (cache->left_right_edges, TRUE);
+  g_array_free (cache->top_bottom_edges, TRUE);
+  meta_spatial_index_free (cache->index);
+  g_hash_table_destroy (cache->windows);
+  g_free (cache);
+}
+
+static gint
+compare_edge_pointers (gconstpointer a,
+                       gconstpointer b)
+{
+  const MetaEdge *a_edge = *(const MetaEdge * const *) a;
+  const MetaEdge *b_edge = *(const MetaEdge * const *) b;
+  int cmp;
+
+  cmp = meta_rectangle_edge_cmp_ignore_type (a_edge, b_edge);
+  if (cmp != 0)
+    return cmp;
+
+  return a_edge->side_type - b_edge->side_type;
+}
+
+static gboolean
+edge_is_left_right (const MetaEdge *edge)
+{
+  return (edge->side_type == META_SIDE_LEFT ||
+          edge->side_type == META_SIDE_RIGHT);
+}
+
+static GList *
+compute_window_edges (const MetaRectangle *rect,
+                      const MetaRectangle *screen_rect,
+                      GArray              *clippers,
+                      gpointer             skipped_window)
+{
+  GList *edges;
+  GSList *clipper_rects;
+  MetaEdge *edge;
+  MetaRectangle reduced;
+  int i;
+
+  /* We don't care about snapping to any portion of the window that
+   * is offscreen.
+   */
+  if (!meta_rectangle_intersect (rect, screen_rect, &reduced))
+    return NULL;
+
+  edges = NULL;
+
+  /* Left side of this window is resistance for the right edge of
+   * the window being moved.
+   */
+  edge = g_new (MetaEdge, 1);
+  edge->rect = reduced;
+  edge->rect.width = 0;
+  edge->side_type = META_SIDE_RIGHT;
+  edge->edge_type = META_EDGE_WINDOW;
+  edges = g_list_prepend (edges, edge);
+
+  /* Right side of this window is resistance for the left edge of
+   * the window being moved.
+   */
+  edge = g_new (MetaEdge, 1);
+  edge->rect = reduced;
+  edge->rect.x += edge->rect.width;
+  edge->rect.width = 0;
+  edge->side_type = META_SIDE_LEFT;
+  edge->edge_type = META_EDGE_WINDOW;
+  edges = g_list_prepend (edges, edge);
+
+  /* Top side of this window is resistance for the bottom edge of
+   * the window being moved.
+   */
+  edge = g_new (MetaEdge, 1);
+  edge->rect = reduced;
+  edge->rect.height = 0;
+  edge->side_type = META_SIDE_BOTTOM;
+  edge->edge_type = META_EDGE_WINDOW;
+  edges = g_list_prepend (edges, edge);
+
+  /* Bottom side of this window is resistance for the top edge of
+   * the window being moved.
+   */
+  edge = g_new (MetaEdge, 1);
+  edge->rect = reduced;
+  edge->rect.y += edge->rect.height;
+  edge->rect.height = 0;
+  edge->side_type = META_SIDE_TOP;
+  edge->edge_type = META_EDGE_WINDOW;
+  edges = g_list_prepend (edges, edge);
+
+  /* Remove edge portions hidden by the windows above, keeping them in
+   * bottom to top order.
+   */
+  clipper_rects = NULL;
+  for (i = (int) clippers->len - 1; i >= 0; i--)
+    {
+      Clipper *clipper = &g_array_index (clippers, Clipper, i);
+
+      if (clipper->window != skipped_window)
+        clipper_rects = g_slist_prepend (clipper_rects, &clipper->rect);
+    }
+
+  edges = meta_rectangle_remove_intersections_with_boxes_from_edges (edges,
+                                                                     clipper_rects);
+  g_slist_free (clipper_rects);
+
+  return edges;
+}
+
+typedef struct
+{
+  guint min_stack_position;
+  GPtrArray *found;
+} FindClippersData;
+
+static gboolean
+collect_window_above (gpointer             item,
+                      const MetaRectangle *rect,
+                      gpointer             user_data)
+{
+  CachedWindow *cw = item;
+  FindClippersData *data = user_data;
+
+  if (cw->stack_position >= data->min_stack_position)
+    g_ptr_array_add (data->found, cw);
+
+  return FALSE;
+}
+
+static gint
+compare_stack_position (gconstpointer a,
+                        gconstpointer b)
+{
+  const CachedWindow *a_cw = *(const CachedWindow * const *) a;
+  const CachedWindow *b_cw = *(const CachedWindow * const *) b;
+
+  return (int) a_cw->stack_position - (int) b_cw->stack_position;
+}
+
+/* Find the windows at least at min_stack_position which touch rect */
+static void
+find_windows_around (MetaEdgeCache       *cache,
+                     const MetaRectangle *rect,
+                     guint                min_stack_position,
+                     GPtrArray           *found)
+{
+  FindClippersData data = { min_stack_position, found };
+  MetaRectangle area;
+
+  /* Windows just next to rect can still hide its edges */
+  area = *rect;
+  area.x -= 1;
+  area.y -= 1;
+  area.width += 2;
+  area.height += 2;
+
+  g_ptr_array_set_size (found, 0);
+  meta_spatial_index_foreach_in_rect (cache->index, &area,
+                                      collect_window_above, &data);
+  g_ptr_array_sort (found, compare_stack_position);
+}
+
+static void
+find_clippers (MetaEdgeCache *cache,
+               CachedWindow  *cw,
+               GPtrArray     *found,
+               GArray        *clippers)
+{
+  guint i;
+
+  find_windows_around (cache, &cw->rect, cw->stack_position + 1, found);
+
+  g_array_set_size (clippers, found->len);
+  for (i = 0; i < found->len; i++)
+    {
+      CachedWindow *above = g_ptr_array_index (found, i);
+      Clipper *clipper = &g_array_index (clippers, Clipper, i);
+
+      clipper->window = above->window;
+      clipper->rect = above->rect;
+    }
+}
+
+static gboolean
+clippers_equal (GArray *a,
+                GArray *b)
+{
+  return (a->len == b->len &&
+          (a->len == 0 ||
+           memcmp (a->data, b->data, a->len * sizeof (Clipper)) == 0));
+}
+
+static void
+add_edges_to_arrays (const GList *edges,
+                     GArray      *left_right_edges,
+                     GArray      *top_bottom_edges)
+{
+  const GList *l;
+
+  for (l = edges; l != NULL; l = l->next)
+    {
+      MetaEdge *edge = l->data;
+
+      if (edge_is_left_right (edge))
+        g_array_append_val (left_right_edges, edge);
+      else
+        g_array_append_val (top_bottom_edges, edge);
+    }
+}
+
+/* Append the elements of a and b to dest, merging them in sorted order,
+ * with the elements of a first when they compare equal.
+ */
+static void
+merge_edges (GArray *dest,
+             GArray *a,
+             GArray *b)
+{
+  guint i = 0, j = 0;
+
+  while (i < a->len && j < b->len)
+    {
+      if (compare_edge_pointers (&g_array_index (b, MetaEdge *, j),
+                                 &g_array_index (a, MetaEdge *, i)) < 0)
+        g_array_append_val (dest, g_array_index (b, MetaEdge *, j++));
+      else
+        g_array_append_val (dest, g_array_index (a, MetaEdge *, i++));
+    }
+
+  g_array_append_vals (dest, &g_array_index (a, MetaEdge *, i), a->len - i);
+  g_array_append_vals (dest, &g_array_index (b, MetaEdge *, j), b->len - j);
+}
+
+static void
+update_sorted_edges (GArray     *sorted_edges,
+                     GHashTable *old_edges,
+                     GArray     *new_edges)
+{
+  GArray *kept;
+  guint i;
+
+  kept = g_array_sized_new (FALSE, FALSE, sizeof (MetaEdge *),
+                            sorted_edges->len);
+  for (i = 0; i < sorted_edges->len; i++)
+    {
+      MetaEdge *edge = g_array_index (sorted_edges, MetaEdge *, i);
+
+      if (!g_hash_table_contains (old_edges, edge))
+        g_array_append_val (kept, edge);
+    }
+
+  g_array_sort (new_edges, compare_edge_pointers);
+
+  g_array_set_size (sorted_edges, 0);
+  merge_edges (sorted_edges, kept, new_edges);
+
+  g_array_free (kept, TRUE);
+}
+
+static void
+queue_window (GPtrArray    *queue,
+              CachedWindow *cw)
+{
+  if (cw->queued)
+    return;
+
+  cw->queued = TRUE;
+  g_ptr_array_add (queue, cw);
+}
+
+/* Queues the windows whose edges may have been hidden, or may now be
+ * hidden, by a window which was or now is at rect.
+ */
+static void
+queue_windows_around (MetaEdgeCache       *cache,
+                      const MetaRectangle *rect,
+                      GPtrArray           *found,
+                      GPtrArray           *queue)
+{
+  guint i;
+
+  find_windows_around (cache, rect, 0, found);
+
+  for (i = 0; i < found->len; i++)
+    queue_window (queue, g_ptr_array_index (found, i));
+}
+
+/* Finds the windows which are not part of a longest run of windows that
+ * kept the same order as in the previous update; every pair of windows
+ * that got swapped includes at least one of them. old_positions holds
+ * the previous stack position of each window, or -1 for new ones.
+ */
+static void
+find_restacked_windows (GPtrArray *stacked,
+                        int       *old_positions,
+                        GPtrArray *restacked)
+{
+  int *tails, *prev;
+  gboolean *in_run;
+  int n_tails = 0, last, i;
+  int n = stacked->len;
+
+  for (i = 0, last = -1; i < n; i++)
+    {
+      if (old_positions[i] < 0)
+        continue;
+      if (old_positions[i] < last)
+        break;
+      last = old_positions[i];
+    }
+  if (i == n)
+    return; /* The common case: nothing was restacked */
+
+  tails = g_new (int, n);
+  prev = g_new (int, n);
+  in_run = g_new0 (gboolean, n);
+
+  for (i = 0; i < n; i++)
+    {
+      int lo = 0, hi = n_tails;
+
+      if (old_positions[i] < 0)
+        continue;
+
+      while (lo < hi)
+        {
+          int mid = (lo + hi) / 2;
+
+          if (old_positions[tails[mid]] < old_positions[i])
+            lo = mid + 1;
+          else
+            hi = mid;
+        }
+
+      prev[i] = lo > 0 ? tails[lo - 1] : -1;
+      tails[lo] = i;
+      if (lo == n_tails)
+        n_tails++;
+    }
+
+  for (last = n_tails > 0 ? tails[n_tails - 1] : -1; last >= 0; last = prev[last])
+    in_run[last] = TRUE;
+
+  for (i = 0; i < n; i++)
+    {
+      if (old_positions[i] >= 0 && !in_run[i])
+        g_ptr_array_add (restacked, g_ptr_array_index (stacked, i));
+    }
+
+  g_free (in_run);
+  g_free (prev);
+  g_free (tails);
+}
+
+/**
+ * meta_edge_cache_update:
+ * @cache: a #MetaEdgeCache
+ * @windows: the windows whose edges matter, from bottom to top
+ * @n_windows: the number of elements in @windows
+ * @screen_rect: the screen rectangle edges are clipped to
+ *
+ * Brings the cache up to date with the given set of windows. Only the
+ * windows around those which were added, removed, moved or restacked
+ * are looked at, and only the edges of those whose clipping windows
+ * changed are recomputed.
+ */
+void
+meta_edge_cache_update (MetaEdgeCache             *cache,
+                        const MetaEdgeCacheWindow *windows,
+                        guint                      n_windows,
+                        const MetaRectangle       *screen_rect)
+{
+  GHashTableIter iter;
+  CachedWindow *cw;
+  GPtrArray *stacked, *queue, *found, *restacked;
+  GArray *damage, *clippers;
+  GArray *new_left_right, *new_top_bottom;
+  GHashTable *old_edges;
+  GList *dead_windows = NULL, *l;
+  int *old_positions;
+  guint i;
+
+  damage = g_array_new (FALSE, FALSE, sizeof (MetaRectangle));
+  queue = g_ptr_array_new ();
+  found = g_ptr_array_new ();
+
+  if (!meta_rectangle_equal (&cache->screen_rect, screen_rect))
+    {
+      /* All the edges depend on it, so start over */
+      g_hash_table_iter_init (&iter, cache->windows);
+      while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &cw))
+        {
+          dead_windows = g_list_prepend (dead_windows, cw);
+          g_hash_table_iter_steal (&iter);
+        }
+
+      meta_spatial_index_free (cache->index);
+      cache->index = meta_spatial_index_new ();
+      cache->screen_rect = *screen_rect;
+    }
+
+  cache->update_stamp++;
+
+  stacked = g_ptr_array_sized_new (n_windows);
+  old_positions = g_new (int, n_windows);
+
+  for (i = 0; i < n_windows; i++)
+    {
+      const MetaEdgeCacheWindow *window = &windows[i];
+
+      cw = g_hash_table_lookup (cache->windows, window->window);
+      if (cw == NULL)
+        {
+          cw = g_slice_new0 (CachedWindow);
+          cw->window = window->window;
+          cw->clippers = g_array_new (FALSE, FALSE, sizeof (Clipper));
+          cw->needs_edges = TRUE;
+          g_hash_table_insert (cache->windows, window->window, cw);
+
+          old_positions[i] = -1;
+          g_array_append_val (damage, window->rect);
+        }
+      else
+        {
+          if (!meta_rectangle_equal (&cw->rect, &window->rect))
+            {
+              cw->needs_edges = TRUE;
+              g_array_append_val (damage, cw->rect);
+              g_array_append_val (damage, window->rect);
+            }
+          else if (cw->has_edges != window->has_edges)
+            {
+              cw->needs_edges = TRUE;
+            }
+
+          old_positions[i] = cw->stack_position;
+        }
+
+      cw->rect = window->rect;
+      cw->has_edges = window->has_edges;
+      cw->stack_position = i;
+      cw->update_stamp = cache->update_stamp;
+      meta_spatial_index_insert (cache->index, cw, &cw->rect);
+
+      if (cw->needs_edges)
+        queue_window (queue, cw);
+
+      g_ptr_array_add (stacked, cw);
+    }
+
+  /* The windows which changed order with others may hide more or less
+   * of the edges around them.
+   */
+  restacked = g_ptr_array_new ();
+  find_restacked_windows (stacked, old_positions, restacked);
+  for (i = 0; i < restacked->len; i++)
+    {
+      cw = g_ptr_array_index (restacked, i);
+      g_array_append_val (damage, cw->rect);
+    }
+  g_ptr_array_unref (restacked);
+
+  g_free (old_positions);
+  g_ptr_array_unref (stacked);
+
+  /* Forget about the windows which went away */
+  g_hash_table_iter_init (&iter, cache->windows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &cw))
+    {
+      if (cw->update_stamp != cache->update_stamp)
+        {
+          g_array_append_val (damage, cw->rect);
+          meta_spatial_index_remove (cache->index, cw);
+          dead_windows = g_list_prepend (dead_windows, cw);
+          g_hash_table_iter_steal (&iter);
+        }
+    }
+
+  for (i = 0; i < damage->len; i++)
+    queue_windows_around (cache, &g_array_index (damage, MetaRectangle, i),
+                          found, queue);
+
+  /* Edges which go away are only freed once they are out of the sorted
+   * arrays, so that their addresses can't be reused by new ones before.
+   */
+  old_edges = g_hash_table_new_full (NULL, NULL, g_free, NULL);
+  new_left_right = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  new_top_bottom = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  clippers = g_array_new (FALSE, FALSE, sizeof (Clipper));
+
+  for (i = 0; i < queue->len; i++)
+    {
+      cw = g_ptr_array_index (queue, i);
+      cw->queued = FALSE;
+
+      if (cw->has_edges)
+        {
+          find_clippers (cache, cw, found, clippers);
+          if (!cw->needs_edges && clippers_equal (cw->clippers, clippers))
+            continue;
+        }
+      else
+        {
+          g_array_set_size (clippers, 0);
+        }
+
+      g_array_set_size (cw->clippers, 0);
+      g_array_append_vals (cw->clippers, clippers->data, clippers->len);
+
+      for (l = cw->edges; l != NULL; l = l->next)
+        g_hash_table_add (old_edges, l->data);
+      g_list_free (cw->edges);
+
+      cw->edges = NULL;
+      if (cw->has_edges)
+        cw->edges = compute_window_edges (&cw->rect, &cache->screen_rect,
+                                          cw->clippers, NULL);
+      add_edges_to_arrays (cw->edges, new_left_right, new_top_bottom);
+      cw->needs_edges = FALSE;
+    }
+
+  for (l = dead_windows; l != NULL; l = l->next)
+    {
+      GList *k;
+
+      cw = l->data;
+      for (k = cw->edges; k != NULL; k = k->next)
+        g_hash_table_add (old_edges, k->data);
+      g_list_free (cw->edges);
+      cw->edges = NULL;
+
+      cached_window_free (cw);
+    }
+  g_list_free (dead_windows);
+
+  if (g_hash_table_size (old_edges) > 0 || new_left_right->len > 0)
+    update_sorted_edges (cache->left_right_edges, old_edges, new_left_right);
+  if (g_hash_table_size (old_edges) > 0 || new_top_bottom->len > 0)
+    update_sorted_edges (cache->top_bottom_edges, old_edges, new_top_bottom);
+
+  g_array_free (clippers, TRUE);
+  g_array_free (new_top_bottom, TRUE);
+  g_array_free (new_left_right, TRUE);
+  g_hash_table_destroy (old_edges);
+  g_ptr_array_unref (found);
+  g_ptr_array_unref (queue);
+  g_array_free (damage, TRUE);
+}
+
+static gboolean
+window_clipped_by (CachedWindow *cw,
+                   gpointer      window)
+{
+  guint i;
+
+  for (i = 0; i < cw->clippers->len; i++)
+    {
+      if (g_array_index (cw->clippers, Clipper, i).window == window)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+get_sorted_edges (GArray     *dest,
+                  GArray     *cached_edges,
+                  GHashTable *skipped_edges,
+                  GArray     *window_edges,
+                  GArray     *monitor_edges,
+                  GArray     *screen_edges)
+{
+  GArray *kept, *tmp, *static_edges;
+  guint i;
+
+  kept = g_array_sized_new (FALSE, FALSE, sizeof (MetaEdge *),
+                            cached_edges->len);
+  for (i = 0; i < cached_edges->len; i++)
+    {
+      MetaEdge *edge = g_array_index (cached_edges, MetaEdge *, i);
+
+      if (skipped_edges == NULL ||
+          !g_hash_table_contains (skipped_edges, edge))
+        g_array_append_val (kept, edge);
+    }
+
+  g_array_sort (window_edges, compare_edge_pointers);
+  g_array_sort (monitor_edges, compare_edge_pointers);
+  g_array_sort (screen_edges, compare_edge_pointers);
+
+  /* Window edges go before monitor edges, which go before screen
+   * edges at the same position.
+   */
+  tmp = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  merge_edges (tmp, kept, window_edges);
+
+  static_edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  merge_edges (static_edges, monitor_edges, screen_edges);
+
+  merge_edges (dest, tmp, static_edges);
+
+  g_array_free (static_edges, TRUE);
+  g_array_free (tmp, TRUE);
+  g_array_free (kept, TRUE);
+}
+
+/**
+ * meta_edge_cache_get_edges:
+ * @cache: a #MetaEdgeCache
+ * @excluded_window: (allow-none): a window to leave out, typically the
+ *   one being moved or resized
+ * @monitor_edges: monitor edges to add to the result
+ * @screen_edges: screen edges to add to the result
+ * @left_right_edges: array of #MetaEdge pointers to fill with the left
+ *   and right edges, sorted
+ * @top_bottom_edges: array of #MetaEdge pointers to fill with the top
+ *   and bottom edges, sorted
+ * @owned_edges: (out): return location for the list of edges which were
+ *   computed for this call, to be freed by the caller
+ *
+ * Retrieves the edges of the windows as of the last update, as if
+ * @excluded_window did not exist, merged with the given monitor and
+ * screen edges. The edges in the arrays are only valid until the next
+ * update of the cache, apart from @owned_edges.
+ */
+void
+meta_edge_cache_get_edges (MetaEdgeCache  *cache,
+                           gpointer        excluded_window,
+                           const GList    *monitor_edges,
+                           const GList    *screen_edges,
+                           GArray         *left_right_edges,
+                           GArray         *top_bottom_edges,
+                           GList         **owned_edges)
+{
+  GHashTable *skipped_edges = NULL;
+  GArray *window_lr, *window_tb;
+  GArray *monitor_lr, *monitor_tb;
+  GArray *screen_lr, *screen_tb;
+  CachedWindow *excluded;
+  const GList *l;
+
+  *owned_edges = NULL;
+
+  window_lr = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  window_tb = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+
+  excluded = excluded_window ?
+    g_hash_table_lookup (cache->windows, excluded_window) : NULL;
+  if (excluded != NULL)
+    {
+      GPtrArray *found;
+      guint i;
+
+      skipped_edges = g_hash_table_new (NULL, NULL);
+
+      for (l = excluded->edges; l != NULL; l = l->next)
+        g_hash_table_add (skipped_edges, l->data);
+
+      /* The windows below the excluded one which it was hiding parts of
+       * the edges of need their edges computed again without it.
+       */
+      found = g_ptr_array_new ();
+      find_windows_around (cache, &excluded->rect, 0, found);
+
+      for (i = 0; i < found->len; i++)
+        {
+          CachedWindow *cw = g_ptr_array_index (found, i);
+          GList *edges;
+
+          if (cw->stack_position >= excluded->stack_position ||
+              !cw->has_edges ||
+              !window_clipped_by (cw, excluded_window))
+            continue;
+
+          for (l = cw->edges; l != NULL; l = l->next)
+            g_hash_table_add (skipped_edges, l->data);
+
+          edges = compute_window_edges (&cw->rect, &cache->screen_rect,
+                                        cw->clippers, excluded_window);
+          add_edges_to_arrays (edges, window_lr, window_tb);
+          *owned_edges = g_list_concat (edges, *owned_edges);
+        }
+
+      g_ptr_array_unref (found);
+    }
+
+  monitor_lr = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  monitor_tb = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  add_edges_to_arrays (monitor_edges, monitor_lr, monitor_tb);
+
+  screen_lr = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  screen_tb = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  add_edges_to_arrays (screen_edges, screen_lr, screen_tb);
+
+  get_sorted_edges (left_right_edges, cache->left_right_edges, skipped_edges,
+                    window_lr, monitor_lr, screen_lr);
+  get_sorted_edges (top_bottom_edges, cache->top_bottom_edges, skipped_edges,
+                    window_tb, monitor_tb, screen_tb);
+
+  g_array_free (screen_tb, TRUE);
+  g_array_free (screen_lr, TRUE);
+  g_array_free (monitor_tb, TRUE);
+  g_array_free (monitor_lr, TRUE);
+  g_array_free (window_tb, TRUE);
+  g_array_free (window_lr, TRUE);
+
+  if (skipped_edges != NULL)
+    g_hash_table_destroy (skipped_edges);
+}
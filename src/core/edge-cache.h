@@ -0,0 +1,55 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Persistent cache of window edges for edge resistance */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_EDGE_CACHE_H
+#define META_EDGE_CACHE_H
+
+#include <glib.h>
+#include <meta/boxes.h>
+
+typedef struct _MetaEdgeCache MetaEdgeCache;
+
+typedef struct _MetaEdgeCacheWindow
+{
+  gpointer      window;
+  MetaRectangle rect;
+
+  /* FALSE for windows (docks) which hide the edges of the windows
+   * below them, but whose own edges are handled as screen edges
+   */
+  gboolean      has_edges;
+} MetaEdgeCacheWindow;
+
+MetaEdgeCache * meta_edge_cache_new       (void);
+void            meta_edge_cache_free      (MetaEdgeCache             *cache);
+
+void            meta_edge_cache_update    (MetaEdgeCache             *cache,
+                                           const MetaEdgeCacheWindow *windows,
+                                           guint                      n_windows,
+                                           const MetaRectangle       *screen_rect);
+
+void            meta_edge_cache_get_edges (MetaEdgeCache             *cache,
+                                           gpointer                   excluded_window,
+                                           const GList               *monitor_edges,
+                                           const GList               *screen_edges,
+                                           GArray                    *left_right_edges,
+                                           GArray                    *top_bottom_edges,
+                                           GList                    **owned_edges);
+
+#endif /* META_EDGE_CACHE_H */
@@ -26,14 +26,14 @@
 #include "workspace-private.h"
 
 /* A simple macro for whether a given window's edges are potentially
- * relevant for resistance/snapping during a move/resize operation
+ * relevant for resistance/snapping during a move/resize operation; the
+ * edges of the window being moved are left out when starting the grab
  */
-#define WINDOW_EDGES_RELEVANT(window, display) \
-  meta_window_should_be_showing (window) &&    \
-  window         != display->grab_window &&    \
-  window->type   != META_WINDOW_DESKTOP &&     \
-  window->type   != META_WINDOW_MENU    &&     \
-  window->type   != META_WINDOW_SPLASHSCREEN
+#define WINDOW_EDGES_RELEVANT(window)           \
+  (meta_window_should_be_showing (window) &&    \
+   window->type   != META_WINDOW_DESKTOP &&     \
+   window->type   != META_WINDOW_MENU    &&     \
+   window->type   != META_WINDOW_SPLASHSCREEN)
 
 struct ResistanceDataForAnEdge
 {
@@ -54,6 +54,11 @@ struct MetaEdgeResistanceData
   GArray *top_edges;
   GArray *bottom_edges;
 
+  /* Window edges computed for this grab only, which do not belong to
+   * display->edge_cache
+   */
+  GList *owned_edges;
+
   ResistanceDataForAnEdge left_data;
   ResistanceDataForAnEdge right_data;
   ResistanceDataForAnEdge top_data;
@@ -670,60 +675,17 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
 void
 meta_display_cleanup_edges (MetaDisplay *display)
 {
-  guint i,j;
   MetaEdgeResistanceData *edge_data = display->grab_edge_resistance_data;
-  GHashTable *edges_to_be_freed;
+
+  /* Whatever made us drop the edges probably changed some of them too */
+  meta_display_queue_edge_cache_update (display);
 
   if (edge_data == NULL) /* Not currently cached */
     return;
 
-  /* We first need to clean out any window edges */
-  edges_to_be_freed = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-                                             g_free, NULL);
-  for (i = 0; i < 4; i++)
-    {
-      GArray *tmp = NULL;
-      MetaSide side;
-      switch (i)
-        {
-        case 0:
-          tmp = edge_data->left_edges;
-          side = META_SIDE_LEFT;
-          break;
-        case 1:
-          tmp = edge_data->right_edges;
-          side = META_SIDE_RIGHT;
-          break;
-        case 2:
-          tmp = edge_data->top_edges;
-          side = META_SIDE_TOP;
-          break;
-        case 3:
-          tmp = edge_data->bottom_edges;
-          side = META_SIDE_BOTTOM;
-          break;
-        default:
-          g_assert_not_reached ();
-        }
-
-      for (j = 0; j < tmp->len; j++)
-        {
-          MetaEdge *edge = g_array_index (tmp, MetaEdge*, j);
-          if (edge->edge_type == META_EDGE_WINDOW &&
-              edge->side_type == side)
-            {
-              /* The same edge will appear in two arrays, and we can't free
-               * it yet we still need to compare edge->side_type for the other
-               * array that it is in.  So store it in a hash table for later
-               * freeing.  Could also do this in a simple linked list.
-               */
-              g_hash_table_insert (edges_to_be_freed, edge, edge);
-            }
-        }
-    }
-
-  /* Now free all the window edges (the key destroy function is g_free) */
-  g_hash_table_destroy (edges_to_be_freed);
+  /* The other window edges belong to the edge cache */
+  meta_rectangle_free_list_and_elements (edge_data->owned_edges);
+  edge_data->owned_edges = NULL;
 
   /* Now free the arrays and data */
   g_array_free (edge_data->left_edges, TRUE);
@@ -753,177 +715,100 @@ meta_display_cleanup_edges (MetaDisplay *display)
   display->grab_edge_resistance_data = NULL;
 }
 
-static int
-stupid_sort_requiring_extra_pointer_dereference (gconstpointer a,
-                                                 gconstpointer b)
-{
-  const MetaEdge * const *a_edge = a;
-  const MetaEdge * const *b_edge = b;
-  return meta_rectangle_edge_cmp_ignore_type (*a_edge, *b_edge);
-}
-
 static void
-cache_edges (MetaDisplay *display,
-             GList *window_edges,
-             GList *monitor_edges,
-             GList *screen_edges)
+update_edge_cache (MetaDisplay *display)
 {
-  MetaEdgeResistanceData *edge_data;
-  GList *tmp;
-  int num_left, num_right, num_top, num_bottom;
-  int i;
+  MetaScreen *screen = display->screen;
+  GList *stacked_windows, *l;
+  GArray *windows;
+
+  if (!display->edge_cache_dirty || screen == NULL ||
+      screen->active_workspace == NULL)
+    return;
 
   /*
-   * 0th: Print debugging information to the log about the edges
+   * 1st: Get the list of relevant windows, from bottom to top
    */
-#ifdef WITH_VERBOSE_MODE
-  if (meta_is_verbose())
+  stacked_windows = meta_stack_list_windows (screen->stack,
+                                             screen->active_workspace);
+
+  windows = g_array_new (FALSE, FALSE, sizeof (MetaEdgeCacheWindow));
+  for (l = stacked_windows; l != NULL; l = l->next)
     {
-      int max_edges = MAX (MAX( g_list_length (window_edges),
-                                g_list_length (monitor_edges)),
-                           g_list_length (screen_edges));
-      char big_buffer[(EDGE_LENGTH+2)*max_edges];
+      MetaWindow *window = l->data;
+      MetaEdgeCacheWindow cache_window;
 
-      meta_rectangle_edge_list_to_string (window_edges, ", ", big_buffer);
-      meta_topic (META_DEBUG_EDGE_RESISTANCE,
-                  "Window edges for resistance  : %s\n", big_buffer);
+      if (!WINDOW_EDGES_RELEVANT (window))
+        continue;
 
-      meta_rectangle_edge_list_to_string (monitor_edges, ", ", big_buffer);
-      meta_topic (META_DEBUG_EDGE_RESISTANCE,
-                  "Monitor edges for resistance: %s\n", big_buffer);
+      cache_window.window = window;
+      meta_window_get_frame_rect (window, &cache_window.rect);
 
-      meta_rectangle_edge_list_to_string (screen_edges, ", ", big_buffer);
-      meta_topic (META_DEBUG_EDGE_RESISTANCE,
-                  "Screen edges for resistance  : %s\n", big_buffer);
+      /* Dock edges are considered screen edges which are handled
+       * separately, but docks still hide the edges of windows below
+       */
+      cache_window.has_edges = window->type != META_WINDOW_DOCK;
+
+      g_array_append_val (windows, cache_window);
     }
-#endif
+  g_list_free (stacked_windows);
 
   /*
-   * 1st: Get the total number of each kind of edge
+   * 2nd: Only recompute the edges of windows which changed, or whose
+   * edges are hidden by windows which changed
    */
-  num_left = num_right = num_top = num_bottom = 0;
-  for (i = 0; i < 3; i++)
-    {
-      tmp = NULL;
-      switch (i)
-        {
-        case 0:
-          tmp = window_edges;
-          break;
-        case 1:
-          tmp = monitor_edges;
-          break;
-        case 2:
-          tmp = screen_edges;
-          break;
-        default:
-          g_assert_not_reached ();
-        }
+  meta_edge_cache_update (display->edge_cache,
+                          (MetaEdgeCacheWindow *) windows->data,
+                          windows->len,
+                          &screen->rect);
+  g_array_free (windows, TRUE);
 
-      while (tmp)
-        {
-          MetaEdge *edge = tmp->data;
-          switch (edge->side_type)
-            {
-            case META_SIDE_LEFT:
-              num_left++;
-              break;
-            case META_SIDE_RIGHT:
-              num_right++;
-              break;
-            case META_SIDE_TOP:
-              num_top++;
-              break;
-            case META_SIDE_BOTTOM:
-              num_bottom++;
-              break;
-            default:
-              g_assert_not_reached ();
-            }
-          tmp = tmp->next;
-        }
-    }
+  display->edge_cache_dirty = FALSE;
+}
 
-  /*
-   * 2nd: Allocate the edges
-   */
-  g_assert (display->grab_edge_resistance_data == NULL);
-  display->grab_edge_resistance_data = g_new0 (MetaEdgeResistanceData, 1);
-  edge_data = display->grab_edge_resistance_data;
-  edge_data->left_edges   = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_left + num_right);
-  edge_data->right_edges  = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_left + num_right);
-  edge_data->top_edges    = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_top + num_bottom);
-  edge_data->bottom_edges = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_top + num_bottom);
+static gboolean
+update_edge_cache_later (gpointer data)
+{
+  MetaDisplay *display = data;
 
-  /*
-   * 3rd: Add the edges to the arrays
+  display->edge_cache_later = 0;
+
+  /* The edges used by the current grab belong to the cache, so wait for
+   * the grab to end; meta_display_cleanup_edges() will queue us again.
    */
-  for (i = 0; i < 3; i++)
-    {
-      tmp = NULL;
-      switch (i)
-        {
-        case 0:
-          tmp = window_edges;
-          break;
-        case 1:
-          tmp = monitor_edges;
-          break;
-        case 2:
-          tmp = screen_edges;
-          break;
-        default:
-          g_assert_not_reached ();
-        }
+  if (display->grab_edge_resistance_data == NULL)
+    update_edge_cache (display);
 
-      while (tmp)
-        {
-          MetaEdge *edge = tmp->data;
-          switch (edge->side_type)
-            {
-            case META_SIDE_LEFT:
-            case META_SIDE_RIGHT:
-              g_array_append_val (edge_data->left_edges, edge);
-              g_array_append_val (edge_data->right_edges, edge);
-              break;
-            case META_SIDE_TOP:
-            case META_SIDE_BOTTOM:
-              g_array_append_val (edge_data->top_edges, edge);
-              g_array_append_val (edge_data->bottom_edges, edge);
-              break;
-            default:
-              g_assert_not_reached ();
-            }
-          tmp = tmp->next;
-        }
-    }
+  return FALSE;
+}
 
-  /*
-   * 4th: Sort the arrays (FIXME: This is kinda dumb since the arrays were
-   * individually sorted earlier and we could have done this faster and
-   * avoided this sort by sticking them into the array with some simple
-   * merging of the lists).
-   */
-  g_array_sort (display->grab_edge_resistance_data->left_edges,
-                stupid_sort_requiring_extra_pointer_dereference);
-  g_array_sort (display->grab_edge_resistance_data->right_edges,
-                stupid_sort_requiring_extra_pointer_dereference);
-  g_array_sort (display->grab_edge_resistance_data->top_edges,
-                stupid_sort_requiring_extra_pointer_dereference);
-  g_array_sort (display->grab_edge_resistance_data->bottom_edges,
-                stupid_sort_requiring_extra_pointer_dereference);
+/**
+ * meta_display_queue_edge_cache_update:
+ * @display: a #MetaDisplay
+ *
+ * Notes that windows were moved, resized, mapped, unmapped or restacked,
+ * so that the cached window edges are brought up to date when idle,
+ * before the next grab needs them.
+ */
+void
+meta_display_queue_edge_cache_update (MetaDisplay *display)
+{
+  display->edge_cache_dirty = TRUE;
+
+  if (display->edge_cache_later == 0 && display->edge_cache != NULL)
+    display->edge_cache_later = meta_later_add (META_LATER_IDLE,
+                                                update_edge_cache_later,
+                                                display, NULL);
+}
+
+void
+meta_display_free_edge_cache (MetaDisplay *display)
+{
+  if (display->edge_cache_later != 0)
+    meta_later_remove (display->edge_cache_later);
+  display->edge_cache_later = 0;
+
+  g_clear_pointer (&display->edge_cache, meta_edge_cache_free);
 }
 
 static void
@@ -945,16 +830,8 @@ initialize_grab_edge_resistance_data (MetaDisplay *display)
 static void
 compute_resistance_and_snapping_edges (MetaDisplay *display)
 {
-  GList *stacked_windows;
-  GList *cur_window_iter;
-  GList *edges;
-  /* Lists of window positions (rects) and their relative stacking positions */
-  int stack_position;
-  GSList *obscuring_windows, *window_stacking;
-  /* The portions of the above lists that still remain at the stacking position
-   * in the layer that we are working on
-   */
-  GSList *rem_windows, *rem_win_stacking;
+  MetaEdgeResistanceData *edge_data;
+  MetaWorkspace *workspace;
 
   g_assert (display->grab_window != NULL);
   meta_topic (META_DEBUG_WINDOW_OPS,
@@ -962,174 +839,45 @@ compute_resistance_and_snapping_edges (MetaDisplay *display)
               display->grab_window->desc);
 
   /*
-   * 1st: Get the list of relevant windows, from bottom to top
-   */
-  stacked_windows =
-    meta_stack_list_windows (display->screen->stack,
-                             display->screen->active_workspace);
-
-  /*
-   * 2nd: we need to separate that stacked list into a list of windows that
-   * can obscure other edges.  To make sure we only have windows obscuring
-   * those below it instead of going both ways, we also need to keep a
-   * counter list.  Messy, I know.
-   */
-  obscuring_windows = window_stacking = NULL;
-  cur_window_iter = stacked_windows;
-  stack_position = 0;
-  while (cur_window_iter != NULL)
-    {
-      MetaWindow *cur_window = cur_window_iter->data;
-      if (WINDOW_EDGES_RELEVANT (cur_window, display))
-        {
-          MetaRectangle *new_rect;
-          new_rect = g_new (MetaRectangle, 1);
-          meta_window_get_frame_rect (cur_window, new_rect);
-          obscuring_windows = g_slist_prepend (obscuring_windows, new_rect);
-          window_stacking =
-            g_slist_prepend (window_stacking, GINT_TO_POINTER (stack_position));
-        }
-
-      stack_position++;
-      cur_window_iter = cur_window_iter->next;
-    }
-  /* Put 'em in bottom to top order */
-  rem_windows = obscuring_windows = g_slist_reverse (obscuring_windows);
-  rem_win_stacking = window_stacking = g_slist_reverse (window_stacking);
-
-  /*
-   * 3rd: loop over the windows again, this time getting the edges from
-   * them and removing intersections with the relevant obscuring_windows &
-   * obscuring_docks.
-   */
-  edges = NULL;
-  stack_position = 0;
-  cur_window_iter = stacked_windows;
-  while (cur_window_iter != NULL)
-    {
-      MetaRectangle  cur_rect;
-      MetaWindow    *cur_window = cur_window_iter->data;
-      meta_window_get_frame_rect (cur_window, &cur_rect);
-
-      /* Check if we want to use this window's edges for edge
-       * resistance (note that dock edges are considered screen edges
-       * which are handled separately
-       */
-      if (WINDOW_EDGES_RELEVANT (cur_window, display) &&
-          cur_window->type != META_WINDOW_DOCK)
-        {
-          GList *new_edges;
-          MetaEdge *new_edge;
-          MetaRectangle reduced;
-
-          /* We don't care about snapping to any portion of the window that
-           * is offscreen (we also don't care about parts of edges covered
-           * by other windows or DOCKS, but that's handled below).
-           */
-          meta_rectangle_intersect (&cur_rect,
-                                    &display->screen->rect,
-                                    &reduced);
-
-          new_edges = NULL;
-
-          /* Left side of this window is resistance for the right edge of
-           * the window being moved.
-           */
-          new_edge = g_new (MetaEdge, 1);
-          new_edge->rect = reduced;
-          new_edge->rect.width = 0;
-          new_edge->side_type = META_SIDE_RIGHT;
-          new_edge->edge_type = META_EDGE_WINDOW;
-          new_edges = g_list_prepend (new_edges, new_edge);
-
-          /* Right side of this window is resistance for the left edge of
-           * the window being moved.
-           */
-          new_edge = g_new (MetaEdge, 1);
-          new_edge->rect = reduced;
-          new_edge->rect.x += new_edge->rect.width;
-          new_edge->rect.width = 0;
-          new_edge->side_type = META_SIDE_LEFT;
-          new_edge->edge_type = META_EDGE_WINDOW;
-          new_edges = g_list_prepend (new_edges, new_edge);
-
-          /* Top side of this window is resistance for the bottom edge of
-           * the window being moved.
-           */
-          new_edge = g_new (MetaEdge, 1);
-          new_edge->rect = reduced;
-          new_edge->rect.height = 0;
-          new_edge->side_type = META_SIDE_BOTTOM;
-          new_edge->edge_type = META_EDGE_WINDOW;
-          new_edges = g_list_prepend (new_edges, new_edge);
-
-          /* Top side of this window is resistance for the bottom edge of
-           * the window being moved.
-           */
-          new_edge = g_new (MetaEdge, 1);
-          new_edge->rect = reduced;
-          new_edge->rect.y += new_edge->rect.height;
-          new_edge->rect.height = 0;
-          new_edge->side_type = META_SIDE_TOP;
-          new_edge->edge_type = META_EDGE_WINDOW;
-          new_edges = g_list_prepend (new_edges, new_edge);
-
-          /* Update the remaining windows to only those at a higher
-           * stacking position than this one.
-           */
-          while (rem_win_stacking &&
-                 stack_position >= GPOINTER_TO_INT (rem_win_stacking->data))
-            {
-              rem_windows      = rem_windows->next;
-              rem_win_stacking = rem_win_stacking->next;
-            }
-
-          /* Remove edge portions overlapped by rem_windows and rem_docks */
-          new_edges =
-            meta_rectangle_remove_intersections_with_boxes_from_edges (
-              new_edges,
-              rem_windows);
-
-          /* Save the new edges */
-          edges = g_list_concat (new_edges, edges);
-        }
-
-      stack_position++;
-      cur_window_iter = cur_window_iter->next;
-    }
-
-  /*
-   * 4th: Free the extra memory not needed and sort the list
-   */
-  g_list_free (stacked_windows);
-  /* Free the memory used by the obscuring windows/docks lists */
-  g_slist_free (window_stacking);
-  /* FIXME: Shouldn't there be a helper function to make this one line of code
-   * to free a list instead of four ugly ones?
-   */
-  g_slist_foreach (obscuring_windows,
-                   (void (*)(gpointer,gpointer))&g_free, /* ew, for ugly */
-                   NULL);
-  g_slist_free (obscuring_windows);
-
-  /* Sort the list.  FIXME: Should I bother with this sorting?  I just
-   * sort again later in cache_edges() anyway...
+   * 1st: Make sure the cached window edges are up to date; usually this
+   * was already done when idle.
    */
-  edges = g_list_sort (edges, meta_rectangle_edge_cmp);
+  update_edge_cache (display);
 
   /*
-   * 5th: Cache the combination of these edges with the onscreen and
-   * monitor edges in an array for quick access.  Free the edges since
-   * they've been cached elsewhere.
+   * 2nd: Get the window edges without those of the grab window, merged
+   * with the onscreen and monitor edges, for quick access.
    */
-  cache_edges (display,
-               edges,
-               display->screen->active_workspace->monitor_edges,
-               display->screen->active_workspace->screen_edges);
-  g_list_free (edges);
+  g_assert (display->grab_edge_resistance_data == NULL);
+  display->grab_edge_resistance_data = g_new0 (MetaEdgeResistanceData, 1);
+  edge_data = display->grab_edge_resistance_data;
+  edge_data->left_edges   = g_array_new (FALSE, FALSE, sizeof (MetaEdge*));
+  edge_data->right_edges  = g_array_new (FALSE, FALSE, sizeof (MetaEdge*));
+  edge_data->top_edges    = g_array_new (FALSE, FALSE, sizeof (MetaEdge*));
+  edge_data->bottom_edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge*));
+
+  workspace = display->screen->active_workspace;
+  meta_edge_cache_get_edges (display->edge_cache,
+                             display->grab_window,
+                             workspace->monitor_edges,
+                             workspace->screen_edges,
+                             edge_data->left_edges,
+                             edge_data->top_edges,
+                             &edge_data->owned_edges);
+
+  g_array_append_vals (edge_data->right_edges,
+                       edge_data->left_edges->data,
+                       edge_data->left_edges->len);
+  g_array_append_vals (edge_data->bottom_edges,
+                       edge_data->top_edges->data,
+                       edge_data->top_edges->len);
+
+  meta_topic (META_DEBUG_EDGE_RESISTANCE,
+              "%u left/right and %u top/bottom edges for resistance\n",
+              edge_data->left_edges->len, edge_data->top_edges->len);
 
   /*
-   * 6th: Initialize the resistance timeouts and buildups
+   * 3rd: Initialize the resistance timeouts and buildups
    */
   initialize_grab_edge_resistance_data (display);
 }
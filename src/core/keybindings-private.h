@@ -108,6 +108,10 @@ typedef struct
 
   xkb_level_index_t keymap_num_levels;
 
+  /* keysym -> GArray of the keycodes producing it in keysym_index_keymap */
+  GHashTable *keysym_index;
+  struct xkb_keymap *keysym_index_keymap;
+
   /* Alt+click button grabs */
   ClutterModifierType window_grab_modifiers;
 } MetaKeyBindingManager;
@@ -282,53 +282,44 @@ reload_modmap (MetaKeyBindingManager *keys)
               keys->meta_mask);
 }
 
-static gboolean
-is_keycode_for_keysym (struct xkb_keymap *keymap,
-                       xkb_layout_index_t layout,
-                       xkb_level_index_t  level,
-                       xkb_keycode_t      keycode,
-                       xkb_keysym_t       keysym)
-{
-  const xkb_keysym_t *syms;
-  int num_syms, k;
-
-  num_syms = xkb_keymap_key_get_syms_by_level (keymap, keycode, layout, level, &syms);
-  for (k = 0; k < num_syms; k++)
-    {
-      if (syms[k] == keysym)
-        return TRUE;
-    }
-
-  return FALSE;
-}
-
 typedef struct
 {
-  GArray *keycodes;
-  xkb_keysym_t keysym;
+  GHashTable *keysym_index;
   xkb_layout_index_t layout;
   xkb_level_index_t level;
-} FindKeysymData;
+} IndexKeysymsData;
 
 static void
-get_keycodes_for_keysym_iter (struct xkb_keymap *keymap,
-                              xkb_keycode_t      keycode,
-                              void              *data)
+index_keysyms_iter (struct xkb_keymap *keymap,
+                    xkb_keycode_t      keycode,
+                    void              *data)
 {
-  FindKeysymData *search_data = data;
-  GArray *keycodes = search_data->keycodes;
-  xkb_keysym_t keysym = search_data->keysym;
-  xkb_layout_index_t layout = search_data->layout;
-  xkb_level_index_t level = search_data->level;
+  IndexKeysymsData *index_data = data;
+  const xkb_keysym_t *syms;
+  int num_syms, k;
 
-  if (is_keycode_for_keysym (keymap, layout, level, keycode, keysym))
+  num_syms = xkb_keymap_key_get_syms_by_level (keymap, keycode,
+                                               index_data->layout,
+                                               index_data->level,
+                                               &syms);
+  for (k = 0; k < num_syms; k++)
     {
+      GArray *keycodes;
       guint i;
       gboolean missing = TRUE;
 
+      keycodes = g_hash_table_lookup (index_data->keysym_index,
+                                      GUINT_TO_POINTER (syms[k]));
+      if (keycodes == NULL)
+        {
+          keycodes = g_array_new (FALSE, FALSE, sizeof (xkb_keycode_t));
+          g_hash_table_insert (index_data->keysym_index,
+                               GUINT_TO_POINTER (syms[k]), keycodes);
+        }
+
       /* duplicate keycode detection */
       for (i = 0; i < keycodes->len; i++)
-        if (g_array_index (keycodes, xkb_keysym_t, i) == keycode)
+        if (g_array_index (keycodes, xkb_keycode_t, i) == keycode)
           {
             missing = FALSE;
             break;
@@ -339,6 +330,74 @@ get_keycodes_for_keysym_iter (struct xkb_keymap *keymap,
     }
 }
 
+static void
+determine_keymap_num_levels_iter (struct xkb_keymap *keymap,
+                                  xkb_keycode_t      keycode,
+                                  void              *data)
+{
+  xkb_level_index_t *num_levels = data;
+  xkb_layout_index_t i;
+
+  for (i = 0; i < xkb_keymap_num_layouts_for_key (keymap, keycode); i++)
+    {
+      xkb_level_index_t level = xkb_keymap_num_levels_for_key (keymap, keycode, i);
+      if (level > *num_levels)
+        *num_levels = level;
+    }
+}
+
+static void
+determine_keymap_num_levels (MetaKeyBindingManager *keys,
+                             struct xkb_keymap     *keymap)
+{
+  keys->keymap_num_levels = 0;
+  xkb_keymap_key_for_each (keymap, determine_keymap_num_levels_iter, &keys->keymap_num_levels);
+}
+
+static void
+clear_keysym_index (MetaKeyBindingManager *keys)
+{
+  g_clear_pointer (&keys->keysym_index, g_hash_table_destroy);
+  g_clear_pointer (&keys->keysym_index_keymap, xkb_keymap_unref);
+}
+
+/* Builds the keysym -> keycodes index of the current keymap, if it is
+ * not built yet. The keycodes of each keysym are ordered like a search
+ * of the keymap layout by layout, then level by level, then keycode by
+ * keycode would find them, so the first one is the "primary" keycode.
+ */
+static void
+ensure_keysym_index (MetaKeyBindingManager *keys)
+{
+  MetaBackend *backend = meta_get_backend ();
+  struct xkb_keymap *keymap = meta_backend_get_keymap (backend);
+  xkb_layout_index_t i;
+  xkb_level_index_t j;
+
+  if (keys->keysym_index != NULL && keys->keysym_index_keymap == keymap)
+    return;
+
+  clear_keysym_index (keys);
+
+  keys->keysym_index =
+    g_hash_table_new_full (NULL, NULL, NULL,
+                           (GDestroyNotify) g_array_unref);
+  keys->keysym_index_keymap = xkb_keymap_ref (keymap);
+
+  determine_keymap_num_levels (keys, keymap);
+
+  for (i = 0; i < xkb_keymap_num_layouts (keymap); i++)
+    for (j = 0; j < keys->keymap_num_levels; j++)
+      {
+        IndexKeysymsData index_data = { keys->keysym_index, i, j };
+        xkb_keymap_key_for_each (keymap, index_keysyms_iter, &index_data);
+      }
+
+  meta_topic (META_DEBUG_KEYBINDINGS,
+              "Indexed %u keysyms of the keymap\n",
+              g_hash_table_size (keys->keysym_index));
+}
+
 /* Original code from gdk_x11_keymap_get_entries_for_keyval() in
  * gdkkeys-x11.c */
 static void
@@ -347,9 +406,10 @@ get_keycodes_for_keysym (MetaKeyBindingManager  *keys,
                          MetaResolvedKeyCombo   *resolved_combo)
 {
   GArray *retval;
+  GArray *keycodes;
   int keycode;
 
-  retval = g_array_new (FALSE, FALSE, sizeof (xkb_keysym_t));
+  retval = g_array_new (FALSE, FALSE, sizeof (xkb_keycode_t));
 
   /* Special-case: Fake mutter keysym */
   if (keysym == META_KEY_ABOVE_TAB)
@@ -359,51 +419,18 @@ get_keycodes_for_keysym (MetaKeyBindingManager  *keys,
       goto out;
     }
 
-  {
-    MetaBackend *backend = meta_get_backend ();
-    struct xkb_keymap *keymap = meta_backend_get_keymap (backend);
-    xkb_layout_index_t i;
-    xkb_level_index_t j;
+  ensure_keysym_index (keys);
 
-    for (i = 0; i < xkb_keymap_num_layouts (keymap); i++)
-      for (j = 0; j < keys->keymap_num_levels; j++)
-        {
-          FindKeysymData search_data = { retval, keysym, i, j };
-          xkb_keymap_key_for_each (keymap, get_keycodes_for_keysym_iter, &search_data);
-        }
-  }
+  keycodes = g_hash_table_lookup (keys->keysym_index,
+                                  GUINT_TO_POINTER ((guint) keysym));
+  if (keycodes != NULL)
+    g_array_append_vals (retval, keycodes->data, keycodes->len);
 
  out:
   resolved_combo->len = retval->len;
   resolved_combo->keycodes = (xkb_keycode_t *) g_array_free (retval, retval->len == 0 ? TRUE : FALSE);
 }
 
-static void
-determine_keymap_num_levels_iter (struct xkb_keymap *keymap,
-                                  xkb_keycode_t      keycode,
-                                  void              *data)
-{
-  xkb_level_index_t *num_levels = data;
-  xkb_layout_index_t i;
-
-  for (i = 0; i < xkb_keymap_num_layouts_for_key (keymap, keycode); i++)
-    {
-      xkb_level_index_t level = xkb_keymap_num_levels_for_key (keymap, keycode, i);
-      if (level > *num_levels)
-        *num_levels = level;
-    }
-}
-
-static void
-determine_keymap_num_levels (MetaKeyBindingManager *keys)
-{
-  MetaBackend *backend = meta_get_backend ();
-  struct xkb_keymap *keymap = meta_backend_get_keymap (backend);
-
-  keys->keymap_num_levels = 0;
-  xkb_keymap_key_for_each (keymap, determine_keymap_num_levels_iter, &keys->keymap_num_levels);
-}
-
 static void
 reload_iso_next_group_combos (MetaKeyBindingManager *keys)
 {
@@ -590,8 +617,6 @@ reload_combos (MetaKeyBindingManager *keys)
 {
   g_hash_table_remove_all (keys->key_bindings_index);
 
-  determine_keymap_num_levels (keys);
-
   resolve_key_combo (keys,
                      &keys->overlay_key_combo,
                      &keys->overlay_resolved_key_combo);
@@ -925,25 +950,6 @@ meta_display_get_keybinding_action (MetaDisplay  *display,
   return get_keybinding_action (keys, &resolved_combo);
 }
 
-static void
-on_keymap_changed (MetaBackend *backend,
-                   gpointer     user_data)
-{
-  MetaDisplay *display = user_data;
-  MetaKeyBindingManager *keys = &display->key_binding_manager;
-
-  ungrab_key_bindings (display);
-
-  /* Deciphering the modmap depends on the loaded keysyms to find out
-   * what modifiers is Super and so forth, so we need to reload it
-   * even when only the keymap changes */
-  reload_modmap (keys);
-
-  reload_combos (keys);
-
-  grab_key_bindings (display);
-}
-
 static GArray *
 calc_grab_modifiers (MetaKeyBindingManager *keys,
                      unsigned int modmask)
@@ -1193,6 +1199,7 @@ meta_display_shutdown_keys (MetaDisplay *display)
 
   g_hash_table_destroy (keys->key_bindings_index);
   g_hash_table_destroy (keys->key_bindings);
+  clear_keysym_index (keys);
 }
 
 /* Grab/ungrab, ignoring all annoying modifiers like NumLock etc. */
@@ -1392,6 +1399,201 @@ meta_window_ungrab_keys (MetaWindow  *window)
     }
 }
 
+static void
+add_resolved_combo_keygrabs (GHashTable           *keygrabs,
+                             MetaResolvedKeyCombo *resolved_combo)
+{
+  int i;
+
+  for (i = 0; i < resolved_combo->len; i++)
+    g_hash_table_add (keygrabs,
+                      GUINT_TO_POINTER (key_combo_key (resolved_combo, i)));
+}
+
+/* Returns the set of keycode/mask pairs, as key_combo_key() values,
+ * grabbed on the root window, or on each window if @only_per_window
+ * is TRUE.
+ */
+static GHashTable *
+get_binding_keygrabs (MetaKeyBindingManager *keys,
+                      gboolean               only_per_window)
+{
+  GHashTable *keygrabs;
+  GHashTableIter iter;
+  gpointer key;
+  int i;
+
+  keygrabs = g_hash_table_new (NULL, NULL);
+
+  if (!only_per_window)
+    {
+      add_resolved_combo_keygrabs (keygrabs, &keys->overlay_resolved_key_combo);
+
+      for (i = 0; i < keys->n_iso_next_group_combos; i++)
+        add_resolved_combo_keygrabs (keygrabs, &keys->iso_next_group_combo[i]);
+    }
+
+  g_hash_table_iter_init (&iter, keys->key_bindings);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      MetaKeyBinding *binding = key;
+      gboolean binding_is_per_window = (binding->flags & META_KEY_BINDING_PER_WINDOW) != 0;
+
+      if (binding_is_per_window == only_per_window)
+        add_resolved_combo_keygrabs (keygrabs, &binding->resolved_combo);
+    }
+
+  return keygrabs;
+}
+
+/* Grabs or ungrabs the keys of @keygrabs which are not in @except */
+static int
+change_keygrab_set (MetaKeyBindingManager *keys,
+                    Window                 xwindow,
+                    gboolean               grab,
+                    GHashTable            *keygrabs,
+                    GHashTable            *except)
+{
+  GHashTableIter iter;
+  gpointer key;
+  int n_changed = 0;
+
+  g_hash_table_iter_init (&iter, keygrabs);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      guint32 index_key = GPOINTER_TO_UINT (key);
+      xkb_keycode_t keycode = index_key >> 16;
+      MetaResolvedKeyCombo resolved_combo = { &keycode, 1, index_key & 0xffff };
+
+      if (except && g_hash_table_contains (except, key))
+        continue;
+
+      meta_change_keygrab (keys, xwindow, grab, &resolved_combo);
+      n_changed++;
+    }
+
+  return n_changed;
+}
+
+/* Moves the key grabs from the keycodes the bindings had before a
+ * keymap change to the ones they have now, leaving alone the keys
+ * which did not change.
+ */
+static void
+update_keygrabs (MetaDisplay    *display,
+                 xkb_mod_mask_t  old_ignored_modifier_mask,
+                 GHashTable     *old_screen_keygrabs,
+                 GHashTable     *old_window_keygrabs)
+{
+  MetaKeyBindingManager *keys = &display->key_binding_manager;
+  MetaScreen *screen = display->screen;
+  xkb_mod_mask_t ignored_modifier_mask = keys->ignored_modifier_mask;
+  GHashTable *screen_keygrabs, *window_keygrabs;
+  gboolean regrab_all;
+  GSList *windows, *l;
+  int n_ungrabbed = 0, n_grabbed = 0;
+
+  screen_keygrabs = get_binding_keygrabs (keys, FALSE);
+  window_keygrabs = get_binding_keygrabs (keys, TRUE);
+
+  /* All the grabs are made together with the ignored modifiers, so
+   * they all need to be redone if those changed.
+   */
+  regrab_all = old_ignored_modifier_mask != ignored_modifier_mask;
+
+  windows = meta_display_list_windows (display, META_LIST_DEFAULT);
+
+  /* Ungrab with the modifiers the keys were grabbed with */
+  keys->ignored_modifier_mask = old_ignored_modifier_mask;
+
+  if (screen->keys_grabbed)
+    n_ungrabbed += change_keygrab_set (keys, screen->xroot, FALSE,
+                                       old_screen_keygrabs,
+                                       regrab_all ? NULL : screen_keygrabs);
+
+  for (l = windows; l; l = l->next)
+    {
+      MetaWindow *w = l->data;
+
+      if (w->keys_grabbed && !w->grab_on_frame)
+        n_ungrabbed += change_keygrab_set (keys, w->xwindow, FALSE,
+                                           old_window_keygrabs,
+                                           regrab_all ? NULL : window_keygrabs);
+      else if (w->keys_grabbed && w->frame != NULL)
+        n_ungrabbed += change_keygrab_set (keys, w->frame->xwindow, FALSE,
+                                           old_window_keygrabs,
+                                           regrab_all ? NULL : window_keygrabs);
+    }
+
+  keys->ignored_modifier_mask = ignored_modifier_mask;
+
+  if (screen->keys_grabbed)
+    n_grabbed += change_keygrab_set (keys, screen->xroot, TRUE,
+                                     screen_keygrabs,
+                                     regrab_all ? NULL : old_screen_keygrabs);
+
+  for (l = windows; l; l = l->next)
+    {
+      MetaWindow *w = l->data;
+
+      if (w->keys_grabbed && !w->grab_on_frame)
+        {
+          n_grabbed += change_keygrab_set (keys, w->xwindow, TRUE,
+                                           window_keygrabs,
+                                           regrab_all ? NULL : old_window_keygrabs);
+        }
+      else if (w->keys_grabbed && w->frame != NULL)
+        {
+          n_grabbed += change_keygrab_set (keys, w->frame->xwindow, TRUE,
+                                           window_keygrabs,
+                                           regrab_all ? NULL : old_window_keygrabs);
+        }
+      else if (w->keys_grabbed)
+        {
+          /* The frame holding the grabs is gone; grab on the client */
+          meta_window_ungrab_keys (w);
+          meta_window_grab_keys (w);
+        }
+    }
+
+  meta_topic (META_DEBUG_KEYBINDINGS,
+              "Keymap changed: ungrabbed %d and grabbed %d keys\n",
+              n_ungrabbed, n_grabbed);
+
+  g_slist_free (windows);
+  g_hash_table_destroy (screen_keygrabs);
+  g_hash_table_destroy (window_keygrabs);
+}
+
+static void
+on_keymap_changed (MetaBackend *backend,
+                   gpointer     user_data)
+{
+  MetaDisplay *display = user_data;
+  MetaKeyBindingManager *keys = &display->key_binding_manager;
+  xkb_mod_mask_t old_ignored_modifier_mask;
+  GHashTable *old_screen_keygrabs, *old_window_keygrabs;
+
+  /* Remember what is grabbed, so that only the keys which moved to
+   * other keycodes need to be grabbed again */
+  old_ignored_modifier_mask = keys->ignored_modifier_mask;
+  old_screen_keygrabs = get_binding_keygrabs (keys, FALSE);
+  old_window_keygrabs = get_binding_keygrabs (keys, TRUE);
+
+  /* Deciphering the modmap depends on the loaded keysyms to find out
+   * what modifiers is Super and so forth, so we need to reload it
+   * even when only the keymap changes */
+  reload_modmap (keys);
+
+  reload_combos (keys);
+
+  update_keygrabs (display, old_ignored_modifier_mask,
+                   old_screen_keygrabs, old_window_keygrabs);
+
+  g_hash_table_destroy (old_screen_keygrabs);
+  g_hash_table_destroy (old_window_keygrabs);
+}
+
 static void
 handle_external_grab (MetaDisplay     *display,
                       MetaScreen      *screen,
@@ -569,7 +569,8 @@ meta_init (void)
   meta_clutter_init ();
 
 #ifdef HAVE_WAYLAND
-  /* Bring up Wayland. This also launches Xwayland and sets DISPLAY as well... */
+  /* Bring up Wayland. This also waits for Xwayland, launched in
+   * meta_wayland_pre_clutter_init(), and sets DISPLAY as well... */
   if (meta_is_wayland_compositor ())
     meta_wayland_init ();
 #endif
@@ -26,6 +26,7 @@
 
 #include "boxes-private.h"
 #include "place.h"
+#include "workspace-private.h"
 #include "backends/meta-backend-private.h"
 #include "backends/meta-logical-monitor.h"
 #include <meta/meta-backend.h>
@@ -364,44 +365,90 @@ avoid_being_obscured_as_second_modal_dialog (MetaWindow *window,
 }
 
 static gboolean
-rectangle_overlaps_some_window (MetaRectangle *rect,
-                                GList         *windows)
+window_is_placement_obstacle (MetaWindow *other)
+{
+  switch (other->type)
+    {
+    case META_WINDOW_DOCK:
+    case META_WINDOW_SPLASHSCREEN:
+    case META_WINDOW_DESKTOP:
+    case META_WINDOW_DIALOG:
+    case META_WINDOW_MODAL_DIALOG:
+    /* override redirect window types: */
+    case META_WINDOW_DROPDOWN_MENU:
+    case META_WINDOW_POPUP_MENU:
+    case META_WINDOW_TOOLTIP:
+    case META_WINDOW_NOTIFICATION:
+    case META_WINDOW_COMBO:
+    case META_WINDOW_DND:
+    case META_WINDOW_OVERRIDE_OTHER:
+      return FALSE;
+
+    case META_WINDOW_NORMAL:
+    case META_WINDOW_UTILITY:
+    case META_WINDOW_TOOLBAR:
+    case META_WINDOW_MENU:
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Whether other is one of the windows that matter when placing window,
+ * see meta_window_place()
+ */
+static gboolean
+window_matters_for_placement (MetaWindow *window,
+                              MetaWindow *other)
+{
+  return (other != window &&
+          meta_window_showing_on_its_workspace (other) &&
+          (window->on_all_workspaces ||
+           meta_window_located_on_workspace (other, window->workspace)));
+}
+
+static gboolean
+window_obstructs_placement (gpointer             item,
+                            const MetaRectangle *rect,
+                            gpointer             user_data)
+{
+  MetaWindow *other = item;
+  MetaWindow *window = user_data;
+
+  return (window_is_placement_obstacle (other) &&
+          window_matters_for_placement (window, other));
+}
+
+/* If index is non-NULL, the windows overlapping rect are looked up in it
+ * instead of going through windows, which must then hold exactly the
+ * windows of the index that matter for placing window.
+ */
+static gboolean
+rectangle_overlaps_some_window (MetaRectangle    *rect,
+                                MetaWindow       *window,
+                                GList            *windows,
+                                MetaSpatialIndex *index)
 {
   GList *tmp;
   MetaRectangle dest;
 
+  if (index != NULL)
+    return meta_spatial_index_foreach_in_rect (index, rect,
+                                               window_obstructs_placement,
+                                               window) != NULL;
+
   tmp = windows;
   while (tmp != NULL)
     {
       MetaWindow *other = tmp->data;
       MetaRectangle other_rect;
 
-      switch (other->type)
+      if (window_is_placement_obstacle (other))
         {
-        case META_WINDOW_DOCK:
-        case META_WINDOW_SPLASHSCREEN:
-        case META_WINDOW_DESKTOP:
-        case META_WINDOW_DIALOG:
-        case META_WINDOW_MODAL_DIALOG:
-	/* override redirect window types: */
-	case META_WINDOW_DROPDOWN_MENU:
-	case META_WINDOW_POPUP_MENU:
-	case META_WINDOW_TOOLTIP:
-	case META_WINDOW_NOTIFICATION:
-	case META_WINDOW_COMBO:
-	case META_WINDOW_DND:
-	case META_WINDOW_OVERRIDE_OTHER:
-          break;
-
-        case META_WINDOW_NORMAL:
-        case META_WINDOW_UTILITY:
-        case META_WINDOW_TOOLBAR:
-        case META_WINDOW_MENU:
           meta_window_get_frame_rect (other, &other_rect);
 
           if (meta_rectangle_intersect (rect, &other_rect, &dest))
             return TRUE;
-          break;
         }
 
       tmp = tmp->next;
@@ -484,6 +531,8 @@ static gboolean
 find_first_fit (MetaWindow         *window,
                 /* visible windows on relevant workspaces */
                 GList              *windows,
+                /* index of the same windows, or NULL */
+                MetaSpatialIndex   *index,
                 MetaLogicalMonitor *logical_monitor,
                 int                 x,
                 int                 y,
@@ -537,7 +586,8 @@ find_first_fit (MetaWindow         *window,
   center_tile_rect_in_area (&rect, &work_area);
 
   if (meta_rectangle_contains_rect (&work_area, &rect) &&
-      !rectangle_overlaps_some_window (&rect, windows))
+      !rectangle_overlaps_some_window (&rect, window,
+                                      windows, index))
     {
       *new_x = rect.x;
       *new_y = rect.y;
@@ -560,7 +610,8 @@ find_first_fit (MetaWindow         *window,
       rect.y = frame_rect.y + frame_rect.height;
 
       if (meta_rectangle_contains_rect (&work_area, &rect) &&
-          !rectangle_overlaps_some_window (&rect, below_sorted))
+          !rectangle_overlaps_some_window (&rect, window,
+                                          below_sorted, index))
         {
           *new_x = rect.x;
           *new_y = rect.y;
@@ -586,7 +637,8 @@ find_first_fit (MetaWindow         *window,
       rect.y = frame_rect.y;
 
       if (meta_rectangle_contains_rect (&work_area, &rect) &&
-          !rectangle_overlaps_some_window (&rect, right_sorted))
+          !rectangle_overlaps_some_window (&rect, window,
+                                          right_sorted, index))
         {
           *new_x = rect.x;
           *new_y = rect.y;
@@ -669,6 +721,7 @@ meta_window_place (MetaWindow        *window,
 {
   MetaBackend *backend = meta_get_backend ();
   GList *windows = NULL;
+  MetaSpatialIndex *index = NULL;
   MetaLogicalMonitor *logical_monitor;
 
   meta_topic (META_DEBUG_PLACEMENT, "Placing window %s\n", window->desc);
@@ -850,10 +903,7 @@ meta_window_place (MetaWindow        *window,
       {
         MetaWindow *w = tmp->data;
 
-        if (w != window &&
-            meta_window_showing_on_its_workspace (w) &&
-            (window->on_all_workspaces ||
-             meta_window_located_on_workspace (w, window->workspace)))
+        if (window_matters_for_placement (window, w))
           windows = g_list_prepend (windows, w);
 
         tmp = tmp->next;
@@ -894,7 +944,13 @@ meta_window_place (MetaWindow        *window,
   x = logical_monitor->rect.x;
   y = logical_monitor->rect.y;
 
-  if (find_first_fit (window, windows,
+  /* The windows of a sticky window's placement span all workspaces, so
+   * there is no single index to look them up in.
+   */
+  if (!window->on_all_workspaces && window->workspace != NULL)
+    index = window->workspace->window_index;
+
+  if (find_first_fit (window, windows, index,
                       logical_monitor,
                       x, y, &x, &y))
     goto done_check_denied_focus;
@@ -931,7 +987,7 @@ meta_window_place (MetaWindow        *window,
           x = logical_monitor->rect.x;
           y = logical_monitor->rect.y;
 
-          found_fit = find_first_fit (window, focus_window_list,
+          found_fit = find_first_fit (window, focus_window_list, NULL,
                                       logical_monitor,
                                       x, y, &x, &y);
           g_list_free (focus_window_list);
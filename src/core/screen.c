@@ -883,22 +883,37 @@ void
 meta_screen_manage_all_windows (MetaScreen *screen)
 {
   guint64 *_children;
-  guint64 *children;
+  Window *children;
   int n_children, i;
+  gint64 start_time;
 
   meta_stack_freeze (screen->stack);
   meta_stack_tracker_get_stack (screen->stack_tracker, &_children, &n_children);
 
   /* Copy the stack as it will be modified as part of the loop */
-  children = g_memdup (_children, sizeof (guint64) * n_children);
-
+  children = g_new (Window, n_children);
   for (i = 0; i < n_children; ++i)
     {
-      g_assert (META_STACK_ID_IS_X11 (children[i]));
-      meta_window_x11_new (screen->display, children[i], TRUE,
-                           META_COMP_EFFECT_NONE);
+      g_assert (META_STACK_ID_IS_X11 (_children[i]));
+      children[i] = _children[i];
     }
 
+  start_time = g_get_monotonic_time ();
+
+  /* Ask for what managing the windows needs for all of them at once,
+   * instead of waiting for the replies window by window.
+   */
+  meta_window_x11_prefetch (screen->display, children, n_children);
+
+  for (i = 0; i < n_children; ++i)
+    meta_window_x11_new (screen->display, children[i], TRUE,
+                         META_COMP_EFFECT_NONE);
+
+  meta_window_x11_clear_prefetch (screen->display);
+
+  meta_verbose ("Managed the %d existing windows in %.1f ms\n",
+                n_children, (g_get_monotonic_time () - start_time) / 1000.0);
+
   g_free (children);
   meta_stack_thaw (screen->stack);
 }
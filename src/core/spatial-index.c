@@ -0,0 +1,428 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * SECTION:spatial-index
+ * @short_description: Spatial index of rectangles
+ *
+ * #MetaSpatialIndex keeps track of a set of items (typically windows)
+ * and their rectangles, and answers "which items overlap this
+ * rectangle" and "which items contain this point" without looking at
+ * every item. Each workspace keeps one for the frame rectangles of its
+ * windows, so that placement and focus-under-pointer do not need to
+ * walk every window of the screen.
+ *
+ * The index is a uniform grid: the plane is divided in square cells,
+ * and each item is listed in every cell its rectangle touches. Items
+ * which would span too many cells are kept aside in a list that is
+ * checked by every query.
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "spatial-index.h"
+
+/* Cells are 256x256 pixels */
+#define CELL_SHIFT 8
+
+/* Items spanning more cells than this are not stored in the grid */
+#define MAX_ITEM_CELLS 256
+
+typedef struct _MetaSpatialEntry
+{
+  gpointer item;
+  MetaRectangle rect;
+
+  /* Range of cells the entry is listed in, inclusive; empty
+   * (x1 > x2) if the entry is not in the grid.
+   */
+  int cell_x1, cell_y1, cell_x2, cell_y2;
+  gboolean oversized;
+
+  /* Last query which visited the entry */
+  guint query_stamp;
+} MetaSpatialEntry;
+
+struct _MetaSpatialIndex
+{
+  /* item -> MetaSpatialEntry */
+  GHashTable *entries;
+
+  /* cell key -> GPtrArray of MetaSpatialEntry */
+  GHashTable *cells;
+
+  /* entries too large to be stored in the grid */
+  GPtrArray *oversized;
+
+  guint query_stamp;
+};
+
+static inline gpointer
+cell_key (int cell_x,
+          int cell_y)
+{
+  return GUINT_TO_POINTER (((guint) cell_x << 16) | ((guint) cell_y & 0xffff));
+}
+
+static void
+get_cell_range (const MetaRectangle *rect,
+                int                 *x1,
+                int                 *y1,
+                int                 *x2,
+                int                 *y2)
+{
+  if (rect->width <= 0 || rect->height <= 0)
+    {
+      /* Empty rectangles never overlap anything */
+      *x1 = *y1 = 0;
+      *x2 = *y2 = -1;
+      return;
+    }
+
+  *x1 = rect->x >> CELL_SHIFT;
+  *y1 = rect->y >> CELL_SHIFT;
+  *x2 = (rect->x + rect->width - 1) >> CELL_SHIFT;
+  *y2 = (rect->y + rect->height - 1) >> CELL_SHIFT;
+}
+
+static inline gint64
+cell_range_size (int x1,
+                 int y1,
+                 int x2,
+                 int y2)
+{
+  if (x1 > x2 || y1 > y2)
+    return 0;
+
+  return (gint64) (x2 - x1 + 1) * (y2 - y1 + 1);
+}
+
+static void
+entry_free (MetaSpatialEntry *entry)
+{
+  g_slice_free (MetaSpatialEntry, entry);
+}
+
+MetaSpatialIndex *
+meta_spatial_index_new (void)
+{
+  MetaSpatialIndex *index;
+
+  index = g_new0 (MetaSpatialIndex, 1);
+  index->entries = g_hash_table_new_full (NULL, NULL, NULL,
+                                          (GDestroyNotify) entry_free);
+  index->cells = g_hash_table_new_full (NULL, NULL, NULL,
+                                        (GDestroyNotify) g_ptr_array_unref);
+  index->oversized = g_ptr_array_new ();
+
+  return index;
+}
+
+void
+meta_spatial_index_free (MetaSpatialIndex *index)
+{
+  g_hash_table_destroy (index->cells);
+  g_hash_table_destroy (index->entries);
+  g_ptr_array_unref (index->oversized);
+  g_free (index);
+}
+
+static void
+link_entry (MetaSpatialIndex *index,
+            MetaSpatialEntry *entry)
+{
+  int x, y;
+
+  get_cell_range (&entry->rect,
+                  &entry->cell_x1, &entry->cell_y1,
+                  &entry->cell_x2, &entry->cell_y2);
+
+  entry->oversized = cell_range_size (entry->cell_x1, entry->cell_y1,
+                                      entry->cell_x2, entry->cell_y2) > MAX_ITEM_CELLS;
+  if (entry->oversized)
+    {
+      g_ptr_array_add (index->oversized, entry);
+      return;
+    }
+
+  for (y = entry->cell_y1; y <= entry->cell_y2; y++)
+    for (x = entry->cell_x1; x <= entry->cell_x2; x++)
+      {
+        GPtrArray *cell;
+
+        cell = g_hash_table_lookup (index->cells, cell_key (x, y));
+        if (cell == NULL)
+          {
+            cell = g_ptr_array_new ();
+            g_hash_table_insert (index->cells, cell_key (x, y), cell);
+          }
+
+        g_ptr_array_add (cell, entry);
+      }
+}
+
+static void
+unlink_entry (MetaSpatialIndex *index,
+              MetaSpatialEntry *entry)
+{
+  int x, y;
+
+  if (entry->oversized)
+    {
+      g_ptr_array_remove_fast (index->oversized, entry);
+      return;
+    }
+
+  for (y = entry->cell_y1; y <= entry->cell_y2; y++)
+    for (x = entry->cell_x1; x <= entry->cell_x2; x++)
+      {
+        GPtrArray *cell;
+
+        cell = g_hash_table_lookup (index->cells, cell_key (x, y));
+        g_assert (cell != NULL);
+
+        g_ptr_array_remove_fast (cell, entry);
+        if (cell->len == 0)
+          g_hash_table_remove (index->cells, cell_key (x, y));
+      }
+}
+
+/**
+ * meta_spatial_index_insert:
+ * @index: a #MetaSpatialIndex
+ * @item: the item to add
+ * @rect: the rectangle of @item
+ *
+ * Adds @item to the index, or updates its rectangle if it is already
+ * in it.
+ */
+void
+meta_spatial_index_insert (MetaSpatialIndex    *index,
+                           gpointer             item,
+                           const MetaRectangle *rect)
+{
+  MetaSpatialEntry *entry;
+
+  entry = g_hash_table_lookup (index->entries, item);
+  if (entry != NULL)
+    {
+      meta_spatial_index_update (index, item, rect);
+      return;
+    }
+
+  entry = g_slice_new0 (MetaSpatialEntry);
+  entry->item = item;
+  entry->rect = *rect;
+  entry->query_stamp = index->query_stamp;
+  g_hash_table_insert (index->entries, item, entry);
+
+  link_entry (index, entry);
+}
+
+/**
+ * meta_spatial_index_update:
+ * @index: a #MetaSpatialIndex
+ * @item: an item
+ * @rect: the new rectangle of @item
+ *
+ * Updates the rectangle of @item. Does nothing if @item is not in
+ * the index.
+ */
+void
+meta_spatial_index_update (MetaSpatialIndex    *index,
+                           gpointer             item,
+                           const MetaRectangle *rect)
+{
+  MetaSpatialEntry *entry;
+  int x1, y1, x2, y2;
+
+  entry = g_hash_table_lookup (index->entries, item);
+  if (entry == NULL)
+    return;
+
+  if (meta_rectangle_equal (&entry->rect, rect))
+    return;
+
+  get_cell_range (rect, &x1, &y1, &x2, &y2);
+  if (!entry->oversized &&
+      x1 == entry->cell_x1 && y1 == entry->cell_y1 &&
+      x2 == entry->cell_x2 && y2 == entry->cell_y2)
+    {
+      /* Still listed in the right cells */
+      entry->rect = *rect;
+      return;
+    }
+
+  unlink_entry (index, entry);
+  entry->rect = *rect;
+  link_entry (index, entry);
+}
+
+/**
+ * meta_spatial_index_remove:
+ * @index: a #MetaSpatialIndex
+ * @item: the item to remove
+ *
+ * Removes @item from the index, if it is in it.
+ */
+void
+meta_spatial_index_remove (MetaSpatialIndex *index,
+                           gpointer          item)
+{
+  MetaSpatialEntry *entry;
+
+  entry = g_hash_table_lookup (index->entries, item);
+  if (entry == NULL)
+    return;
+
+  unlink_entry (index, entry);
+  g_hash_table_remove (index->entries, item);
+}
+
+gboolean
+meta_spatial_index_contains (MetaSpatialIndex *index,
+                             gpointer          item)
+{
+  return g_hash_table_contains (index->entries, item);
+}
+
+guint
+meta_spatial_index_get_size (MetaSpatialIndex *index)
+{
+  return g_hash_table_size (index->entries);
+}
+
+static gboolean
+visit_entry (MetaSpatialIndex     *index,
+             MetaSpatialEntry     *entry,
+             const MetaRectangle  *rect,
+             MetaSpatialIndexFunc  func,
+             gpointer              user_data)
+{
+  MetaRectangle overlap;
+
+  if (entry->query_stamp == index->query_stamp)
+    return FALSE;
+
+  entry->query_stamp = index->query_stamp;
+
+  /* Unlike meta_rectangle_overlap(), this never matches empty rects */
+  if (!meta_rectangle_intersect (&entry->rect, rect, &overlap))
+    return FALSE;
+
+  return func (entry->item, &entry->rect, user_data);
+}
+
+/**
+ * meta_spatial_index_foreach_in_rect:
+ * @index: a #MetaSpatialIndex
+ * @rect: the rectangle to look up
+ * @func: (scope call): function called for each item overlapping @rect
+ * @user_data: data to pass to @func
+ *
+ * Calls @func once for every item whose rectangle has a non-empty
+ * intersection with @rect, in no particular order, until @func returns
+ * %TRUE. The index must not be modified by @func.
+ *
+ * Returns: the item for which @func returned %TRUE, or %NULL
+ */
+gpointer
+meta_spatial_index_foreach_in_rect (MetaSpatialIndex     *index,
+                                    const MetaRectangle  *rect,
+                                    MetaSpatialIndexFunc  func,
+                                    gpointer              user_data)
+{
+  int x1, y1, x2, y2;
+  int x, y;
+  guint i;
+
+  get_cell_range (rect, &x1, &y1, &x2, &y2);
+  if (cell_range_size (x1, y1, x2, y2) == 0)
+    return NULL;
+
+  index->query_stamp++;
+
+  if (cell_range_size (x1, y1, x2, y2) > g_hash_table_size (index->cells))
+    {
+      GHashTableIter iter;
+      MetaSpatialEntry *entry;
+
+      /* Looking at every entry is cheaper than looking up every cell */
+      g_hash_table_iter_init (&iter, index->entries);
+      while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+        {
+          if (visit_entry (index, entry, rect, func, user_data))
+            return entry->item;
+        }
+
+      return NULL;
+    }
+
+  for (i = 0; i < index->oversized->len; i++)
+    {
+      MetaSpatialEntry *entry = g_ptr_array_index (index->oversized, i);
+
+      if (visit_entry (index, entry, rect, func, user_data))
+        return entry->item;
+    }
+
+  for (y = y1; y <= y2; y++)
+    for (x = x1; x <= x2; x++)
+      {
+        GPtrArray *cell;
+
+        cell = g_hash_table_lookup (index->cells, cell_key (x, y));
+        if (cell == NULL)
+          continue;
+
+        for (i = 0; i < cell->len; i++)
+          {
+            MetaSpatialEntry *entry = g_ptr_array_index (cell, i);
+
+            if (visit_entry (index, entry, rect, func, user_data))
+              return entry->item;
+          }
+      }
+
+  return NULL;
+}
+
+/**
+ * meta_spatial_index_foreach_at_point:
+ * @index: a #MetaSpatialIndex
+ * @x: X coordinate of the point
+ * @y: Y coordinate of the point
+ * @func: (scope call): function called for each item containing the point
+ * @user_data: data to pass to @func
+ *
+ * Calls @func once for every item whose rectangle contains the given
+ * point, in no particular order, until @func returns %TRUE. The index
+ * must not be modified by @func.
+ *
+ * Returns: the item for which @func returned %TRUE, or %NULL
+ */
+gpointer
+meta_spatial_index_foreach_at_point (MetaSpatialIndex     *index,
+                                     int                   x,
+                                     int                   y,
+                                     MetaSpatialIndexFunc  func,
+                                     gpointer              user_data)
+{
+  MetaRectangle point = { x, y, 1, 1 };
+
+  return meta_spatial_index_foreach_in_rect (index, &point, func, user_data);
+}
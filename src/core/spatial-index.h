@@ -0,0 +1,59 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Spatial index of rectangles */
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_SPATIAL_INDEX_H
+#define META_SPATIAL_INDEX_H
+
+#include <glib.h>
+#include <meta/boxes.h>
+
+typedef struct _MetaSpatialIndex MetaSpatialIndex;
+
+/* Return TRUE to stop the iteration */
+typedef gboolean (* MetaSpatialIndexFunc) (gpointer             item,
+                                           const MetaRectangle *rect,
+                                           gpointer             user_data);
+
+MetaSpatialIndex * meta_spatial_index_new      (void);
+void               meta_spatial_index_free     (MetaSpatialIndex    *index);
+
+void               meta_spatial_index_insert   (MetaSpatialIndex    *index,
+                                                gpointer             item,
+                                                const MetaRectangle *rect);
+void               meta_spatial_index_update   (MetaSpatialIndex    *index,
+                                                gpointer             item,
+                                                const MetaRectangle *rect);
+void               meta_spatial_index_remove   (MetaSpatialIndex    *index,
+                                                gpointer             item);
+
+gboolean           meta_spatial_index_contains (MetaSpatialIndex    *index,
+                                                gpointer             item);
+guint              meta_spatial_index_get_size (MetaSpatialIndex    *index);
+
+gpointer           meta_spatial_index_foreach_in_rect  (MetaSpatialIndex     *index,
+                                                        const MetaRectangle  *rect,
+                                                        MetaSpatialIndexFunc  func,
+                                                        gpointer              user_data);
+gpointer           meta_spatial_index_foreach_at_point (MetaSpatialIndex     *index,
+                                                        int                   x,
+                                                        int                   y,
+                                                        MetaSpatialIndexFunc  func,
+                                                        gpointer              user_data);
+
+#endif /* META_SPATIAL_INDEX_H */
@@ -71,11 +71,14 @@
  * no longer pending b) if necessary, drop the predicted stacking
  * order to recompute it at the next opportunity.
  *
- * Possible optimizations:
- *  Keep the stacks as an array + reverse-mapping hash table to avoid
- *    linear lookups.
- *  Keep the stacks as a GList + reverse-mapping hash table to avoid
- *    linear lookups and to make restacking constant-time.
+ * Both stacks are kept as an array plus a reverse-mapping hash table
+ * from stack id to position, so finding a window is constant-time and
+ * restacking only touches the windows between the old and the new
+ * position.
+ *
+ * When syncing the stack to the compositor, we remember the stack and
+ * the MetaWindows we passed the last time, and only look up the windows
+ * in the range that changed since then.
  */
 
 typedef union _MetaStackOp MetaStackOp;
@@ -138,6 +141,23 @@ union _MetaStackOp
   } lower_below;
 };
 
+typedef struct
+{
+  guint64 window;
+  int position;
+} StackEntry;
+
+/* A stack of windows, bottom to top, with a mapping back from
+ * stack id to position in the stack.
+ */
+typedef struct
+{
+  GArray *windows;
+
+  /* &StackEntry.window -> StackEntry */
+  GHashTable *entries;
+} StackArray;
+
 struct _MetaStackTracker
 {
   MetaScreen *screen;
@@ -149,7 +169,7 @@ struct _MetaStackTracker
 
   /* A combined stack containing X and Wayland windows but without
    * any unverified operations applied. */
-  GArray *verified_stack;
+  StackArray *verified_stack;
 
   /* This is a queue of requests we've made to change the stacking order,
    * where we haven't yet gotten a reply back from the server.
@@ -160,12 +180,23 @@ struct _MetaStackTracker
    * on the unverified_predictions we've made subsequent to
    * verified_stack.
    */
-  GArray *predicted_stack;
+  StackArray *predicted_stack;
 
   /* Idle function used to sync the compositor's view of the window
    * stack up with our best guess before a frame is drawn.
    */
   guint sync_stack_later;
+
+  /* The stack ids we last synced to the compositor, and the MetaWindow
+   * (or NULL) each of them mapped to at the time
+   */
+  GArray *synced_stack;
+  GArray *synced_windows;
+
+  /* Set when MetaWindows were created or destroyed, so that the
+   * whole stack needs to be mapped to MetaWindows again
+   */
+  gboolean resync_all_windows;
 };
 
 static inline const char *
@@ -218,14 +249,14 @@ meta_stack_op_dump (MetaStackTracker *tracker,
 
 static void
 stack_dump (MetaStackTracker *tracker,
-            GArray           *stack)
+            StackArray       *stack)
 {
   guint i;
 
   meta_push_no_msg_prefix ();
-  for (i = 0; i < stack->len; i++)
+  for (i = 0; i < stack->windows->len; i++)
     {
-      guint64 window = g_array_index (stack, guint64, i);
+      guint64 window = g_array_index (stack->windows, guint64, i);
       meta_topic (META_DEBUG_STACK, "  %s", get_window_desc (tracker, window));
     }
   meta_topic (META_DEBUG_STACK, "\n");
@@ -237,6 +268,12 @@ meta_stack_tracker_dump (MetaStackTracker *tracker)
 {
   GList *l;
 
+  /* Describing every window of the stack is expensive, and this
+   * is called for every stacking event.
+   */
+  if (!meta_is_verbose ())
+    return;
+
   meta_topic (META_DEBUG_STACK, "MetaStackTracker state\n");
   meta_push_no_msg_prefix ();
   meta_topic (META_DEBUG_STACK, "  xserver_serial: %ld\n", tracker->xserver_serial);
@@ -263,30 +300,104 @@ meta_stack_op_free (MetaStackOp *op)
   g_slice_free (MetaStackOp, op);
 }
 
-static int
-find_window (GArray  *window_stack,
-             guint64  window)
+static void
+stack_entry_free (StackEntry *entry)
 {
-  guint i;
+  g_slice_free (StackEntry, entry);
+}
+
+static StackArray *
+stack_array_new (guint reserved_size)
+{
+  StackArray *stack = g_new0 (StackArray, 1);
+
+  stack->windows = g_array_sized_new (FALSE, FALSE, sizeof (guint64), reserved_size);
+  stack->entries = g_hash_table_new_full (g_int64_hash, g_int64_equal, NULL,
+                                          (GDestroyNotify) stack_entry_free);
+
+  return stack;
+}
 
-  for (i = 0; i < window_stack->len; i++)
+static void
+stack_array_free (StackArray *stack)
+{
+  g_hash_table_destroy (stack->entries);
+  g_array_free (stack->windows, TRUE);
+  g_free (stack);
+}
+
+static void
+stack_array_append (StackArray *stack,
+                    guint64     window)
+{
+  StackEntry *entry = g_slice_new (StackEntry);
+
+  entry->window = window;
+  entry->position = stack->windows->len;
+  g_hash_table_insert (stack->entries, &entry->window, entry);
+
+  g_array_append_val (stack->windows, window);
+}
+
+/* Updates the positions of the windows in [start, end) after they
+ * have been moved in the array
+ */
+static void
+stack_array_reindex (StackArray *stack,
+                     int         start,
+                     int         end)
+{
+  int i;
+
+  for (i = start; i < end; i++)
     {
-      guint64 current = g_array_index (window_stack, guint64, i);
-      if (current == window)
-        return i;
+      StackEntry *entry = g_hash_table_lookup (stack->entries,
+                                               &g_array_index (stack->windows, guint64, i));
+      entry->position = i;
     }
+}
+
+static void
+stack_array_remove (StackArray *stack,
+                    int         position)
+{
+  guint64 window = g_array_index (stack->windows, guint64, position);
+
+  g_hash_table_remove (stack->entries, &window);
+  g_array_remove_index (stack->windows, position);
+  stack_array_reindex (stack, position, stack->windows->len);
+}
+
+static StackArray *
+stack_array_copy (StackArray *stack)
+{
+  StackArray *copy = stack_array_new (stack->windows->len);
+  guint i;
+
+  for (i = 0; i < stack->windows->len; i++)
+    stack_array_append (copy, g_array_index (stack->windows, guint64, i));
+
+  return copy;
+}
 
-  return -1;
+static int
+find_window (StackArray *stack,
+             guint64     window)
+{
+  StackEntry *entry = g_hash_table_lookup (stack->entries, &window);
+
+  return entry ? entry->position : -1;
 }
 
 /* Returns TRUE if stack was changed */
 static gboolean
-move_window_above (GArray    *stack,
-                   guint64    window,
-                   int        old_pos,
-                   int        above_pos,
-                   ApplyFlags apply_flags)
+move_window_above (StackArray *stack,
+                   guint64     window,
+                   int         old_pos,
+                   int         above_pos,
+                   ApplyFlags  apply_flags)
 {
+  GArray *windows = stack->windows;
   int i;
   gboolean can_restack_this_window =
     (apply_flags & NO_RESTACK_X_WINDOWS) == 0  || !META_STACK_ID_IS_X11 (window);
@@ -297,7 +408,7 @@ move_window_above (GArray    *stack,
         {
           gboolean found_x_window = FALSE;
           for (i = old_pos + 1; i <= above_pos; i++)
-            if (META_STACK_ID_IS_X11 (g_array_index (stack, guint64, i)))
+            if (META_STACK_ID_IS_X11 (g_array_index (windows, guint64, i)))
               found_x_window = TRUE;
 
           if (!found_x_window)
@@ -307,14 +418,15 @@ move_window_above (GArray    *stack,
       for (i = old_pos; i < above_pos; i++)
         {
           if (!can_restack_this_window &&
-              META_STACK_ID_IS_X11 (g_array_index (stack, guint64, i + 1)))
+              META_STACK_ID_IS_X11 (g_array_index (windows, guint64, i + 1)))
             break;
 
-          g_array_index (stack, guint64, i) =
-            g_array_index (stack, guint64, i + 1);
+          g_array_index (windows, guint64, i) =
+            g_array_index (windows, guint64, i + 1);
         }
 
-      g_array_index (stack, guint64, i) = window;
+      g_array_index (windows, guint64, i) = window;
+      stack_array_reindex (stack, old_pos, i + 1);
 
       return i != old_pos;
     }
@@ -324,7 +436,7 @@ move_window_above (GArray    *stack,
         {
           gboolean found_x_window = FALSE;
           for (i = above_pos + 1; i < old_pos; i++)
-            if (META_STACK_ID_IS_X11 (g_array_index (stack, guint64, i)))
+            if (META_STACK_ID_IS_X11 (g_array_index (windows, guint64, i)))
               found_x_window = TRUE;
 
           if (!found_x_window)
@@ -334,14 +446,15 @@ move_window_above (GArray    *stack,
       for (i = old_pos; i > above_pos + 1; i--)
         {
           if (!can_restack_this_window &&
-              META_STACK_ID_IS_X11 (g_array_index (stack, guint64, i - 1)))
+              META_STACK_ID_IS_X11 (g_array_index (windows, guint64, i - 1)))
             break;
 
-          g_array_index (stack, guint64, i) =
-            g_array_index (stack, guint64, i - 1);
+          g_array_index (windows, guint64, i) =
+            g_array_index (windows, guint64, i - 1);
         }
 
-      g_array_index (stack, guint64, i) = window;
+      g_array_index (windows, guint64, i) = window;
+      stack_array_reindex (stack, i, old_pos + 1);
 
       return i != old_pos;
     }
@@ -353,7 +466,7 @@ move_window_above (GArray    *stack,
 static gboolean
 meta_stack_op_apply (MetaStackTracker *tracker,
                      MetaStackOp      *op,
-		     GArray           *stack,
+		     StackArray       *stack,
                      ApplyFlags        apply_flags)
 {
   switch (op->any.type)
@@ -372,7 +485,7 @@ meta_stack_op_apply (MetaStackTracker *tracker,
 	    return FALSE;
 	  }
 
-	g_array_append_val (stack, op->add.window);
+	stack_array_append (stack, op->add.window);
 	return TRUE;
       }
     case STACK_OP_REMOVE:
@@ -389,7 +502,7 @@ meta_stack_op_apply (MetaStackTracker *tracker,
 	    return FALSE;
 	  }
 
-	g_array_remove_index (stack, old_pos);
+	stack_array_remove (stack, old_pos);
 	return TRUE;
       }
     case STACK_OP_RAISE_ABOVE:
@@ -446,7 +559,7 @@ meta_stack_op_apply (MetaStackTracker *tracker,
 	  }
 	else
 	  {
-	    above_pos = stack->len - 1;
+	    above_pos = stack->windows->len - 1;
 	  }
 
 	return move_window_above (stack, op->lower_below.window, old_pos, above_pos,
@@ -458,18 +571,6 @@ meta_stack_op_apply (MetaStackTracker *tracker,
   return FALSE;
 }
 
-static GArray *
-copy_stack (GArray *stack)
-{
-  GArray *copy = g_array_sized_new (FALSE, FALSE, sizeof (guint64), stack->len);
-
-  g_array_set_size (copy, stack->len);
-
-  memcpy (copy->data, stack->data, sizeof (guint64) * stack->len);
-
-  return copy;
-}
-
 static void
 query_xserver_stack (MetaStackTracker *tracker)
 {
@@ -485,11 +586,10 @@ query_xserver_stack (MetaStackTracker *tracker)
               screen->xroot,
               &ignored1, &ignored2, &children, &n_children);
 
-  tracker->verified_stack = g_array_sized_new (FALSE, FALSE, sizeof (guint64), n_children);
-  g_array_set_size (tracker->verified_stack, n_children);
+  tracker->verified_stack = stack_array_new (n_children);
 
   for (i = 0; i < n_children; i++)
-    g_array_index (tracker->verified_stack, guint64, i) = children[i];
+    stack_array_append (tracker->verified_stack, children[i]);
 
   XFree (children);
 }
@@ -506,6 +606,10 @@ meta_stack_tracker_new (MetaScreen *screen)
 
   tracker->unverified_predictions = g_queue_new ();
 
+  tracker->synced_stack = g_array_new (FALSE, FALSE, sizeof (guint64));
+  tracker->synced_windows = g_array_new (FALSE, FALSE, sizeof (MetaWindow *));
+  tracker->resync_all_windows = TRUE;
+
   meta_stack_tracker_dump (tracker);
 
   return tracker;
@@ -517,9 +621,12 @@ meta_stack_tracker_free (MetaStackTracker *tracker)
   if (tracker->sync_stack_later)
     meta_later_remove (tracker->sync_stack_later);
 
-  g_array_free (tracker->verified_stack, TRUE);
+  stack_array_free (tracker->verified_stack);
   if (tracker->predicted_stack)
-    g_array_free (tracker->predicted_stack, TRUE);
+    stack_array_free (tracker->predicted_stack);
+
+  g_array_free (tracker->synced_stack, TRUE);
+  g_array_free (tracker->synced_windows, TRUE);
 
   g_queue_foreach (tracker->unverified_predictions, (GFunc)meta_stack_op_free, NULL);
   g_queue_free (tracker->unverified_predictions);
@@ -528,6 +635,28 @@ meta_stack_tracker_free (MetaStackTracker *tracker)
   g_free (tracker);
 }
 
+static gboolean
+stack_tracker_sync_stack_later (gpointer data)
+{
+  meta_stack_tracker_sync_stack (data);
+
+  return FALSE;
+}
+
+/* Like meta_stack_tracker_queue_sync_stack(), for changes of the
+ * stack itself
+ */
+static void
+stack_tracker_queue_sync_stack (MetaStackTracker *tracker)
+{
+  if (tracker->sync_stack_later == 0)
+    {
+      tracker->sync_stack_later = meta_later_add (META_LATER_SYNC_STACK,
+                                                  stack_tracker_sync_stack_later,
+                                                  tracker, NULL);
+    }
+}
+
 static void
 stack_tracker_apply_prediction (MetaStackTracker *tracker,
 			        MetaStackOp      *op)
@@ -542,7 +671,7 @@ stack_tracker_apply_prediction (MetaStackTracker *tracker,
       tracker->unverified_predictions->length == 0)
     {
       if (meta_stack_op_apply (tracker, op, tracker->verified_stack, APPLY_DEFAULT))
-        meta_stack_tracker_queue_sync_stack (tracker);
+        stack_tracker_queue_sync_stack (tracker);
 
       free_at_end = TRUE;
     }
@@ -554,7 +683,7 @@ stack_tracker_apply_prediction (MetaStackTracker *tracker,
 
   if (!tracker->predicted_stack ||
       meta_stack_op_apply (tracker, op, tracker->predicted_stack, APPLY_DEFAULT))
-    meta_stack_tracker_queue_sync_stack (tracker);
+    stack_tracker_queue_sync_stack (tracker);
 
   if (free_at_end)
     meta_stack_op_free (op);
@@ -687,11 +816,11 @@ stack_tracker_event_received (MetaStackTracker *tracker,
     {
       if (tracker->predicted_stack)
         {
-          g_array_free (tracker->predicted_stack, TRUE);
+          stack_array_free (tracker->predicted_stack);
           tracker->predicted_stack = NULL;
         }
 
-      meta_stack_tracker_queue_sync_stack (tracker);
+      stack_tracker_queue_sync_stack (tracker);
     }
 
   meta_stack_tracker_dump (tracker);
@@ -763,6 +892,27 @@ meta_stack_tracker_configure_event (MetaStackTracker    *tracker,
   stack_tracker_event_received (tracker, &op);
 }
 
+static StackArray *
+get_stack_array (MetaStackTracker *tracker)
+{
+  if (tracker->unverified_predictions->length == 0)
+    return tracker->verified_stack;
+
+  if (tracker->predicted_stack == NULL)
+    {
+      GList *l;
+
+      tracker->predicted_stack = stack_array_copy (tracker->verified_stack);
+      for (l = tracker->unverified_predictions->head; l; l = l->next)
+        {
+          MetaStackOp *op = l->data;
+          meta_stack_op_apply (tracker, op, tracker->predicted_stack, APPLY_DEFAULT);
+        }
+    }
+
+  return tracker->predicted_stack;
+}
+
 /**
  * meta_stack_tracker_get_stack:
  * @tracker: a #MetaStackTracker
@@ -785,33 +935,62 @@ meta_stack_tracker_get_stack (MetaStackTracker *tracker,
                               guint64         **windows,
 			      int              *n_windows)
 {
-  GArray *stack;
+  StackArray *stack = get_stack_array (tracker);
 
-  if (tracker->unverified_predictions->length == 0)
+  if (windows)
+    *windows = (guint64 *)stack->windows->data;
+  if (n_windows)
+    *n_windows = stack->windows->len;
+}
+
+static MetaWindow *
+lookup_stack_window (MetaStackTracker *tracker,
+                     guint64           window)
+{
+  if (META_STACK_ID_IS_X11 (window))
     {
-      stack = tracker->verified_stack;
+      MetaWindow *meta_window =
+        meta_display_lookup_x_window (tracker->screen->display, (Window)window);
+
+      /* When mapping back from xwindow to MetaWindow we have to be a bit careful;
+       * children of the root could include unmapped windows created by toolkits
+       * for internal purposes, including ones that we have registered in our
+       * XID => window table. (Wine uses a toplevel for _NET_WM_USER_TIME_WINDOW;
+       * see window-prop.c:reload_net_wm_user_time_window() for registration.)
+       */
+      if (meta_window &&
+          ((Window)window == meta_window->xwindow ||
+           (meta_window->frame && (Window)window == meta_window->frame->xwindow)))
+        return meta_window;
+
+      return NULL;
     }
   else
-    {
-      if (tracker->predicted_stack == NULL)
-        {
-          GList *l;
-
-          tracker->predicted_stack = copy_stack (tracker->verified_stack);
-          for (l = tracker->unverified_predictions->head; l; l = l->next)
-            {
-              MetaStackOp *op = l->data;
-              meta_stack_op_apply (tracker, op, tracker->predicted_stack, APPLY_DEFAULT);
-            }
-        }
+    return meta_display_lookup_stamp (tracker->screen->display, window);
+}
 
-      stack = tracker->predicted_stack;
-    }
+/* Replaces the @old_len elements of @array at @start by @new_len
+ * uninitialized elements, keeping the elements after them.
+ */
+static void
+splice_array (GArray *array,
+              guint   start,
+              guint   old_len,
+              guint   new_len)
+{
+  guint element_size = g_array_get_element_size (array);
+  guint n_after = array->len - start - old_len;
 
-  if (windows)
-    *windows = (guint64 *)stack->data;
-  if (n_windows)
-    *n_windows = stack->len;
+  if (new_len > old_len)
+    g_array_set_size (array, array->len + new_len - old_len);
+
+  if (n_after > 0 && new_len != old_len)
+    memmove (array->data + (start + new_len) * element_size,
+             array->data + (start + old_len) * element_size,
+             n_after * element_size);
+
+  if (new_len < old_len)
+    g_array_set_size (array, array->len + new_len - old_len);
 }
 
 /**
@@ -824,9 +1003,11 @@ meta_stack_tracker_get_stack (MetaStackTracker *tracker,
 void
 meta_stack_tracker_sync_stack (MetaStackTracker *tracker)
 {
-  guint64 *windows;
+  guint64 *windows, *synced;
+  MetaWindow **synced_windows;
   GList *meta_windows;
-  int n_windows;
+  int n_windows, n_synced;
+  int start, end;
   int i;
 
   if (tracker->sync_stack_later)
@@ -837,30 +1018,49 @@ meta_stack_tracker_sync_stack (MetaStackTracker *tracker)
 
   meta_stack_tracker_get_stack (tracker, &windows, &n_windows);
 
+  /* Find the range of the stack which changed since the last sync;
+   * the windows around it still map to the same MetaWindows, unless
+   * MetaWindows were created or destroyed since.
+   */
+  synced = (guint64 *)tracker->synced_stack->data;
+  n_synced = tracker->synced_stack->len;
+  start = 0;
+  end = 0;
+
+  if (!tracker->resync_all_windows)
+    {
+      while (start < n_windows && start < n_synced &&
+             windows[start] == synced[start])
+        start++;
+      while (end < n_windows - start && end < n_synced - start &&
+             windows[n_windows - end - 1] == synced[n_synced - end - 1])
+        end++;
+    }
+
+  tracker->resync_all_windows = FALSE;
+
+  splice_array (tracker->synced_stack,
+                start, n_synced - start - end, n_windows - start - end);
+  splice_array (tracker->synced_windows,
+                start, n_synced - start - end, n_windows - start - end);
+
+  synced = (guint64 *)tracker->synced_stack->data;
+  synced_windows = (MetaWindow **)tracker->synced_windows->data;
+
+  meta_topic (META_DEBUG_STACK, "Looking up %d of %d windows to sync the stack\n",
+              n_windows - start - end, n_windows);
+
+  for (i = start; i < n_windows - end; i++)
+    {
+      synced[i] = windows[i];
+      synced_windows[i] = lookup_stack_window (tracker, windows[i]);
+    }
+
   meta_windows = NULL;
   for (i = 0; i < n_windows; i++)
     {
-      guint64 window = windows[i];
-
-      if (META_STACK_ID_IS_X11 (window))
-        {
-          MetaWindow *meta_window =
-            meta_display_lookup_x_window (tracker->screen->display, (Window)window);
-
-          /* When mapping back from xwindow to MetaWindow we have to be a bit careful;
-           * children of the root could include unmapped windows created by toolkits
-           * for internal purposes, including ones that we have registered in our
-           * XID => window table. (Wine uses a toplevel for _NET_WM_USER_TIME_WINDOW;
-           * see window-prop.c:reload_net_wm_user_time_window() for registration.)
-           */
-          if (meta_window &&
-              ((Window)window == meta_window->xwindow ||
-               (meta_window->frame && (Window)window == meta_window->frame->xwindow)))
-            meta_windows = g_list_prepend (meta_windows, meta_window);
-        }
-      else
-        meta_windows = g_list_prepend (meta_windows,
-                                       meta_display_lookup_stamp (tracker->screen->display, window));
+      if (synced_windows[i])
+        meta_windows = g_list_prepend (meta_windows, synced_windows[i]);
     }
 
   meta_compositor_sync_stack (tracker->screen->display->compositor,
@@ -870,14 +1070,6 @@ meta_stack_tracker_sync_stack (MetaStackTracker *tracker)
   meta_screen_restacked (tracker->screen);
 }
 
-static gboolean
-stack_tracker_sync_stack_later (gpointer data)
-{
-  meta_stack_tracker_sync_stack (data);
-
-  return FALSE;
-}
-
 /**
  * meta_stack_tracker_queue_sync_stack:
  * @tracker: a #MetaStackTracker
@@ -894,12 +1086,8 @@ stack_tracker_sync_stack_later (gpointer data)
 void
 meta_stack_tracker_queue_sync_stack (MetaStackTracker *tracker)
 {
-  if (tracker->sync_stack_later == 0)
-    {
-      tracker->sync_stack_later = meta_later_add (META_LATER_SYNC_STACK,
-                                                  stack_tracker_sync_stack_later,
-                                                  tracker, NULL);
-    }
+  tracker->resync_all_windows = TRUE;
+  stack_tracker_queue_sync_stack (tracker);
 }
 
 /* When moving an X window we sometimes need an X based sibling.
@@ -912,25 +1100,21 @@ static Window
 find_x11_sibling_downwards (MetaStackTracker *tracker,
                             guint64           sibling)
 {
+  StackArray *stack;
   guint64 *windows;
-  int n_windows;
   int i;
 
   if (META_STACK_ID_IS_X11 (sibling))
     return (Window)sibling;
 
-  meta_stack_tracker_get_stack (tracker,
-                                &windows, &n_windows);
+  stack = get_stack_array (tracker);
+  windows = (guint64 *)stack->windows->data;
 
   /* NB: Children are in order from bottom to top and we
    * want to search downwards for the nearest X window.
    */
 
-  for (i = n_windows - 1; i >= 0; i--)
-    if (windows[i] == sibling)
-      break;
-
-  for (; i >= 0; i--)
+  for (i = find_window (stack, sibling); i >= 0; i--)
     {
       if (META_STACK_ID_IS_X11 (windows[i]))
         return (Window)windows[i];
@@ -943,6 +1127,7 @@ static Window
 find_x11_sibling_upwards (MetaStackTracker *tracker,
                           guint64           sibling)
 {
+  StackArray *stack;
   guint64 *windows;
   int n_windows;
   int i;
@@ -950,12 +1135,13 @@ find_x11_sibling_upwards (MetaStackTracker *tracker,
   if (META_STACK_ID_IS_X11 (sibling))
     return (Window)sibling;
 
-  meta_stack_tracker_get_stack (tracker,
-                                &windows, &n_windows);
+  stack = get_stack_array (tracker);
+  windows = (guint64 *)stack->windows->data;
+  n_windows = stack->windows->len;
 
-  for (i = 0; i < n_windows; i++)
-    if (windows[i] == sibling)
-      break;
+  i = find_window (stack, sibling);
+  if (i < 0)
+    return None;
 
   for (; i < n_windows; i++)
     {
@@ -1040,17 +1226,99 @@ meta_stack_tracker_lower (MetaStackTracker *tracker,
   meta_stack_tracker_raise_above (tracker, window, None);
 }
 
-void
+/**
+ * meta_stack_find_moved_windows:
+ * @current: windows in their current stacking order, bottom to top; windows
+ *   which are not in @wanted are ignored
+ * @n_current: the number of elements in @current
+ * @wanted: the wanted stacking order, bottom to top
+ * @n_wanted: the number of elements in @wanted
+ * @moved: (out caller-allocates): set to %TRUE for each window of @wanted
+ *   which has to be moved
+ *
+ * Finds a smallest set of windows to move so that @current ends up in the
+ * order of @wanted: the windows which are already in the right order
+ * relative to each other are the longest subsequence of @current which is
+ * also a subsequence of @wanted, and only the others need to be moved.
+ *
+ * Returns: the number of windows to move
+ */
+int
+meta_stack_find_moved_windows (const guint64 *current,
+                               int            n_current,
+                               const guint64 *wanted,
+                               int            n_wanted,
+                               gboolean      *moved)
+{
+  GHashTable *wanted_positions;
+  int *positions, *tails, *prev;
+  int n_positions = 0, n_tails = 0, last, i;
+
+  /* Positions are stored off by one so that NULL means not wanted */
+  wanted_positions = g_hash_table_new (g_int64_hash, g_int64_equal);
+  for (i = 0; i < n_wanted; i++)
+    {
+      g_hash_table_insert (wanted_positions, (gpointer) &wanted[i],
+                           GINT_TO_POINTER (i + 1));
+      moved[i] = TRUE;
+    }
+
+  positions = g_new (int, n_current);
+  for (i = 0; i < n_current; i++)
+    {
+      int pos = GPOINTER_TO_INT (g_hash_table_lookup (wanted_positions,
+                                                      &current[i]));
+      if (pos > 0)
+        positions[n_positions++] = pos - 1;
+    }
+  g_hash_table_destroy (wanted_positions);
+
+  /* Longest increasing subsequence of the wanted positions */
+  tails = g_new (int, MAX (n_positions, 1));
+  prev = g_new (int, MAX (n_positions, 1));
+  for (i = 0; i < n_positions; i++)
+    {
+      int lo = 0, hi = n_tails;
+
+      while (lo < hi)
+        {
+          int mid = (lo + hi) / 2;
+
+          if (positions[tails[mid]] < positions[i])
+            lo = mid + 1;
+          else
+            hi = mid;
+        }
+
+      prev[i] = lo > 0 ? tails[lo - 1] : -1;
+      tails[lo] = i;
+      if (lo == n_tails)
+        n_tails++;
+    }
+
+  for (last = n_tails > 0 ? tails[n_tails - 1] : -1; last >= 0; last = prev[last])
+    moved[positions[last]] = FALSE;
+
+  g_free (prev);
+  g_free (tails);
+  g_free (positions);
+
+  return n_wanted - n_tails;
+}
+
+int
 meta_stack_tracker_restack_managed (MetaStackTracker *tracker,
                                     const guint64    *managed,
                                     int               n_managed)
 {
   guint64 *windows;
+  guint64 top_window;
+  gboolean *moved;
   int n_windows;
-  int old_pos, new_pos;
+  int old_pos, guard_pos, n_moved, i;
 
   if (n_managed == 0)
-    return;
+    return 0;
 
   meta_stack_tracker_get_stack (tracker, &windows, &n_windows);
 
@@ -1059,7 +1327,6 @@ meta_stack_tracker_restack_managed (MetaStackTracker *tracker,
    * the top of the X stack; we instead move it above all managed windows (or
    * above the guard window if there are no non-hidden managed windows.)
    */
-  old_pos = n_windows - 1;
   for (old_pos = n_windows - 1; old_pos >= 0; old_pos--)
     {
       MetaWindow *old_window = meta_display_lookup_stack_id (tracker->screen->display, windows[old_pos]);
@@ -1068,54 +1335,46 @@ meta_stack_tracker_restack_managed (MetaStackTracker *tracker,
         break;
     }
   g_assert (old_pos >= 0);
+  top_window = windows[old_pos];
 
-  new_pos = n_managed - 1;
-  if (managed[new_pos] != windows[old_pos])
-    {
-      /* Move the first managed window in the new stack above all managed windows */
-      meta_stack_tracker_raise_above (tracker, managed[new_pos], windows[old_pos]);
-      meta_stack_tracker_get_stack (tracker, &windows, &n_windows);
-      /* Moving managed[new_pos] above windows[old_pos], moves the window at old_pos down by one */
-    }
-
-  old_pos--;
-  new_pos--;
+  /* Windows below the guard window are hidden ones, which always need to
+   * be moved up.
+   */
+  guard_pos = find_window (get_stack_array (tracker), tracker->screen->guard_window);
 
-  while (old_pos >= 0 && new_pos >= 0)
-    {
-      if (windows[old_pos] == tracker->screen->guard_window)
-        break;
+  /* Only move the windows which are out of order, rather than restacking
+   * everything from the first difference down; raising or lowering a
+   * single window then takes a single request.
+   */
+  moved = g_new (gboolean, n_managed);
+  n_moved = meta_stack_find_moved_windows (windows + guard_pos + 1,
+                                           n_windows - guard_pos - 1,
+                                           managed, n_managed,
+                                           moved);
 
-      if (windows[old_pos] == managed[new_pos])
-        {
-          old_pos--;
-          new_pos--;
-          continue;
-        }
+  meta_topic (META_DEBUG_STACK, "Moving %d of %d managed windows\n",
+              n_moved, n_managed);
 
-      MetaWindow *old_window = meta_display_lookup_stack_id (tracker->screen->display, windows[old_pos]);
-      if (!old_window || old_window->override_redirect || old_window->unmanaging)
-        {
-          old_pos--;
-          continue;
-        }
+  /* Going down from the top, each moved window goes just below the one
+   * which should be above it, which is in place by then.
+   */
+  for (i = n_managed - 1; i >= 0; i--)
+    {
+      if (!moved[i])
+        continue;
 
-      meta_stack_tracker_lower_below (tracker, managed[new_pos], managed[new_pos + 1]);
-      meta_stack_tracker_get_stack (tracker, &windows, &n_windows);
-      /* Moving managed[new_pos] above windows[old_pos] moves the window at old_pos down by one,
-       * we'll examine it again to see if it matches the next new window */
-      old_pos--;
-      new_pos--;
+      if (i == n_managed - 1)
+        meta_stack_tracker_raise_above (tracker, managed[i], top_window);
+      else
+        meta_stack_tracker_lower_below (tracker, managed[i], managed[i + 1]);
     }
 
-  while (new_pos > 0)
-    {
-      meta_stack_tracker_lower_below (tracker, managed[new_pos], managed[new_pos - 1]);
-      new_pos--;
-    }
+  g_free (moved);
+
+  return n_moved;
 }
 
-void
+int
 meta_stack_tracker_restack_at_bottom (MetaStackTracker *tracker,
                                       const guint64    *new_order,
                                       int               n_new_order)
@@ -1123,6 +1382,7 @@ meta_stack_tracker_restack_at_bottom (MetaStackTracker *tracker,
   guint64 *windows;
   int n_windows;
   int pos;
+  int n_moved = 0;
 
   meta_stack_tracker_get_stack (tracker, &windows, &n_windows);
 
@@ -1136,6 +1396,9 @@ meta_stack_tracker_restack_at_bottom (MetaStackTracker *tracker,
             meta_stack_tracker_raise_above (tracker, new_order[pos], new_order[pos - 1]);
 
           meta_stack_tracker_get_stack (tracker, &windows, &n_windows);
+          n_moved++;
         }
     }
+
+  return n_moved;
 }
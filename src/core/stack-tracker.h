@@ -57,12 +57,19 @@ void meta_stack_tracker_record_remove          (MetaStackTracker *tracker,
 void meta_stack_tracker_lower           (MetaStackTracker *tracker,
                                          guint64           window);
 
-void meta_stack_tracker_restack_managed (MetaStackTracker *tracker,
-                                         const guint64    *windows,
-                                         int               n_windows);
-void meta_stack_tracker_restack_at_bottom (MetaStackTracker *tracker,
-                                           const guint64    *new_order,
-                                           int               n_new_order);
+/* These return the number of windows they moved */
+int meta_stack_tracker_restack_managed (MetaStackTracker *tracker,
+                                        const guint64    *windows,
+                                        int               n_windows);
+int meta_stack_tracker_restack_at_bottom (MetaStackTracker *tracker,
+                                          const guint64    *new_order,
+                                          int               n_new_order);
+
+int meta_stack_find_moved_windows (const guint64 *current,
+                                   int            n_current,
+                                   const guint64 *wanted,
+                                   int            n_wanted,
+                                   gboolean      *moved);
 
 /* These functions are used to update the stack when we get events
  * reflecting changes to the stacking order */
@@ -28,6 +28,7 @@
 #include <config.h>
 #include "stack.h"
 #include "window-private.h"
+#include "workspace-private.h"
 #include <meta/errors.h>
 #include "frame.h"
 #include <meta/group.h>
@@ -36,6 +37,7 @@
 #include "backends/meta-logical-monitor.h"
 
 #include <X11/Xatom.h>
+#include <string.h>
 
 #include "x11/group-private.h"
 
@@ -83,13 +85,24 @@ meta_stack_new (MetaScreen *screen)
   stack->need_relayer = FALSE;
   stack->need_constrain = FALSE;
 
+  stack->last_client_list = NULL;
+  stack->last_client_list_stacking = NULL;
+  stack->sync_later = 0;
+
   return stack;
 }
 
 void
 meta_stack_free (MetaStack *stack)
 {
+  if (stack->sync_later != 0)
+    meta_later_remove (stack->sync_later);
+
   g_array_free (stack->xwindows, TRUE);
+  if (stack->last_client_list)
+    g_array_free (stack->last_client_list, TRUE);
+  if (stack->last_client_list_stacking)
+    g_array_free (stack->last_client_list_stacking, TRUE);
 
   g_list_free (stack->sorted);
   g_list_free (stack->added);
@@ -976,26 +989,50 @@ stack_ensure_sorted (MetaStack *stack)
   stack_do_resort (stack);
 }
 
+static void
+sync_client_list (MetaStack *stack,
+                  Atom       atom,
+                  GArray    *xwindows,
+                  GArray   **last_xwindows)
+{
+  if (*last_xwindows != NULL &&
+      (*last_xwindows)->len == xwindows->len &&
+      memcmp ((*last_xwindows)->data, xwindows->data,
+              xwindows->len * sizeof (Window)) == 0)
+    return;
+
+  XChangeProperty (stack->screen->display->xdisplay,
+                   stack->screen->xroot,
+                   atom,
+                   XA_WINDOW,
+                   32, PropModeReplace,
+                   (unsigned char *)xwindows->data,
+                   xwindows->len);
+
+  if (*last_xwindows == NULL)
+    *last_xwindows = g_array_new (FALSE, FALSE, sizeof (Window));
+
+  g_array_set_size (*last_xwindows, 0);
+  g_array_append_vals (*last_xwindows, xwindows->data, xwindows->len);
+}
+
 /**
- * stack_sync_to_server:
+ * stack_do_sync_to_xserver:
  *
  * Order the windows on the X server to be the same as in our structure.
- * We do this using XRestackWindows if we don't know the previous order,
- * or XConfigureWindow on a few particular windows if we do and can figure
- * out the minimum set of changes.  After that, we set __NET_CLIENT_LIST
- * and __NET_CLIENT_LIST_STACKING.
- *
- * FIXME: Now that we have a good view of the stacking order on the server
- * with MetaStackTracker it should be possible to do a simpler and better
- * job of computing the minimal set of stacking requests needed.
+ * We only move the windows which are out of order compared to what
+ * MetaStackTracker predicts the server stacking to be, so that raising
+ * or lowering a window takes a single request.  After that, we set
+ * _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING if they changed.
  */
 static void
-stack_sync_to_xserver (MetaStack *stack)
+stack_do_sync_to_xserver (MetaStack *stack)
 {
   GArray *x11_stacked;
   GArray *all_root_children_stacked; /* wayland OR x11 */
   GList *tmp;
   GArray *hidden_stack_ids;
+  int n_moved;
 
   /* Bail out if frozen */
   if (stack->freeze_count > 0)
@@ -1065,35 +1102,71 @@ stack_sync_to_xserver (MetaStack *stack)
   meta_topic (META_DEBUG_STACK, "Restacking %u windows\n",
               all_root_children_stacked->len);
 
-  meta_stack_tracker_restack_managed (stack->screen->stack_tracker,
-                                      (guint64 *)all_root_children_stacked->data,
-                                      all_root_children_stacked->len);
-  meta_stack_tracker_restack_at_bottom (stack->screen->stack_tracker,
-                                        (guint64 *)hidden_stack_ids->data,
-                                        hidden_stack_ids->len);
+  n_moved = meta_stack_tracker_restack_managed (stack->screen->stack_tracker,
+                                                (guint64 *)all_root_children_stacked->data,
+                                                all_root_children_stacked->len);
+  n_moved += meta_stack_tracker_restack_at_bottom (stack->screen->stack_tracker,
+                                                   (guint64 *)hidden_stack_ids->data,
+                                                   hidden_stack_ids->len);
+
+  if (n_moved > 0)
+    {
+      /* We are already in the sync stack phase, so tell the compositor
+       * now rather than waiting for the next frame.
+       */
+      meta_stack_tracker_sync_stack (stack->screen->stack_tracker);
+
+      /* Restacking changes which window edges hide which */
+      meta_display_queue_edge_cache_update (stack->screen->display);
+    }
 
   /* Sync _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING */
 
-  XChangeProperty (stack->screen->display->xdisplay,
-                   stack->screen->xroot,
-                   stack->screen->display->atom__NET_CLIENT_LIST,
-                   XA_WINDOW,
-                   32, PropModeReplace,
-                   (unsigned char *)stack->xwindows->data,
-                   stack->xwindows->len);
-  XChangeProperty (stack->screen->display->xdisplay,
-                   stack->screen->xroot,
-                   stack->screen->display->atom__NET_CLIENT_LIST_STACKING,
-                   XA_WINDOW,
-                   32, PropModeReplace,
-                   (unsigned char *)x11_stacked->data,
-                   x11_stacked->len);
+  sync_client_list (stack,
+                    stack->screen->display->atom__NET_CLIENT_LIST,
+                    stack->xwindows,
+                    &stack->last_client_list);
+  sync_client_list (stack,
+                    stack->screen->display->atom__NET_CLIENT_LIST_STACKING,
+                    x11_stacked,
+                    &stack->last_client_list_stacking);
 
   g_array_free (x11_stacked, TRUE);
   g_array_free (hidden_stack_ids, TRUE);
   g_array_free (all_root_children_stacked, TRUE);
 }
 
+static gboolean
+stack_sync_to_xserver_later (gpointer data)
+{
+  MetaStack *stack = data;
+
+  stack->sync_later = 0;
+  stack_do_sync_to_xserver (stack);
+
+  return FALSE;
+}
+
+/**
+ * stack_sync_to_xserver:
+ *
+ * Queues syncing the stacking order to the server, so that the restacks
+ * done while handling a batch of events end up as a single set of
+ * changes.
+ */
+static void
+stack_sync_to_xserver (MetaStack *stack)
+{
+  /* Bail out if frozen; meta_stack_thaw() will call us again */
+  if (stack->freeze_count > 0)
+    return;
+
+  if (stack->sync_later == 0)
+    stack->sync_later = meta_later_add (META_LATER_SYNC_STACK,
+                                        stack_sync_to_xserver_later,
+                                        stack, NULL);
+}
+
 MetaWindow*
 meta_stack_get_top (MetaStack *stack)
 {
@@ -1182,6 +1255,56 @@ window_contains_point (MetaWindow *window,
   return POINT_IN_RECT (root_x, root_y, rect);
 }
 
+static gboolean
+window_can_be_default_focus (MetaWindow *window,
+                             MetaWindow *not_this_one)
+{
+  if (window == not_this_one)
+    return FALSE;
+
+  if (window->unmaps_pending > 0)
+    return FALSE;
+
+  if (window->unmanaging)
+    return FALSE;
+
+  if (!(window->input || window->take_focus))
+    return FALSE;
+
+  if (!meta_window_should_be_showing (window))
+    return FALSE;
+
+  if (window->type == META_WINDOW_DOCK)
+    return FALSE;
+
+  return TRUE;
+}
+
+typedef struct
+{
+  MetaWindow *not_this_one;
+  MetaWindow *topmost;
+} FocusAtPointData;
+
+static gboolean
+find_topmost_focus_candidate (gpointer             item,
+                              const MetaRectangle *rect,
+                              gpointer             user_data)
+{
+  FocusAtPointData *data = user_data;
+  MetaWindow *window = item;
+
+  if (!WINDOW_IN_STACK (window) ||
+      !window_can_be_default_focus (window, data->not_this_one))
+    return FALSE;
+
+  if (data->topmost == NULL ||
+      compare_window_position (window, data->topmost) < 0)
+    data->topmost = window;
+
+  return FALSE;
+}
+
 static MetaWindow*
 get_default_focus_window (MetaStack     *stack,
                           MetaWorkspace *workspace,
@@ -1198,6 +1321,24 @@ get_default_focus_window (MetaStack     *stack,
 
   stack_ensure_sorted (stack);
 
+  /* Only windows on the active workspace can be showing, so when that
+   * is the workspace asked about, the ones at the point can be looked up
+   * in its index and compared by stacking order rather than walking the
+   * whole stack.
+   */
+  if (must_be_at_point &&
+      workspace != NULL &&
+      workspace == stack->screen->active_workspace)
+    {
+      FocusAtPointData data = { not_this_one, NULL };
+
+      meta_spatial_index_foreach_at_point (workspace->window_index,
+                                           root_x, root_y,
+                                           find_topmost_focus_candidate,
+                                           &data);
+      return data.topmost;
+    }
+
   /* top of this layer is at the front of the list */
   for (l = stack->sorted; l != NULL; l = l->next)
     {
@@ -1206,27 +1347,12 @@ get_default_focus_window (MetaStack     *stack,
       if (!window)
         continue;
 
-      if (window == not_this_one)
-        continue;
-
-      if (window->unmaps_pending > 0)
-        continue;
-
-      if (window->unmanaging)
-        continue;
-
-      if (!(window->input || window->take_focus))
-        continue;
-
-      if (!meta_window_should_be_showing (window))
+      if (!window_can_be_default_focus (window, not_this_one))
         continue;
 
       if (must_be_at_point && !window_contains_point (window, root_x, root_y))
         continue;
 
-      if (window->type == META_WINDOW_DOCK)
-        continue;
-
       return window;
     }
 
@@ -1281,6 +1407,12 @@ meta_stack_list_windows (MetaStack     *stack,
   return workspace_windows;
 }
 
+void
+meta_stack_ensure_sorted (MetaStack *stack)
+{
+  stack_ensure_sorted (stack);
+}
+
 int
 meta_stack_windows_cmp  (MetaStack  *stack,
                          MetaWindow *window_a,
@@ -99,6 +99,20 @@ struct _MetaStack
    */
   GArray *last_all_root_children_stacked;
 
+  /**
+   * The contents last written to _NET_CLIENT_LIST and
+   * _NET_CLIENT_LIST_STACKING, so that unchanged lists are not written
+   * again; every write wakes up all the pagers and taskbars.
+   */
+  GArray *last_client_list;
+  GArray *last_client_list_stacking;
+
+  /**
+   * The pending sync of the stack to the server, if any. The changes to
+   * the stack done while handling a batch of events are synced together.
+   */
+  guint sync_later;
+
   /**
    * Number of stack positions; same as the length of added, but
    * kept for quick reference.
@@ -351,6 +365,17 @@ MetaWindow* meta_stack_get_default_focus_window_at_point (MetaStack     *stack,
 GList*      meta_stack_list_windows (MetaStack *stack,
                                      MetaWorkspace *workspace);
 
+/**
+ * meta_stack_ensure_sorted:
+ * @stack: The stack to sort
+ *
+ * Applies the pending additions, removals and restackings to the stack,
+ * so that the layer and stack_position of its windows are up to date.
+ * Most functions here do this themselves; this is for callers which
+ * compare many windows using those fields directly.
+ */
+void        meta_stack_ensure_sorted (MetaStack *stack);
+
 /**
  * meta_stack_windows_cmp:
  * @stack: A stack containing both window_a and window_b
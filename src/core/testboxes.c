@@ -1380,9 +1380,114 @@ test_find_closest_point_to_line (void)
   printf ("%s passed.\n", G_STRFUNC);
 }
 
+/* Builds the struts of a wall of n_columns x n_rows monitors, each of them
+ * with a top panel, a partial dock at the bottom and n_extra partial struts
+ * on the left side.
+ */
+static GSList*
+get_monitor_wall_struts (int            n_columns,
+                         int            n_rows,
+                         int            n_extra,
+                         MetaRectangle *basic_rect)
+{
+  const int monitor_width = 1920, monitor_height = 1080;
+  GSList *struts = NULL;
+  int column, row, i;
+
+  *basic_rect = meta_rect (0, 0,
+                           n_columns * monitor_width,
+                           n_rows * monitor_height);
+
+  for (column = 0; column < n_columns; column++)
+    for (row = 0; row < n_rows; row++)
+      {
+        int x = column * monitor_width;
+        int y = row * monitor_height;
+
+        struts = g_slist_prepend (struts,
+                                  new_meta_strut (x, y, monitor_width, 32,
+                                                  META_SIDE_TOP));
+        struts = g_slist_prepend (struts,
+                                  new_meta_strut (x + 480, y + monitor_height - 64,
+                                                  960, 64,
+                                                  META_SIDE_BOTTOM));
+
+        for (i = 0; i < n_extra; i++)
+          struts = g_slist_prepend (struts,
+                                    new_meta_strut (x, y + 100 + i * 120,
+                                                    48 + 16 * i, 100,
+                                                    META_SIDE_LEFT));
+      }
+
+  return struts;
+}
+
+static void
+benchmark_monitor_wall (int n_columns,
+                        int n_rows,
+                        int n_extra)
+{
+  const int n_iterations = 200;
+  MetaRectangle basic_rect;
+  GSList *struts;
+  gint64 start, region_time, edges_time;
+  guint n_rects = 0, n_edges = 0;
+  int i;
+
+  struts = get_monitor_wall_struts (n_columns, n_rows, n_extra, &basic_rect);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_iterations; i++)
+    {
+      GList *region;
+
+      region = meta_rectangle_get_minimal_spanning_set_for_region (&basic_rect,
+                                                                   struts);
+      n_rects = g_list_length (region);
+      meta_rectangle_free_list_and_elements (region);
+    }
+  region_time = g_get_monotonic_time () - start;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_iterations; i++)
+    {
+      GList *edges;
+
+      edges = meta_rectangle_find_onscreen_edges (&basic_rect, struts);
+      n_edges = g_list_length (edges);
+      meta_rectangle_free_list_and_elements (edges);
+    }
+  edges_time = g_get_monotonic_time () - start;
+
+  printf ("%dx%d monitors, %3u struts: "
+          "region %8.1f us (%4u rects), edges %8.1f us (%4u edges)\n",
+          n_columns, n_rows, g_slist_length (struts),
+          (double) region_time / n_iterations, n_rects,
+          (double) edges_time / n_iterations, n_edges);
+
+  free_strut_list (struts);
+}
+
+static void
+run_benchmarks (void)
+{
+  benchmark_monitor_wall (1, 1, 0);
+  benchmark_monitor_wall (2, 1, 1);
+  benchmark_monitor_wall (3, 2, 0);
+  benchmark_monitor_wall (3, 2, 2);
+  benchmark_monitor_wall (3, 2, 4);
+  benchmark_monitor_wall (4, 3, 4);
+}
+
 int
-main(void)
+main (int argc, char **argv)
 {
+  if (argc > 1 && g_strcmp0 (argv[1], "--benchmark") == 0)
+    {
+      run_benchmarks ();
+      return 0;
+    }
+
   init_random_ness ();
   test_area ();
   test_intersect ();
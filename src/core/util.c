@@ -347,6 +347,8 @@ topic_name (MetaDebugTopic topic)
       return "EDGE_RESISTANCE";
     case META_DEBUG_DBUS:
       return "DBUS";
+    case META_DEBUG_WAYLAND:
+      return "WAYLAND";
     case META_DEBUG_VERBOSE:
       return "VERBOSE";
     }
@@ -137,6 +137,10 @@ struct _MetaWindow
   MetaScreen *screen;
   guint64 stamp;
   MetaLogicalMonitor *monitor;
+  /* The frame rect and monitor configuration serial for which
+   * meta_window_move_resize_internal() last updated the monitor */
+  MetaRectangle monitor_frame_rect;
+  unsigned int monitor_serial;
   MetaWorkspace *workspace;
   MetaWindowClientType client_type;
   MetaWaylandSurface *surface;
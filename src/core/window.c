@@ -1636,6 +1636,8 @@ implement_showing (MetaWindow *window,
 
   if (!window->override_redirect)
     sync_client_window_mapped (window);
+
+  meta_display_queue_edge_cache_update (window->display);
 }
 
 static void
@@ -1644,9 +1646,18 @@ meta_window_calc_showing (MetaWindow  *window)
   implement_showing (window, meta_window_should_be_showing (window));
 }
 
+#define CALC_SHOWING_QUEUE 0
+#define MOVE_RESIZE_QUEUE  1
+
+/* Windows moved while being shown can queue calc_showing again and the
+ * other way around; give up on a frame after this many rounds.
+ */
+#define MAX_WINDOW_QUEUE_PASSES 8
+
 static guint queue_later[NUMBER_OF_QUEUES] = {0, 0, 0};
 static GSList *queue_pending[NUMBER_OF_QUEUES] = {NULL, NULL, NULL};
 
+/* Only valid once the stacks have been sorted; see process_calc_showing_queue() */
 static int
 stackcmp (gconstpointer a, gconstpointer b)
 {
@@ -1655,13 +1666,16 @@ stackcmp (gconstpointer a, gconstpointer b)
 
   if (aw->screen != bw->screen)
     return 0; /* don't care how they sort with respect to each other */
+  else if (aw->layer != bw->layer)
+    return aw->layer < bw->layer ? -1 : 1;
+  else if (aw->stack_position != bw->stack_position)
+    return aw->stack_position < bw->stack_position ? -1 : 1;
   else
-    return meta_stack_windows_cmp (aw->screen->stack,
-                                   aw, bw);
+    return 0;
 }
 
-static gboolean
-idle_calc_showing (gpointer data)
+static int
+process_calc_showing_queue (void)
 {
   GSList *tmp;
   GSList *copy;
@@ -1669,9 +1683,7 @@ idle_calc_showing (gpointer data)
   GSList *should_hide;
   GSList *unplaced;
   GSList *displays;
-  guint queue_index = GPOINTER_TO_INT (data);
-
-  g_return_val_if_fail (queue_pending[queue_index] != NULL, FALSE);
+  int n_windows;
 
   meta_topic (META_DEBUG_WINDOW_STATE,
               "Clearing the calc_showing queue\n");
@@ -1680,12 +1692,9 @@ idle_calc_showing (gpointer data)
    * complete; destroying a window while we're in here would result in
    * badness. But it's OK to queue/unqueue calc_showings.
    */
-  copy = g_slist_copy (queue_pending[queue_index]);
-  g_slist_free (queue_pending[queue_index]);
-  queue_pending[queue_index] = NULL;
-  queue_later[queue_index] = 0;
-
-  destroying_windows_disallowed += 1;
+  copy = queue_pending[CALC_SHOWING_QUEUE];
+  queue_pending[CALC_SHOWING_QUEUE] = NULL;
+  n_windows = g_slist_length (copy);
 
   /* We map windows from top to bottom and unmap from bottom to
    * top, to avoid extra expose events. The exception is
@@ -1697,6 +1706,14 @@ idle_calc_showing (gpointer data)
   unplaced = NULL;
   displays = NULL;
 
+  /* Sort the stack once here, rather than in every comparison */
+  if (copy != NULL)
+    {
+      MetaWindow *first_window = copy->data;
+
+      meta_stack_ensure_sorted (first_window->screen->stack);
+    }
+
   tmp = copy;
   while (tmp != NULL)
     {
@@ -1800,9 +1817,7 @@ idle_calc_showing (gpointer data)
   g_slist_free (should_hide);
   g_slist_free (displays);
 
-  destroying_windows_disallowed -= 1;
-
-  return FALSE;
+  return n_windows;
 }
 
 #ifdef WITH_VERBOSE_MODE
@@ -3655,12 +3670,17 @@ meta_window_move_resize_internal (MetaWindow          *window,
    * to the client.
    */
 
+  MetaBackend *backend = meta_get_backend ();
+  MetaMonitorManager *monitor_manager =
+    meta_backend_get_monitor_manager (backend);
   gboolean did_placement;
   guint old_output_winsys_id;
   MetaRectangle unconstrained_rect;
   MetaRectangle constrained_rect;
+  MetaRectangle new_frame_rect;
   MetaMoveResizeResultFlags result = 0;
   gboolean moved_or_resized = FALSE;
+  GList *l;
 
   g_return_if_fail (!window->override_redirect);
 
@@ -3750,6 +3770,14 @@ meta_window_move_resize_internal (MetaWindow          *window,
   if (moved_or_resized || did_placement)
     window->unconstrained_rect = unconstrained_rect;
 
+  /* The X11 implementation updates the frame rect even when it doesn't
+   * report a move or resize, so always resync the workspace indices;
+   * this is a no-op when nothing changed.
+   */
+  for (l = window->screen->workspaces; l != NULL; l = l->next)
+    meta_workspace_update_window (l->data, window);
+  meta_display_queue_edge_cache_update (window->display);
+
   if ((moved_or_resized ||
        did_placement ||
        (flags & META_MOVE_RESIZE_STATE_CHANGED) != 0) &&
@@ -3760,13 +3788,29 @@ meta_window_move_resize_internal (MetaWindow          *window,
                                             did_placement);
     }
 
-  old_output_winsys_id = window->monitor->winsys_id;
+  /* Clients ack and re-request the same geometry all the time; the main
+   * monitor only depends on the frame rect and the monitor setup, so
+   * only look it up again when one of those changed. Transients, such as
+   * Wayland popups, follow the monitor of their parent instead.
+   */
+  meta_window_get_frame_rect (window, &new_frame_rect);
+  if (window->transient_for != NULL ||
+      window->monitor_serial != monitor_manager->serial ||
+      !meta_rectangle_equal (&new_frame_rect, &window->monitor_frame_rect))
+    {
+      old_output_winsys_id = window->monitor->winsys_id;
 
-  meta_window_update_monitor (window, flags & META_MOVE_RESIZE_USER_ACTION);
+      meta_window_update_monitor (window,
+                                  flags & META_MOVE_RESIZE_USER_ACTION);
 
-  if (old_output_winsys_id != window->monitor->winsys_id &&
-      flags & META_MOVE_RESIZE_MOVE_ACTION && flags & META_MOVE_RESIZE_USER_ACTION)
-    window->preferred_output_winsys_id = window->monitor->winsys_id;
+      if (old_output_winsys_id != window->monitor->winsys_id &&
+          flags & META_MOVE_RESIZE_MOVE_ACTION &&
+          flags & META_MOVE_RESIZE_USER_ACTION)
+        window->preferred_output_winsys_id = window->monitor->winsys_id;
+
+      window->monitor_frame_rect = new_frame_rect;
+      window->monitor_serial = monitor_manager->serial;
+    }
 
   if ((result & META_MOVE_RESIZE_RESULT_FRAME_SHAPE_CHANGED) && window->frame_bounds)
     {
@@ -3936,12 +3980,12 @@ meta_window_move_resize_now (MetaWindow  *window)
                                  window->unconstrained_rect.height);
 }
 
-static gboolean
-idle_move_resize (gpointer data)
+static int
+process_move_resize_queue (void)
 {
   GSList *tmp;
   GSList *copy;
-  guint queue_index = GPOINTER_TO_INT (data);
+  int n_windows;
 
   meta_topic (META_DEBUG_GEOMETRY, "Clearing the move_resize queue\n");
 
@@ -3949,12 +3993,9 @@ idle_move_resize (gpointer data)
    * complete; destroying a window while we're in here would result in
    * badness. But it's OK to queue/unqueue move_resizes.
    */
-  copy = g_slist_copy (queue_pending[queue_index]);
-  g_slist_free (queue_pending[queue_index]);
-  queue_pending[queue_index] = NULL;
-  queue_later[queue_index] = 0;
-
-  destroying_windows_disallowed += 1;
+  copy = queue_pending[MOVE_RESIZE_QUEUE];
+  queue_pending[MOVE_RESIZE_QUEUE] = NULL;
+  n_windows = 0;
 
   tmp = copy;
   while (tmp != NULL)
@@ -3963,16 +4004,105 @@ idle_move_resize (gpointer data)
 
       window = tmp->data;
 
-      /* As a side effect, sets window->move_resize_queued = FALSE */
-      meta_window_move_resize_now (window);
+      /* The window may have been moved (and unqueued) as a side effect
+       * of moving another one, such as its transient parent, in which
+       * case there is nothing left to do.
+       */
+      if (window->is_in_queues & META_QUEUE_MOVE_RESIZE)
+        {
+          /* As a side effect, removes the window from the queue */
+          meta_window_move_resize_now (window);
+          n_windows++;
+        }
 
       tmp = tmp->next;
     }
 
   g_slist_free (copy);
 
+  return n_windows;
+}
+
+static gboolean
+idle_move_resize (gpointer data)
+{
+  queue_later[MOVE_RESIZE_QUEUE] = 0;
+
+  destroying_windows_disallowed += 1;
+  process_move_resize_queue ();
+  destroying_windows_disallowed -= 1;
+
+  return FALSE;
+}
+
+/* The move_resize queue is normally cleared earlier, in the RESIZE
+ * phase, but windows shown or hidden here may be moved again and the
+ * other way around. So keep processing both queues, move_resize first,
+ * until neither has anything left; that way all the windows are moved
+ * and shown or hidden before the stage is updated.
+ */
+static gboolean
+idle_calc_showing (gpointer data)
+{
+  gint64 move_resize_time = 0, calc_showing_time = 0;
+  int n_moved = 0, n_calc_showing = 0;
+  int pass;
+
+  queue_later[CALC_SHOWING_QUEUE] = 0;
+
+  destroying_windows_disallowed += 1;
+
+  for (pass = 0;
+       pass < MAX_WINDOW_QUEUE_PASSES &&
+       (queue_pending[MOVE_RESIZE_QUEUE] != NULL ||
+        queue_pending[CALC_SHOWING_QUEUE] != NULL);
+       pass++)
+    {
+      gint64 start_time;
+
+      if (queue_pending[MOVE_RESIZE_QUEUE] != NULL)
+        {
+          start_time = g_get_monotonic_time ();
+          n_moved += process_move_resize_queue ();
+          move_resize_time += g_get_monotonic_time () - start_time;
+        }
+
+      if (queue_pending[CALC_SHOWING_QUEUE] != NULL)
+        {
+          start_time = g_get_monotonic_time ();
+          n_calc_showing += process_calc_showing_queue ();
+          calc_showing_time += g_get_monotonic_time () - start_time;
+        }
+    }
+
   destroying_windows_disallowed -= 1;
 
+  meta_topic (META_DEBUG_WINDOW_STATE,
+              "Processed the window queues in %d passes: "
+              "move_resize %d windows in %" G_GINT64_FORMAT " us, "
+              "calc_showing %d windows in %" G_GINT64_FORMAT " us\n",
+              pass,
+              n_moved, move_resize_time,
+              n_calc_showing, calc_showing_time);
+
+  /* Windows queued while we were running added new laters; they are
+   * only needed for those queued again in the last pass, which wait
+   * for the next frame.
+   */
+  if (queue_pending[MOVE_RESIZE_QUEUE] == NULL &&
+      queue_later[MOVE_RESIZE_QUEUE] != 0)
+    {
+      meta_later_remove (queue_later[MOVE_RESIZE_QUEUE]);
+      queue_later[MOVE_RESIZE_QUEUE] = 0;
+    }
+
+  if (queue_pending[CALC_SHOWING_QUEUE] == NULL &&
+      queue_later[CALC_SHOWING_QUEUE] != 0)
+    {
+      meta_later_remove (queue_later[CALC_SHOWING_QUEUE]);
+      queue_later[CALC_SHOWING_QUEUE] = 0;
+    }
+
   return FALSE;
 }
 
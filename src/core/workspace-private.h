@@ -32,6 +32,7 @@
 #define META_WORKSPACE_PRIVATE_H
 
 #include <meta/workspace.h>
+#include "spatial-index.h"
 #include "window-private.h"
 
 struct _MetaWorkspace
@@ -41,6 +42,11 @@ struct _MetaWorkspace
 
   GList *windows;
 
+  /* Frame rectangles of the windows above, for placement and
+   * focus-under-pointer lookups.
+   */
+  MetaSpatialIndex *window_index;
+
   /* The "MRU list", or "most recently used" list, is a list of
    * MetaWindows ordered based on the time the the user interacted
    * with the window most recently.
@@ -78,6 +84,8 @@ void           meta_workspace_add_window    (MetaWorkspace *workspace,
                                              MetaWindow    *window);
 void           meta_workspace_remove_window (MetaWorkspace *workspace,
                                              MetaWindow    *window);
+void           meta_workspace_update_window (MetaWorkspace *workspace,
+                                             MetaWindow    *window);
 void           meta_workspace_relocate_windows (MetaWorkspace *workspace,
                                                 MetaWorkspace *new_home);
 
@@ -233,6 +233,7 @@ meta_workspace_new (MetaScreen *screen)
   workspace->screen->workspaces =
     g_list_append (workspace->screen->workspaces, workspace);
   workspace->windows = NULL;
+  workspace->window_index = meta_spatial_index_new ();
   workspace->mru_list = NULL;
 
   workspace->work_areas_invalid = TRUE;
@@ -325,10 +326,12 @@ meta_workspace_remove (MetaWorkspace *workspace)
   workspace->screen->workspaces =
     g_list_remove (workspace->screen->workspaces, workspace);
 
+  meta_display_cleanup_constraint_cache (workspace->screen->display);
   meta_workspace_clear_logical_monitor_data (workspace);
 
   g_list_free (workspace->mru_list);
   g_list_free (workspace->list_containing_self);
+  meta_spatial_index_free (workspace->window_index);
 
   workspace_free_builtin_struts (workspace);
 
@@ -358,10 +361,14 @@ void
 meta_workspace_add_window (MetaWorkspace *workspace,
                            MetaWindow    *window)
 {
+  MetaRectangle frame_rect;
+
   g_assert (g_list_find (workspace->mru_list, window) == NULL);
   workspace->mru_list = g_list_prepend (workspace->mru_list, window);
 
   workspace->windows = g_list_prepend (workspace->windows, window);
+  meta_window_get_frame_rect (window, &frame_rect);
+  meta_spatial_index_insert (workspace->window_index, window, &frame_rect);
 
   if (window->struts)
     {
@@ -380,6 +387,7 @@ meta_workspace_remove_window (MetaWorkspace *workspace,
                               MetaWindow    *window)
 {
   workspace->windows = g_list_remove (workspace->windows, window);
+  meta_spatial_index_remove (workspace->window_index, window);
 
   workspace->mru_list = g_list_remove (workspace->mru_list, window);
   g_assert (g_list_find (workspace->mru_list, window) == NULL);
@@ -396,6 +404,24 @@ meta_workspace_remove_window (MetaWorkspace *workspace,
   g_object_notify (G_OBJECT (workspace), "n-windows");
 }
 
+/**
+ * meta_workspace_update_window:
+ * @workspace: a #MetaWorkspace
+ * @window: a #MetaWindow
+ *
+ * Lets @workspace know that the frame rectangle of @window may have
+ * changed. Does nothing if @window is not on @workspace.
+ */
+void
+meta_workspace_update_window (MetaWorkspace *workspace,
+                              MetaWindow    *window)
+{
+  MetaRectangle frame_rect;
+
+  meta_window_get_frame_rect (window, &frame_rect);
+  meta_spatial_index_update (workspace->window_index, window, &frame_rect);
+}
+
 void
 meta_workspace_relocate_windows (MetaWorkspace *workspace,
                                  MetaWorkspace *new_home)
@@ -534,6 +560,7 @@ meta_workspace_activate_with_focus (MetaWorkspace *workspace,
   /* Free any cached pointers to the workspaces's edges from
    * a current resize or move operation */
   meta_display_cleanup_edges (workspace->screen->display);
+  meta_display_cleanup_constraint_cache (workspace->screen->display);
 
   if (workspace->screen->active_workspace)
     workspace_switch_sound (workspace->screen->active_workspace, workspace);
@@ -743,6 +770,10 @@ meta_workspace_invalidate_work_area (MetaWorkspace *workspace)
   if (workspace == workspace->screen->active_workspace)
     meta_display_cleanup_edges (workspace->screen->display);
 
+  /* The work area of a window being moved may depend on any of the
+   * workspaces it is on, not only the active one */
+  meta_display_cleanup_constraint_cache (workspace->screen->display);
+
   meta_workspace_clear_logical_monitor_data (workspace);
 
   workspace_free_all_struts (workspace);
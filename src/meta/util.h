@@ -70,6 +70,8 @@ void meta_fatal      (const char *format,
  * @META_DEBUG_SHAPES: shapes
  * @META_DEBUG_COMPOSITOR: compositor
  * @META_DEBUG_EDGE_RESISTANCE: edge resistance
+ * @META_DEBUG_DBUS: D-Bus
+ * @META_DEBUG_WAYLAND: Wayland
  */
 typedef enum
 {
@@ -96,7 +98,8 @@ typedef enum
   META_DEBUG_SHAPES          = 1 << 19,
   META_DEBUG_COMPOSITOR      = 1 << 20,
   META_DEBUG_EDGE_RESISTANCE = 1 << 21,
-  META_DEBUG_DBUS            = 1 << 22
+  META_DEBUG_DBUS            = 1 << 22,
+  META_DEBUG_WAYLAND         = 1 << 23
 } MetaDebugTopic;
 
 void meta_topic_real      (MetaDebugTopic topic,
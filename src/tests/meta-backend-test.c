@@ -26,10 +26,41 @@
 struct _MetaBackendTest
 {
   MetaBackendX11Nested parent;
+
+  struct xkb_keymap *keymap;
 };
 
 G_DEFINE_TYPE (MetaBackendTest, meta_backend_test, META_TYPE_BACKEND_X11_NESTED)
 
+/**
+ * meta_backend_test_set_keymap:
+ * @backend_test: a #MetaBackendTest
+ * @keymap: (nullable): the keymap to use, or %NULL for the X server's
+ *
+ * Overrides the keymap of the backend, as a layout change would.
+ */
+void
+meta_backend_test_set_keymap (MetaBackendTest   *backend_test,
+                              struct xkb_keymap *keymap)
+{
+  g_clear_pointer (&backend_test->keymap, xkb_keymap_unref);
+  if (keymap)
+    backend_test->keymap = xkb_keymap_ref (keymap);
+
+  g_signal_emit_by_name (backend_test, "keymap-changed");
+}
+
+static struct xkb_keymap *
+meta_backend_test_get_keymap (MetaBackend *backend)
+{
+  MetaBackendTest *backend_test = META_BACKEND_TEST (backend);
+
+  if (backend_test->keymap)
+    return backend_test->keymap;
+
+  return META_BACKEND_CLASS (meta_backend_test_parent_class)->get_keymap (backend);
+}
+
 static void
 meta_backend_test_init (MetaBackendTest *backend_test)
 {
@@ -47,4 +78,5 @@ meta_backend_test_class_init (MetaBackendTestClass *klass)
   MetaBackendClass *backend_class = META_BACKEND_CLASS (klass);
 
   backend_class->create_monitor_manager = meta_backend_test_create_monitor_manager;
+  backend_class->get_keymap = meta_backend_test_get_keymap;
 }
@@ -26,4 +26,7 @@
 G_DECLARE_FINAL_TYPE (MetaBackendTest, meta_backend_test,
                       META, BACKEND_TEST, MetaBackendX11Nested)
 
+void meta_backend_test_set_keymap (MetaBackendTest   *backend_test,
+                                   struct xkb_keymap *keymap);
+
 #endif /* META_BACKEND_TEST_H */
@@ -21,17 +21,26 @@
 
 #include <glib.h>
 #include <stdlib.h>
+#include <string.h>
+#include <X11/Xatom.h>
 
 #include <meta/main.h>
 #include <meta/util.h>
 
 #include "compositor/meta-plugin-manager.h"
 #include "core/boxes-private.h"
+#include "core/display-private.h"
+#include "core/edge-cache.h"
 #include "core/main-private.h"
+#include "core/screen-private.h"
+#include "core/spatial-index.h"
+#include "core/stack-tracker.h"
 #include "tests/meta-backend-test.h"
 #include "tests/monitor-unit-tests.h"
 #include "tests/monitor-store-unit-tests.h"
+#include "tests/wayland-unit-tests.h"
 #include "wayland/meta-wayland.h"
+#include "x11/iconcache.h"
 
 typedef struct _MetaTestLaterOrderCallbackData
 {
@@ -211,6 +220,1357 @@ meta_test_adjecent_to (void)
     g_assert (!meta_rectangle_is_adjecent_to (&base, &not_adjecent[i]));
 }
 
+#define SPATIAL_INDEX_TEST_ITEMS 500
+
+static void
+random_window_rect (GRand         *rand,
+                    MetaRectangle *rect)
+{
+  rect->x = g_rand_int_range (rand, -200, 5760);
+  rect->y = g_rand_int_range (rand, -200, 2160);
+  rect->width = g_rand_int_range (rand, 0, 1200);
+  rect->height = g_rand_int_range (rand, 0, 900);
+
+  /* Throw in some huge ones too */
+  if (g_rand_int_range (rand, 0, 50) == 0)
+    {
+      rect->width *= 100;
+      rect->height *= 100;
+    }
+}
+
+/* Windows of sensible sizes spread over six 1920x1080 monitors, the
+ * window set the scaling tests are run with
+ */
+static MetaRectangle *
+create_test_window_set (unsigned int n_windows)
+{
+  MetaRectangle *rects;
+  GRand *rand;
+  unsigned int i;
+
+  rand = g_rand_new_with_seed (n_windows);
+  rects = g_new (MetaRectangle, n_windows);
+
+  for (i = 0; i < n_windows; i++)
+    {
+      rects[i].x = g_rand_int_range (rand, 0, 5760 - 400);
+      rects[i].y = g_rand_int_range (rand, 0, 2160 - 300);
+      rects[i].width = g_rand_int_range (rand, 100, 400);
+      rects[i].height = g_rand_int_range (rand, 100, 300);
+    }
+
+  g_rand_free (rand);
+
+  return rects;
+}
+
+static gboolean
+collect_item (gpointer             item,
+              const MetaRectangle *rect,
+              gpointer             user_data)
+{
+  GHashTable *found = user_data;
+
+  g_assert (!g_hash_table_contains (found, item));
+  g_hash_table_add (found, item);
+
+  return FALSE;
+}
+
+static void
+check_spatial_index_query (MetaSpatialIndex    *index,
+                           MetaRectangle       *rects,
+                           gboolean            *present,
+                           const MetaRectangle *query)
+{
+  GHashTable *found;
+  unsigned int i;
+
+  found = g_hash_table_new (NULL, NULL);
+  meta_spatial_index_foreach_in_rect (index, query, collect_item, found);
+
+  for (i = 0; i < SPATIAL_INDEX_TEST_ITEMS; i++)
+    {
+      MetaRectangle overlap;
+      gboolean expected;
+
+      expected = (present[i] &&
+                  meta_rectangle_intersect (&rects[i], query, &overlap));
+
+      g_assert_cmpint (g_hash_table_contains (found, &rects[i]), ==, expected);
+    }
+
+  g_hash_table_destroy (found);
+}
+
+static void
+meta_test_spatial_index_query (void)
+{
+  MetaSpatialIndex *index;
+  MetaRectangle rects[SPATIAL_INDEX_TEST_ITEMS];
+  gboolean present[SPATIAL_INDEX_TEST_ITEMS] = { FALSE, };
+  GRand *rand;
+  unsigned int i, round;
+
+  rand = g_rand_new_with_seed (1);
+  index = meta_spatial_index_new ();
+
+  for (i = 0; i < SPATIAL_INDEX_TEST_ITEMS; i++)
+    {
+      random_window_rect (rand, &rects[i]);
+      meta_spatial_index_insert (index, &rects[i], &rects[i]);
+      present[i] = TRUE;
+    }
+
+  g_assert_cmpuint (meta_spatial_index_get_size (index), ==,
+                    SPATIAL_INDEX_TEST_ITEMS);
+
+  for (round = 0; round < 20; round++)
+    {
+      MetaRectangle query;
+
+      /* Move, remove and add back some of the items */
+      for (i = 0; i < SPATIAL_INDEX_TEST_ITEMS / 10; i++)
+        {
+          int n = g_rand_int_range (rand, 0, SPATIAL_INDEX_TEST_ITEMS);
+
+          if (present[n] && g_rand_boolean (rand))
+            {
+              meta_spatial_index_remove (index, &rects[n]);
+              present[n] = FALSE;
+            }
+          else
+            {
+              random_window_rect (rand, &rects[n]);
+              if (present[n])
+                meta_spatial_index_update (index, &rects[n], &rects[n]);
+              else
+                meta_spatial_index_insert (index, &rects[n], &rects[n]);
+              present[n] = TRUE;
+            }
+        }
+
+      for (i = 0; i < SPATIAL_INDEX_TEST_ITEMS; i++)
+        g_assert_cmpint (meta_spatial_index_contains (index, &rects[i]), ==,
+                         present[i]);
+
+      for (i = 0; i < 50; i++)
+        {
+          random_window_rect (rand, &query);
+          check_spatial_index_query (index, rects, present, &query);
+
+          query.width = query.height = 1;
+          check_spatial_index_query (index, rects, present, &query);
+        }
+    }
+
+  meta_spatial_index_free (index);
+  g_rand_free (rand);
+}
+
+static gboolean
+count_item (gpointer             item,
+            const MetaRectangle *rect,
+            gpointer             user_data)
+{
+  unsigned int *n_items = user_data;
+
+  *n_items += 1;
+
+  return FALSE;
+}
+
+static void
+meta_test_spatial_index_scaling (void)
+{
+  unsigned int n_windows;
+
+  if (!g_test_perf ())
+    return;
+
+  /* Compare finding the windows under a point, or overlapping a window
+   * sized rectangle, against going through every window.
+   */
+  for (n_windows = 100; n_windows <= 3200; n_windows *= 2)
+    {
+      MetaSpatialIndex *index;
+      MetaRectangle *rects;
+      GRand *rand;
+      double index_time, scan_time;
+      unsigned int i, j, n_queries = 10000;
+      unsigned int n_index_hits = 0, n_scan_hits = 0;
+
+      rand = g_rand_new_with_seed (0);
+      index = meta_spatial_index_new ();
+      rects = create_test_window_set (n_windows);
+
+      for (i = 0; i < n_windows; i++)
+        meta_spatial_index_insert (index, &rects[i], &rects[i]);
+
+      g_test_timer_start ();
+      for (i = 0; i < n_queries; i++)
+        {
+          MetaRectangle query = { g_rand_int_range (rand, 0, 5760),
+                                  g_rand_int_range (rand, 0, 2160),
+                                  1 + (i % 2) * 200, 1 + (i % 2) * 150 };
+
+          meta_spatial_index_foreach_in_rect (index, &query,
+                                              count_item, &n_index_hits);
+        }
+      index_time = g_test_timer_elapsed ();
+
+      g_rand_set_seed (rand, 0);
+      g_test_timer_start ();
+      for (i = 0; i < n_queries; i++)
+        {
+          MetaRectangle query = { g_rand_int_range (rand, 0, 5760),
+                                  g_rand_int_range (rand, 0, 2160),
+                                  1 + (i % 2) * 200, 1 + (i % 2) * 150 };
+
+          for (j = 0; j < n_windows; j++)
+            {
+              MetaRectangle overlap;
+
+              if (meta_rectangle_intersect (&rects[j], &query, &overlap))
+                n_scan_hits++;
+            }
+        }
+      scan_time = g_test_timer_elapsed ();
+
+      g_assert_cmpuint (n_index_hits, ==, n_scan_hits);
+
+      g_test_message ("%4u windows: index %.3f us/query, scan %.3f us/query",
+                      n_windows,
+                      index_time * G_USEC_PER_SEC / n_queries,
+                      scan_time * G_USEC_PER_SEC / n_queries);
+
+      g_free (rects);
+      meta_spatial_index_free (index);
+      g_rand_free (rand);
+    }
+}
+
+#define EDGE_CACHE_TEST_WINDOWS 60
+
+static const MetaRectangle edge_cache_test_screen = { 0, 0, 1920, 1080 };
+
+static void
+random_edge_cache_window (GRand               *rand,
+                          MetaEdgeCacheWindow *window)
+{
+  window->rect.x = g_rand_int_range (rand, -100, 1900);
+  window->rect.y = g_rand_int_range (rand, -100, 1060);
+  window->rect.width = g_rand_int_range (rand, 1, 800);
+  window->rect.height = g_rand_int_range (rand, 1, 600);
+
+  /* Line some of them up against each other */
+  if (g_rand_boolean (rand))
+    window->rect.x -= window->rect.x % 100;
+  if (g_rand_boolean (rand))
+    window->rect.width -= window->rect.width % 100 - 1;
+
+  window->has_edges = g_rand_int_range (rand, 0, 10) != 0;
+}
+
+static int
+compare_edges_exactly (gconstpointer a,
+                       gconstpointer b)
+{
+  const MetaEdge *a_edge = *(const MetaEdge * const *) a;
+  const MetaEdge *b_edge = *(const MetaEdge * const *) b;
+
+  if (a_edge->side_type != b_edge->side_type)
+    return a_edge->side_type - b_edge->side_type;
+  if (a_edge->edge_type != b_edge->edge_type)
+    return a_edge->edge_type - b_edge->edge_type;
+  if (a_edge->rect.x != b_edge->rect.x)
+    return a_edge->rect.x - b_edge->rect.x;
+  if (a_edge->rect.y != b_edge->rect.y)
+    return a_edge->rect.y - b_edge->rect.y;
+  if (a_edge->rect.width != b_edge->rect.width)
+    return a_edge->rect.width - b_edge->rect.width;
+
+  return a_edge->rect.height - b_edge->rect.height;
+}
+
+/* The edges of every window, clipped by every window above it, the way
+ * edge resistance used to compute them at the start of each grab.
+ */
+static GList *
+compute_edges_from_scratch (const MetaEdgeCacheWindow *windows,
+                            unsigned int               n_windows,
+                            gpointer                   excluded_window,
+                            const MetaRectangle       *screen_rect)
+{
+  GList *edges = NULL;
+  unsigned int i, j;
+
+  for (i = 0; i < n_windows; i++)
+    {
+      GList *window_edges = NULL;
+      GSList *above = NULL;
+      MetaRectangle reduced;
+      MetaEdge *edge;
+      int side;
+
+      if (!windows[i].has_edges || windows[i].window == excluded_window)
+        continue;
+
+      if (!meta_rectangle_intersect (&windows[i].rect, screen_rect, &reduced))
+        continue;
+
+      for (side = 0; side < 4; side++)
+        {
+          edge = g_new (MetaEdge, 1);
+          edge->rect = reduced;
+          edge->edge_type = META_EDGE_WINDOW;
+
+          switch (side)
+            {
+            case 0:
+              edge->rect.width = 0;
+              edge->side_type = META_SIDE_RIGHT;
+              break;
+            case 1:
+              edge->rect.x += edge->rect.width;
+              edge->rect.width = 0;
+              edge->side_type = META_SIDE_LEFT;
+              break;
+            case 2:
+              edge->rect.height = 0;
+              edge->side_type = META_SIDE_BOTTOM;
+              break;
+            case 3:
+              edge->rect.y += edge->rect.height;
+              edge->rect.height = 0;
+              edge->side_type = META_SIDE_TOP;
+              break;
+            }
+
+          window_edges = g_list_prepend (window_edges, edge);
+        }
+
+      for (j = n_windows; j > i + 1; j--)
+        {
+          if (windows[j - 1].window != excluded_window)
+            above = g_slist_prepend (above, (gpointer) &windows[j - 1].rect);
+        }
+
+      window_edges =
+        meta_rectangle_remove_intersections_with_boxes_from_edges (window_edges,
+                                                                   above);
+      g_slist_free (above);
+
+      edges = g_list_concat (window_edges, edges);
+    }
+
+  return edges;
+}
+
+static void
+check_sorted_edges (GArray *edges,
+                    GArray *expected_window_edges,
+                    GList  *static_edges,
+                    gboolean left_right)
+{
+  GArray *window_edges;
+  GList *l;
+  unsigned int i, n_static = 0;
+
+  for (i = 1; i < edges->len; i++)
+    g_assert_cmpint (meta_rectangle_edge_cmp_ignore_type (
+                       g_array_index (edges, MetaEdge *, i - 1),
+                       g_array_index (edges, MetaEdge *, i)), <=, 0);
+
+  window_edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  for (i = 0; i < edges->len; i++)
+    {
+      MetaEdge *edge = g_array_index (edges, MetaEdge *, i);
+
+      if (edge->edge_type == META_EDGE_WINDOW)
+        g_array_append_val (window_edges, edge);
+    }
+
+  for (l = static_edges; l != NULL; l = l->next)
+    {
+      MetaEdge *edge = l->data;
+
+      if ((edge->side_type == META_SIDE_LEFT ||
+           edge->side_type == META_SIDE_RIGHT) == left_right)
+        n_static++;
+    }
+  g_assert_cmpuint (edges->len, ==, window_edges->len + n_static);
+
+  g_array_sort (window_edges, compare_edges_exactly);
+  g_assert_cmpuint (window_edges->len, ==, expected_window_edges->len);
+  for (i = 0; i < window_edges->len; i++)
+    g_assert_cmpint (compare_edges_exactly (
+                       &g_array_index (window_edges, MetaEdge *, i),
+                       &g_array_index (expected_window_edges, MetaEdge *, i)),
+                     ==, 0);
+
+  g_array_free (window_edges, TRUE);
+}
+
+static void
+check_edge_cache (MetaEdgeCache             *cache,
+                  const MetaEdgeCacheWindow *windows,
+                  unsigned int               n_windows,
+                  gpointer                   excluded_window,
+                  GList                     *screen_edges)
+{
+  GArray *left_right_edges, *top_bottom_edges;
+  GArray *expected_left_right, *expected_top_bottom;
+  GList *owned_edges, *expected, *l;
+
+  left_right_edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  top_bottom_edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  meta_edge_cache_get_edges (cache, excluded_window, NULL, screen_edges,
+                             left_right_edges, top_bottom_edges,
+                             &owned_edges);
+
+  expected = compute_edges_from_scratch (windows, n_windows, excluded_window,
+                                         &edge_cache_test_screen);
+  expected_left_right = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  expected_top_bottom = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  for (l = expected; l != NULL; l = l->next)
+    {
+      MetaEdge *edge = l->data;
+
+      if (edge->side_type == META_SIDE_LEFT ||
+          edge->side_type == META_SIDE_RIGHT)
+        g_array_append_val (expected_left_right, edge);
+      else
+        g_array_append_val (expected_top_bottom, edge);
+    }
+  g_array_sort (expected_left_right, compare_edges_exactly);
+  g_array_sort (expected_top_bottom, compare_edges_exactly);
+
+  check_sorted_edges (left_right_edges, expected_left_right,
+                      screen_edges, TRUE);
+  check_sorted_edges (top_bottom_edges, expected_top_bottom,
+                      screen_edges, FALSE);
+
+  g_array_free (expected_top_bottom, TRUE);
+  g_array_free (expected_left_right, TRUE);
+  meta_rectangle_free_list_and_elements (expected);
+  meta_rectangle_free_list_and_elements (owned_edges);
+  g_array_free (top_bottom_edges, TRUE);
+  g_array_free (left_right_edges, TRUE);
+}
+
+static GList *
+get_test_screen_edges (void)
+{
+  GList *edges = NULL;
+  const MetaRectangle *screen = &edge_cache_test_screen;
+  int side;
+
+  for (side = 0; side < 4; side++)
+    {
+      MetaEdge *edge = g_new (MetaEdge, 1);
+
+      edge->rect = *screen;
+      edge->edge_type = META_EDGE_SCREEN;
+
+      switch (side)
+        {
+        case 0:
+          edge->rect.width = 0;
+          edge->side_type = META_SIDE_LEFT;
+          break;
+        case 1:
+          edge->rect.x += edge->rect.width;
+          edge->rect.width = 0;
+          edge->side_type = META_SIDE_RIGHT;
+          break;
+        case 2:
+          edge->rect.height = 0;
+          edge->side_type = META_SIDE_TOP;
+          break;
+        case 3:
+          edge->rect.y += edge->rect.height;
+          edge->rect.height = 0;
+          edge->side_type = META_SIDE_BOTTOM;
+          break;
+        }
+
+      edges = g_list_prepend (edges, edge);
+    }
+
+  return edges;
+}
+
+static void
+meta_test_edge_cache_incremental (void)
+{
+  MetaEdgeCache *cache;
+  MetaEdgeCacheWindow windows[EDGE_CACHE_TEST_WINDOWS];
+  int ids[EDGE_CACHE_TEST_WINDOWS];
+  unsigned int n_windows = EDGE_CACHE_TEST_WINDOWS;
+  GList *screen_edges;
+  GRand *rand;
+  unsigned int i, round;
+
+  rand = g_rand_new_with_seed (1);
+  cache = meta_edge_cache_new ();
+  screen_edges = get_test_screen_edges ();
+
+  for (i = 0; i < n_windows; i++)
+    {
+      windows[i].window = &ids[i];
+      random_edge_cache_window (rand, &windows[i]);
+    }
+
+  for (round = 0; round < 100; round++)
+    {
+      /* Move, restack, unmap and map some of the windows */
+      for (i = 0; i < 3; i++)
+        {
+          int n = g_rand_int_range (rand, 0, n_windows);
+          MetaEdgeCacheWindow tmp;
+
+          switch (g_rand_int_range (rand, 0, 4))
+            {
+            case 0:
+              random_edge_cache_window (rand, &windows[n]);
+              break;
+            case 1:
+              windows[n].rect.x += g_rand_int_range (rand, -50, 50);
+              windows[n].rect.height += g_rand_int_range (rand, 0, 50);
+              break;
+            case 2:
+              tmp = windows[n];
+              memmove (&windows[n], &windows[n + 1],
+                       (n_windows - n - 1) * sizeof (MetaEdgeCacheWindow));
+              windows[n_windows - 1] = tmp;
+              break;
+            case 3:
+              if (n_windows == EDGE_CACHE_TEST_WINDOWS ||
+                  (n_windows > EDGE_CACHE_TEST_WINDOWS / 2 &&
+                   g_rand_boolean (rand)))
+                {
+                  tmp = windows[n];
+                  windows[n] = windows[n_windows - 1];
+                  windows[n_windows - 1] = tmp;
+                  n_windows--;
+                }
+              else
+                {
+                  n_windows++;
+                }
+              break;
+            }
+        }
+
+      meta_edge_cache_update (cache, windows, n_windows,
+                              &edge_cache_test_screen);
+
+      check_edge_cache (cache, windows, n_windows, NULL, screen_edges);
+      for (i = 0; i < 5; i++)
+        {
+          gpointer excluded = windows[g_rand_int_range (rand, 0, n_windows)].window;
+
+          check_edge_cache (cache, windows, n_windows, excluded, screen_edges);
+        }
+    }
+
+  meta_rectangle_free_list_and_elements (screen_edges);
+  meta_edge_cache_free (cache);
+  g_rand_free (rand);
+}
+
+static GArray *
+get_sorted_edge_cache_edges (MetaEdgeCache  *cache,
+                             gpointer        excluded_window,
+                             GList         **owned_edges)
+{
+  GArray *edges, *top_bottom_edges;
+
+  edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  top_bottom_edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  meta_edge_cache_get_edges (cache, excluded_window, NULL, NULL,
+                             edges, top_bottom_edges,
+                             owned_edges);
+
+  g_array_append_vals (edges, top_bottom_edges->data, top_bottom_edges->len);
+  g_array_sort (edges, compare_edges_exactly);
+
+  g_array_free (top_bottom_edges, TRUE);
+
+  return edges;
+}
+
+static void
+check_edge_cache_matches_new (MetaEdgeCache             *cache,
+                              const MetaEdgeCacheWindow *windows,
+                              unsigned int               n_windows,
+                              const MetaRectangle       *screen,
+                              gpointer                   excluded_window)
+{
+  MetaEdgeCache *new_cache;
+  GArray *edges, *new_edges;
+  GList *owned_edges, *new_owned_edges;
+  unsigned int i;
+
+  new_cache = meta_edge_cache_new ();
+  meta_edge_cache_update (new_cache, windows, n_windows, screen);
+
+  edges = get_sorted_edge_cache_edges (cache, excluded_window,
+                                       &owned_edges);
+  new_edges = get_sorted_edge_cache_edges (new_cache, excluded_window,
+                                           &new_owned_edges);
+
+  g_assert_cmpuint (edges->len, ==, new_edges->len);
+  for (i = 0; i < edges->len; i++)
+    g_assert_cmpint (compare_edges_exactly (
+                       &g_array_index (edges, MetaEdge *, i),
+                       &g_array_index (new_edges, MetaEdge *, i)),
+                     ==, 0);
+
+  meta_rectangle_free_list_and_elements (new_owned_edges);
+  meta_rectangle_free_list_and_elements (owned_edges);
+  g_array_free (new_edges, TRUE);
+  g_array_free (edges, TRUE);
+  meta_edge_cache_free (new_cache);
+}
+
+static void
+meta_test_edge_cache_grab_latency (void)
+{
+  unsigned int n_windows;
+
+  if (!g_test_perf ())
+    return;
+
+  /* Compare starting a grab with the cache kept up to date while idle
+   * against computing all the edges when the grab starts.
+   */
+  for (n_windows = 100; n_windows <= 3200; n_windows *= 2)
+    {
+      MetaRectangle screen = { 0, 0, 5760, 2160 };
+      MetaEdgeCacheWindow *windows;
+      MetaEdgeCache *cache;
+      MetaRectangle *rects;
+      GArray *left_right_edges, *top_bottom_edges;
+      GList *owned_edges;
+      double rebuild_time, update_time, grab_time;
+      unsigned int i, n_grabs = 20;
+
+      rects = create_test_window_set (n_windows);
+      windows = g_new (MetaEdgeCacheWindow, n_windows);
+      left_right_edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+      top_bottom_edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+
+      for (i = 0; i < n_windows; i++)
+        {
+          windows[i].window = GUINT_TO_POINTER (i + 1);
+          windows[i].rect = rects[i];
+          windows[i].has_edges = TRUE;
+        }
+
+      g_test_timer_start ();
+      for (i = 0; i < n_grabs; i++)
+        {
+          cache = meta_edge_cache_new ();
+          meta_edge_cache_update (cache, windows, n_windows, &screen);
+          meta_edge_cache_get_edges (cache, windows[i].window, NULL, NULL,
+                                     left_right_edges, top_bottom_edges,
+                                     &owned_edges);
+          meta_rectangle_free_list_and_elements (owned_edges);
+          g_array_set_size (left_right_edges, 0);
+          g_array_set_size (top_bottom_edges, 0);
+          meta_edge_cache_free (cache);
+        }
+      rebuild_time = g_test_timer_elapsed ();
+
+      cache = meta_edge_cache_new ();
+      meta_edge_cache_update (cache, windows, n_windows, &screen);
+
+      update_time = grab_time = 0;
+      for (i = 0; i < n_grabs; i++)
+        {
+          /* The previous grab moved a window */
+          windows[i].rect.x += 10;
+
+          g_test_timer_start ();
+          meta_edge_cache_update (cache, windows, n_windows, &screen);
+          update_time += g_test_timer_elapsed ();
+
+          g_test_timer_start ();
+          meta_edge_cache_get_edges (cache, windows[i].window, NULL, NULL,
+                                     left_right_edges, top_bottom_edges,
+                                     &owned_edges);
+          grab_time += g_test_timer_elapsed ();
+
+          meta_rectangle_free_list_and_elements (owned_edges);
+          g_array_set_size (left_right_edges, 0);
+          g_array_set_size (top_bottom_edges, 0);
+        }
+
+      /* The cache kept up to date has the edges a new one would have */
+      check_edge_cache_matches_new (cache, windows, n_windows, &screen,
+                                    windows[0].window);
+
+      g_test_message ("%4u windows: grab start %.3f ms (idle update %.3f ms), "
+                      "from scratch %.3f ms",
+                      n_windows,
+                      grab_time * 1000 / n_grabs,
+                      update_time * 1000 / n_grabs,
+                      rebuild_time * 1000 / n_grabs);
+
+      meta_edge_cache_free (cache);
+      g_array_free (top_bottom_edges, TRUE);
+      g_array_free (left_right_edges, TRUE);
+      g_free (windows);
+      g_free (rects);
+    }
+}
+
+#define RESTACK_TEST_WINDOWS 300
+
+static int
+find_stack_position (GArray  *stack,
+                     guint64  window)
+{
+  unsigned int i;
+
+  for (i = 0; i < stack->len; i++)
+    {
+      if (g_array_index (stack, guint64, i) == window)
+        return i;
+    }
+
+  g_assert_not_reached ();
+  return -1;
+}
+
+/* Moves the windows the way meta_stack_tracker_restack_managed() does,
+ * returning the number of requests it would make.
+ */
+static int
+restack_windows (GArray        *stack,
+                 const guint64 *wanted,
+                 int            n_wanted)
+{
+  gboolean moved[RESTACK_TEST_WINDOWS];
+  guint64 top_window;
+  int n_moved, n_requests = 0, i;
+
+  n_moved = meta_stack_find_moved_windows ((guint64 *) stack->data,
+                                           stack->len,
+                                           wanted, n_wanted,
+                                           moved);
+
+  top_window = g_array_index (stack, guint64, stack->len - 1);
+
+  for (i = n_wanted - 1; i >= 0; i--)
+    {
+      int pos;
+
+      if (!moved[i])
+        continue;
+
+      g_array_remove_index (stack, find_stack_position (stack, wanted[i]));
+
+      if (i == n_wanted - 1)
+        pos = find_stack_position (stack, top_window) + 1;
+      else
+        pos = find_stack_position (stack, wanted[i + 1]);
+
+      g_array_insert_val (stack, pos, wanted[i]);
+      n_requests++;
+    }
+
+  g_assert_cmpint (n_requests, ==, n_moved);
+  g_assert_cmpint (memcmp (stack->data, wanted, n_wanted * sizeof (guint64)),
+                   ==, 0);
+
+  return n_requests;
+}
+
+static void
+meta_test_stack_minimal_restack (void)
+{
+  guint64 wanted[RESTACK_TEST_WINDOWS];
+  GArray *stack;
+  GRand *rand;
+  int i, round;
+
+  rand = g_rand_new_with_seed (1);
+  stack = g_array_new (FALSE, FALSE, sizeof (guint64));
+
+  for (i = 0; i < RESTACK_TEST_WINDOWS; i++)
+    {
+      wanted[i] = i + 1;
+      g_array_append_val (stack, wanted[i]);
+    }
+
+  g_assert_cmpint (restack_windows (stack, wanted, RESTACK_TEST_WINDOWS),
+                   ==, 0);
+
+  /* Raising, lowering or moving a single window takes one request,
+   * wherever it is in the stack.
+   */
+  for (round = 0; round < 100; round++)
+    {
+      int from = g_rand_int_range (rand, 0, RESTACK_TEST_WINDOWS);
+      int to;
+      guint64 window = wanted[from];
+
+      switch (round % 3)
+        {
+        case 0:
+          to = RESTACK_TEST_WINDOWS - 1;
+          break;
+        case 1:
+          to = 0;
+          break;
+        default:
+          to = g_rand_int_range (rand, 0, RESTACK_TEST_WINDOWS);
+          break;
+        }
+
+      if (from < to)
+        memmove (&wanted[from], &wanted[from + 1],
+                 (to - from) * sizeof (guint64));
+      else
+        memmove (&wanted[to + 1], &wanted[to],
+                 (from - to) * sizeof (guint64));
+      wanted[to] = window;
+
+      g_assert_cmpint (restack_windows (stack, wanted, RESTACK_TEST_WINDOWS),
+                       ==, from == to ? 0 : 1);
+    }
+
+  /* Several raises synced together take at most one request each */
+  for (round = 0; round < 20; round++)
+    {
+      int n_raises = g_rand_int_range (rand, 2, 10);
+
+      for (i = 0; i < n_raises; i++)
+        {
+          int from = g_rand_int_range (rand, 0, RESTACK_TEST_WINDOWS);
+          guint64 window = wanted[from];
+
+          memmove (&wanted[from], &wanted[from + 1],
+                   (RESTACK_TEST_WINDOWS - 1 - from) * sizeof (guint64));
+          wanted[RESTACK_TEST_WINDOWS - 1] = window;
+        }
+
+      g_assert_cmpint (restack_windows (stack, wanted, RESTACK_TEST_WINDOWS),
+                       <=, n_raises);
+    }
+
+  /* Reversing the stack needs all windows but one to move */
+  for (i = 0; i < RESTACK_TEST_WINDOWS; i++)
+    wanted[i] = i + 1;
+  restack_windows (stack, wanted, RESTACK_TEST_WINDOWS);
+
+  for (i = 0; i < RESTACK_TEST_WINDOWS; i++)
+    wanted[i] = RESTACK_TEST_WINDOWS - i;
+  g_assert_cmpint (restack_windows (stack, wanted, RESTACK_TEST_WINDOWS),
+                   ==, RESTACK_TEST_WINDOWS - 1);
+
+  g_array_free (stack, TRUE);
+  g_rand_free (rand);
+}
+
+#define STACK_REPLAY_FIRST_XID 0x1f000000
+
+typedef struct
+{
+  MetaStackTracker *tracker;
+  gulong serial;
+
+  /* The stack as a naive array, to check the tracker against */
+  GArray *expected;
+
+  /* Fake XIDs of the windows created by the replay */
+  GArray *windows;
+  Window next_xid;
+} StackReplay;
+
+static void
+stack_replay_init (StackReplay *replay)
+{
+  MetaDisplay *display = meta_get_display ();
+  guint64 *windows;
+  int n_windows;
+
+  replay->tracker = meta_stack_tracker_new (display->screen);
+  replay->serial = XNextRequest (display->xdisplay);
+
+  meta_stack_tracker_get_stack (replay->tracker, &windows, &n_windows);
+  replay->expected = g_array_new (FALSE, FALSE, sizeof (guint64));
+  g_array_append_vals (replay->expected, windows, n_windows);
+
+  replay->windows = g_array_new (FALSE, FALSE, sizeof (guint64));
+  replay->next_xid = STACK_REPLAY_FIRST_XID;
+}
+
+static void
+stack_replay_clear (StackReplay *replay)
+{
+  meta_stack_tracker_free (replay->tracker);
+  g_array_free (replay->expected, TRUE);
+  g_array_free (replay->windows, TRUE);
+}
+
+static void
+stack_replay_create (StackReplay *replay,
+                     gboolean     check)
+{
+  XCreateWindowEvent event = { 0 };
+  guint64 window = replay->next_xid++;
+
+  event.type = CreateNotify;
+  event.serial = replay->serial++;
+  event.window = window;
+  meta_stack_tracker_create_event (replay->tracker, &event);
+
+  g_array_append_val (replay->windows, window);
+  if (check)
+    g_array_append_val (replay->expected, window);
+}
+
+static void
+stack_replay_destroy (StackReplay *replay,
+                      int          index,
+                      gboolean     check)
+{
+  XDestroyWindowEvent event = { 0 };
+  guint64 window = g_array_index (replay->windows, guint64, index);
+
+  event.type = DestroyNotify;
+  event.serial = replay->serial++;
+  event.window = window;
+  meta_stack_tracker_destroy_event (replay->tracker, &event);
+
+  g_array_remove_index_fast (replay->windows, index);
+  if (check)
+    g_array_remove_index (replay->expected,
+                          find_stack_position (replay->expected, window));
+}
+
+static void
+stack_replay_configure (StackReplay *replay,
+                        int          index,
+                        guint64      sibling,
+                        gboolean     check)
+{
+  XConfigureEvent event = { 0 };
+  guint64 window = g_array_index (replay->windows, guint64, index);
+
+  if (window == sibling)
+    return;
+
+  event.type = ConfigureNotify;
+  event.serial = replay->serial++;
+  event.window = window;
+  event.above = sibling;
+  meta_stack_tracker_configure_event (replay->tracker, &event);
+
+  if (check)
+    {
+      int pos = 0;
+
+      g_array_remove_index (replay->expected,
+                            find_stack_position (replay->expected, window));
+      if (sibling)
+        pos = find_stack_position (replay->expected, sibling) + 1;
+      g_array_insert_val (replay->expected, pos, window);
+    }
+}
+
+/* Replays a stream of stacking events like the ones a busy client with
+ * lots of override-redirect windows produces: mostly ConfigureNotify
+ * events raising windows or restacking them, with windows created and
+ * destroyed now and then.
+ */
+static void
+stack_replay_run (StackReplay *replay,
+                  GRand       *rand,
+                  int          n_events,
+                  gboolean     check)
+{
+  int i;
+
+  for (i = 0; i < n_events; i++)
+    {
+      int n_windows = replay->windows->len;
+      int action = g_rand_int_range (rand, 0, 20);
+
+      if (action == 0 || n_windows < 2)
+        {
+          stack_replay_create (replay, check);
+        }
+      else if (action == 1)
+        {
+          stack_replay_destroy (replay,
+                                g_rand_int_range (rand, 0, n_windows),
+                                check);
+        }
+      else
+        {
+          int index = g_rand_int_range (rand, 0, n_windows);
+          guint64 sibling;
+
+          if (action < 12)
+            {
+              guint64 *windows;
+              int n_stack;
+
+              meta_stack_tracker_get_stack (replay->tracker, &windows, &n_stack);
+              sibling = windows[n_stack - 1];
+            }
+          else if (action < 19)
+            {
+              sibling = g_array_index (replay->windows, guint64,
+                                       g_rand_int_range (rand, 0, n_windows));
+            }
+          else
+            {
+              sibling = 0;
+            }
+
+          stack_replay_configure (replay, index, sibling, check);
+        }
+    }
+}
+
+static void
+stack_replay_check (StackReplay *replay)
+{
+  guint64 *windows;
+  int n_windows;
+
+  meta_stack_tracker_get_stack (replay->tracker, &windows, &n_windows);
+
+  g_assert_cmpint (n_windows, ==, replay->expected->len);
+  g_assert_cmpint (memcmp (windows, replay->expected->data,
+                           n_windows * sizeof (guint64)), ==, 0);
+}
+
+static void
+meta_test_stack_tracker_replay (void)
+{
+  StackReplay replay;
+  GRand *rand;
+  int i, round;
+
+  rand = g_rand_new_with_seed (1);
+  stack_replay_init (&replay);
+
+  for (round = 0; round < 50; round++)
+    {
+      stack_replay_run (&replay, rand, 100, TRUE);
+      stack_replay_check (&replay);
+    }
+
+  /* The stacks are indexed for the case with lots of windows */
+  for (i = 0; i < 1000; i++)
+    stack_replay_create (&replay, TRUE);
+  stack_replay_check (&replay);
+
+  for (round = 0; round < 10; round++)
+    {
+      stack_replay_run (&replay, rand, 500, TRUE);
+      stack_replay_check (&replay);
+    }
+
+  stack_replay_clear (&replay);
+  g_rand_free (rand);
+}
+
+static void
+meta_test_stack_tracker_replay_scaling (void)
+{
+  int n_windows;
+
+  if (!g_test_perf ())
+    return;
+
+  /* With the stacks indexed, the time per event should not grow much
+   * with the number of windows.
+   */
+  for (n_windows = 250; n_windows <= 4000; n_windows *= 2)
+    {
+      StackReplay replay;
+      GRand *rand;
+      int i, n_events = 20000;
+      double elapsed;
+
+      rand = g_rand_new_with_seed (n_windows);
+      stack_replay_init (&replay);
+
+      for (i = 0; i < n_windows; i++)
+        stack_replay_create (&replay, FALSE);
+
+      g_test_timer_start ();
+      stack_replay_run (&replay, rand, n_events, FALSE);
+      elapsed = g_test_timer_elapsed ();
+
+      g_test_message ("%d windows: %.3f us per stacking event",
+                      n_windows, elapsed * 1e6 / n_events);
+
+      stack_replay_clear (&replay);
+      g_rand_free (rand);
+    }
+}
+
+static gboolean
+keycode_has_keysym (struct xkb_keymap *keymap,
+                    xkb_keycode_t      keycode,
+                    xkb_keysym_t       keysym)
+{
+  xkb_layout_index_t layout;
+  xkb_level_index_t level;
+
+  for (layout = 0; layout < xkb_keymap_num_layouts_for_key (keymap, keycode); layout++)
+    for (level = 0; level < xkb_keymap_num_levels_for_key (keymap, keycode, layout); level++)
+      {
+        const xkb_keysym_t *syms;
+        int num_syms, i;
+
+        num_syms = xkb_keymap_key_get_syms_by_level (keymap, keycode,
+                                                     layout, level, &syms);
+        for (i = 0; i < num_syms; i++)
+          if (syms[i] == keysym)
+            return TRUE;
+      }
+
+  return FALSE;
+}
+
+static void
+meta_test_keybindings_keymap_reload (void)
+{
+  MetaDisplay *display = meta_get_display ();
+  MetaBackend *backend = meta_get_backend ();
+  MetaKeyBindingManager *keys = &display->key_binding_manager;
+  struct xkb_keymap *keymap = meta_backend_get_keymap (backend);
+  struct xkb_rule_names names = { .layout = "de" };
+  struct xkb_context *context;
+  struct xkb_keymap *new_keymap;
+  GHashTable *resolved, *index;
+  GHashTableIter iter;
+  gpointer key, value;
+
+  /* Every resolved keycode must produce the keysym of its binding */
+  resolved = g_hash_table_new_full (NULL, NULL, NULL,
+                                    (GDestroyNotify) g_array_unref);
+  g_hash_table_iter_init (&iter, keys->key_bindings);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      MetaKeyBinding *binding = key;
+      GArray *keycodes;
+      int i;
+
+      if (binding->combo.keysym == 0 ||
+          binding->combo.keysym == META_KEY_ABOVE_TAB)
+        continue;
+
+      for (i = 0; i < binding->resolved_combo.len; i++)
+        g_assert (keycode_has_keysym (keymap,
+                                      binding->resolved_combo.keycodes[i],
+                                      binding->combo.keysym));
+
+      keycodes = g_array_new (FALSE, FALSE, sizeof (xkb_keycode_t));
+      g_array_append_vals (keycodes, binding->resolved_combo.keycodes,
+                           binding->resolved_combo.len);
+      g_hash_table_insert (resolved, binding, keycodes);
+    }
+
+  /* Reloading the same keymap resolves to the same keycodes, in the
+   * same order */
+  g_clear_pointer (&keys->keysym_index, g_hash_table_destroy);
+  g_signal_emit_by_name (backend, "keymap-changed");
+
+  g_hash_table_iter_init (&iter, resolved);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      MetaKeyBinding *binding = key;
+      GArray *keycodes = value;
+
+      g_assert_cmpint (binding->resolved_combo.len, ==, keycodes->len);
+      if (keycodes->len > 0)
+        g_assert_cmpint (memcmp (binding->resolved_combo.keycodes,
+                                 keycodes->data,
+                                 keycodes->len * sizeof (xkb_keycode_t)), ==, 0);
+    }
+
+  g_hash_table_destroy (resolved);
+
+  /* The keysym index is kept for the same keymap, and rebuilt for a new
+   * one, such as on a layout switch */
+  g_assert (keys->keysym_index_keymap == keymap);
+  index = keys->keysym_index;
+  g_signal_emit_by_name (backend, "keymap-changed");
+  g_assert (keys->keysym_index == index);
+
+  context = xkb_context_new (XKB_CONTEXT_NO_FLAGS);
+  new_keymap = xkb_keymap_new_from_names (context, &names,
+                                          XKB_KEYMAP_COMPILE_NO_FLAGS);
+  g_assert (new_keymap);
+
+  meta_backend_test_set_keymap (META_BACKEND_TEST (backend), new_keymap);
+  g_assert (keys->keysym_index_keymap == new_keymap);
+
+  meta_backend_test_set_keymap (META_BACKEND_TEST (backend), NULL);
+  g_assert (keys->keysym_index_keymap == keymap);
+
+  xkb_keymap_unref (new_keymap);
+  xkb_context_unref (context);
+}
+
+static void
+meta_test_keybindings_keymap_reload_time (void)
+{
+  MetaDisplay *display = meta_get_display ();
+  MetaBackend *backend = meta_get_backend ();
+  MetaKeyBindingManager *keys = &display->key_binding_manager;
+  struct xkb_rule_names names = { .layout = "de" };
+  struct xkb_context *context;
+  struct xkb_keymap *new_keymap;
+  int i, n_reloads = 100;
+  double elapsed;
+
+  if (!g_test_perf ())
+    return;
+
+  context = xkb_context_new (XKB_CONTEXT_NO_FLAGS);
+  new_keymap = xkb_keymap_new_from_names (context, &names,
+                                          XKB_KEYMAP_COMPILE_NO_FLAGS);
+  g_assert (new_keymap);
+
+  /* Switch back and forth between two layouts, each switch bringing a
+   * new keymap, so the keysym index is rebuilt every time */
+  g_test_timer_start ();
+  for (i = 0; i < n_reloads; i++)
+    meta_backend_test_set_keymap (META_BACKEND_TEST (backend),
+                                  i % 2 == 0 ? new_keymap : NULL);
+  elapsed = g_test_timer_elapsed ();
+
+  meta_backend_test_set_keymap (META_BACKEND_TEST (backend), NULL);
+
+  g_test_message ("%u bindings: %.3f ms per layout switch",
+                  g_hash_table_size (keys->key_bindings),
+                  elapsed * 1e3 / n_reloads);
+
+  xkb_keymap_unref (new_keymap);
+  xkb_context_unref (context);
+}
+
+static void
+append_test_icon (GArray *items,
+                  int     size,
+                  guint32 base)
+{
+  gulong item;
+  int i;
+
+  item = size;
+  g_array_append_val (items, item);
+  g_array_append_val (items, item);
+
+  for (i = 0; i < size * size; i++)
+    {
+      item = 0xff000000 | base | i;
+      g_array_append_val (items, item);
+    }
+}
+
+static gboolean
+read_test_icons (MetaDisplay      *display,
+                 Window            xwindow,
+                 GArray           *items,
+                 MetaIconCache    *icon_cache,
+                 cairo_surface_t **icon,
+                 cairo_surface_t **mini_icon)
+{
+  XChangeProperty (display->xdisplay, xwindow,
+                   display->atom__NET_WM_ICON,
+                   XA_CARDINAL, 32, PropModeReplace,
+                   (guchar *) items->data, items->len);
+  meta_icon_cache_property_changed (icon_cache, display,
+                                    display->atom__NET_WM_ICON);
+
+  return meta_read_icons (display->screen, xwindow, icon_cache,
+                          None, None,
+                          icon, 48, 48,
+                          mini_icon, 16, 16);
+}
+
+static guint32
+get_icon_pixel (cairo_surface_t *surface,
+                int              x,
+                int              y)
+{
+  uint32_t *data = (uint32_t *) cairo_image_surface_get_data (surface);
+  int stride = cairo_image_surface_get_stride (surface) / sizeof (uint32_t);
+
+  return data[y * stride + x];
+}
+
+static void
+meta_test_iconcache_net_wm_icon (void)
+{
+  MetaDisplay *display = meta_get_display ();
+  MetaIconCache icon_cache;
+  cairo_surface_t *icon, *mini_icon;
+  GArray *items;
+  gulong *pixels;
+  Window xwindow;
+
+  xwindow = XCreateSimpleWindow (display->xdisplay,
+                                 display->screen->xroot,
+                                 0, 0, 1, 1, 0, 0, 0);
+  meta_icon_cache_init (&icon_cache);
+
+  /* The large image first puts the ones we use past the part of the
+   * property that is fetched up front.
+   */
+  items = g_array_new (FALSE, FALSE, sizeof (gulong));
+  append_test_icon (items, 130, 0x300000);
+  append_test_icon (items, 48, 0x200000);
+  append_test_icon (items, 16, 0x100000);
+
+  g_assert (read_test_icons (display, xwindow, items, &icon_cache,
+                             &icon, &mini_icon));
+  g_assert_cmpint (cairo_image_surface_get_width (icon), ==, 48);
+  g_assert_cmpint (cairo_image_surface_get_width (mini_icon), ==, 16);
+  g_assert_cmphex (get_icon_pixel (icon, 1, 1), ==, 0xff200000 | 49);
+  g_assert_cmphex (get_icon_pixel (mini_icon, 1, 1), ==, 0xff100000 | 17);
+  cairo_surface_destroy (icon);
+  cairo_surface_destroy (mini_icon);
+
+  /* Setting the same icon again is not a change */
+  g_assert (!read_test_icons (display, xwindow, items, &icon_cache,
+                              &icon, &mini_icon));
+  g_assert_null (icon);
+  g_assert_null (mini_icon);
+
+  /* Changing two pixels in a way that keeps the content hash the same is
+   * still seen as a change.
+   */
+  pixels = &g_array_index (items, gulong, 130 * 130 + 2 + 2);
+  pixels[0] += 1;
+  pixels[1] -= 33;
+
+  g_assert (read_test_icons (display, xwindow, items, &icon_cache,
+                             &icon, &mini_icon));
+  g_assert_cmphex (get_icon_pixel (icon, 0, 0), ==, (guint32) pixels[0]);
+  g_assert_cmphex (get_icon_pixel (icon, 1, 0), ==, (guint32) pixels[1]);
+  cairo_surface_destroy (icon);
+  cairo_surface_destroy (mini_icon);
+
+  meta_icon_cache_free (&icon_cache);
+  g_array_free (items, TRUE);
+  XDestroyWindow (display->xdisplay, xwindow);
+}
+
 static gboolean
 run_tests (gpointer data)
 {
@@ -248,9 +1608,30 @@ init_tests (int argc, char **argv)
                    meta_test_util_later_schedule_from_later);
 
   g_test_add_func ("/core/boxes/adjecent-to", meta_test_adjecent_to);
+  g_test_add_func ("/core/spatial-index/query", meta_test_spatial_index_query);
+  g_test_add_func ("/core/spatial-index/scaling",
+                   meta_test_spatial_index_scaling);
+  g_test_add_func ("/core/edge-cache/incremental",
+                   meta_test_edge_cache_incremental);
+  g_test_add_func ("/core/edge-cache/grab-latency",
+                   meta_test_edge_cache_grab_latency);
+  g_test_add_func ("/core/stack/minimal-restack",
+                   meta_test_stack_minimal_restack);
+  g_test_add_func ("/core/stack-tracker/replay",
+                   meta_test_stack_tracker_replay);
+  g_test_add_func ("/core/stack-tracker/replay-scaling",
+                   meta_test_stack_tracker_replay_scaling);
+  g_test_add_func ("/core/keybindings/keymap-reload",
+                   meta_test_keybindings_keymap_reload);
+  g_test_add_func ("/core/keybindings/keymap-reload-time",
+                   meta_test_keybindings_keymap_reload_time);
+
+  g_test_add_func ("/x11/iconcache/net-wm-icon",
+                   meta_test_iconcache_net_wm_icon);
 
   init_monitor_store_tests ();
   init_monitor_tests ();
+  init_wayland_tests ();
 }
 
 int
@@ -0,0 +1,967 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "tests/wayland-unit-tests.h"
+
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+#include <meta/window.h>
+
+#include "backends/meta-backend-private.h"
+#include "compositor/meta-surface-actor.h"
+#include "core/display-private.h"
+#include "core/window-private.h"
+#include "tests/meta-backend-test.h"
+#include "wayland/meta-wayland.h"
+#include "wayland/meta-wayland-private.h"
+#include "wayland/meta-wayland-surface.h"
+
+#define TEST_CLIENT_TITLE "frame-callback-test"
+#define TEST_CLIENT_SIZE 64
+
+/* See meta-surface-actor-wayland.c */
+#define HIDDEN_FRAME_CALLBACK_INTERVAL_MS 100
+
+/* A minimal Wayland client, running in the same main loop as the
+ * compositor, that draws a new frame whenever it gets a frame callback.
+ */
+typedef struct _TestClient
+{
+  struct wl_display *display;
+  struct wl_registry *registry;
+  struct wl_compositor *compositor;
+  struct wl_shm *shm;
+  struct wl_shell *shell;
+  struct wl_subcompositor *subcompositor;
+  struct wl_seat *seat;
+
+  struct wl_surface *surface;
+  struct wl_shell_surface *shell_surface;
+  struct wl_buffer *buffer;
+
+  /* Set before test_client_init() for anything but the main test client */
+  const char *title;
+  gboolean opaque;
+
+  int n_frame_callbacks;
+  uint32_t last_frame_time;
+} TestClient;
+
+static void
+handle_registry_global (void               *data,
+                        struct wl_registry *registry,
+                        uint32_t            id,
+                        const char         *interface,
+                        uint32_t            version)
+{
+  TestClient *client = data;
+
+  if (strcmp (interface, "wl_compositor") == 0)
+    client->compositor = wl_registry_bind (registry, id,
+                                           &wl_compositor_interface, 1);
+  else if (strcmp (interface, "wl_shm") == 0)
+    client->shm = wl_registry_bind (registry, id, &wl_shm_interface, 1);
+  else if (strcmp (interface, "wl_shell") == 0)
+    client->shell = wl_registry_bind (registry, id, &wl_shell_interface, 1);
+  else if (strcmp (interface, "wl_subcompositor") == 0)
+    client->subcompositor = wl_registry_bind (registry, id,
+                                              &wl_subcompositor_interface, 1);
+  else if (strcmp (interface, "wl_seat") == 0)
+    client->seat = wl_registry_bind (registry, id, &wl_seat_interface, 1);
+}
+
+static void
+handle_registry_global_remove (void               *data,
+                               struct wl_registry *registry,
+                               uint32_t            name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+  handle_registry_global,
+  handle_registry_global_remove
+};
+
+static void
+handle_shell_surface_ping (void                    *data,
+                           struct wl_shell_surface *shell_surface,
+                           uint32_t                 serial)
+{
+  wl_shell_surface_pong (shell_surface, serial);
+}
+
+static void
+handle_shell_surface_configure (void                    *data,
+                                struct wl_shell_surface *shell_surface,
+                                uint32_t                 edges,
+                                int32_t                  width,
+                                int32_t                  height)
+{
+}
+
+static void
+handle_shell_surface_popup_done (void                    *data,
+                                 struct wl_shell_surface *shell_surface)
+{
+}
+
+static const struct wl_shell_surface_listener shell_surface_listener = {
+  handle_shell_surface_ping,
+  handle_shell_surface_configure,
+  handle_shell_surface_popup_done
+};
+
+/* Lets the compositor run for one main loop iteration and dispatches
+ * whatever the client got back, without ever blocking on either side.
+ */
+static void
+test_client_dispatch (TestClient *client)
+{
+  struct pollfd pollfd;
+
+  wl_display_flush (client->display);
+
+  if (!g_main_context_iteration (NULL, FALSE))
+    g_usleep (1000);
+
+  while (wl_display_prepare_read (client->display) != 0)
+    wl_display_dispatch_pending (client->display);
+
+  pollfd = (struct pollfd) {
+    .fd = wl_display_get_fd (client->display),
+    .events = POLLIN,
+  };
+  if (poll (&pollfd, 1, 0) > 0)
+    wl_display_read_events (client->display);
+  else
+    wl_display_cancel_read (client->display);
+
+  wl_display_dispatch_pending (client->display);
+}
+
+static void
+handle_sync_done (void               *data,
+                  struct wl_callback *callback,
+                  uint32_t            time)
+{
+  gboolean *done = data;
+
+  *done = TRUE;
+  wl_callback_destroy (callback);
+}
+
+static const struct wl_callback_listener sync_listener = {
+  handle_sync_done
+};
+
+static void
+test_client_sync (TestClient *client)
+{
+  struct wl_callback *callback;
+  gboolean done = FALSE;
+
+  callback = wl_display_sync (client->display);
+  wl_callback_add_listener (callback, &sync_listener, &done);
+
+  while (!done)
+    test_client_dispatch (client);
+}
+
+static struct wl_buffer *
+create_shm_buffer (TestClient *client,
+                   int         width,
+                   int         height)
+{
+  struct wl_shm_pool *pool;
+  struct wl_buffer *buffer;
+  int stride = width * 4;
+  int size = stride * height;
+  char *path;
+  void *data;
+  int fd;
+
+  fd = g_file_open_tmp ("mutter-test-shm-XXXXXX", &path, NULL);
+  g_assert_cmpint (fd, >=, 0);
+  unlink (path);
+  g_free (path);
+
+  g_assert_cmpint (ftruncate (fd, size), ==, 0);
+  data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  g_assert (data != MAP_FAILED);
+  memset (data, 0xff, size);
+  munmap (data, size);
+
+  pool = wl_shm_create_pool (client->shm, fd, size);
+  buffer = wl_shm_pool_create_buffer (pool, 0, width, height, stride,
+                                      WL_SHM_FORMAT_XRGB8888);
+  wl_shm_pool_destroy (pool);
+  close (fd);
+
+  return buffer;
+}
+
+static void test_client_draw (TestClient *client);
+
+static void
+handle_frame_done (void               *data,
+                   struct wl_callback *callback,
+                   uint32_t            time)
+{
+  TestClient *client = data;
+
+  wl_callback_destroy (callback);
+  client->n_frame_callbacks++;
+  client->last_frame_time = time;
+
+  test_client_draw (client);
+}
+
+static const struct wl_callback_listener frame_listener = {
+  handle_frame_done
+};
+
+static void
+test_client_draw (TestClient *client)
+{
+  struct wl_callback *callback;
+
+  wl_surface_attach (client->surface, client->buffer, 0, 0);
+  wl_surface_damage (client->surface, 0, 0,
+                     TEST_CLIENT_SIZE, TEST_CLIENT_SIZE);
+  callback = wl_surface_frame (client->surface);
+  wl_callback_add_listener (callback, &frame_listener, client);
+  wl_surface_commit (client->surface);
+}
+
+static void
+test_client_init (TestClient *client)
+{
+  MetaWaylandCompositor *compositor = meta_wayland_compositor_get_default ();
+
+  client->display =
+    wl_display_connect (meta_wayland_get_wayland_display_name (compositor));
+  g_assert (client->display);
+
+  client->registry = wl_display_get_registry (client->display);
+  wl_registry_add_listener (client->registry, &registry_listener, client);
+  test_client_sync (client);
+
+  g_assert (client->compositor && client->shm && client->shell &&
+            client->subcompositor);
+
+  client->surface = wl_compositor_create_surface (client->compositor);
+  client->shell_surface = wl_shell_get_shell_surface (client->shell,
+                                                      client->surface);
+  wl_shell_surface_add_listener (client->shell_surface,
+                                 &shell_surface_listener, client);
+  wl_shell_surface_set_toplevel (client->shell_surface);
+  wl_shell_surface_set_title (client->shell_surface,
+                              client->title ? client->title
+                                            : TEST_CLIENT_TITLE);
+  client->buffer = create_shm_buffer (client,
+                                      TEST_CLIENT_SIZE, TEST_CLIENT_SIZE);
+
+  if (client->opaque)
+    {
+      struct wl_region *region;
+
+      region = wl_compositor_create_region (client->compositor);
+      wl_region_add (region, 0, 0, TEST_CLIENT_SIZE, TEST_CLIENT_SIZE);
+      wl_surface_set_opaque_region (client->surface, region);
+      wl_region_destroy (region);
+    }
+
+  test_client_draw (client);
+  test_client_sync (client);
+}
+
+static void
+test_client_finish (TestClient *client)
+{
+  wl_buffer_destroy (client->buffer);
+  wl_shell_surface_destroy (client->shell_surface);
+  wl_surface_destroy (client->surface);
+  wl_shell_destroy (client->shell);
+  wl_subcompositor_destroy (client->subcompositor);
+  if (client->seat)
+    wl_seat_destroy (client->seat);
+  wl_shm_destroy (client->shm);
+  wl_compositor_destroy (client->compositor);
+  wl_registry_destroy (client->registry);
+  test_client_sync (client);
+
+  wl_display_disconnect (client->display);
+}
+
+static MetaWindow *
+find_window_by_title (const char *title)
+{
+  MetaDisplay *display = meta_get_display ();
+  MetaWindow *found = NULL;
+  GSList *windows, *l;
+
+  windows = meta_display_list_windows (display, META_LIST_DEFAULT);
+  for (l = windows; l; l = l->next)
+    {
+      MetaWindow *window = l->data;
+
+      if (g_strcmp0 (meta_window_get_title (window), title) == 0)
+        found = window;
+    }
+  g_slist_free (windows);
+
+  return found;
+}
+
+static MetaWindow *
+find_test_client_window (void)
+{
+  return find_window_by_title (TEST_CLIENT_TITLE);
+}
+
+static void
+wait_for_frame_callback (TestClient *client)
+{
+  int n_frame_callbacks = client->n_frame_callbacks;
+
+  while (client->n_frame_callbacks == n_frame_callbacks)
+    test_client_dispatch (client);
+}
+
+/* The client draws a new frame as soon as it gets a frame callback, so
+ * with the surface hidden, each callback has to come from a separate
+ * dispatch of the fallback timeout, queued when the frame is committed.
+ */
+static void
+assert_hidden_frame_callbacks (TestClient *client,
+                               int         n_frames)
+{
+  int i;
+
+  /* The frame committed before the surface got hidden may have been
+   * painted still */
+  wait_for_frame_callback (client);
+
+  for (i = 0; i < n_frames; i++)
+    {
+      uint32_t last_frame_time = client->last_frame_time;
+      int n_frame_callbacks = client->n_frame_callbacks;
+
+      wait_for_frame_callback (client);
+
+      g_assert_cmpint (client->n_frame_callbacks, ==, n_frame_callbacks + 1);
+      g_assert_cmpuint (client->last_frame_time - last_frame_time, >=,
+                        HIDDEN_FRAME_CALLBACK_INTERVAL_MS);
+    }
+}
+
+static void
+meta_test_wayland_hidden_frame_callbacks (void)
+{
+  TestClient client = { 0 };
+  TestClient obscuring_client = { 0 };
+  MetaWindow *window, *obscuring_window;
+  MetaSurfaceActor *surface_actor;
+  MetaRectangle frame_rect;
+
+  test_client_init (&client);
+
+  while (!(window = find_test_client_window ()))
+    test_client_dispatch (&client);
+  surface_actor = window->surface->surface_actor;
+
+  /* Painted surfaces get their callbacks from the frames */
+  wait_for_frame_callback (&client);
+  g_assert (!meta_surface_actor_is_obscured (surface_actor));
+
+  /* Completely obscured by an opaque window on top */
+  obscuring_client.title = "frame-callback-test-obscuring";
+  obscuring_client.opaque = TRUE;
+  test_client_init (&obscuring_client);
+
+  while (!(obscuring_window =
+           find_window_by_title (obscuring_client.title)))
+    test_client_dispatch (&obscuring_client);
+
+  meta_window_get_frame_rect (window, &frame_rect);
+  meta_window_move_frame (obscuring_window, FALSE, frame_rect.x, frame_rect.y);
+  meta_window_raise (obscuring_window);
+
+  while (!meta_surface_actor_is_obscured (surface_actor))
+    test_client_dispatch (&client);
+
+  assert_hidden_frame_callbacks (&client, 3);
+
+  test_client_finish (&obscuring_client);
+
+  /* Minimized */
+  meta_window_minimize (window);
+
+  while (clutter_actor_is_mapped (CLUTTER_ACTOR (surface_actor)))
+    test_client_dispatch (&client);
+
+  assert_hidden_frame_callbacks (&client, 3);
+
+  test_client_finish (&client);
+}
+
+typedef struct _WindowQueuesCheck
+{
+  MetaWindow *window;
+  guint is_in_queues;
+  gboolean done;
+} WindowQueuesCheck;
+
+static gboolean
+check_window_queues (gpointer user_data)
+{
+  WindowQueuesCheck *check = user_data;
+
+  check->is_in_queues = check->window->is_in_queues;
+  check->done = TRUE;
+
+  return FALSE;
+}
+
+static gboolean
+queue_window_move_resize (gpointer user_data)
+{
+  MetaWindow *window = user_data;
+
+  meta_window_queue (window, META_QUEUE_MOVE_RESIZE);
+
+  return FALSE;
+}
+
+static void
+meta_test_wayland_window_queues (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaMonitorManager *monitor_manager =
+    meta_backend_get_monitor_manager (backend);
+  TestClient client = { 0 };
+  WindowQueuesCheck check = { 0 };
+  MetaRectangle frame_rect;
+  MetaWindow *window;
+
+  test_client_init (&client);
+
+  while (!(window = find_test_client_window ()))
+    test_client_dispatch (&client);
+
+  check.window = window;
+
+  /* The move_resize queue is processed in the RESIZE phase, before any
+   * later of the CALC_SHOWING phase runs.
+   */
+  meta_window_queue (window, META_QUEUE_MOVE_RESIZE);
+  meta_later_add (META_LATER_CALC_SHOWING, check_window_queues, &check, NULL);
+  while (!check.done)
+    test_client_dispatch (&client);
+  g_assert_cmpuint (check.is_in_queues & META_QUEUE_MOVE_RESIZE, ==, 0);
+
+  /* A window moved while the calc_showing queue is being processed, after
+   * the RESIZE phase, is still moved before the stage is updated.
+   */
+  check.done = FALSE;
+  meta_later_add (META_LATER_BEFORE_REDRAW, check_window_queues, &check, NULL);
+  meta_window_queue (window, META_QUEUE_CALC_SHOWING);
+  meta_later_add (META_LATER_CALC_SHOWING, queue_window_move_resize,
+                  window, NULL);
+  while (!check.done)
+    test_client_dispatch (&client);
+  g_assert_cmpuint (check.is_in_queues &
+                    (META_QUEUE_MOVE_RESIZE | META_QUEUE_CALC_SHOWING),
+                    ==, 0);
+
+  /* The monitor was looked up for the current geometry and setup, so
+   * moving the window in place does not need to do it again.
+   */
+  meta_window_get_frame_rect (window, &frame_rect);
+  g_assert (meta_rectangle_equal (&window->monitor_frame_rect, &frame_rect));
+  g_assert_cmpuint (window->monitor_serial, ==, monitor_manager->serial);
+
+  test_client_finish (&client);
+}
+
+typedef struct _TestSubsurface
+{
+  struct wl_surface *surface;
+  struct wl_subsurface *subsurface;
+  struct wl_surface *parent;
+} TestSubsurface;
+
+static void
+create_subsurface_tree (TestClient        *client,
+                        struct wl_surface *parent,
+                        int                depth,
+                        int                fan_out,
+                        GArray            *subsurfaces)
+{
+  int i;
+
+  for (i = 0; i < fan_out; i++)
+    {
+      TestSubsurface subsurface;
+
+      subsurface.surface = wl_compositor_create_surface (client->compositor);
+      subsurface.subsurface =
+        wl_subcompositor_get_subsurface (client->subcompositor,
+                                         subsurface.surface,
+                                         parent);
+      subsurface.parent = parent;
+      wl_subsurface_set_position (subsurface.subsurface, i * 4, i * 4);
+      g_array_append_val (subsurfaces, subsurface);
+
+      if (depth > 1)
+        create_subsurface_tree (client, subsurface.surface,
+                                depth - 1, fan_out, subsurfaces);
+    }
+}
+
+/* Commits new content to every surface of a tree of synchronized
+ * subsurfaces, restacking each of them like clients tend to do on every
+ * frame, and then the parent surface, which applies the whole tree.
+ */
+static void
+commit_subsurface_tree (TestClient        *client,
+                        GArray            *subsurfaces,
+                        struct wl_buffer  *buffer)
+{
+  unsigned int i;
+
+  for (i = 0; i < subsurfaces->len; i++)
+    {
+      TestSubsurface *subsurface =
+        &g_array_index (subsurfaces, TestSubsurface, i);
+
+      wl_subsurface_place_above (subsurface->subsurface, subsurface->parent);
+      wl_surface_attach (subsurface->surface, buffer, 0, 0);
+      wl_surface_damage (subsurface->surface, 0, 0, 4, 4);
+      wl_surface_damage (subsurface->surface, 8, 8, 4, 4);
+      wl_surface_commit (subsurface->surface);
+    }
+
+  wl_surface_attach (client->surface, client->buffer, 0, 0);
+  wl_surface_damage (client->surface, 0, 0,
+                     TEST_CLIENT_SIZE, TEST_CLIENT_SIZE);
+  wl_surface_commit (client->surface);
+  test_client_sync (client);
+
+  g_assert_cmpint (wl_display_get_error (client->display), ==, 0);
+}
+
+static void
+destroy_subsurfaces (GArray *subsurfaces)
+{
+  unsigned int i;
+
+  for (i = subsurfaces->len; i > 0; i--)
+    {
+      TestSubsurface *subsurface =
+        &g_array_index (subsurfaces, TestSubsurface, i - 1);
+
+      wl_subsurface_destroy (subsurface->subsurface);
+      wl_surface_destroy (subsurface->surface);
+    }
+  g_array_free (subsurfaces, TRUE);
+}
+
+/* Checks the stacking of the actors of the subsurfaces of @parent, bottom
+ * to top; @parent itself stands for its shaped texture.
+ */
+static void
+assert_subsurface_order (MetaWaylandSurface *parent,
+                         ...)
+{
+  ClutterActor *parent_actor = CLUTTER_ACTOR (parent->surface_actor);
+  ClutterActor *child;
+  MetaWaylandSurface *surface;
+  va_list args;
+
+  va_start (args, parent);
+
+  for (child = clutter_actor_get_first_child (parent_actor);
+       child;
+       child = clutter_actor_get_next_sibling (child))
+    {
+      surface = va_arg (args, MetaWaylandSurface *);
+      g_assert (surface != NULL);
+
+      if (surface == parent)
+        g_assert (child == CLUTTER_ACTOR (meta_surface_actor_get_texture (parent->surface_actor)));
+      else
+        g_assert (child == CLUTTER_ACTOR (surface->surface_actor));
+    }
+
+  g_assert (va_arg (args, MetaWaylandSurface *) == NULL);
+
+  va_end (args);
+}
+
+static void
+count_relayouts (ClutterActor *actor,
+                 gpointer      user_data)
+{
+  int *n_relayouts = user_data;
+
+  *n_relayouts += 1;
+}
+
+static void
+meta_test_wayland_subsurface_tree_commit (void)
+{
+  TestClient client = { 0 };
+  MetaWaylandSurface *parent;
+  MetaWaylandSurface *sub[3];
+  MetaWindow *window;
+  GArray *subsurfaces;
+  struct wl_buffer *buffer;
+  int i, round;
+
+  test_client_init (&client);
+
+  while (!(window = find_test_client_window ()))
+    test_client_dispatch (&client);
+  parent = window->surface;
+
+  subsurfaces = g_array_new (FALSE, FALSE, sizeof (TestSubsurface));
+  create_subsurface_tree (&client, client.surface, 3, 3, subsurfaces);
+  buffer = create_shm_buffer (&client, 16, 16);
+
+  /* Each subsurface is placed right above its parent in turn, so the
+   * last one ends up lowest of them; restacking them all the same way
+   * again keeps that order.
+   */
+  for (round = 0; round < 3; round++)
+    {
+      commit_subsurface_tree (&client, subsurfaces, buffer);
+
+      g_assert_cmpuint (g_list_length (parent->subsurfaces), ==, 3);
+      for (i = 0; i < 3; i++)
+        sub[i] = g_list_nth_data (parent->subsurfaces, i);
+
+      assert_subsurface_order (parent,
+                               parent, sub[2], sub[1], sub[0], NULL);
+      assert_subsurface_order (sub[0],
+                               sub[0],
+                               g_list_nth_data (sub[0]->subsurfaces, 2),
+                               g_list_nth_data (sub[0]->subsurfaces, 1),
+                               g_list_nth_data (sub[0]->subsurfaces, 0),
+                               NULL);
+    }
+
+  destroy_subsurfaces (subsurfaces);
+  wl_buffer_destroy (buffer);
+
+  test_client_finish (&client);
+}
+
+static void
+meta_test_wayland_subsurface_placement (void)
+{
+  TestClient client = { 0 };
+  MetaWaylandSurface *parent;
+  MetaWaylandSurface *sub[3];
+  ClutterActor *parent_actor;
+  ClutterActorBox allocation;
+  TestSubsurface *subsurface;
+  MetaWindow *window;
+  GArray *subsurfaces;
+  struct wl_buffer *buffer;
+  gulong handler_id;
+  int n_relayouts = 0;
+  unsigned int i;
+
+  test_client_init (&client);
+
+  while (!(window = find_test_client_window ()))
+    test_client_dispatch (&client);
+  parent = window->surface;
+  parent_actor = CLUTTER_ACTOR (parent->surface_actor);
+
+  subsurfaces = g_array_new (FALSE, FALSE, sizeof (TestSubsurface));
+  create_subsurface_tree (&client, client.surface, 1, 3, subsurfaces);
+  buffer = create_shm_buffer (&client, 16, 16);
+
+  for (i = 0; i < subsurfaces->len; i++)
+    {
+      subsurface = &g_array_index (subsurfaces, TestSubsurface, i);
+      wl_surface_attach (subsurface->surface, buffer, 0, 0);
+      wl_surface_commit (subsurface->surface);
+    }
+  wl_surface_commit (client.surface);
+  test_client_sync (&client);
+
+  for (i = 0; i < 3; i++)
+    sub[i] = g_list_nth_data (parent->subsurfaces, i);
+
+  /* New subsurfaces are stacked above their parent, in order */
+  assert_subsurface_order (parent, parent, sub[0], sub[1], sub[2], NULL);
+
+  /* Placing relative to the parent stacks relative to its texture */
+  subsurface = &g_array_index (subsurfaces, TestSubsurface, 2);
+  wl_subsurface_place_below (subsurface->subsurface, client.surface);
+  wl_surface_commit (client.surface);
+  test_client_sync (&client);
+  assert_subsurface_order (parent, sub[2], parent, sub[0], sub[1], NULL);
+
+  subsurface = &g_array_index (subsurfaces, TestSubsurface, 0);
+  wl_subsurface_place_above (subsurface->subsurface,
+                             g_array_index (subsurfaces,
+                                            TestSubsurface, 1).surface);
+  wl_surface_commit (client.surface);
+  test_client_sync (&client);
+  assert_subsurface_order (parent, sub[2], parent, sub[1], sub[0], NULL);
+
+  /* Placing a subsurface where it already is does not touch the actors */
+  clutter_actor_get_allocation_box (parent_actor, &allocation);
+  handler_id = g_signal_connect (parent_actor, "queue-relayout",
+                                 G_CALLBACK (count_relayouts), &n_relayouts);
+
+  subsurface = &g_array_index (subsurfaces, TestSubsurface, 1);
+  wl_subsurface_place_above (subsurface->subsurface, client.surface);
+  wl_surface_commit (client.surface);
+  test_client_sync (&client);
+
+  g_signal_handler_disconnect (parent_actor, handler_id);
+  assert_subsurface_order (parent, sub[2], parent, sub[1], sub[0], NULL);
+  g_assert_cmpint (n_relayouts, ==, 0);
+
+  g_assert_cmpint (wl_display_get_error (client.display), ==, 0);
+
+  destroy_subsurfaces (subsurfaces);
+  wl_buffer_destroy (buffer);
+
+  test_client_finish (&client);
+}
+
+typedef struct _TestKeyboards
+{
+  int n_keymaps;
+  int n_keymap_files;
+  ino_t keymap_ino;
+  int n_enters;
+  int n_modifiers;
+  uint32_t group;
+} TestKeyboards;
+
+static void
+handle_keyboard_keymap (void               *data,
+                        struct wl_keyboard *wl_keyboard,
+                        uint32_t            format,
+                        int32_t             fd,
+                        uint32_t            size)
+{
+  TestKeyboards *keyboards = data;
+  struct stat st;
+
+  g_assert_cmpint (fstat (fd, &st), ==, 0);
+  close (fd);
+
+  if (keyboards->n_keymaps == 0 || st.st_ino != keyboards->keymap_ino)
+    keyboards->n_keymap_files++;
+
+  keyboards->keymap_ino = st.st_ino;
+  keyboards->n_keymaps++;
+}
+
+static void
+handle_keyboard_enter (void               *data,
+                       struct wl_keyboard *wl_keyboard,
+                       uint32_t            serial,
+                       struct wl_surface  *surface,
+                       struct wl_array    *keys)
+{
+  TestKeyboards *keyboards = data;
+
+  keyboards->n_enters++;
+}
+
+static void
+handle_keyboard_leave (void               *data,
+                       struct wl_keyboard *wl_keyboard,
+                       uint32_t            serial,
+                       struct wl_surface  *surface)
+{
+}
+
+static void
+handle_keyboard_key (void               *data,
+                     struct wl_keyboard *wl_keyboard,
+                     uint32_t            serial,
+                     uint32_t            time,
+                     uint32_t            key,
+                     uint32_t            state)
+{
+}
+
+static void
+handle_keyboard_modifiers (void               *data,
+                           struct wl_keyboard *wl_keyboard,
+                           uint32_t            serial,
+                           uint32_t            mods_depressed,
+                           uint32_t            mods_latched,
+                           uint32_t            mods_locked,
+                           uint32_t            group)
+{
+  TestKeyboards *keyboards = data;
+
+  keyboards->n_modifiers++;
+  keyboards->group = group;
+}
+
+static void
+handle_keyboard_repeat_info (void               *data,
+                             struct wl_keyboard *wl_keyboard,
+                             int32_t             rate,
+                             int32_t             delay)
+{
+}
+
+static const struct wl_keyboard_listener keyboard_listener = {
+  handle_keyboard_keymap,
+  handle_keyboard_enter,
+  handle_keyboard_leave,
+  handle_keyboard_key,
+  handle_keyboard_modifiers,
+  handle_keyboard_repeat_info
+};
+
+static struct xkb_keymap *
+create_keymap (const char *layout)
+{
+  struct xkb_rule_names names = { .layout = layout };
+  struct xkb_context *context;
+  struct xkb_keymap *keymap;
+
+  context = xkb_context_new (XKB_CONTEXT_NO_FLAGS);
+  keymap = xkb_keymap_new_from_names (context, &names,
+                                      XKB_KEYMAP_COMPILE_NO_FLAGS);
+  xkb_context_unref (context);
+
+  return keymap;
+}
+
+static void
+meta_test_wayland_keyboard_keymap_changes (void)
+{
+  MetaWaylandCompositor *compositor = meta_wayland_compositor_get_default ();
+  MetaBackendTest *backend_test = META_BACKEND_TEST (meta_get_backend ());
+  MetaWaylandKeyboard *keyboard = compositor->seat->keyboard;
+  TestClient client = { 0 };
+  TestKeyboards keyboards = { 0 };
+  struct wl_keyboard *wl_keyboards[20];
+  struct xkb_keymap *keymap;
+  MetaWindow *window;
+  int n_keyboards = G_N_ELEMENTS (wl_keyboards);
+  int n_modifiers;
+  int i;
+
+  test_client_init (&client);
+
+  keymap = create_keymap ("us,de");
+  if (!client.seat || !meta_wayland_seat_has_keyboard (compositor->seat) ||
+      !keymap)
+    {
+      g_test_skip ("No keyboard on the seat, or no XKB data");
+      g_clear_pointer (&keymap, xkb_keymap_unref);
+      test_client_finish (&client);
+      return;
+    }
+
+  for (i = 0; i < n_keyboards; i++)
+    {
+      wl_keyboards[i] = wl_seat_get_keyboard (client.seat);
+      wl_keyboard_add_listener (wl_keyboards[i], &keyboard_listener,
+                                &keyboards);
+    }
+  test_client_sync (&client);
+
+  /* All keyboards share the one file of the current keymap */
+  g_assert_cmpint (keyboards.n_keymaps, ==, n_keyboards);
+  g_assert_cmpint (keyboards.n_keymap_files, ==, 1);
+
+  while (!(window = find_test_client_window ()))
+    test_client_dispatch (&client);
+
+  /* Entering sends the modifiers along */
+  meta_wayland_keyboard_set_focus (keyboard, window->surface);
+  test_client_sync (&client);
+  g_assert_cmpint (keyboards.n_enters, ==, n_keyboards);
+  g_assert_cmpint (keyboards.n_modifiers, ==, n_keyboards);
+
+  /* Reloading an identical keymap changes nothing clients can see */
+  g_signal_emit_by_name (backend_test, "keymap-changed");
+  test_client_sync (&client);
+  g_assert_cmpint (keyboards.n_keymaps, ==, n_keyboards);
+  g_assert_cmpint (keyboards.n_modifiers, ==, n_keyboards);
+
+  /* A new keymap resets the client side state, so the modifiers are
+   * sent again even though the masks are the same */
+  meta_backend_test_set_keymap (backend_test, keymap);
+  test_client_sync (&client);
+  g_assert_cmpint (keyboards.n_keymaps, ==, 2 * n_keyboards);
+  g_assert_cmpint (keyboards.n_keymap_files, ==, 2);
+  g_assert_cmpint (keyboards.n_modifiers, ==, 2 * n_keyboards);
+
+  /* A layout switch is one modifiers event per keyboard, switching to
+   * the current layout again none */
+  g_signal_emit_by_name (backend_test, "keymap-layout-group-changed", 1);
+  test_client_sync (&client);
+  g_assert_cmpint (keyboards.n_modifiers, ==, 3 * n_keyboards);
+  g_assert_cmpuint (keyboards.group, ==, 1);
+
+  n_modifiers = keyboards.n_modifiers;
+  g_signal_emit_by_name (backend_test, "keymap-layout-group-changed", 1);
+  test_client_sync (&client);
+  g_assert_cmpint (keyboards.n_modifiers, ==, n_modifiers);
+
+  g_signal_emit_by_name (backend_test, "keymap-layout-group-changed", 0);
+  meta_backend_test_set_keymap (backend_test, NULL);
+  meta_wayland_keyboard_set_focus (keyboard, NULL);
+  xkb_keymap_unref (keymap);
+
+  for (i = 0; i < n_keyboards; i++)
+    wl_keyboard_destroy (wl_keyboards[i]);
+
+  test_client_finish (&client);
+}
+
+void
+init_wayland_tests (void)
+{
+  g_test_add_func ("/wayland/frame-callbacks/hidden",
+                   meta_test_wayland_hidden_frame_callbacks);
+  g_test_add_func ("/wayland/window/queues",
+                   meta_test_wayland_window_queues);
+  g_test_add_func ("/wayland/subsurfaces/tree-commit",
+                   meta_test_wayland_subsurface_tree_commit);
+  g_test_add_func ("/wayland/subsurfaces/placement",
+                   meta_test_wayland_subsurface_placement);
+  g_test_add_func ("/wayland/keyboard/keymap-changes",
+                   meta_test_wayland_keyboard_keymap_changes);
+}
@@ -31,6 +31,7 @@
 #include <meta/util.h>
 
 #include "backends/meta-backend-private.h"
+#include "wayland/meta-wayland-client-stats.h"
 
 enum
 {
@@ -97,6 +98,7 @@ meta_wayland_buffer_realize (MetaWaylandBuffer *buffer)
   CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
   EGLDisplay egl_display = cogl_egl_context_get_egl_display (cogl_context);
   MetaWaylandEglStream *stream;
+  MetaWaylandDmaBufBuffer *dma_buf;
 
   if (wl_shm_buffer_get (buffer->resource) != NULL)
     {
@@ -104,6 +106,14 @@ meta_wayland_buffer_realize (MetaWaylandBuffer *buffer)
       return TRUE;
     }
 
+  dma_buf = meta_wayland_dma_buf_from_buffer (buffer);
+  if (dma_buf)
+    {
+      buffer->dma_buf.dma_buf = g_object_ref (dma_buf);
+      buffer->type = META_WAYLAND_BUFFER_TYPE_DMA_BUF;
+      return TRUE;
+    }
+
   if (meta_egl_query_wayland_buffer (egl, egl_display, buffer->resource,
                                      EGL_TEXTURE_FORMAT, &format,
                                      NULL))
@@ -315,10 +325,38 @@ egl_stream_buffer_attach (MetaWaylandBuffer  *buffer,
   return TRUE;
 }
 
+static void
+account_texture (MetaWaylandBuffer *buffer)
+{
+  struct wl_client *client;
+
+  if (buffer->client_stats || !buffer->texture)
+    return;
+
+  client = wl_resource_get_client (buffer->resource);
+  buffer->client_stats =
+    meta_wayland_client_stats_ref (meta_wayland_client_stats_from_client (client));
+
+  /* Assume 4 bytes per pixel; this is an estimate of what the buffer costs
+   * the compositor, not an exact account of the driver's allocations.
+   */
+  buffer->texture_bytes = (int64_t) cogl_texture_get_width (buffer->texture) *
+                          cogl_texture_get_height (buffer->texture) * 4;
+  meta_wayland_client_stats_add_texture (buffer->client_stats,
+                                         buffer->texture_bytes);
+
+  /* SHM buffers are uploaded as a whole when the texture is created */
+  if (buffer->type == META_WAYLAND_BUFFER_TYPE_SHM)
+    meta_wayland_client_stats_add_shm_upload (buffer->client_stats,
+                                              buffer->texture_bytes);
+}
+
 gboolean
 meta_wayland_buffer_attach (MetaWaylandBuffer *buffer,
                             GError           **error)
 {
+  gboolean ret = FALSE;
+
   g_return_val_if_fail (buffer->resource, FALSE);
 
   if (!meta_wayland_buffer_is_realized (buffer))
@@ -335,17 +373,26 @@ meta_wayland_buffer_attach (MetaWaylandBuffer *buffer,
   switch (buffer->type)
     {
     case META_WAYLAND_BUFFER_TYPE_SHM:
-      return shm_buffer_attach (buffer, error);
+      ret = shm_buffer_attach (buffer, error);
+      break;
     case META_WAYLAND_BUFFER_TYPE_EGL_IMAGE:
-      return egl_image_buffer_attach (buffer, error);
+      ret = egl_image_buffer_attach (buffer, error);
+      break;
     case META_WAYLAND_BUFFER_TYPE_EGL_STREAM:
-      return egl_stream_buffer_attach (buffer, error);
+      ret = egl_stream_buffer_attach (buffer, error);
+      break;
+    case META_WAYLAND_BUFFER_TYPE_DMA_BUF:
+      ret = meta_wayland_dma_buf_buffer_attach (buffer, error);
+      break;
     case META_WAYLAND_BUFFER_TYPE_UNKNOWN:
       g_assert_not_reached ();
       return FALSE;
     }
 
-  g_assert_not_reached ();
+  if (ret)
+    account_texture (buffer);
+
+  return ret;
 }
 
 CoglTexture *
@@ -376,6 +423,7 @@ process_shm_buffer_damage (MetaWaylandBuffer *buffer,
 {
   struct wl_shm_buffer *shm_buffer;
   int i, n_rectangles;
+  uint64_t n_bytes = 0;
   gboolean set_texture_failed = FALSE;
 
   n_rectangles = cairo_region_num_rectangles (region);
@@ -407,10 +455,15 @@ process_shm_buffer_damage (MetaWaylandBuffer *buffer,
           set_texture_failed = TRUE;
           break;
         }
+
+      n_bytes += (uint64_t) rect.width * rect.height * bpp;
     }
 
   wl_shm_buffer_end_access (shm_buffer);
 
+  if (buffer->client_stats)
+    meta_wayland_client_stats_add_shm_upload (buffer->client_stats, n_bytes);
+
   return !set_texture_failed;
 }
 
@@ -429,6 +482,7 @@ meta_wayland_buffer_process_damage (MetaWaylandBuffer *buffer,
       res = process_shm_buffer_damage (buffer, region, &error);
     case META_WAYLAND_BUFFER_TYPE_EGL_IMAGE:
     case META_WAYLAND_BUFFER_TYPE_EGL_STREAM:
+    case META_WAYLAND_BUFFER_TYPE_DMA_BUF:
       res = TRUE;
       break;
     case META_WAYLAND_BUFFER_TYPE_UNKNOWN:
@@ -451,7 +505,14 @@ meta_wayland_buffer_finalize (GObject *object)
   MetaWaylandBuffer *buffer = META_WAYLAND_BUFFER (object);
 
   g_clear_pointer (&buffer->texture, cogl_object_unref);
+  if (buffer->client_stats)
+    {
+      meta_wayland_client_stats_add_texture (buffer->client_stats,
+                                             -buffer->texture_bytes);
+      meta_wayland_client_stats_unref (buffer->client_stats);
+    }
   g_clear_object (&buffer->egl_stream.stream);
+  g_clear_object (&buffer->dma_buf.dma_buf);
 
   G_OBJECT_CLASS (meta_wayland_buffer_parent_class)->finalize (object);
 }
@@ -31,6 +31,7 @@
 
 #include "meta-wayland-types.h"
 #include "meta-wayland-egl-stream.h"
+#include "meta-wayland-dma-buf.h"
 
 typedef enum _MetaWaylandBufferType
 {
@@ -38,6 +39,7 @@ typedef enum _MetaWaylandBufferType
   META_WAYLAND_BUFFER_TYPE_SHM,
   META_WAYLAND_BUFFER_TYPE_EGL_IMAGE,
   META_WAYLAND_BUFFER_TYPE_EGL_STREAM,
+  META_WAYLAND_BUFFER_TYPE_DMA_BUF,
 } MetaWaylandBufferType;
 
 struct _MetaWaylandBuffer
@@ -50,11 +52,19 @@ struct _MetaWaylandBuffer
   CoglTexture *texture;
   gboolean is_y_inverted;
 
+  /* The client the texture memory is accounted to */
+  MetaWaylandClientStats *client_stats;
+  int64_t texture_bytes;
+
   MetaWaylandBufferType type;
 
   struct {
     MetaWaylandEglStream *stream;
   } egl_stream;
+
+  struct {
+    MetaWaylandDmaBufBuffer *dma_buf;
+  } dma_buf;
 };
 
 #define META_TYPE_WAYLAND_BUFFER (meta_wayland_buffer_get_type ())
@@ -0,0 +1,327 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * Copyright (C) 2017 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include "wayland/meta-wayland-client-stats.h"
+
+#include <meta/main.h>
+#include <meta/util.h>
+
+#include "meta-dbus-wayland-client-stats.h"
+#include "wayland/meta-wayland-private.h"
+
+typedef struct _MetaWaylandClientCounters
+{
+  uint64_t n_commits;
+  uint64_t n_damage_rectangles;
+  uint64_t shm_bytes_uploaded;
+  uint64_t request_time_us;
+} MetaWaylandClientCounters;
+
+struct _MetaWaylandClientStats
+{
+  int ref_count;
+
+  /* Link in the manager's client list, and the client the statistics are
+   * about; both only valid while the client is connected.
+   */
+  struct wl_list link;
+  struct wl_listener client_destroy_listener;
+  struct wl_client *client;
+  pid_t pid;
+
+  MetaWaylandClientCounters counters;
+
+  /* The counters at the start of the current rate measurement interval */
+  MetaWaylandClientCounters interval_counters;
+  int64_t interval_start_time_us;
+
+  double commit_rate;
+  double damage_rectangle_rate;
+  double shm_upload_rate;
+  double request_time_rate;
+
+  int64_t texture_bytes;
+  unsigned int n_frame_callbacks;
+};
+
+/* The minimum interval over which rates are averaged */
+#define RATE_INTERVAL_US G_USEC_PER_SEC
+
+static void
+update_rates (MetaWaylandClientStats *stats,
+              int64_t                 now_us)
+{
+  MetaWaylandClientCounters *counters = &stats->counters;
+  MetaWaylandClientCounters *interval_counters = &stats->interval_counters;
+  double seconds;
+
+  if (now_us - stats->interval_start_time_us < RATE_INTERVAL_US)
+    return;
+
+  seconds = (now_us - stats->interval_start_time_us) / (double) G_USEC_PER_SEC;
+
+  stats->commit_rate =
+    (counters->n_commits - interval_counters->n_commits) / seconds;
+  stats->damage_rectangle_rate =
+    (counters->n_damage_rectangles -
+     interval_counters->n_damage_rectangles) / seconds;
+  stats->shm_upload_rate =
+    (counters->shm_bytes_uploaded -
+     interval_counters->shm_bytes_uploaded) / seconds;
+  stats->request_time_rate =
+    (counters->request_time_us - interval_counters->request_time_us) / seconds;
+
+  *interval_counters = *counters;
+  stats->interval_start_time_us = now_us;
+
+  if (stats->commit_rate > 0)
+    meta_topic (META_DEBUG_WAYLAND,
+                "Client %d: %.1f commits/s, %.1f damage rectangles/s, "
+                "%.1f KiB/s uploaded, %.1f ms/s handling commits, "
+                "%" G_GINT64_FORMAT " KiB of textures, "
+                "%u frame callbacks pending\n",
+                (int) stats->pid,
+                stats->commit_rate,
+                stats->damage_rectangle_rate,
+                stats->shm_upload_rate / 1024,
+                stats->request_time_rate / 1000,
+                stats->texture_bytes / 1024,
+                stats->n_frame_callbacks);
+}
+
+static void
+client_destroyed (struct wl_listener *listener,
+                  void               *data)
+{
+  MetaWaylandClientStats *stats =
+    wl_container_of (listener, stats, client_destroy_listener);
+
+  wl_list_remove (&stats->client_destroy_listener.link);
+  wl_list_remove (&stats->link);
+  stats->client = NULL;
+
+  meta_wayland_client_stats_unref (stats);
+}
+
+MetaWaylandClientStats *
+meta_wayland_client_stats_from_client (struct wl_client *client)
+{
+  MetaWaylandCompositor *compositor = meta_wayland_compositor_get_default ();
+  MetaWaylandClientStats *stats;
+  struct wl_listener *listener;
+
+  listener = wl_client_get_destroy_listener (client, client_destroyed);
+  if (listener)
+    return wl_container_of (listener, stats, client_destroy_listener);
+
+  stats = g_slice_new0 (MetaWaylandClientStats);
+  stats->ref_count = 1;
+  stats->client = client;
+  wl_client_get_credentials (client, &stats->pid, NULL, NULL);
+  stats->interval_start_time_us = g_get_monotonic_time ();
+
+  stats->client_destroy_listener.notify = client_destroyed;
+  wl_client_add_destroy_listener (client, &stats->client_destroy_listener);
+  wl_list_insert (&compositor->client_stats.clients, &stats->link);
+
+  return stats;
+}
+
+MetaWaylandClientStats *
+meta_wayland_client_stats_ref (MetaWaylandClientStats *stats)
+{
+  stats->ref_count++;
+
+  return stats;
+}
+
+void
+meta_wayland_client_stats_unref (MetaWaylandClientStats *stats)
+{
+  stats->ref_count--;
+  if (stats->ref_count > 0)
+    return;
+
+  g_slice_free (MetaWaylandClientStats, stats);
+}
+
+void
+meta_wayland_client_stats_add_commit (MetaWaylandClientStats *stats,
+                                      int64_t                 duration_us)
+{
+  stats->counters.n_commits++;
+  stats->counters.request_time_us += duration_us;
+
+  update_rates (stats, g_get_monotonic_time ());
+}
+
+void
+meta_wayland_client_stats_add_damage (MetaWaylandClientStats *stats,
+                                      int                     n_rectangles)
+{
+  stats->counters.n_damage_rectangles += n_rectangles;
+}
+
+void
+meta_wayland_client_stats_add_shm_upload (MetaWaylandClientStats *stats,
+                                          uint64_t                n_bytes)
+{
+  stats->counters.shm_bytes_uploaded += n_bytes;
+}
+
+void
+meta_wayland_client_stats_add_texture (MetaWaylandClientStats *stats,
+                                       int64_t                 n_bytes)
+{
+  stats->texture_bytes += n_bytes;
+}
+
+void
+meta_wayland_client_stats_frame_callback_created (MetaWaylandClientStats *stats)
+{
+  stats->n_frame_callbacks++;
+}
+
+void
+meta_wayland_client_stats_frame_callback_destroyed (MetaWaylandClientStats *stats)
+{
+  g_return_if_fail (stats->n_frame_callbacks > 0);
+
+  stats->n_frame_callbacks--;
+}
+
+static GVariant *
+client_stats_to_variant (MetaWaylandClientStats *stats)
+{
+  GVariantBuilder builder;
+
+  update_rates (stats, g_get_monotonic_time ());
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+  g_variant_builder_add (&builder, "{sv}", "commits",
+                         g_variant_new_uint64 (stats->counters.n_commits));
+  g_variant_builder_add (&builder, "{sv}", "commits-per-second",
+                         g_variant_new_double (stats->commit_rate));
+  g_variant_builder_add (&builder, "{sv}", "damage-rectangles",
+                         g_variant_new_uint64 (stats->counters.n_damage_rectangles));
+  g_variant_builder_add (&builder, "{sv}", "damage-rectangles-per-second",
+                         g_variant_new_double (stats->damage_rectangle_rate));
+  g_variant_builder_add (&builder, "{sv}", "shm-bytes-uploaded",
+                         g_variant_new_uint64 (stats->counters.shm_bytes_uploaded));
+  g_variant_builder_add (&builder, "{sv}", "shm-bytes-uploaded-per-second",
+                         g_variant_new_double (stats->shm_upload_rate));
+  g_variant_builder_add (&builder, "{sv}", "texture-bytes",
+                         g_variant_new_uint64 (MAX (stats->texture_bytes, 0)));
+  g_variant_builder_add (&builder, "{sv}", "frame-callbacks",
+                         g_variant_new_uint32 (stats->n_frame_callbacks));
+  g_variant_builder_add (&builder, "{sv}", "request-time-us",
+                         g_variant_new_uint64 (stats->counters.request_time_us));
+  g_variant_builder_add (&builder, "{sv}", "request-time-us-per-second",
+                         g_variant_new_double (stats->request_time_rate));
+
+  return g_variant_new ("(u@a{sv})",
+                        (uint32_t) stats->pid,
+                        g_variant_builder_end (&builder));
+}
+
+static gboolean
+handle_get_client_stats (MetaDBusWaylandClientStats *skeleton,
+                         GDBusMethodInvocation      *invocation,
+                         MetaWaylandCompositor      *compositor)
+{
+  MetaWaylandClientStats *stats;
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ua{sv})"));
+  wl_list_for_each (stats, &compositor->client_stats.clients, link)
+    g_variant_builder_add_value (&builder, client_stats_to_variant (stats));
+
+  meta_dbus_wayland_client_stats_complete_get_client_stats (
+    skeleton, invocation, g_variant_builder_end (&builder));
+
+  return TRUE;
+}
+
+static void
+on_bus_acquired (GDBusConnection *connection,
+                 const char      *name,
+                 gpointer         user_data)
+{
+  MetaWaylandCompositor *compositor = user_data;
+  MetaDBusWaylandClientStats *skeleton;
+  GError *error = NULL;
+
+  skeleton = meta_dbus_wayland_client_stats_skeleton_new ();
+  g_signal_connect (skeleton, "handle-get-client-stats",
+                    G_CALLBACK (handle_get_client_stats), compositor);
+
+  if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (skeleton),
+                                         connection,
+                                         "/org/gnome/Mutter/WaylandClientStats",
+                                         &error))
+    {
+      g_warning ("Failed to export Wayland client stats object: %s",
+                 error->message);
+      g_error_free (error);
+      g_object_unref (skeleton);
+      return;
+    }
+
+  compositor->client_stats.skeleton = G_DBUS_INTERFACE_SKELETON (skeleton);
+}
+
+static void
+on_name_acquired (GDBusConnection *connection,
+                  const char      *name,
+                  gpointer         user_data)
+{
+  meta_topic (META_DEBUG_DBUS, "Acquired name %s\n", name);
+}
+
+static void
+on_name_lost (GDBusConnection *connection,
+              const char      *name,
+              gpointer         user_data)
+{
+  meta_topic (META_DEBUG_DBUS, "Lost or failed to acquire name %s\n", name);
+}
+
+void
+meta_wayland_client_stats_init (MetaWaylandCompositor *compositor)
+{
+  MetaWaylandClientStatsManager *manager = &compositor->client_stats;
+
+  wl_list_init (&manager->clients);
+
+  manager->dbus_name_id =
+    g_bus_own_name (G_BUS_TYPE_SESSION,
+                    "org.gnome.Mutter.WaylandClientStats",
+                    G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT |
+                    (meta_get_replace_current_wm () ?
+                     G_BUS_NAME_OWNER_FLAGS_REPLACE : 0),
+                    on_bus_acquired,
+                    on_name_acquired,
+                    on_name_lost,
+                    compositor,
+                    NULL);
+}
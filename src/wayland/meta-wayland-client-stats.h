@@ -0,0 +1,64 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * Copyright (C) 2017 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_WAYLAND_CLIENT_STATS_H
+#define META_WAYLAND_CLIENT_STATS_H
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <wayland-server.h>
+
+#include "wayland/meta-wayland-types.h"
+
+typedef struct _MetaWaylandClientStatsManager
+{
+  /* Statistics of the connected clients */
+  struct wl_list clients;
+
+  guint dbus_name_id;
+  GDBusInterfaceSkeleton *skeleton;
+} MetaWaylandClientStatsManager;
+
+void meta_wayland_client_stats_init (MetaWaylandCompositor *compositor);
+
+MetaWaylandClientStats * meta_wayland_client_stats_from_client (struct wl_client *client);
+
+MetaWaylandClientStats * meta_wayland_client_stats_ref (MetaWaylandClientStats *stats);
+
+void meta_wayland_client_stats_unref (MetaWaylandClientStats *stats);
+
+void meta_wayland_client_stats_add_commit (MetaWaylandClientStats *stats,
+                                           int64_t                 duration_us);
+
+void meta_wayland_client_stats_add_damage (MetaWaylandClientStats *stats,
+                                           int                     n_rectangles);
+
+void meta_wayland_client_stats_add_shm_upload (MetaWaylandClientStats *stats,
+                                               uint64_t                n_bytes);
+
+void meta_wayland_client_stats_add_texture (MetaWaylandClientStats *stats,
+                                            int64_t                 n_bytes);
+
+void meta_wayland_client_stats_frame_callback_created (MetaWaylandClientStats *stats);
+
+void meta_wayland_client_stats_frame_callback_destroyed (MetaWaylandClientStats *stats);
+
+#endif /* META_WAYLAND_CLIENT_STATS_H */
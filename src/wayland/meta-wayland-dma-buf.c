@@ -0,0 +1,814 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * Copyright (C) 2017 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Implementation of zwp_linux_dmabuf_v1. Clients hand us dma-buf file
+ * descriptors, which are imported as EGLImages and wrapped in Cogl
+ * textures without any copy. The formats and modifiers advertised are
+ * the ones the EGL implementation says it can import.
+ */
+
+#include "config.h"
+
+#include "wayland/meta-wayland-dma-buf.h"
+
+#include <drm_fourcc.h>
+#include <unistd.h>
+
+#include "cogl/cogl-egl.h"
+#include "backends/meta-backend-private.h"
+#include "backends/meta-egl.h"
+#include "backends/meta-egl-ext.h"
+#include "meta/meta-backend.h"
+#include "wayland/meta-wayland-buffer.h"
+#include "wayland/meta-wayland-private.h"
+#include "wayland/meta-wayland-versions.h"
+
+#include "linux-dmabuf-unstable-v1-server-protocol.h"
+
+#ifndef DRM_FORMAT_MOD_INVALID
+#define DRM_FORMAT_MOD_INVALID ((1ULL << 56) - 1)
+#endif
+
+#define META_WAYLAND_DMA_BUF_MAX_PLANES 4
+
+typedef struct
+{
+  uint32_t drm_format;
+  CoglPixelFormat cogl_format;
+} MetaWaylandDmaBufFormatInfo;
+
+/* The formats we know how to wrap in a Cogl texture; the actual
+ * channel layout is handled by EGL, Cogl only needs to know whether
+ * there is an alpha channel.
+ */
+static const MetaWaylandDmaBufFormatInfo format_infos[] = {
+  { DRM_FORMAT_ARGB8888, COGL_PIXEL_FORMAT_ARGB_8888_PRE },
+  { DRM_FORMAT_XRGB8888, COGL_PIXEL_FORMAT_RGB_888 },
+  { DRM_FORMAT_ABGR8888, COGL_PIXEL_FORMAT_RGBA_8888_PRE },
+  { DRM_FORMAT_XBGR8888, COGL_PIXEL_FORMAT_RGB_888 },
+  { DRM_FORMAT_ARGB2101010, COGL_PIXEL_FORMAT_ARGB_2101010_PRE },
+  { DRM_FORMAT_RGB565, COGL_PIXEL_FORMAT_RGB_565 },
+};
+
+typedef struct
+{
+  const MetaWaylandDmaBufFormatInfo *info;
+
+  /* Modifiers EGL can import into a 2D texture; empty if EGL can't tell */
+  GArray *modifiers;
+} MetaWaylandDmaBufFormat;
+
+typedef struct _MetaWaylandDmaBufManager
+{
+  MetaWaylandCompositor *compositor;
+
+  /* Queried once, as the answers don't change and are sent on every bind */
+  GArray *formats;
+} MetaWaylandDmaBufManager;
+
+struct _MetaWaylandDmaBufBuffer
+{
+  GObject parent;
+
+  MetaWaylandDmaBufManager *manager;
+
+  int width;
+  int height;
+  const MetaWaylandDmaBufFormatInfo *format_info;
+  gboolean is_y_inverted;
+
+  int fds[META_WAYLAND_DMA_BUF_MAX_PLANES];
+  uint32_t offsets[META_WAYLAND_DMA_BUF_MAX_PLANES];
+  uint32_t strides[META_WAYLAND_DMA_BUF_MAX_PLANES];
+  uint64_t modifiers[META_WAYLAND_DMA_BUF_MAX_PLANES];
+
+  CoglTexture2D *texture;
+};
+
+G_DEFINE_TYPE (MetaWaylandDmaBufBuffer, meta_wayland_dma_buf_buffer,
+               G_TYPE_OBJECT)
+
+static const EGLint plane_fd_attribs[META_WAYLAND_DMA_BUF_MAX_PLANES] = {
+  EGL_DMA_BUF_PLANE0_FD_EXT,
+  EGL_DMA_BUF_PLANE1_FD_EXT,
+  EGL_DMA_BUF_PLANE2_FD_EXT,
+  EGL_DMA_BUF_PLANE3_FD_EXT,
+};
+
+static const EGLint plane_offset_attribs[META_WAYLAND_DMA_BUF_MAX_PLANES] = {
+  EGL_DMA_BUF_PLANE0_OFFSET_EXT,
+  EGL_DMA_BUF_PLANE1_OFFSET_EXT,
+  EGL_DMA_BUF_PLANE2_OFFSET_EXT,
+  EGL_DMA_BUF_PLANE3_OFFSET_EXT,
+};
+
+static const EGLint plane_pitch_attribs[META_WAYLAND_DMA_BUF_MAX_PLANES] = {
+  EGL_DMA_BUF_PLANE0_PITCH_EXT,
+  EGL_DMA_BUF_PLANE1_PITCH_EXT,
+  EGL_DMA_BUF_PLANE2_PITCH_EXT,
+  EGL_DMA_BUF_PLANE3_PITCH_EXT,
+};
+
+static const EGLint plane_modifier_lo_attribs[META_WAYLAND_DMA_BUF_MAX_PLANES] = {
+  EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT,
+  EGL_DMA_BUF_PLANE1_MODIFIER_LO_EXT,
+  EGL_DMA_BUF_PLANE2_MODIFIER_LO_EXT,
+  EGL_DMA_BUF_PLANE3_MODIFIER_LO_EXT,
+};
+
+static const EGLint plane_modifier_hi_attribs[META_WAYLAND_DMA_BUF_MAX_PLANES] = {
+  EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT,
+  EGL_DMA_BUF_PLANE1_MODIFIER_HI_EXT,
+  EGL_DMA_BUF_PLANE2_MODIFIER_HI_EXT,
+  EGL_DMA_BUF_PLANE3_MODIFIER_HI_EXT,
+};
+
+static gboolean
+meta_wayland_dma_buf_realize_texture (MetaWaylandDmaBufBuffer  *dma_buf,
+                                      GError                  **error)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaEgl *egl = meta_backend_get_egl (backend);
+  ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
+  CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
+  EGLDisplay egl_display = cogl_egl_context_get_egl_display (cogl_context);
+  EGLint attribs[6 + META_WAYLAND_DMA_BUF_MAX_PLANES * 10 + 1];
+  EGLImageKHR egl_image;
+  CoglTexture2D *texture;
+  int n_attribs = 0;
+  int i;
+
+  attribs[n_attribs++] = EGL_WIDTH;
+  attribs[n_attribs++] = dma_buf->width;
+  attribs[n_attribs++] = EGL_HEIGHT;
+  attribs[n_attribs++] = dma_buf->height;
+  attribs[n_attribs++] = EGL_LINUX_DRM_FOURCC_EXT;
+  attribs[n_attribs++] = dma_buf->format_info->drm_format;
+
+  for (i = 0; i < META_WAYLAND_DMA_BUF_MAX_PLANES; i++)
+    {
+      if (dma_buf->fds[i] == -1)
+        break;
+
+      attribs[n_attribs++] = plane_fd_attribs[i];
+      attribs[n_attribs++] = dma_buf->fds[i];
+      attribs[n_attribs++] = plane_offset_attribs[i];
+      attribs[n_attribs++] = dma_buf->offsets[i];
+      attribs[n_attribs++] = plane_pitch_attribs[i];
+      attribs[n_attribs++] = dma_buf->strides[i];
+
+      /* Without a modifier, the layout is whatever the driver implies */
+      if (dma_buf->modifiers[i] != DRM_FORMAT_MOD_INVALID)
+        {
+          attribs[n_attribs++] = plane_modifier_lo_attribs[i];
+          attribs[n_attribs++] = dma_buf->modifiers[i] & 0xffffffff;
+          attribs[n_attribs++] = plane_modifier_hi_attribs[i];
+          attribs[n_attribs++] = dma_buf->modifiers[i] >> 32;
+        }
+    }
+
+  attribs[n_attribs++] = EGL_NONE;
+
+  egl_image = meta_egl_create_image (egl, egl_display, EGL_NO_CONTEXT,
+                                     EGL_LINUX_DMA_BUF_EXT, NULL,
+                                     attribs,
+                                     error);
+  if (egl_image == EGL_NO_IMAGE_KHR)
+    return FALSE;
+
+  texture = cogl_egl_texture_2d_new_from_image (cogl_context,
+                                                dma_buf->width,
+                                                dma_buf->height,
+                                                dma_buf->format_info->cogl_format,
+                                                egl_image,
+                                                error);
+
+  meta_egl_destroy_image (egl, egl_display, egl_image, NULL);
+
+  if (!texture)
+    return FALSE;
+
+  dma_buf->texture = texture;
+
+  return TRUE;
+}
+
+gboolean
+meta_wayland_dma_buf_buffer_attach (MetaWaylandBuffer  *buffer,
+                                    GError            **error)
+{
+  MetaWaylandDmaBufBuffer *dma_buf = buffer->dma_buf.dma_buf;
+
+  if (buffer->texture)
+    return TRUE;
+
+  /* The texture is created when the buffer is, so that import failures
+   * can be reported to the client; attaching it again is free.
+   */
+  if (!dma_buf->texture &&
+      !meta_wayland_dma_buf_realize_texture (dma_buf, error))
+    return FALSE;
+
+  buffer->texture = COGL_TEXTURE (cogl_object_ref (dma_buf->texture));
+  buffer->is_y_inverted = dma_buf->is_y_inverted;
+
+  return TRUE;
+}
+
+static void
+buffer_params_add (struct wl_client   *client,
+                   struct wl_resource *resource,
+                   int32_t             fd,
+                   uint32_t            plane_idx,
+                   uint32_t            offset,
+                   uint32_t            stride,
+                   uint32_t            drm_modifier_hi,
+                   uint32_t            drm_modifier_lo)
+{
+  MetaWaylandDmaBufBuffer *dma_buf = wl_resource_get_user_data (resource);
+
+  if (!dma_buf)
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_ALREADY_USED,
+                              "params already used");
+      close (fd);
+      return;
+    }
+
+  if (plane_idx >= META_WAYLAND_DMA_BUF_MAX_PLANES)
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_PLANE_IDX,
+                              "out-of-bounds plane index %u",
+                              plane_idx);
+      close (fd);
+      return;
+    }
+
+  if (dma_buf->fds[plane_idx] != -1)
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_PLANE_SET,
+                              "plane index %u already set",
+                              plane_idx);
+      close (fd);
+      return;
+    }
+
+  dma_buf->fds[plane_idx] = fd;
+  dma_buf->offsets[plane_idx] = offset;
+  dma_buf->strides[plane_idx] = stride;
+  dma_buf->modifiers[plane_idx] = ((uint64_t) drm_modifier_hi << 32) |
+                                  drm_modifier_lo;
+}
+
+static void
+buffer_params_destroy (struct wl_client   *client,
+                       struct wl_resource *resource)
+{
+  wl_resource_destroy (resource);
+}
+
+static void
+buffer_params_destructor (struct wl_resource *resource)
+{
+  MetaWaylandDmaBufBuffer *dma_buf = wl_resource_get_user_data (resource);
+
+  /* Only unref if we haven't already handed the buffer over */
+  if (dma_buf)
+    g_object_unref (dma_buf);
+}
+
+static void
+buffer_destroy (struct wl_client   *client,
+                struct wl_resource *resource)
+{
+  wl_resource_destroy (resource);
+}
+
+static void
+buffer_destructor (struct wl_resource *resource)
+{
+  MetaWaylandDmaBufBuffer *dma_buf = wl_resource_get_user_data (resource);
+
+  g_object_unref (dma_buf);
+}
+
+static const struct wl_buffer_interface dma_buf_buffer_impl =
+{
+  buffer_destroy,
+};
+
+MetaWaylandDmaBufBuffer *
+meta_wayland_dma_buf_from_buffer (MetaWaylandBuffer *buffer)
+{
+  if (wl_resource_instance_of (buffer->resource, &wl_buffer_interface,
+                               &dma_buf_buffer_impl))
+    return wl_resource_get_user_data (buffer->resource);
+
+  return NULL;
+}
+
+static const MetaWaylandDmaBufFormatInfo *
+find_format_info (MetaWaylandDmaBufManager *manager,
+                  uint32_t                  drm_format)
+{
+  guint i;
+
+  for (i = 0; i < manager->formats->len; i++)
+    {
+      MetaWaylandDmaBufFormat *format =
+        &g_array_index (manager->formats, MetaWaylandDmaBufFormat, i);
+
+      if (format->info->drm_format == drm_format)
+        return format->info;
+    }
+
+  return NULL;
+}
+
+static gboolean
+validate_buffer_params (struct wl_resource      *params_resource,
+                        MetaWaylandDmaBufBuffer *dma_buf,
+                        int32_t                  width,
+                        int32_t                  height,
+                        uint32_t                 drm_format,
+                        uint32_t                 flags)
+{
+  int n_planes;
+  int i;
+
+  for (n_planes = 0; n_planes < META_WAYLAND_DMA_BUF_MAX_PLANES; n_planes++)
+    {
+      if (dma_buf->fds[n_planes] == -1)
+        break;
+    }
+
+  if (n_planes == 0)
+    {
+      wl_resource_post_error (params_resource,
+                              ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INCOMPLETE,
+                              "no dmabuf has been added for plane 0");
+      return FALSE;
+    }
+
+  for (i = n_planes; i < META_WAYLAND_DMA_BUF_MAX_PLANES; i++)
+    {
+      if (dma_buf->fds[i] != -1)
+        {
+          wl_resource_post_error (params_resource,
+                                  ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INCOMPLETE,
+                                  "no dmabuf has been added for plane %d",
+                                  n_planes);
+          return FALSE;
+        }
+    }
+
+  for (i = 1; i < n_planes; i++)
+    {
+      if (dma_buf->modifiers[i] != dma_buf->modifiers[0])
+        {
+          wl_resource_post_error (params_resource,
+                                  ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INVALID_FORMAT,
+                                  "modifier of plane %d doesn't match plane 0",
+                                  i);
+          return FALSE;
+        }
+    }
+
+  if (width <= 0 || height <= 0)
+    {
+      wl_resource_post_error (params_resource,
+                              ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INVALID_DIMENSIONS,
+                              "invalid width %d or height %d",
+                              width, height);
+      return FALSE;
+    }
+
+  if (flags & ~ZWP_LINUX_BUFFER_PARAMS_V1_FLAGS_Y_INVERT)
+    {
+      wl_resource_post_error (params_resource,
+                              ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INVALID_FORMAT,
+                              "unsupported flags 0x%x",
+                              flags);
+      return FALSE;
+    }
+
+  if (!find_format_info (dma_buf->manager, drm_format))
+    {
+      wl_resource_post_error (params_resource,
+                              ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INVALID_FORMAT,
+                              "unsupported format 0x%x",
+                              drm_format);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+buffer_params_create_common (struct wl_client   *client,
+                             struct wl_resource *params_resource,
+                             uint32_t            buffer_id,
+                             int32_t             width,
+                             int32_t             height,
+                             uint32_t            drm_format,
+                             uint32_t            flags)
+{
+  MetaWaylandDmaBufBuffer *dma_buf;
+  struct wl_resource *buffer_resource;
+  GError *error = NULL;
+
+  dma_buf = wl_resource_get_user_data (params_resource);
+  if (!dma_buf)
+    {
+      wl_resource_post_error (params_resource,
+                              ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_ALREADY_USED,
+                              "params already used");
+      return;
+    }
+
+  /* The params can only be used once */
+  wl_resource_set_user_data (params_resource, NULL);
+
+  if (!validate_buffer_params (params_resource, dma_buf,
+                               width, height, drm_format, flags))
+    {
+      g_object_unref (dma_buf);
+      return;
+    }
+
+  dma_buf->width = width;
+  dma_buf->height = height;
+  dma_buf->format_info = find_format_info (dma_buf->manager, drm_format);
+  dma_buf->is_y_inverted = !(flags & ZWP_LINUX_BUFFER_PARAMS_V1_FLAGS_Y_INVERT);
+
+  if (!meta_wayland_dma_buf_realize_texture (dma_buf, &error))
+    {
+      if (buffer_id == 0)
+        {
+          zwp_linux_buffer_params_v1_send_failed (params_resource);
+        }
+      else
+        {
+          wl_resource_post_error (params_resource,
+                                  ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INVALID_WL_BUFFER,
+                                  "failed to import supplied dmabufs: %s",
+                                  error ? error->message : "unknown error");
+        }
+
+      g_clear_error (&error);
+      g_object_unref (dma_buf);
+      return;
+    }
+
+  buffer_resource = wl_resource_create (client, &wl_buffer_interface, 1, buffer_id);
+  if (!buffer_resource)
+    {
+      wl_client_post_no_memory (client);
+      g_object_unref (dma_buf);
+      return;
+    }
+
+  /* The wl_buffer owns the dma-buf from now on */
+  wl_resource_set_implementation (buffer_resource, &dma_buf_buffer_impl,
+                                  dma_buf, buffer_destructor);
+
+  if (buffer_id == 0)
+    zwp_linux_buffer_params_v1_send_created (params_resource, buffer_resource);
+}
+
+static void
+buffer_params_create (struct wl_client   *client,
+                      struct wl_resource *params_resource,
+                      int32_t             width,
+                      int32_t             height,
+                      uint32_t            format,
+                      uint32_t            flags)
+{
+  buffer_params_create_common (client, params_resource, 0,
+                               width, height, format, flags);
+}
+
+static void
+buffer_params_create_immed (struct wl_client   *client,
+                            struct wl_resource *params_resource,
+                            uint32_t            buffer_id,
+                            int32_t             width,
+                            int32_t             height,
+                            uint32_t            format,
+                            uint32_t            flags)
+{
+  buffer_params_create_common (client, params_resource, buffer_id,
+                               width, height, format, flags);
+}
+
+static const struct zwp_linux_buffer_params_v1_interface buffer_params_implementation =
+{
+  buffer_params_destroy,
+  buffer_params_add,
+  buffer_params_create,
+  buffer_params_create_immed,
+};
+
+static void
+dma_buf_handle_destroy (struct wl_client   *client,
+                        struct wl_resource *resource)
+{
+  wl_resource_destroy (resource);
+}
+
+static void
+dma_buf_handle_create_buffer_params (struct wl_client   *client,
+                                     struct wl_resource *dma_buf_resource,
+                                     uint32_t            params_id)
+{
+  MetaWaylandDmaBufManager *manager =
+    wl_resource_get_user_data (dma_buf_resource);
+  struct wl_resource *params_resource;
+  MetaWaylandDmaBufBuffer *dma_buf;
+
+  params_resource =
+    wl_resource_create (client,
+                        &zwp_linux_buffer_params_v1_interface,
+                        wl_resource_get_version (dma_buf_resource),
+                        params_id);
+  if (!params_resource)
+    {
+      wl_client_post_no_memory (client);
+      return;
+    }
+
+  dma_buf = g_object_new (META_TYPE_WAYLAND_DMA_BUF_BUFFER, NULL);
+  dma_buf->manager = manager;
+
+  wl_resource_set_implementation (params_resource,
+                                  &buffer_params_implementation,
+                                  dma_buf,
+                                  buffer_params_destructor);
+}
+
+static const struct zwp_linux_dmabuf_v1_interface dma_buf_implementation =
+{
+  dma_buf_handle_destroy,
+  dma_buf_handle_create_buffer_params,
+};
+
+static void
+send_format (struct wl_resource      *resource,
+             MetaWaylandDmaBufFormat *format)
+{
+  uint32_t drm_format = format->info->drm_format;
+  guint i;
+
+  zwp_linux_dmabuf_v1_send_format (resource, drm_format);
+
+  /* The modifier event was only added in version 3 */
+  if (wl_resource_get_version (resource) <
+      ZWP_LINUX_DMABUF_V1_MODIFIER_SINCE_VERSION)
+    return;
+
+  if (format->modifiers->len == 0)
+    {
+      zwp_linux_dmabuf_v1_send_modifier (resource, drm_format,
+                                         DRM_FORMAT_MOD_INVALID >> 32,
+                                         DRM_FORMAT_MOD_INVALID & 0xffffffff);
+      return;
+    }
+
+  for (i = 0; i < format->modifiers->len; i++)
+    {
+      uint64_t modifier = g_array_index (format->modifiers, uint64_t, i);
+
+      zwp_linux_dmabuf_v1_send_modifier (resource, drm_format,
+                                         modifier >> 32,
+                                         modifier & 0xffffffff);
+    }
+}
+
+static void
+dma_buf_bind (struct wl_client *client,
+              void             *data,
+              uint32_t          version,
+              uint32_t          id)
+{
+  MetaWaylandDmaBufManager *manager = data;
+  struct wl_resource *resource;
+  guint i;
+
+  resource = wl_resource_create (client, &zwp_linux_dmabuf_v1_interface,
+                                 version, id);
+  if (!resource)
+    {
+      wl_client_post_no_memory (client);
+      return;
+    }
+
+  wl_resource_set_implementation (resource, &dma_buf_implementation,
+                                  manager, NULL);
+
+  for (i = 0; i < manager->formats->len; i++)
+    send_format (resource,
+                 &g_array_index (manager->formats, MetaWaylandDmaBufFormat, i));
+}
+
+static GArray *
+query_modifiers (MetaEgl    *egl,
+                 EGLDisplay  egl_display,
+                 uint32_t    drm_format)
+{
+  GArray *modifiers;
+  EGLuint64KHR *egl_modifiers;
+  EGLBoolean *external_only;
+  EGLint n_modifiers;
+  EGLint i;
+
+  modifiers = g_array_new (FALSE, FALSE, sizeof (uint64_t));
+
+  if (!meta_egl_query_dma_buf_modifiers (egl, egl_display, drm_format,
+                                         0, NULL, NULL,
+                                         &n_modifiers, NULL) ||
+      n_modifiers == 0)
+    return modifiers;
+
+  egl_modifiers = g_new0 (EGLuint64KHR, n_modifiers);
+  external_only = g_new0 (EGLBoolean, n_modifiers);
+
+  if (meta_egl_query_dma_buf_modifiers (egl, egl_display, drm_format,
+                                        n_modifiers, egl_modifiers,
+                                        external_only,
+                                        &n_modifiers, NULL))
+    {
+      for (i = 0; i < n_modifiers; i++)
+        {
+          uint64_t modifier = egl_modifiers[i];
+
+          /* We sample from GL_TEXTURE_2D, not GL_TEXTURE_EXTERNAL_OES */
+          if (external_only[i])
+            continue;
+
+          g_array_append_val (modifiers, modifier);
+        }
+    }
+
+  g_free (egl_modifiers);
+  g_free (external_only);
+
+  return modifiers;
+}
+
+static GArray *
+query_formats (MetaEgl    *egl,
+               EGLDisplay  egl_display)
+{
+  GArray *formats;
+  EGLint *egl_formats = NULL;
+  EGLint n_egl_formats = 0;
+  gboolean has_modifiers;
+  guint i;
+  EGLint j;
+
+  formats = g_array_new (FALSE, FALSE, sizeof (MetaWaylandDmaBufFormat));
+
+  /* Without EGL_EXT_image_dma_buf_import_modifiers, EGL can't tell what
+   * it supports; assume the common formats with implicit modifiers.
+   */
+  has_modifiers =
+    meta_egl_has_extensions (egl, egl_display, NULL,
+                             "EGL_EXT_image_dma_buf_import_modifiers",
+                             NULL) &&
+    meta_egl_query_dma_buf_formats (egl, egl_display, 0, NULL,
+                                    &n_egl_formats, NULL);
+
+  if (has_modifiers)
+    {
+      egl_formats = g_new0 (EGLint, n_egl_formats);
+      if (!meta_egl_query_dma_buf_formats (egl, egl_display,
+                                           n_egl_formats, egl_formats,
+                                           &n_egl_formats, NULL))
+        n_egl_formats = 0;
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (format_infos); i++)
+    {
+      MetaWaylandDmaBufFormat format;
+
+      format.info = &format_infos[i];
+
+      if (has_modifiers)
+        {
+          for (j = 0; j < n_egl_formats; j++)
+            {
+              if ((uint32_t) egl_formats[j] == format.info->drm_format)
+                break;
+            }
+
+          if (j == n_egl_formats)
+            continue;
+
+          format.modifiers = query_modifiers (egl, egl_display,
+                                              format.info->drm_format);
+        }
+      else
+        {
+          format.modifiers = g_array_new (FALSE, FALSE, sizeof (uint64_t));
+        }
+
+      g_array_append_val (formats, format);
+    }
+
+  g_free (egl_formats);
+
+  return formats;
+}
+
+gboolean
+meta_wayland_dma_buf_init (MetaWaylandCompositor *compositor)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaEgl *egl = meta_backend_get_egl (backend);
+  ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
+  CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
+  EGLDisplay egl_display = cogl_egl_context_get_egl_display (cogl_context);
+  MetaWaylandDmaBufManager *manager;
+
+  if (!meta_egl_has_extensions (egl, egl_display, NULL,
+                                "EGL_EXT_image_dma_buf_import",
+                                NULL))
+    return FALSE;
+
+  manager = g_new0 (MetaWaylandDmaBufManager, 1);
+  manager->compositor = compositor;
+  manager->formats = query_formats (egl, egl_display);
+
+  if (manager->formats->len == 0 ||
+      !wl_global_create (compositor->wayland_display,
+                         &zwp_linux_dmabuf_v1_interface,
+                         META_ZWP_LINUX_DMABUF_V1_VERSION,
+                         manager,
+                         dma_buf_bind))
+    {
+      g_array_free (manager->formats, TRUE);
+      g_free (manager);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+meta_wayland_dma_buf_buffer_finalize (GObject *object)
+{
+  MetaWaylandDmaBufBuffer *dma_buf = META_WAYLAND_DMA_BUF_BUFFER (object);
+  int i;
+
+  g_clear_pointer (&dma_buf->texture, cogl_object_unref);
+
+  for (i = 0; i < META_WAYLAND_DMA_BUF_MAX_PLANES; i++)
+    {
+      if (dma_buf->fds[i] != -1)
+        close (dma_buf->fds[i]);
+    }
+
+  G_OBJECT_CLASS (meta_wayland_dma_buf_buffer_parent_class)->finalize (object);
+}
+
+static void
+meta_wayland_dma_buf_buffer_init (MetaWaylandDmaBufBuffer *dma_buf)
+{
+  int i;
+
+  for (i = 0; i < META_WAYLAND_DMA_BUF_MAX_PLANES; i++)
+    {
+      dma_buf->fds[i] = -1;
+      dma_buf->modifiers[i] = DRM_FORMAT_MOD_INVALID;
+    }
+}
+
+static void
+meta_wayland_dma_buf_buffer_class_init (MetaWaylandDmaBufBufferClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = meta_wayland_dma_buf_buffer_finalize;
+}
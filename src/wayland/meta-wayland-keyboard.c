@@ -66,6 +66,17 @@
 #endif
 
 #define GSD_KEYBOARD_SCHEMA "org.gnome.settings-daemon.peripherals.keyboard"
+
+/* Layout switches usually go back and forth between a few keymaps */
+#define MAX_CACHED_KEYMAPS 4
+
+typedef struct
+{
+  char *keymap_str;
+  guint hash;
+  int fd;
+  size_t size;
+} MetaWaylandKeymapFile;
 typedef enum
 {
   GSD_KEYBOARD_NUM_LOCK_STATE_UNKNOWN,
@@ -126,11 +137,162 @@ create_anonymous_file (off_t size,
   return -1;
 }
 
+static gboolean
+write_all (int         fd,
+           const char *data,
+           size_t      size)
+{
+  while (size > 0)
+    {
+      ssize_t written = write (fd, data, size);
+
+      if (written < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          return FALSE;
+        }
+
+      data += written;
+      size -= written;
+    }
+
+  return TRUE;
+}
+
+static int
+create_keymap_file (const char  *keymap_str,
+                    size_t       size,
+                    GError     **error)
+{
+  int fd = -1;
+
+#ifdef HAVE_MEMFD_CREATE
+  fd = memfd_create ("mutter-keymap", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#endif
+
+  if (fd < 0)
+    {
+      fd = create_anonymous_file (0, error);
+      if (fd < 0)
+        return -1;
+    }
+
+  if (!write_all (fd, keymap_str, size))
+    {
+      g_set_error_literal (error,
+                           G_FILE_ERROR,
+                           g_file_error_from_errno (errno),
+                           strerror (errno));
+      close (fd);
+      return -1;
+    }
+
+#if defined(HAVE_MEMFD_CREATE) && defined(F_ADD_SEALS)
+  /* Every client gets the same file, so make sure none of them can
+   * change it under the others' feet. This fails on the temporary
+   * file fallback, which is then shared unsealed as before.
+   */
+  fcntl (fd, F_ADD_SEALS,
+         F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+#endif
+
+  return fd;
+}
+
+static void
+keymap_file_free (MetaWaylandKeymapFile *keymap_file)
+{
+  close (keymap_file->fd);
+  free (keymap_file->keymap_str);
+  g_slice_free (MetaWaylandKeymapFile, keymap_file);
+}
+
+/* Takes ownership of @keymap_str */
+static MetaWaylandKeymapFile *
+ensure_keymap_file (MetaWaylandXkbInfo *xkb_info,
+                    char               *keymap_str)
+{
+  MetaWaylandKeymapFile *keymap_file;
+  GError *error = NULL;
+  guint hash;
+  GList *l;
+  int fd;
+
+  hash = g_str_hash (keymap_str);
+
+  for (l = xkb_info->keymap_files; l; l = l->next)
+    {
+      keymap_file = l->data;
+
+      if (keymap_file->hash == hash &&
+          strcmp (keymap_file->keymap_str, keymap_str) == 0)
+        {
+          free (keymap_str);
+
+          xkb_info->keymap_files =
+            g_list_delete_link (xkb_info->keymap_files, l);
+          xkb_info->keymap_files =
+            g_list_prepend (xkb_info->keymap_files, keymap_file);
+
+          return keymap_file;
+        }
+    }
+
+  fd = create_keymap_file (keymap_str, strlen (keymap_str) + 1, &error);
+  if (fd < 0)
+    {
+      g_warning ("creating a keymap file for %lu bytes failed: %s",
+                 (unsigned long) strlen (keymap_str) + 1,
+                 error->message);
+      g_clear_error (&error);
+      free (keymap_str);
+      return NULL;
+    }
+
+  keymap_file = g_slice_new0 (MetaWaylandKeymapFile);
+  keymap_file->keymap_str = keymap_str;
+  keymap_file->hash = hash;
+  keymap_file->fd = fd;
+  keymap_file->size = strlen (keymap_str) + 1;
+
+  xkb_info->keymap_files = g_list_prepend (xkb_info->keymap_files,
+                                           keymap_file);
+
+  /* The one in use is at the front, so never evicted */
+  l = g_list_nth (xkb_info->keymap_files, MAX_CACHED_KEYMAPS);
+  if (l)
+    {
+      l->prev->next = NULL;
+      l->prev = NULL;
+      g_list_free_full (l, (GDestroyNotify) keymap_file_free);
+    }
+
+  return keymap_file;
+}
+
+static void
+invalidate_focus_modifiers (MetaWaylandKeyboard *keyboard)
+{
+  /* No serialized state has an invalid layout, so the next broadcast
+   * always goes out.
+   */
+  keyboard->focus_modifiers = (MetaWaylandXkbModifiers) {
+    .group = XKB_LAYOUT_INVALID
+  };
+}
+
 static void
 inform_clients_of_new_keymap (MetaWaylandKeyboard *keyboard)
 {
   struct wl_resource *keyboard_resource;
 
+  /* Clients start over with a fresh xkb state on a new keymap, so they
+   * need the modifiers again even if the masks happen to be the same.
+   */
+  invalidate_focus_modifiers (keyboard);
+
   wl_resource_for_each (keyboard_resource, &keyboard->resource_list)
     {
       wl_keyboard_send_keymap (keyboard_resource,
@@ -152,9 +314,8 @@ meta_wayland_keyboard_take_keymap (MetaWaylandKeyboard *keyboard,
 				   struct xkb_keymap   *keymap)
 {
   MetaWaylandXkbInfo  *xkb_info = &keyboard->xkb_info;
-  GError *error = NULL;
+  MetaWaylandKeymapFile *keymap_file;
   char *keymap_str;
-  size_t previous_size;
 
   if (keymap == NULL)
     {
@@ -173,49 +334,24 @@ meta_wayland_keyboard_take_keymap (MetaWaylandKeyboard *keyboard,
       g_warning ("failed to get string version of keymap");
       return;
     }
-  previous_size = xkb_info->keymap_size;
-  xkb_info->keymap_size = strlen (keymap_str) + 1;
-
-  if (xkb_info->keymap_fd >= 0)
-    close (xkb_info->keymap_fd);
 
-  xkb_info->keymap_fd = create_anonymous_file (xkb_info->keymap_size, &error);
-  if (xkb_info->keymap_fd < 0)
+  keymap_file = ensure_keymap_file (xkb_info, keymap_str);
+  if (!keymap_file)
     {
-      g_warning ("creating a keymap file for %lu bytes failed: %s",
-                 (unsigned long) xkb_info->keymap_size,
-                 error->message);
-      g_clear_error (&error);
-      goto err_keymap_str;
+      xkb_info->keymap_fd = -1;
+      return;
     }
 
-  if (xkb_info->keymap_area)
-    munmap (xkb_info->keymap_area, previous_size);
-
-  xkb_info->keymap_area = mmap (NULL, xkb_info->keymap_size,
-                                PROT_READ | PROT_WRITE,
-                                MAP_SHARED, xkb_info->keymap_fd, 0);
-  if (xkb_info->keymap_area == MAP_FAILED)
+  /* Clients already have the file if the keymap did not actually change */
+  if (keymap_file->fd != xkb_info->keymap_fd)
     {
-      g_warning ("failed to mmap() %lu bytes\n",
-                 (unsigned long) xkb_info->keymap_size);
-      goto err_dev_zero;
-    }
-  strcpy (xkb_info->keymap_area, keymap_str);
-  free (keymap_str);
+      xkb_info->keymap_fd = keymap_file->fd;
+      xkb_info->keymap_size = keymap_file->size;
 
-  inform_clients_of_new_keymap (keyboard);
+      inform_clients_of_new_keymap (keyboard);
+    }
 
   notify_modifiers (keyboard);
-
-  return;
-
-err_dev_zero:
-  close (xkb_info->keymap_fd);
-  xkb_info->keymap_fd = -1;
-err_keymap_str:
-  free (keymap_str);
-  return;
 }
 
 static void
@@ -329,20 +465,29 @@ add_virtual_mods (xkb_mod_mask_t mask)
   return mask;
 }
 
-static void
-keyboard_send_modifiers (MetaWaylandKeyboard *keyboard,
-                         struct wl_resource  *resource,
-                         uint32_t             serial)
+static MetaWaylandXkbModifiers
+get_xkb_modifiers (MetaWaylandKeyboard *keyboard)
 {
   struct xkb_state *state = keyboard->xkb_info.state;
-  xkb_mod_mask_t depressed, latched, locked;
 
-  depressed = add_virtual_mods (xkb_state_serialize_mods (state, XKB_STATE_MODS_DEPRESSED));
-  latched = add_virtual_mods (xkb_state_serialize_mods (state, XKB_STATE_MODS_LATCHED));
-  locked = add_virtual_mods (xkb_state_serialize_mods (state, XKB_STATE_MODS_LOCKED));
+  return (MetaWaylandXkbModifiers) {
+    .depressed = add_virtual_mods (xkb_state_serialize_mods (state, XKB_STATE_MODS_DEPRESSED)),
+    .latched = add_virtual_mods (xkb_state_serialize_mods (state, XKB_STATE_MODS_LATCHED)),
+    .locked = add_virtual_mods (xkb_state_serialize_mods (state, XKB_STATE_MODS_LOCKED)),
+    .group = xkb_state_serialize_layout (state, XKB_STATE_LAYOUT_EFFECTIVE)
+  };
+}
 
-  wl_keyboard_send_modifiers (resource, serial, depressed, latched, locked,
-                              xkb_state_serialize_layout (state, XKB_STATE_LAYOUT_EFFECTIVE));
+static void
+keyboard_send_modifiers (struct wl_resource            *resource,
+                         uint32_t                       serial,
+                         const MetaWaylandXkbModifiers *modifiers)
+{
+  wl_keyboard_send_modifiers (resource, serial,
+                              modifiers->depressed,
+                              modifiers->latched,
+                              modifiers->locked,
+                              modifiers->group);
 }
 
 static void
@@ -354,12 +499,22 @@ meta_wayland_keyboard_broadcast_modifiers (MetaWaylandKeyboard *keyboard)
     {
       MetaWaylandInputDevice *input_device =
         META_WAYLAND_INPUT_DEVICE (keyboard);
+      MetaWaylandXkbModifiers modifiers;
       uint32_t serial;
 
+      /* Key events and layout or keymap changes often leave the
+       * modifiers as the focused client last saw them.
+       */
+      modifiers = get_xkb_modifiers (keyboard);
+      if (memcmp (&modifiers, &keyboard->focus_modifiers,
+                  sizeof (MetaWaylandXkbModifiers)) == 0)
+        return;
+
+      keyboard->focus_modifiers = modifiers;
       serial = meta_wayland_input_device_next_serial (input_device);
 
       wl_resource_for_each (resource, &keyboard->focus_resource_list)
-        keyboard_send_modifiers (keyboard, resource, serial);
+        keyboard_send_modifiers (resource, serial, &modifiers);
     }
 }
 
@@ -649,16 +804,10 @@ meta_wayland_xkb_info_destroy (MetaWaylandXkbInfo *xkb_info)
   g_clear_pointer (&xkb_info->keymap, xkb_keymap_unref);
   g_clear_pointer (&xkb_info->state, xkb_state_unref);
 
-  if (xkb_info->keymap_area)
-    {
-      munmap (xkb_info->keymap_area, xkb_info->keymap_size);
-      xkb_info->keymap_area = NULL;
-    }
-  if (xkb_info->keymap_fd >= 0)
-    {
-      close (xkb_info->keymap_fd);
-      xkb_info->keymap_fd = -1;
-    }
+  g_list_free_full (xkb_info->keymap_files,
+                    (GDestroyNotify) keymap_file_free);
+  xkb_info->keymap_files = NULL;
+  xkb_info->keymap_fd = -1;
 }
 
 void
@@ -818,7 +967,9 @@ broadcast_focus (MetaWaylandKeyboard *keyboard,
    */
   wl_array_init (&fake_keys);
 
-  keyboard_send_modifiers (keyboard, resource, keyboard->focus_serial);
+  keyboard->focus_modifiers = get_xkb_modifiers (keyboard);
+  keyboard_send_modifiers (resource, keyboard->focus_serial,
+                           &keyboard->focus_modifiers);
   wl_keyboard_send_enter (resource, keyboard->focus_serial,
                           keyboard->focus_surface->resource,
                           &fake_keys);
@@ -967,6 +1118,7 @@ meta_wayland_keyboard_init (MetaWaylandKeyboard *keyboard)
   wl_list_init (&keyboard->focus_resource_list);
 
   meta_wayland_xkb_info_init (&keyboard->xkb_info);
+  invalidate_focus_modifiers (keyboard);
 
   keyboard->default_grab.interface = &default_keyboard_grab_interface;
   keyboard->default_grab.keyboard = keyboard;
@@ -76,9 +76,19 @@ typedef struct
   struct xkb_state *state;
   int keymap_fd;
   size_t keymap_size;
-  char *keymap_area;
+
+  /* Files of the recently used keymaps, most recent first */
+  GList *keymap_files;
 } MetaWaylandXkbInfo;
 
+typedef struct
+{
+  xkb_mod_mask_t depressed;
+  xkb_mod_mask_t latched;
+  xkb_mod_mask_t locked;
+  xkb_layout_index_t group;
+} MetaWaylandXkbModifiers;
+
 struct _MetaWaylandKeyboard
 {
   MetaWaylandInputDevice parent;
@@ -94,6 +104,9 @@ struct _MetaWaylandKeyboard
   MetaWaylandXkbInfo xkb_info;
   enum xkb_state_component mods_changed;
 
+  /* The modifiers the resources in focus_resource_list were sent last */
+  MetaWaylandXkbModifiers focus_modifiers;
+
   MetaWaylandKeyboardGrab *grab;
   MetaWaylandKeyboardGrab default_grab;
 
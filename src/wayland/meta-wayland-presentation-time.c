@@ -0,0 +1,330 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * Copyright (C) 2017 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Implementation of wp_presentation. A feedback requested for a content
+ * update is tagged with the stage frame counter of the first frame that
+ * painted the surface after the update was committed, and answered when
+ * Cogl reports that frame as complete, using the presentation time and
+ * refresh rate from the page flip.
+ */
+
+#include "config.h"
+
+#include "wayland/meta-wayland-presentation-time.h"
+
+#include <time.h>
+
+#include "compositor/meta-surface-actor.h"
+#include "meta/meta-backend.h"
+#include "wayland/meta-wayland-outputs.h"
+#include "wayland/meta-wayland-private.h"
+#include "wayland/meta-wayland-surface.h"
+#include "wayland/meta-wayland-versions.h"
+
+#include "presentation-time-server-protocol.h"
+
+typedef struct _MetaWaylandPresentationFeedback
+{
+  struct wl_list link;
+  struct wl_resource *resource;
+  MetaWaylandSurface *surface;
+
+  /* The stage frame counter of the frame that first showed the content
+   * update, or -1 if it hasn't been painted yet.
+   */
+  int64_t frame_counter;
+} MetaWaylandPresentationFeedback;
+
+static void
+feedback_destructor (struct wl_resource *resource)
+{
+  MetaWaylandPresentationFeedback *feedback =
+    wl_resource_get_user_data (resource);
+
+  wl_list_remove (&feedback->link);
+  g_slice_free (MetaWaylandPresentationFeedback, feedback);
+}
+
+static void
+discard_feedback (MetaWaylandPresentationFeedback *feedback)
+{
+  wp_presentation_feedback_send_discarded (feedback->resource);
+  wl_resource_destroy (feedback->resource);
+}
+
+void
+meta_wayland_presentation_time_discard_list (struct wl_list *feedbacks)
+{
+  MetaWaylandPresentationFeedback *feedback, *next;
+
+  wl_list_for_each_safe (feedback, next, feedbacks, link)
+    discard_feedback (feedback);
+}
+
+static void
+presentation_destroy (struct wl_client   *client,
+                      struct wl_resource *resource)
+{
+  wl_resource_destroy (resource);
+}
+
+static void
+presentation_feedback (struct wl_client   *client,
+                       struct wl_resource *resource,
+                       struct wl_resource *surface_resource,
+                       uint32_t            id)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (surface_resource);
+  MetaWaylandPresentationFeedback *feedback;
+
+  feedback = g_slice_new0 (MetaWaylandPresentationFeedback);
+  feedback->resource = wl_resource_create (client,
+                                           &wp_presentation_feedback_interface,
+                                           wl_resource_get_version (resource),
+                                           id);
+  wl_resource_set_implementation (feedback->resource, NULL, feedback,
+                                  feedback_destructor);
+
+  /* X11 unmanaged window */
+  if (!surface)
+    {
+      wl_list_init (&feedback->link);
+      discard_feedback (feedback);
+      return;
+    }
+
+  feedback->surface = surface;
+  feedback->frame_counter = -1;
+  wl_list_insert (surface->pending->presentation_feedback_list.prev,
+                  &feedback->link);
+}
+
+static const struct wp_presentation_interface presentation_interface = {
+  presentation_destroy,
+  presentation_feedback,
+};
+
+static void
+presentation_bind (struct wl_client *client,
+                   void             *data,
+                   uint32_t          version,
+                   uint32_t          id)
+{
+  struct wl_resource *resource;
+
+  resource = wl_resource_create (client, &wp_presentation_interface,
+                                 version, id);
+  wl_resource_set_implementation (resource, &presentation_interface,
+                                  data, NULL);
+
+  wp_presentation_send_clock_id (resource, CLOCK_MONOTONIC);
+}
+
+void
+meta_wayland_presentation_time_init (MetaWaylandCompositor *compositor)
+{
+  wl_list_init (&compositor->presentation_time.feedbacks);
+
+  if (wl_global_create (compositor->wayland_display,
+                        &wp_presentation_interface,
+                        META_WP_PRESENTATION_VERSION,
+                        compositor, presentation_bind) == NULL)
+    g_error ("Failed to register a global wp_presentation object");
+}
+
+void
+meta_wayland_presentation_time_commit (MetaWaylandSurface *surface,
+                                       struct wl_list     *feedbacks)
+{
+  MetaWaylandPresentationTime *presentation_time =
+    &surface->compositor->presentation_time;
+  MetaWaylandPresentationFeedback *feedback, *next;
+
+  /* A new content update supersedes the ones of the same surface that
+   * were not painted yet; those will never be presented.
+   */
+  wl_list_for_each_safe (feedback, next, &presentation_time->feedbacks, link)
+    {
+      if (feedback->surface == surface && feedback->frame_counter == -1)
+        discard_feedback (feedback);
+    }
+
+  wl_list_insert_list (presentation_time->feedbacks.prev, feedbacks);
+  wl_list_init (feedbacks);
+}
+
+void
+meta_wayland_presentation_time_surface_destroyed (MetaWaylandSurface *surface)
+{
+  MetaWaylandPresentationTime *presentation_time =
+    &surface->compositor->presentation_time;
+  MetaWaylandPresentationFeedback *feedback, *next;
+
+  wl_list_for_each_safe (feedback, next, &presentation_time->feedbacks, link)
+    {
+      if (feedback->surface == surface)
+        discard_feedback (feedback);
+    }
+}
+
+void
+meta_wayland_presentation_time_paint_finished (MetaWaylandCompositor *compositor)
+{
+  MetaWaylandPresentationTime *presentation_time =
+    &compositor->presentation_time;
+  MetaWaylandPresentationFeedback *feedback;
+  ClutterActor *stage = NULL;
+
+  wl_list_for_each (feedback, &presentation_time->feedbacks, link)
+    {
+      ClutterActor *actor;
+
+      if (feedback->frame_counter != -1)
+        continue;
+
+      actor = CLUTTER_ACTOR (feedback->surface->surface_actor);
+      if (!clutter_actor_is_mapped (actor))
+        continue;
+
+      if (!stage)
+        stage = meta_backend_get_stage (meta_get_backend ());
+
+      feedback->frame_counter =
+        clutter_stage_get_frame_counter (CLUTTER_STAGE (stage));
+    }
+}
+
+static int64_t
+get_monotonic_time_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * G_GINT64_CONSTANT (1000000000) + ts.tv_nsec;
+}
+
+static void
+send_sync_outputs (MetaWaylandPresentationFeedback *feedback)
+{
+  struct wl_client *client = wl_resource_get_client (feedback->resource);
+  GHashTableIter iter;
+  gpointer key;
+
+  g_hash_table_iter_init (&iter,
+                          feedback->surface->outputs_to_destroy_notify_id);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      MetaWaylandOutput *wayland_output = key;
+      GList *l;
+
+      for (l = wayland_output->resources; l; l = l->next)
+        {
+          struct wl_resource *output_resource = l->data;
+
+          if (wl_resource_get_client (output_resource) == client)
+            wp_presentation_feedback_send_sync_output (feedback->resource,
+                                                       output_resource);
+        }
+    }
+}
+
+void
+meta_wayland_presentation_time_presented (MetaWaylandCompositor *compositor,
+                                          ClutterFrameInfo      *frame_info)
+{
+  MetaWaylandPresentationTime *presentation_time =
+    &compositor->presentation_time;
+  MetaWaylandPresentationFeedback *feedback, *next;
+  int64_t presentation_time_ns;
+  int64_t refresh_interval_ns;
+  uint32_t flags;
+
+  if (frame_info->refresh_rate >= 1.0)
+    refresh_interval_ns = (int64_t) (0.5 + 1000000000.0 / frame_info->refresh_rate);
+  else
+    refresh_interval_ns = 0;
+
+  if (frame_info->presentation_time != 0)
+    {
+      ClutterBackend *clutter_backend = clutter_get_default_backend ();
+      CoglContext *cogl_context =
+        clutter_backend_get_cogl_context (clutter_backend);
+
+      /* Cogl reports the presentation time in nanoseconds of its own
+       * clock; see on_presented() in compositor.c.
+       */
+      presentation_time_ns =
+        get_monotonic_time_ns () +
+        (frame_info->presentation_time - cogl_get_clock_time (cogl_context));
+      flags = (WP_PRESENTATION_FEEDBACK_KIND_VSYNC |
+               WP_PRESENTATION_FEEDBACK_KIND_HW_CLOCK |
+               WP_PRESENTATION_FEEDBACK_KIND_HW_COMPLETION);
+    }
+  else
+    {
+      presentation_time_ns = get_monotonic_time_ns ();
+      flags = 0;
+    }
+
+  /* There is no vblank counter exposed to us, so keep a synthetic one
+   * that advances by the number of refresh cycles between presentations.
+   */
+  if (presentation_time->last_presentation_time != 0 &&
+      refresh_interval_ns > 0 &&
+      presentation_time_ns > presentation_time->last_presentation_time)
+    {
+      int64_t elapsed_ns = (presentation_time_ns -
+                            presentation_time->last_presentation_time);
+
+      presentation_time->seq += MAX (1, ((elapsed_ns + refresh_interval_ns / 2) /
+                                         refresh_interval_ns));
+    }
+  else
+    {
+      presentation_time->seq++;
+    }
+  presentation_time->last_presentation_time = presentation_time_ns;
+
+  wl_list_for_each_safe (feedback, next, &presentation_time->feedbacks, link)
+    {
+      uint64_t tv_sec;
+      uint32_t tv_nsec;
+
+      if (feedback->frame_counter == -1 ||
+          feedback->frame_counter > frame_info->frame_counter)
+        continue;
+
+      tv_sec = presentation_time_ns / 1000000000;
+      tv_nsec = presentation_time_ns % 1000000000;
+
+      send_sync_outputs (feedback);
+      wp_presentation_feedback_send_presented (feedback->resource,
+                                               (uint32_t) (tv_sec >> 32),
+                                               (uint32_t) tv_sec,
+                                               tv_nsec,
+                                               (uint32_t) refresh_interval_ns,
+                                               (uint32_t) (presentation_time->seq >> 32),
+                                               (uint32_t) presentation_time->seq,
+                                               flags);
+      wl_resource_destroy (feedback->resource);
+    }
+}
@@ -0,0 +1,57 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * Copyright (C) 2017 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_WAYLAND_PRESENTATION_TIME_H
+#define META_WAYLAND_PRESENTATION_TIME_H
+
+#include <glib.h>
+#include <wayland-server.h>
+
+#include <clutter/clutter.h>
+#include "wayland/meta-wayland-types.h"
+
+typedef struct _MetaWaylandPresentationTime
+{
+  /* Feedbacks of committed content updates that have not been presented
+   * yet, in commit order.
+   */
+  struct wl_list feedbacks;
+
+  /* State of the synthetic vertical retrace counter */
+  uint64_t seq;
+  int64_t last_presentation_time;
+} MetaWaylandPresentationTime;
+
+void meta_wayland_presentation_time_init (MetaWaylandCompositor *compositor);
+
+void meta_wayland_presentation_time_commit (MetaWaylandSurface *surface,
+                                            struct wl_list     *feedbacks);
+
+void meta_wayland_presentation_time_discard_list (struct wl_list *feedbacks);
+
+void meta_wayland_presentation_time_surface_destroyed (MetaWaylandSurface *surface);
+
+void meta_wayland_presentation_time_paint_finished (MetaWaylandCompositor *compositor);
+
+void meta_wayland_presentation_time_presented (MetaWaylandCompositor *compositor,
+                                               ClutterFrameInfo      *frame_info);
+
+#endif /* META_WAYLAND_PRESENTATION_TIME_H */
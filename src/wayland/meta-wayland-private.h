@@ -34,6 +34,8 @@
 #include "meta-wayland-seat.h"
 #include "meta-wayland-pointer-gestures.h"
 #include "meta-wayland-tablet-manager.h"
+#include "meta-wayland-presentation-time.h"
+#include "meta-wayland-client-stats.h"
 
 typedef struct _MetaXWaylandSelection MetaXWaylandSelection;
 
@@ -42,6 +44,7 @@ typedef struct
   struct wl_list link;
   struct wl_resource *resource;
   MetaWaylandSurface *surface;
+  MetaWaylandClientStats *client_stats;
 } MetaWaylandFrameCallback;
 
 typedef struct
@@ -56,6 +59,8 @@ typedef struct
   char *display_name;
 
   GMainLoop *init_loop;
+  gint64 start_time;
+  gint64 ready_time;
 
   MetaXWaylandSelection *selection_data;
 } MetaXWaylandManager;
@@ -67,6 +72,10 @@ struct _MetaWaylandCompositor
   GHashTable *outputs;
   struct wl_list frame_callbacks;
 
+  MetaWaylandPresentationTime presentation_time;
+
+  MetaWaylandClientStatsManager client_stats;
+
   MetaXWaylandManager xwayland_manager;
 
   MetaWaylandSeat *seat;
@@ -30,6 +30,7 @@
 #include <cogl/cogl-wayland-server.h>
 
 #include <gobject/gvaluecollector.h>
+#include <math.h>
 #include <wayland-server.h>
 
 #include "meta-wayland-private.h"
@@ -44,6 +45,8 @@
 #include "meta-wayland-xdg-shell.h"
 #include "meta-wayland-wl-shell.h"
 #include "meta-wayland-gtk-shell.h"
+#include "meta-wayland-presentation-time.h"
+#include "meta-wayland-client-stats.h"
 
 #include "meta-cursor-tracker-private.h"
 #include "display-private.h"
@@ -57,6 +60,8 @@
 #include "meta-surface-actor-wayland.h"
 #include "meta-xwayland-private.h"
 
+#include "viewporter-server-protocol.h"
+
 enum {
   PENDING_STATE_SIGNAL_APPLIED,
 
@@ -296,16 +301,80 @@ meta_wayland_surface_assign_role (MetaWaylandSurface *surface,
     }
 }
 
+/* Transforms a region in surface coordinates to buffer coordinates,
+ * going backwards through the viewport, rounding outwards.
+ */
+static cairo_region_t *
+surface_region_to_buffer_region (MetaWaylandSurface *surface,
+                                 cairo_region_t     *region)
+{
+  CoglTexture *texture = surface->buffer_ref.buffer->texture;
+  cairo_rectangle_int_t buffer_rect = {
+    .width = cogl_texture_get_width (texture),
+    .height = cogl_texture_get_height (texture),
+  };
+  cairo_region_t *buffer_region;
+  ClutterRect src_rect;
+  int surface_width, surface_height;
+  float scale_x, scale_y;
+  int i, n_rectangles;
+
+  if (!surface->viewport.has_src_rect && !surface->viewport.has_dst_size)
+    return meta_region_scale (region, surface->scale);
+
+  surface_width = meta_wayland_surface_get_width (surface);
+  surface_height = meta_wayland_surface_get_height (surface);
+  if (surface_width == 0 || surface_height == 0)
+    return cairo_region_create ();
+
+  if (surface->viewport.has_src_rect)
+    src_rect = surface->viewport.src_rect;
+  else
+    src_rect = (ClutterRect) {
+      .size.width = buffer_rect.width / surface->scale,
+      .size.height = buffer_rect.height / surface->scale,
+    };
+
+  scale_x = src_rect.size.width * surface->scale / surface_width;
+  scale_y = src_rect.size.height * surface->scale / surface_height;
+
+  buffer_region = cairo_region_create ();
+  n_rectangles = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rectangles; i++)
+    {
+      cairo_rectangle_int_t rect;
+      float x1, y1, x2, y2;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      x1 = floorf (src_rect.origin.x * surface->scale + rect.x * scale_x);
+      y1 = floorf (src_rect.origin.y * surface->scale + rect.y * scale_y);
+      x2 = ceilf (src_rect.origin.x * surface->scale +
+                  (rect.x + rect.width) * scale_x);
+      y2 = ceilf (src_rect.origin.y * surface->scale +
+                  (rect.y + rect.height) * scale_y);
+
+      rect = (cairo_rectangle_int_t) {
+        .x = (int) x1,
+        .y = (int) y1,
+        .width = (int) (x2 - x1),
+        .height = (int) (y2 - y1),
+      };
+      cairo_region_union_rectangle (buffer_region, &rect);
+    }
+
+  cairo_region_intersect_rectangle (buffer_region, &buffer_rect);
+
+  return buffer_region;
+}
+
 static void
 surface_process_damage (MetaWaylandSurface *surface,
                         cairo_region_t *region)
 {
   MetaWaylandBuffer *buffer = surface->buffer_ref.buffer;
-  unsigned int buffer_width;
-  unsigned int buffer_height;
   cairo_rectangle_int_t surface_rect;
   cairo_region_t *scaled_region;
-  int i, n_rectangles;
 
   /* If the client destroyed the buffer it attached before committing, but
    * still posted damage, or posted damage without any buffer, don't try to
@@ -317,34 +386,28 @@ surface_process_damage (MetaWaylandSurface *surface,
   /* Intersect the damage region with the surface region before scaling in
    * order to avoid integer overflow when scaling a damage region is too large
    * (for example INT32_MAX which mesa passes). */
-  buffer_width = cogl_texture_get_width (buffer->texture);
-  buffer_height = cogl_texture_get_height (buffer->texture);
   surface_rect = (cairo_rectangle_int_t) {
-    .width = buffer_width / surface->scale,
-    .height = buffer_height / surface->scale,
+    .width = meta_wayland_surface_get_width (surface),
+    .height = meta_wayland_surface_get_height (surface),
   };
   cairo_region_intersect_rectangle (region, &surface_rect);
 
   /* The damage region must be in the same coordinate space as the buffer,
-   * i.e. scaled with surface->scale. */
-  scaled_region = meta_region_scale (region, surface->scale);
+   * i.e. scaled with surface->scale and mapped through the viewport. */
+  scaled_region = surface_region_to_buffer_region (surface, region);
 
   /* First update the buffer. */
   meta_wayland_buffer_process_damage (buffer, scaled_region);
 
-  /* Now damage the actor. The actor expects damage in the unscaled texture
-   * coordinate space, i.e. same as the buffer. */
+  /* Now damage the actor, queueing a single redraw for the whole region.
+   * The actor expects damage in the unscaled texture coordinate space, i.e.
+   * same as the buffer. */
   /* XXX: Should this be a signal / callback on MetaWaylandBuffer instead? */
-  n_rectangles = cairo_region_num_rectangles (scaled_region);
-  for (i = 0; i < n_rectangles; i++)
-    {
-      cairo_rectangle_int_t rect;
-      cairo_region_get_rectangle (scaled_region, i, &rect);
+  meta_surface_actor_process_damage_region (surface->surface_actor,
+                                            scaled_region);
 
-      meta_surface_actor_process_damage (surface->surface_actor,
-                                         rect.x, rect.y,
-                                         rect.width, rect.height);
-    }
+  meta_wayland_client_stats_add_damage (surface->client_stats,
+                                        cairo_region_num_rectangles (scaled_region));
 
   cairo_region_destroy (scaled_region);
 }
@@ -434,6 +497,50 @@ meta_wayland_surface_get_buffer (MetaWaylandSurface *surface)
   return surface->buffer_ref.buffer;
 }
 
+/**
+ * meta_wayland_surface_get_width:
+ * @surface: a #MetaWaylandSurface
+ *
+ * Returns: the width of @surface in surface coordinates, taking the
+ *   buffer scale and the viewport into account.
+ */
+int
+meta_wayland_surface_get_width (MetaWaylandSurface *surface)
+{
+  MetaWaylandBuffer *buffer = surface->buffer_ref.buffer;
+
+  if (surface->viewport.has_dst_size)
+    return surface->viewport.dst_width;
+  else if (surface->viewport.has_src_rect)
+    return (int) ceilf (surface->viewport.src_rect.size.width);
+  else if (buffer)
+    return cogl_texture_get_width (buffer->texture) / surface->scale;
+  else
+    return 0;
+}
+
+/**
+ * meta_wayland_surface_get_height:
+ * @surface: a #MetaWaylandSurface
+ *
+ * Returns: the height of @surface in surface coordinates, taking the
+ *   buffer scale and the viewport into account.
+ */
+int
+meta_wayland_surface_get_height (MetaWaylandSurface *surface)
+{
+  MetaWaylandBuffer *buffer = surface->buffer_ref.buffer;
+
+  if (surface->viewport.has_dst_size)
+    return surface->viewport.dst_height;
+  else if (surface->viewport.has_src_rect)
+    return (int) ceilf (surface->viewport.src_rect.size.height);
+  else if (buffer)
+    return cogl_texture_get_height (buffer->texture) / surface->scale;
+  else
+    return 0;
+}
+
 void
 meta_wayland_surface_ref_buffer_use_count (MetaWaylandSurface *surface)
 {
@@ -494,10 +601,14 @@ pending_state_init (MetaWaylandPendingState *state)
 
   state->damage = cairo_region_create ();
   wl_list_init (&state->frame_callback_list);
+  wl_list_init (&state->presentation_feedback_list);
 
   state->has_new_geometry = FALSE;
   state->has_new_min_size = FALSE;
   state->has_new_max_size = FALSE;
+
+  state->has_new_viewport_src_rect = FALSE;
+  state->has_new_viewport_dst_size = FALSE;
 }
 
 static void
@@ -514,6 +625,7 @@ pending_state_destroy (MetaWaylandPendingState *state)
                                  state->buffer_destroy_handler_id);
   wl_list_for_each_safe (cb, next, &state->frame_callback_list, link)
     wl_resource_destroy (cb->resource);
+  meta_wayland_presentation_time_discard_list (&state->presentation_feedback_list);
 }
 
 static void
@@ -548,9 +660,17 @@ move_pending_state (MetaWaylandPendingState *from,
   to->has_new_max_size = from->has_new_max_size;
   to->new_max_width = from->new_max_width;
   to->new_max_height = from->new_max_height;
+  to->has_new_viewport_src_rect = from->has_new_viewport_src_rect;
+  to->viewport_src_rect = from->viewport_src_rect;
+  to->has_new_viewport_dst_size = from->has_new_viewport_dst_size;
+  to->viewport_dst_width = from->viewport_dst_width;
+  to->viewport_dst_height = from->viewport_dst_height;
 
   wl_list_init (&to->frame_callback_list);
   wl_list_insert_list (&to->frame_callback_list, &from->frame_callback_list);
+  wl_list_init (&to->presentation_feedback_list);
+  wl_list_insert_list (&to->presentation_feedback_list,
+                       &from->presentation_feedback_list);
 
   if (to->buffer)
     {
@@ -649,33 +769,66 @@ is_surface_effectively_synchronized (MetaWaylandSurface *surface)
 }
 
 static void
-apply_pending_state (MetaWaylandSurface      *surface,
+apply_surface_state (MetaWaylandSurface      *surface,
                      MetaWaylandPendingState *pending);
 
+static ClutterActor *
+get_placement_sibling_actor (MetaWaylandSurface *surface,
+                             MetaWaylandSurface *sibling)
+{
+  /* The subsurface actors are children of the parent's surface actor, and
+   * stacked relative to its shaped texture, which draws the parent itself. */
+  if (sibling == surface->sub.parent)
+    return CLUTTER_ACTOR (meta_surface_actor_get_texture (sibling->surface_actor));
+  else
+    return CLUTTER_ACTOR (sibling->surface_actor);
+}
+
+/* Applies the pending placement operations of all subsurfaces of @parent to
+ * a copy of the stacking order first, and then only moves the actors whose
+ * position actually changed; restacking a subsurface where it already is,
+ * which clients tend to do on every commit, then doesn't cause a relayout.
+ */
 static void
-parent_surface_state_applied (gpointer data, gpointer user_data)
+apply_subsurface_placement_ops (MetaWaylandSurface *parent)
 {
-  MetaWaylandSurface *surface = data;
+  ClutterActor *parent_actor = CLUTTER_ACTOR (parent->surface_actor);
+  ClutterActor *child;
+  ClutterActor *current;
+  gboolean has_placement_ops = FALSE;
+  GList *stack = NULL;
+  GList *l;
 
-  if (surface->sub.pending_pos)
+  for (l = parent->subsurfaces; l; l = l->next)
     {
-      surface->sub.x = surface->sub.pending_x;
-      surface->sub.y = surface->sub.pending_y;
-      surface->sub.pending_pos = FALSE;
+      MetaWaylandSurface *surface = l->data;
+
+      if (surface->sub.pending_placement_ops)
+        {
+          has_placement_ops = TRUE;
+          break;
+        }
     }
 
-  if (surface->sub.pending_placement_ops)
+  if (!has_placement_ops)
+    return;
+
+  for (child = clutter_actor_get_last_child (parent_actor);
+       child;
+       child = clutter_actor_get_previous_sibling (child))
+    stack = g_list_prepend (stack, child);
+
+  for (l = parent->subsurfaces; l; l = l->next)
     {
-      GSList *it;
-      MetaWaylandSurface *parent = surface->sub.parent;
-      ClutterActor *parent_actor =
-        clutter_actor_get_parent (CLUTTER_ACTOR (parent->surface_actor));
+      MetaWaylandSurface *surface = l->data;
       ClutterActor *surface_actor = CLUTTER_ACTOR (surface->surface_actor);
+      GSList *it;
 
       for (it = surface->sub.pending_placement_ops; it; it = it->next)
         {
           MetaWaylandSubsurfacePlacementOp *op = it->data;
-          ClutterActor *sibling_actor;
+          GList *surface_link;
+          GList *sibling_link;
 
           if (!op->sibling)
             {
@@ -683,20 +836,26 @@ parent_surface_state_applied (gpointer data, gpointer user_data)
               continue;
             }
 
-          sibling_actor = CLUTTER_ACTOR (op->sibling->surface_actor);
+          surface_link = g_list_find (stack, surface_actor);
+          sibling_link =
+            g_list_find (stack, get_placement_sibling_actor (surface,
+                                                             op->sibling));
 
-          switch (op->placement)
+          if (surface_link && sibling_link && surface_link != sibling_link)
             {
-            case META_WAYLAND_SUBSURFACE_PLACEMENT_ABOVE:
-              clutter_actor_set_child_above_sibling (parent_actor,
-                                                     surface_actor,
-                                                     sibling_actor);
-              break;
-            case META_WAYLAND_SUBSURFACE_PLACEMENT_BELOW:
-              clutter_actor_set_child_below_sibling (parent_actor,
-                                                     surface_actor,
-                                                     sibling_actor);
-              break;
+              stack = g_list_delete_link (stack, surface_link);
+
+              switch (op->placement)
+                {
+                case META_WAYLAND_SUBSURFACE_PLACEMENT_ABOVE:
+                  stack = g_list_insert_before (stack, sibling_link->next,
+                                                surface_actor);
+                  break;
+                case META_WAYLAND_SUBSURFACE_PLACEMENT_BELOW:
+                  stack = g_list_insert_before (stack, sibling_link,
+                                                surface_actor);
+                  break;
+                }
             }
 
           wl_list_remove (&op->sibling_destroy_listener.link);
@@ -707,15 +866,143 @@ parent_surface_state_applied (gpointer data, gpointer user_data)
       surface->sub.pending_placement_ops = NULL;
     }
 
-  if (is_surface_effectively_synchronized (surface))
-    apply_pending_state (surface, surface->sub.pending);
+  /* Everything before current is already in the new order, and every actor
+   * not placed yet comes after it. */
+  current = clutter_actor_get_first_child (parent_actor);
+  for (l = stack; l; l = l->next)
+    {
+      ClutterActor *actor = l->data;
 
-  meta_surface_actor_wayland_sync_subsurface_state (
-    META_SURFACE_ACTOR_WAYLAND (surface->surface_actor));
+      if (actor == current)
+        current = clutter_actor_get_next_sibling (current);
+      else
+        clutter_actor_set_child_below_sibling (parent_actor, actor, current);
+    }
+
+  g_list_free (stack);
 }
 
+/* Applies the state of the subsurface tree below @surface, after the state
+ * of @surface itself has been applied, in a single pass: the cached state of
+ * the synchronized subsurfaces is applied, and the position and stacking of
+ * all direct subsurfaces updated.
+ */
 static void
-apply_pending_state (MetaWaylandSurface      *surface,
+apply_subsurface_tree_state (MetaWaylandSurface *surface,
+                             gboolean            is_synchronized)
+{
+  GList *l;
+
+  apply_subsurface_placement_ops (surface);
+
+  for (l = surface->subsurfaces; l; l = l->next)
+    {
+      MetaWaylandSurface *subsurface = l->data;
+
+      if (subsurface->sub.pending_pos)
+        {
+          subsurface->sub.x = subsurface->sub.pending_x;
+          subsurface->sub.y = subsurface->sub.pending_y;
+          subsurface->sub.pending_pos = FALSE;
+        }
+
+      /* A subsurface is effectively synchronized if either its parent is,
+       * or itself is in synchronized mode. */
+      if (is_synchronized || subsurface->sub.synchronous)
+        {
+          apply_surface_state (subsurface, subsurface->sub.pending);
+          apply_subsurface_tree_state (subsurface, TRUE);
+        }
+
+      meta_surface_actor_wayland_sync_subsurface_state (
+        META_SURFACE_ACTOR_WAYLAND (subsurface->surface_actor));
+    }
+}
+
+static gboolean
+apply_viewport_state (MetaWaylandSurface      *surface,
+                      MetaWaylandPendingState *pending)
+{
+  MetaWaylandBuffer *buffer = surface->buffer_ref.buffer;
+  MetaShapedTexture *stex;
+
+  if (pending->has_new_viewport_src_rect)
+    {
+      surface->viewport.has_src_rect =
+        pending->viewport_src_rect.size.width > 0;
+      surface->viewport.src_rect = pending->viewport_src_rect;
+    }
+
+  if (pending->has_new_viewport_dst_size)
+    {
+      surface->viewport.has_dst_size = pending->viewport_dst_width > 0;
+      surface->viewport.dst_width = pending->viewport_dst_width;
+      surface->viewport.dst_height = pending->viewport_dst_height;
+    }
+
+  if (surface->viewport.has_src_rect)
+    {
+      ClutterRect *src_rect = &surface->viewport.src_rect;
+
+      if (!surface->viewport.has_dst_size &&
+          (floorf (src_rect->size.width) != src_rect->size.width ||
+           floorf (src_rect->size.height) != src_rect->size.height))
+        {
+          wl_resource_post_error (surface->viewport.resource,
+                                  WP_VIEWPORT_ERROR_BAD_SIZE,
+                                  "Source size of surface %i is not integer "
+                                  "and no destination size is set",
+                                  wl_resource_get_id (surface->resource));
+          return FALSE;
+        }
+
+      if (buffer &&
+          (src_rect->origin.x + src_rect->size.width >
+           cogl_texture_get_width (buffer->texture) / (float) surface->scale ||
+           src_rect->origin.y + src_rect->size.height >
+           cogl_texture_get_height (buffer->texture) / (float) surface->scale))
+        {
+          wl_resource_post_error (surface->viewport.resource,
+                                  WP_VIEWPORT_ERROR_OUT_OF_BUFFER,
+                                  "Source rectangle of surface %i extends "
+                                  "outside of the buffer",
+                                  wl_resource_get_id (surface->resource));
+          return FALSE;
+        }
+    }
+
+  /* The shaped texture works in buffer pixels, i.e. surface coordinates
+   * scaled with surface->scale. */
+  stex = meta_surface_actor_get_texture (surface->surface_actor);
+
+  if (surface->viewport.has_src_rect)
+    {
+      ClutterRect src_rect = {
+        .origin.x = surface->viewport.src_rect.origin.x * surface->scale,
+        .origin.y = surface->viewport.src_rect.origin.y * surface->scale,
+        .size.width = surface->viewport.src_rect.size.width * surface->scale,
+        .size.height = surface->viewport.src_rect.size.height * surface->scale,
+      };
+
+      meta_shaped_texture_set_viewport_src_rect (stex, &src_rect);
+    }
+  else
+    {
+      meta_shaped_texture_reset_viewport_src_rect (stex);
+    }
+
+  if (surface->viewport.has_dst_size)
+    meta_shaped_texture_set_viewport_dst_size (stex,
+                                               surface->viewport.dst_width * surface->scale,
+                                               surface->viewport.dst_height * surface->scale);
+  else
+    meta_shaped_texture_reset_viewport_dst_size (stex);
+
+  return TRUE;
+}
+
+static void
+apply_surface_state (MetaWaylandSurface      *surface,
                      MetaWaylandPendingState *pending)
 {
   if (surface->role)
@@ -798,6 +1085,9 @@ apply_pending_state (MetaWaylandSurface      *surface,
   if (pending->scale > 0)
     surface->scale = pending->scale;
 
+  if (!apply_viewport_state (surface, pending))
+    goto cleanup;
+
   if (!cairo_region_is_empty (pending->damage))
     surface_process_damage (surface, pending->damage);
 
@@ -824,6 +1114,9 @@ apply_pending_state (MetaWaylandSurface      *surface,
         surface->input_region = NULL;
     }
 
+  meta_wayland_presentation_time_commit (surface,
+                                         &pending->presentation_feedback_list);
+
   if (surface->role)
     {
       meta_wayland_surface_role_commit (surface->role, pending);
@@ -864,8 +1157,15 @@ cleanup:
                  0);
 
   pending_state_reset (pending);
+}
 
-  g_list_foreach (surface->subsurfaces, parent_surface_state_applied, NULL);
+static void
+apply_pending_state (MetaWaylandSurface      *surface,
+                     MetaWaylandPendingState *pending)
+{
+  apply_surface_state (surface, pending);
+  apply_subsurface_tree_state (surface,
+                               is_surface_effectively_synchronized (surface));
 }
 
 static void
@@ -956,6 +1256,8 @@ destroy_frame_callback (struct wl_resource *callback_resource)
     wl_resource_get_user_data (callback_resource);
 
   wl_list_remove (&callback->link);
+  meta_wayland_client_stats_frame_callback_destroyed (callback->client_stats);
+  meta_wayland_client_stats_unref (callback->client_stats);
   g_slice_free (MetaWaylandFrameCallback, callback);
 }
 
@@ -973,6 +1275,8 @@ wl_surface_frame (struct wl_client *client,
 
   callback = g_slice_new0 (MetaWaylandFrameCallback);
   callback->surface = surface;
+  callback->client_stats = meta_wayland_client_stats_ref (surface->client_stats);
+  meta_wayland_client_stats_frame_callback_created (callback->client_stats);
   callback->resource = wl_resource_create (client, &wl_callback_interface, META_WL_CALLBACK_VERSION, callback_id);
   wl_resource_set_implementation (callback->resource, NULL, callback, destroy_frame_callback);
 
@@ -1026,12 +1330,16 @@ wl_surface_commit (struct wl_client *client,
                    struct wl_resource *resource)
 {
   MetaWaylandSurface *surface = wl_resource_get_user_data (resource);
+  int64_t start_time_us;
 
   /* X11 unmanaged window */
   if (!surface)
     return;
 
+  start_time_us = g_get_monotonic_time ();
   meta_wayland_surface_commit (surface);
+  meta_wayland_client_stats_add_commit (surface->client_stats,
+                                        g_get_monotonic_time () - start_time_us);
 }
 
 static void
@@ -1279,6 +1587,7 @@ wl_surface_destructor (struct wl_resource *resource)
   g_object_unref (surface->surface_actor);
 
   meta_wayland_compositor_destroy_frame_callbacks (compositor, surface);
+  meta_wayland_presentation_time_surface_destroyed (surface);
 
   g_hash_table_foreach (surface->outputs_to_destroy_notify_id, surface_output_disconnect_signal, surface);
   g_hash_table_unref (surface->outputs_to_destroy_notify_id);
@@ -1292,6 +1601,8 @@ wl_surface_destructor (struct wl_resource *resource)
   if (surface->wl_subsurface)
     wl_resource_destroy (surface->wl_subsurface);
 
+  meta_wayland_client_stats_unref (surface->client_stats);
+
   g_object_unref (surface);
 
   meta_wayland_compositor_repick (compositor);
@@ -1327,6 +1638,9 @@ meta_wayland_surface_create (MetaWaylandCompositor *compositor,
   surface->resource = wl_resource_create (client, &wl_surface_interface, wl_resource_get_version (compositor_resource), id);
   wl_resource_set_implementation (surface->resource, &meta_wayland_wl_surface_interface, surface, wl_surface_destructor);
 
+  surface->client_stats =
+    meta_wayland_client_stats_ref (meta_wayland_client_stats_from_client (client));
+
   surface->surface_actor = g_object_ref_sink (meta_surface_actor_wayland_new (surface));
 
   wl_list_init (&surface->pending_frame_callback_list);
@@ -2087,7 +2401,6 @@ shell_surface_role_surface_commit (MetaWaylandSurfaceRole  *surface_role,
   MetaWaylandSurfaceRoleClass *surface_role_class;
   MetaWindow *window;
   MetaWaylandBuffer *buffer;
-  CoglTexture *texture;
   MetaSurfaceActorWayland *actor;
   double scale;
 
@@ -2105,10 +2418,11 @@ shell_surface_role_surface_commit (MetaWaylandSurfaceRole  *surface_role,
 
   actor = META_SURFACE_ACTOR_WAYLAND (surface->surface_actor);
   scale = meta_surface_actor_wayland_get_scale (actor);
-  texture = buffer->texture;
 
-  window->buffer_rect.width = cogl_texture_get_width (texture) * scale;
-  window->buffer_rect.height = cogl_texture_get_height (texture) * scale;
+  window->buffer_rect.width =
+    meta_wayland_surface_get_width (surface) * surface->scale * scale;
+  window->buffer_rect.height =
+    meta_wayland_surface_get_height (surface) * surface->scale * scale;
 }
 
 static void
@@ -2160,15 +2474,13 @@ meta_wayland_surface_calculate_input_region (MetaWaylandSurface *surface)
 {
   cairo_region_t *region;
   cairo_rectangle_int_t buffer_rect;
-  CoglTexture *texture;
 
   if (!surface->buffer_ref.buffer)
     return NULL;
 
-  texture = surface->buffer_ref.buffer->texture;
   buffer_rect = (cairo_rectangle_int_t) {
-    .width = cogl_texture_get_width (texture) / surface->scale,
-    .height = cogl_texture_get_height (texture) / surface->scale,
+    .width = meta_wayland_surface_get_width (surface),
+    .height = meta_wayland_surface_get_height (surface),
   };
   region = cairo_region_create_rectangle (&buffer_rect);
 
@@ -140,6 +140,17 @@ struct _MetaWaylandPendingState
   /* wl_surface.frame */
   struct wl_list frame_callback_list;
 
+  /* wp_presentation.feedback */
+  struct wl_list presentation_feedback_list;
+
+  /* wp_viewport; a width of -1 unsets the source rectangle or the
+   * destination size */
+  gboolean has_new_viewport_src_rect;
+  ClutterRect viewport_src_rect;
+  gboolean has_new_viewport_dst_size;
+  int viewport_dst_width;
+  int viewport_dst_height;
+
   MetaRectangle new_geometry;
   gboolean has_new_geometry;
 
@@ -184,6 +195,7 @@ struct _MetaWaylandSurface
   int32_t offset_x, offset_y;
   GList *subsurfaces;
   GHashTable *outputs_to_destroy_notify_id;
+  MetaWaylandClientStats *client_stats;
 
   /* Buffer reference state. */
   struct {
@@ -208,6 +220,19 @@ struct _MetaWaylandSurface
     const MetaWaylandDragDestFuncs *funcs;
   } dnd;
 
+  /* wp_viewport state, in surface coordinates. */
+  struct {
+    struct wl_resource *resource;
+    gulong destroy_handler_id;
+
+    gboolean has_src_rect;
+    ClutterRect src_rect;
+
+    gboolean has_dst_size;
+    int dst_width;
+    int dst_height;
+  } viewport;
+
   /* All the pending state that wl_surface.commit will apply. */
   MetaWaylandPendingState *pending;
 
@@ -254,6 +279,10 @@ gboolean            meta_wayland_surface_assign_role (MetaWaylandSurface *surfac
 
 MetaWaylandBuffer  *meta_wayland_surface_get_buffer (MetaWaylandSurface *surface);
 
+int                 meta_wayland_surface_get_width (MetaWaylandSurface *surface);
+
+int                 meta_wayland_surface_get_height (MetaWaylandSurface *surface);
+
 void                meta_wayland_surface_ref_buffer_use_count (MetaWaylandSurface *surface);
 
 void                meta_wayland_surface_unref_buffer_use_count (MetaWaylandSurface *surface);
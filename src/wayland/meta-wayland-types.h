@@ -58,4 +58,6 @@ typedef struct _MetaWaylandSerial MetaWaylandSerial;
 
 typedef struct _MetaWaylandPointerClient MetaWaylandPointerClient;
 
+typedef struct _MetaWaylandClientStats MetaWaylandClientStats;
+
 #endif
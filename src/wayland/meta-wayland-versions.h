@@ -47,5 +47,8 @@
 #define META_ZWP_POINTER_GESTURES_V1_VERSION    1
 #define META_ZXDG_EXPORTER_V1_VERSION       1
 #define META_ZXDG_IMPORTER_V1_VERSION       1
+#define META_ZWP_LINUX_DMABUF_V1_VERSION    3
+#define META_WP_PRESENTATION_VERSION        1
+#define META_WP_VIEWPORTER_VERSION          1
 
 #endif
@@ -0,0 +1,239 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/*
+ * Copyright (C) 2017 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+
+/*
+ * Implementation of wp_viewporter. The viewport state is double buffered
+ * state of the surface; it is applied on commit, see
+ * apply_viewport_state() in meta-wayland-surface.c, and honoured by the
+ * MetaShapedTexture of the surface when painting.
+ */
+
+#include "config.h"
+
+#include "wayland/meta-wayland-viewporter.h"
+
+#include "wayland/meta-wayland-private.h"
+#include "wayland/meta-wayland-surface.h"
+#include "wayland/meta-wayland-versions.h"
+
+#include "viewporter-server-protocol.h"
+
+static void
+viewport_surface_destroyed (MetaWaylandSurface *surface,
+                            gpointer            user_data)
+{
+  wl_resource_set_user_data (surface->viewport.resource, NULL);
+  surface->viewport.resource = NULL;
+  surface->viewport.destroy_handler_id = 0;
+}
+
+static void
+viewport_destructor (struct wl_resource *resource)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (resource);
+
+  if (!surface)
+    return;
+
+  g_signal_handler_disconnect (surface, surface->viewport.destroy_handler_id);
+  surface->viewport.destroy_handler_id = 0;
+  surface->viewport.resource = NULL;
+
+  /* Destroying the viewport unsets the source rectangle and the
+   * destination size on the next commit. */
+  surface->pending->has_new_viewport_src_rect = TRUE;
+  surface->pending->viewport_src_rect.size.width = -1;
+  surface->pending->has_new_viewport_dst_size = TRUE;
+  surface->pending->viewport_dst_width = -1;
+}
+
+static void
+viewport_destroy (struct wl_client   *client,
+                  struct wl_resource *resource)
+{
+  wl_resource_destroy (resource);
+}
+
+static void
+viewport_set_source (struct wl_client   *client,
+                     struct wl_resource *resource,
+                     wl_fixed_t          src_x,
+                     wl_fixed_t          src_y,
+                     wl_fixed_t          src_width,
+                     wl_fixed_t          src_height)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (resource);
+  float x, y, width, height;
+
+  if (!surface)
+    {
+      wl_resource_post_error (resource,
+                              WP_VIEWPORT_ERROR_NO_SURFACE,
+                              "wl_surface for this viewport no longer exists");
+      return;
+    }
+
+  x = wl_fixed_to_double (src_x);
+  y = wl_fixed_to_double (src_y);
+  width = wl_fixed_to_double (src_width);
+  height = wl_fixed_to_double (src_height);
+
+  if (x == -1 && y == -1 && width == -1 && height == -1)
+    {
+      surface->pending->has_new_viewport_src_rect = TRUE;
+      surface->pending->viewport_src_rect.size.width = -1;
+      return;
+    }
+
+  if (x < 0 || y < 0 || width <= 0 || height <= 0)
+    {
+      wl_resource_post_error (resource,
+                              WP_VIEWPORT_ERROR_BAD_VALUE,
+                              "Invalid source rectangle %f,%f %fx%f",
+                              x, y, width, height);
+      return;
+    }
+
+  surface->pending->has_new_viewport_src_rect = TRUE;
+  surface->pending->viewport_src_rect = (ClutterRect) {
+    .origin.x = x,
+    .origin.y = y,
+    .size.width = width,
+    .size.height = height,
+  };
+}
+
+static void
+viewport_set_destination (struct wl_client   *client,
+                          struct wl_resource *resource,
+                          int32_t             dst_width,
+                          int32_t             dst_height)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (resource);
+
+  if (!surface)
+    {
+      wl_resource_post_error (resource,
+                              WP_VIEWPORT_ERROR_NO_SURFACE,
+                              "wl_surface for this viewport no longer exists");
+      return;
+    }
+
+  if (dst_width == -1 && dst_height == -1)
+    {
+      surface->pending->has_new_viewport_dst_size = TRUE;
+      surface->pending->viewport_dst_width = -1;
+      return;
+    }
+
+  if (dst_width <= 0 || dst_height <= 0)
+    {
+      wl_resource_post_error (resource,
+                              WP_VIEWPORT_ERROR_BAD_VALUE,
+                              "Invalid destination size %dx%d",
+                              dst_width, dst_height);
+      return;
+    }
+
+  surface->pending->has_new_viewport_dst_size = TRUE;
+  surface->pending->viewport_dst_width = dst_width;
+  surface->pending->viewport_dst_height = dst_height;
+}
+
+static const struct wp_viewport_interface viewport_interface = {
+  viewport_destroy,
+  viewport_set_source,
+  viewport_set_destination,
+};
+
+static void
+viewporter_destroy (struct wl_client   *client,
+                    struct wl_resource *resource)
+{
+  wl_resource_destroy (resource);
+}
+
+static void
+viewporter_get_viewport (struct wl_client   *client,
+                         struct wl_resource *resource,
+                         uint32_t            id,
+                         struct wl_resource *surface_resource)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (surface_resource);
+  struct wl_resource *viewport_resource;
+
+  if (surface && surface->viewport.resource)
+    {
+      wl_resource_post_error (resource,
+                              WP_VIEWPORTER_ERROR_VIEWPORT_EXISTS,
+                              "viewport already exists on surface");
+      return;
+    }
+
+  viewport_resource = wl_resource_create (client,
+                                          &wp_viewport_interface,
+                                          wl_resource_get_version (resource),
+                                          id);
+  wl_resource_set_implementation (viewport_resource,
+                                  &viewport_interface,
+                                  surface,
+                                  viewport_destructor);
+
+  /* X11 unmanaged window */
+  if (!surface)
+    return;
+
+  surface->viewport.resource = viewport_resource;
+  surface->viewport.destroy_handler_id =
+    g_signal_connect (surface, "destroy",
+                      G_CALLBACK (viewport_surface_destroyed),
+                      NULL);
+}
+
+static const struct wp_viewporter_interface viewporter_interface = {
+  viewporter_destroy,
+  viewporter_get_viewport,
+};
+
+static void
+viewporter_bind (struct wl_client *client,
+                 void             *data,
+                 uint32_t          version,
+                 uint32_t          id)
+{
+  struct wl_resource *resource;
+
+  resource = wl_resource_create (client, &wp_viewporter_interface,
+                                 version, id);
+  wl_resource_set_implementation (resource, &viewporter_interface,
+                                  data, NULL);
+}
+
+void
+meta_wayland_viewporter_init (MetaWaylandCompositor *compositor)
+{
+  if (wl_global_create (compositor->wayland_display,
+                        &wp_viewporter_interface,
+                        META_WP_VIEWPORTER_VERSION,
+                        compositor, viewporter_bind) == NULL)
+    g_error ("Failed to register a global wp_viewporter object");
+}
@@ -41,6 +41,10 @@
 #include "meta-wayland-data-device.h"
 #include "meta-wayland-tablet-manager.h"
 #include "meta-wayland-xdg-foreign.h"
+#include "meta-wayland-dma-buf.h"
+#include "meta-wayland-presentation-time.h"
+#include "meta-wayland-viewporter.h"
+#include "meta-wayland-client-stats.h"
 
 static MetaWaylandCompositor _meta_wayland_compositor;
 static char *_display_name_override;
@@ -189,6 +193,15 @@ meta_wayland_compositor_paint_finished (MetaWaylandCompositor *compositor)
       wl_callback_send_done (callback->resource, current_time / 1000);
       wl_resource_destroy (callback->resource);
     }
+
+  meta_wayland_presentation_time_paint_finished (compositor);
+}
+
+void
+meta_wayland_compositor_presented (MetaWaylandCompositor *compositor,
+                                   ClutterFrameInfo      *frame_info)
+{
+  meta_wayland_presentation_time_presented (compositor, frame_info);
 }
 
 /**
@@ -308,6 +321,12 @@ meta_wayland_pre_clutter_init (void)
     g_error ("Failed to create the global wl_display");
 
   clutter_wayland_set_compositor_display (compositor->wayland_display);
+
+  /* Launch Xwayland now so it starts up while the backend and Clutter
+   * initialize; meta_wayland_init() waits for it to be ready.
+   */
+  if (!meta_xwayland_start (&compositor->xwayland_manager, compositor->wayland_display))
+    g_error ("Failed to start X Wayland");
 }
 
 void
@@ -350,9 +369,12 @@ meta_wayland_init (void)
   meta_wayland_relative_pointer_init (compositor);
   meta_wayland_pointer_constraints_init (compositor);
   meta_wayland_xdg_foreign_init (compositor);
+  meta_wayland_dma_buf_init (compositor);
+  meta_wayland_presentation_time_init (compositor);
+  meta_wayland_viewporter_init (compositor);
+  meta_wayland_client_stats_init (compositor);
 
-  if (!meta_xwayland_start (&compositor->xwayland_manager, compositor->wayland_display))
-    g_error ("Failed to start X Wayland");
+  meta_xwayland_wait_ready (&compositor->xwayland_manager);
 
   if (_display_name_override)
     {
@@ -40,18 +40,30 @@
 #include "meta-xwayland-selection-private.h"
 #include "meta-wayland-data-device.h"
 
-#define INCR_CHUNK_SIZE (128 * 1024)
+/* INCR chunks are as large as the X server takes in one request,
+ * within these bounds.
+ */
+#define MIN_INCR_CHUNK_SIZE (16 * 1024)
+#define MAX_INCR_CHUNK_SIZE (1024 * 1024)
+/* Chunks buffered ahead of the slower side of a transfer */
+#define MAX_CHUNKS_IN_FLIGHT 4
 #define XDND_VERSION 5
 
+typedef struct _MetaSelectionBridge MetaSelectionBridge;
+
 typedef struct {
-  MetaXWaylandSelection *selection_data;
+  MetaSelectionBridge *selection;
   GInputStream *stream;
   GCancellable *cancellable;
   MetaWindow *window;
   XSelectionRequestEvent request_event;
-  guchar buffer[INCR_CHUNK_SIZE];
-  gsize buffer_len;
+  gsize chunk_size;
+  guchar *read_buffer;
+  GByteArray *pending; /* Read from the wayland client, not sent yet */
+  guint reading : 1;
+  guint eof : 1;
   guint incr : 1;
+  guint property_deleted : 1; /* The requestor waits for the next chunk */
 } WaylandSelectionData;
 
 typedef struct {
@@ -59,21 +71,26 @@ typedef struct {
   GOutputStream *stream;
   GCancellable *cancellable;
   gchar *mime_type;
+  GQueue chunks; /* GBytes fetched from the X11 client, not written yet */
+  gsize write_offset;
+  guint writing : 1;
+  guint eof : 1;
+  guint ack_pending : 1; /* The last INCR chunk is not acknowledged yet */
   guint incr : 1;
 } X11SelectionData;
 
-typedef struct {
+struct _MetaSelectionBridge {
   Atom selection_atom;
   Window window;
   Window owner;
   Time timestamp;
   Time client_message_timestamp;
   MetaWaylandDataSource *source; /* owned by MetaWaylandDataDevice */
-  WaylandSelectionData *wayland_selection;
+  GList *wayland_selections; /* WaylandSelectionData, one per request */
   X11SelectionData *x11_selection;
 
   struct wl_listener ownership_listener;
-} MetaSelectionBridge;
+};
 
 typedef struct {
   MetaSelectionBridge selection;
@@ -440,10 +457,16 @@ x11_selection_data_new (MetaXWaylandSelection *selection_data,
 static void
 x11_selection_data_free (X11SelectionData *data)
 {
+  GBytes *chunk;
+
   g_cancellable_cancel (data->cancellable);
   g_object_unref (data->cancellable);
   g_object_unref (data->stream);
   g_free (data->mime_type);
+
+  while ((chunk = g_queue_pop_head (&data->chunks)))
+    g_bytes_unref (chunk);
+
   g_slice_free (X11SelectionData, data);
 }
 
@@ -493,6 +516,8 @@ x11_selection_data_close (X11SelectionData *data)
   g_output_stream_close (data->stream, data->cancellable, NULL);
 }
 
+static void x11_selection_data_update (MetaSelectionBridge *selection);
+
 static void
 x11_data_write_cb (GObject      *object,
                    GAsyncResult *res,
@@ -501,9 +526,11 @@ x11_data_write_cb (GObject      *object,
   MetaSelectionBridge *selection = user_data;
   X11SelectionData *data = selection->x11_selection;
   GError *error = NULL;
-  gboolean success = TRUE;
+  gssize bytes_written;
+  GBytes *chunk;
 
-  g_output_stream_write_finish (G_OUTPUT_STREAM (object), res, &error);
+  bytes_written = g_output_stream_write_finish (G_OUTPUT_STREAM (object),
+                                                res, &error);
 
   if (error)
     {
@@ -515,34 +542,94 @@ x11_data_write_cb (GObject      *object,
 
       g_warning ("Error writing from X11 selection: %s\n", error->message);
       g_error_free (error);
-      success = FALSE;
-    }
 
-  if (success && data->incr)
-    {
-      Display *xdisplay = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
-      XDeleteProperty (xdisplay, selection->window,
-                       gdk_x11_get_xatom_by_name ("_META_SELECTION"));
+      if (data && data->stream == G_OUTPUT_STREAM (object))
+        {
+          x11_selection_data_close (data);
+          x11_selection_data_finish (selection, FALSE);
+        }
+
+      return;
     }
-  else
+
+  if (!data || data->stream != G_OUTPUT_STREAM (object))
+    return;
+
+  /* Writes to the pipe may be short, carry on from where this one ended */
+  data->writing = FALSE;
+  data->write_offset += bytes_written;
+
+  chunk = g_queue_peek_head (&data->chunks);
+  if (data->write_offset == g_bytes_get_size (chunk))
     {
-      x11_selection_data_close (selection->x11_selection);
-      x11_selection_data_finish (selection, success);
+      g_bytes_unref (g_queue_pop_head (&data->chunks));
+      data->write_offset = 0;
     }
+
+  x11_selection_data_update (selection);
 }
 
 static void
-x11_selection_data_write (MetaSelectionBridge *selection,
-                          guchar              *buffer,
-                          gulong               len)
+x11_selection_data_write (MetaSelectionBridge *selection)
 {
   X11SelectionData *data = selection->x11_selection;
+  const guchar *buffer;
+  GBytes *chunk;
+  gsize len;
 
-  g_output_stream_write_async (data->stream, buffer, len,
+  chunk = g_queue_peek_head (&data->chunks);
+  buffer = g_bytes_get_data (chunk, &len);
+
+  data->writing = TRUE;
+  g_output_stream_write_async (data->stream,
+                               buffer + data->write_offset,
+                               len - data->write_offset,
                                G_PRIORITY_DEFAULT, data->cancellable,
                                x11_data_write_cb, selection);
 }
 
+static void
+x11_selection_data_queue (MetaSelectionBridge *selection,
+                          const guchar        *buffer,
+                          gulong               len)
+{
+  X11SelectionData *data = selection->x11_selection;
+
+  g_queue_push_tail (&data->chunks, g_bytes_new (buffer, len));
+}
+
+static void
+x11_selection_data_update (MetaSelectionBridge *selection)
+{
+  X11SelectionData *data = selection->x11_selection;
+
+  /* Deleting the property asks the X11 client for the next INCR chunk,
+   * let it send that one while the queued chunks are written, as long
+   * as the wayland client keeps up.
+   */
+  if (data->ack_pending &&
+      g_queue_get_length (&data->chunks) < MAX_CHUNKS_IN_FLIGHT)
+    {
+      Display *xdisplay = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
+
+      XDeleteProperty (xdisplay, selection->window,
+                       gdk_x11_get_xatom_by_name ("_META_SELECTION"));
+      data->ack_pending = FALSE;
+    }
+
+  if (!g_queue_is_empty (&data->chunks))
+    {
+      if (!data->writing)
+        x11_selection_data_write (selection);
+    }
+  else if (data->eof)
+    {
+      /* Transfer has completed */
+      x11_selection_data_close (data);
+      x11_selection_data_finish (selection, TRUE);
+    }
+}
+
 static MetaWaylandDataSource *
 data_device_get_active_source_for_atom (MetaWaylandDataDevice *data_device,
                                         Atom                   selection_atom)
@@ -557,6 +644,21 @@ data_device_get_active_source_for_atom (MetaWaylandDataDevice *data_device,
     return NULL;
 }
 
+static gsize
+get_incr_chunk_size (void)
+{
+  Display *xdisplay = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
+  long max_request_size;
+
+  /* In 4 byte units, leave room for the ChangeProperty request header */
+  max_request_size = XExtendedMaxRequestSize (xdisplay);
+  if (max_request_size == 0)
+    max_request_size = XMaxRequestSize (xdisplay);
+
+  return CLAMP (max_request_size * 4 - 1024,
+                MIN_INCR_CHUNK_SIZE, MAX_INCR_CHUNK_SIZE);
+}
+
 static WaylandSelectionData *
 wayland_selection_data_new (XSelectionRequestEvent *request_event,
                             MetaWaylandCompositor  *compositor)
@@ -605,9 +707,13 @@ wayland_selection_data_new (XSelectionRequestEvent *request_event,
   meta_wayland_data_source_send (wayland_source, mime_type, p[1]);
 
   data = g_slice_new0 (WaylandSelectionData);
+  data->selection = selection;
   data->request_event = *request_event;
   data->cancellable = g_cancellable_new ();
   data->stream = g_unix_input_stream_new (p[0], TRUE);
+  data->chunk_size = get_incr_chunk_size ();
+  data->read_buffer = g_malloc (data->chunk_size);
+  data->pending = g_byte_array_sized_new (data->chunk_size);
 
   data->window = meta_display_lookup_x_window (meta_get_display (),
                                                data->request_event.requestor);
@@ -644,6 +750,23 @@ reply_selection_request (XSelectionRequestEvent *request_event,
               False, NoEventMask, (XEvent *) &event);
 }
 
+static gboolean
+requestor_has_transfers (MetaSelectionBridge *selection,
+                         Window               requestor)
+{
+  GList *l;
+
+  for (l = selection->wayland_selections; l; l = l->next)
+    {
+      WaylandSelectionData *data = l->data;
+
+      if (data->request_event.requestor == requestor)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
 static void
 wayland_selection_data_free (WaylandSelectionData *data)
 {
@@ -651,7 +774,8 @@ wayland_selection_data_free (WaylandSelectionData *data)
   MetaScreen *screen = display->screen;
 
   /* Do *not* change the event mask on the root window, bugger! */
-  if (!data->window && data->request_event.requestor != screen->xroot)
+  if (!data->window && data->request_event.requestor != screen->xroot &&
+      !requestor_has_transfers (data->selection, data->request_event.requestor))
     {
       meta_error_trap_push (display);
       XSelectInput (GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
@@ -662,110 +786,159 @@ wayland_selection_data_free (WaylandSelectionData *data)
   g_cancellable_cancel (data->cancellable);
   g_object_unref (data->cancellable);
   g_object_unref (data->stream);
+  g_free (data->read_buffer);
+  g_byte_array_free (data->pending, TRUE);
   g_slice_free (WaylandSelectionData, data);
 }
 
+static void
+wayland_selection_data_finish (WaylandSelectionData *data)
+{
+  MetaSelectionBridge *selection = data->selection;
+
+  selection->wayland_selections =
+    g_list_remove (selection->wayland_selections, data);
+  wayland_selection_data_free (data);
+}
+
+static WaylandSelectionData *
+wayland_selection_data_lookup (MetaSelectionBridge *selection,
+                               Window               requestor,
+                               Atom                 property)
+{
+  GList *l;
+
+  for (l = selection->wayland_selections; l; l = l->next)
+    {
+      WaylandSelectionData *data = l->data;
+
+      if (data->request_event.requestor == requestor &&
+          data->request_event.property == property)
+        return data;
+    }
+
+  return NULL;
+}
+
 static void
 wayland_selection_update_x11_property (WaylandSelectionData *data)
 {
   Display *xdisplay = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
+  gsize len = MIN (data->pending->len, data->chunk_size);
 
   XChangeProperty (xdisplay,
                    data->request_event.requestor,
                    data->request_event.property,
                    data->request_event.target,
                    8, PropModeReplace,
-                   data->buffer, data->buffer_len);
-  data->buffer_len = 0;
+                   data->pending->data, len);
+  g_byte_array_remove_range (data->pending, 0, len);
 }
 
+static void wayland_selection_data_read (WaylandSelectionData *data);
+
 static void
-wayland_data_read_cb (GObject      *object,
-                      GAsyncResult *res,
-                      gpointer      user_data)
+wayland_selection_data_update (WaylandSelectionData *data)
 {
-  MetaSelectionBridge *selection = user_data;
-  WaylandSelectionData *data = selection->wayland_selection;
-  GError *error = NULL;
-  gsize bytes_read;
-
-  bytes_read = g_input_stream_read_finish (G_INPUT_STREAM (object),
-                                           res, &error);
-  if (error)
+  if (!data->incr)
     {
-      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      if (data->eof)
         {
-          g_error_free (error);
+          /* Non-incr transfer finished */
+          wayland_selection_update_x11_property (data);
+          reply_selection_request (&data->request_event, TRUE);
+          wayland_selection_data_finish (data);
           return;
         }
-
-      g_warning ("Error transfering wayland clipboard to X11: %s\n",
-                 error->message);
-      g_error_free (error);
-
-      if (data && data->stream == G_INPUT_STREAM (object))
-        {
-          reply_selection_request (&data->request_event, FALSE);
-          g_clear_pointer (&selection->wayland_selection,
-                           (GDestroyNotify) wayland_selection_data_free);
-        }
-
-      return;
-    }
-
-  data->buffer_len = bytes_read;
-
-  if (bytes_read == INCR_CHUNK_SIZE)
-    {
-      if (!data->incr)
+      else if (data->pending->len >= data->chunk_size)
         {
           Display *xdisplay = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
-          guint32 incr_chunk_size = INCR_CHUNK_SIZE;
+          guint32 incr_size = data->pending->len;
 
-          /* Not yet in incr */
+          /* Too big for a single property, the requestor starts the
+           * incr transfer by deleting this one.
+           */
           data->incr = TRUE;
           XChangeProperty (xdisplay,
                            data->request_event.requestor,
                            data->request_event.property,
                            gdk_x11_get_xatom_by_name ("INCR"),
                            32, PropModeReplace,
-                           (guchar *) &incr_chunk_size, 1);
+                           (guchar *) &incr_size, 1);
           reply_selection_request (&data->request_event, TRUE);
         }
-      else
-        wayland_selection_update_x11_property (data);
     }
-  else
+  else if (data->property_deleted)
     {
-      if (!data->incr)
+      if (data->pending->len > 0)
         {
-          /* Non-incr transfer finished */
           wayland_selection_update_x11_property (data);
-          reply_selection_request (&data->request_event, TRUE);
+          data->property_deleted = FALSE;
         }
-      else if (data->incr)
+      else if (data->eof)
         {
-          /* Incr transfer complete, setting a new property */
+          /* Incr transfer complete, a zero-length property marks the end */
           wayland_selection_update_x11_property (data);
+          wayland_selection_data_finish (data);
+          return;
+        }
+    }
+
+  /* Read ahead while the requestor is busy with the previous chunks */
+  if (!data->reading && !data->eof &&
+      data->pending->len < MAX_CHUNKS_IN_FLIGHT * data->chunk_size)
+    wayland_selection_data_read (data);
+}
 
-          if (bytes_read > 0)
-            return;
+static void
+wayland_data_read_cb (GObject      *object,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+  WaylandSelectionData *data = user_data;
+  GError *error = NULL;
+  gssize bytes_read;
+
+  bytes_read = g_input_stream_read_finish (G_INPUT_STREAM (object),
+                                           res, &error);
+  if (error)
+    {
+      /* Cancelled when the data is freed, so do not touch it */
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          g_error_free (error);
+          return;
         }
 
-      g_clear_pointer (&selection->wayland_selection,
-                       (GDestroyNotify) wayland_selection_data_free);
+      g_warning ("Error transfering wayland clipboard to X11: %s\n",
+                 error->message);
+      g_error_free (error);
+
+      if (!data->incr)
+        reply_selection_request (&data->request_event, FALSE);
+
+      wayland_selection_data_finish (data);
+      return;
     }
+
+  data->reading = FALSE;
+
+  if (bytes_read == 0)
+    data->eof = TRUE;
+  else
+    g_byte_array_append (data->pending, data->read_buffer, bytes_read);
+
+  wayland_selection_data_update (data);
 }
 
 static void
-wayland_selection_data_read (MetaSelectionBridge *selection)
+wayland_selection_data_read (WaylandSelectionData *data)
 {
-  WaylandSelectionData *data = selection->wayland_selection;
-
-  g_input_stream_read_async (data->stream, data->buffer,
-                             INCR_CHUNK_SIZE, G_PRIORITY_DEFAULT,
+  data->reading = TRUE;
+  g_input_stream_read_async (data->stream, data->read_buffer,
+                             data->chunk_size, G_PRIORITY_DEFAULT,
                              data->cancellable,
-                             wayland_data_read_cb, selection);
+                             wayland_data_read_cb, data);
 }
 
 static void
@@ -791,18 +964,16 @@ meta_xwayland_selection_get_incr_chunk (MetaWaylandCompositor *compositor,
                       &bytes_after_ret,
                       &prop_ret);
 
+  /* A zero-length chunk marks the end of the transfer */
   if (nitems_ret > 0)
-    {
-      x11_selection_data_write (selection, prop_ret, nitems_ret);
-    }
+    x11_selection_data_queue (selection, prop_ret, nitems_ret);
   else
-    {
-      /* Transfer has completed */
-      x11_selection_data_close (selection->x11_selection);
-      x11_selection_data_finish (selection, TRUE);
-    }
+    selection->x11_selection->eof = TRUE;
 
   XFree (prop_ret);
+
+  selection->x11_selection->ack_pending = TRUE;
+  x11_selection_data_update (selection);
 }
 
 static void
@@ -1132,7 +1303,11 @@ meta_xwayland_selection_get_x11_data (MetaWaylandCompositor *compositor,
     return;
 
   if (type_ret == gdk_x11_get_xatom_by_name (selection->x11_selection->mime_type))
-    x11_selection_data_write (selection, prop_ret, nitems_ret);
+    {
+      x11_selection_data_queue (selection, prop_ret, nitems_ret);
+      selection->x11_selection->eof = TRUE;
+      x11_selection_data_update (selection);
+    }
 
   XFree (prop_ret);
 }
@@ -1219,27 +1394,16 @@ meta_xwayland_selection_send_timestamp (MetaWaylandCompositor *compositor,
                    (guchar *) &timestamp, 1);
 }
 
-static void
-meta_xwayland_selection_send_incr_chunk (MetaWaylandCompositor *compositor,
-                                         MetaSelectionBridge   *selection)
-{
-  if (!selection->wayland_selection)
-    return;
-
-  if (selection->wayland_selection->buffer_len > 0)
-    wayland_selection_update_x11_property (selection->wayland_selection);
-  else
-    wayland_selection_data_read (selection);
-}
-
 static gboolean
 handle_incr_chunk (MetaWaylandCompositor *compositor,
                    MetaSelectionBridge   *selection,
                    XPropertyEvent        *event)
 {
+  WaylandSelectionData *data;
+
   if (selection->x11_selection &&
       selection->x11_selection->incr &&
-      event->window == selection->owner &&
+      event->window == selection->window &&
       event->state == PropertyNewValue &&
       event->atom == gdk_x11_get_xatom_by_name ("_META_SELECTION"))
     {
@@ -1247,14 +1411,16 @@ handle_incr_chunk (MetaWaylandCompositor *compositor,
       meta_xwayland_selection_get_incr_chunk (compositor, selection);
       return TRUE;
     }
-  else if (selection->wayland_selection &&
-           selection->wayland_selection->incr &&
-           event->window == selection->window &&
-           event->state == PropertyDelete &&
-           event->atom == selection->wayland_selection->request_event.property)
+
+  if (event->state != PropertyDelete)
+    return FALSE;
+
+  data = wayland_selection_data_lookup (selection, event->window, event->atom);
+  if (data && data->incr)
     {
       /* Wayland to X11 */
-      meta_xwayland_selection_send_incr_chunk (compositor, selection);
+      data->property_deleted = TRUE;
+      wayland_selection_data_update (data);
       return TRUE;
     }
 
@@ -1268,7 +1434,9 @@ meta_xwayland_selection_handle_property_notify (MetaWaylandCompositor *composito
   MetaXWaylandSelection *selection_data = compositor->xwayland_manager.selection_data;
   XPropertyEvent *event = (XPropertyEvent *) xevent;
 
-  return handle_incr_chunk (compositor, &selection_data->clipboard, event);
+  return (handle_incr_chunk (compositor, &selection_data->clipboard, event) ||
+          handle_incr_chunk (compositor, &selection_data->primary, event) ||
+          handle_incr_chunk (compositor, &selection_data->dnd.selection, event));
 }
 
 static gboolean
@@ -1278,6 +1446,7 @@ meta_xwayland_selection_handle_selection_request (MetaWaylandCompositor *composi
   XSelectionRequestEvent *event = (XSelectionRequestEvent *) xevent;
   MetaWaylandDataSource *data_source;
   MetaSelectionBridge *selection;
+  WaylandSelectionData *data = NULL;
 
   selection = atom_to_selection_bridge (compositor, event->selection);
 
@@ -1293,8 +1462,16 @@ meta_xwayland_selection_handle_selection_request (MetaWaylandCompositor *composi
   if (!data_source)
     return FALSE;
 
-  g_clear_pointer (&selection->wayland_selection,
-                   (GDestroyNotify) wayland_selection_data_free);
+  /* Transfers to other requestors or properties carry on unaffected,
+   * a request reusing this property supersedes the one in progress.
+   */
+  data = wayland_selection_data_lookup (selection,
+                                        event->requestor, event->property);
+  if (data)
+    {
+      wayland_selection_data_finish (data);
+      data = NULL;
+    }
 
   if (event->target == gdk_x11_get_xatom_by_name ("TARGETS"))
     {
@@ -1321,14 +1498,17 @@ meta_xwayland_selection_handle_selection_request (MetaWaylandCompositor *composi
           meta_wayland_data_source_has_mime_type (data_source,
                                                   gdk_x11_get_xatom_name (event->target)))
         {
-          selection->wayland_selection = wayland_selection_data_new (event,
-                                                                     compositor);
+          data = wayland_selection_data_new (event, compositor);
 
-          if (selection->wayland_selection)
-            wayland_selection_data_read (selection);
+          if (data)
+            {
+              selection->wayland_selections =
+                g_list_prepend (selection->wayland_selections, data);
+              wayland_selection_data_read (data);
+            }
         }
 
-      if (!selection->wayland_selection)
+      if (!data)
         reply_selection_request (event, FALSE);
     }
 
@@ -1747,8 +1927,8 @@ shutdown_selection_bridge (MetaSelectionBridge *selection)
 
   XDestroyWindow (GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
                   selection->window);
-  g_clear_pointer (&selection->wayland_selection,
-                   (GDestroyNotify) wayland_selection_data_free);
+  while (selection->wayland_selections)
+    wayland_selection_data_finish (selection->wayland_selections->data);
   g_clear_pointer (&selection->x11_selection,
                    (GDestroyNotify) x11_selection_data_free);
 }
@@ -32,6 +32,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 
+#include <meta/util.h>
 #include "compositor/meta-surface-actor-wayland.h"
 
 enum {
@@ -475,12 +476,14 @@ choose_xdisplay (MetaXWaylandManager *manager)
 static void
 xserver_finished_init (MetaXWaylandManager *manager)
 {
+  manager->ready_time = g_get_monotonic_time ();
+
   /* At this point xwayland is all setup to start accepting
    * connections so we can quit the transient initialization mainloop
    * and unblock meta_wayland_init() to continue initializing mutter.
    * */
-  g_main_loop_quit (manager->init_loop);
-  g_clear_pointer (&manager->init_loop, g_main_loop_unref);
+  if (manager->init_loop)
+    g_main_loop_quit (manager->init_loop);
 }
 
 static gboolean
@@ -511,6 +514,8 @@ meta_xwayland_start (MetaXWaylandManager *manager,
   GSubprocess *proc;
   GError *error = NULL;
 
+  manager->start_time = g_get_monotonic_time ();
+
   if (!choose_xdisplay (manager))
     goto out;
 
@@ -562,12 +567,6 @@ meta_xwayland_start (MetaXWaylandManager *manager,
   g_unix_fd_add (displayfd[0], G_IO_IN, on_displayfd_ready, manager);
   manager->client = wl_client_create (wl_display, xwayland_client_fd[0]);
 
-  /* We need to run a mainloop until we know xwayland has a binding
-   * for our xserver interface at which point we can assume it's
-   * ready to start accepting connections. */
-  manager->init_loop = g_main_loop_new (NULL, FALSE);
-  g_main_loop_run (manager->init_loop);
-
   started = TRUE;
 
 out:
@@ -579,6 +578,37 @@ out:
   return started;
 }
 
+/**
+ * meta_xwayland_wait_ready:
+ * @manager: a #MetaXWaylandManager
+ *
+ * Blocks until the Xwayland server launched by meta_xwayland_start()
+ * accepts connections. Xwayland is a wayland client of ours, so this
+ * must only be called once the wayland event source is attached and
+ * the globals it needs are registered; the time between the two calls
+ * is spent initializing in parallel with it.
+ */
+void
+meta_xwayland_wait_ready (MetaXWaylandManager *manager)
+{
+  gint64 wait_start = g_get_monotonic_time ();
+
+  /* We need to run a mainloop until we know xwayland has a binding
+   * for our xserver interface at which point we can assume it's
+   * ready to start accepting connections. */
+  if (manager->ready_time == 0)
+    {
+      manager->init_loop = g_main_loop_new (NULL, FALSE);
+      g_main_loop_run (manager->init_loop);
+      g_clear_pointer (&manager->init_loop, g_main_loop_unref);
+    }
+
+  meta_topic (META_DEBUG_WAYLAND,
+              "Xwayland ready %.1f ms after launch, startup blocked on it for %.1f ms\n",
+              (manager->ready_time - manager->start_time) / 1000.0,
+              (g_get_monotonic_time () - wait_start) / 1000.0);
+}
+
 /* To be called right after connecting */
 void
 meta_xwayland_complete_init (void)
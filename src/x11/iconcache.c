@@ -32,58 +32,74 @@
 #include <X11/Xatom.h>
 #include <X11/extensions/Xrender.h>
 
-static gboolean
-find_largest_sizes (gulong *data,
-                    gulong  nitems,
-                    int    *width,
-                    int    *height)
+/* _NET_WM_ICON properties up to this many items are fetched at once;
+ * for larger ones, only this much, then the remaining headers and the
+ * images we use.
+ */
+#define NET_WM_ICON_FETCH_ALL_MAX_ITEMS (64 * 64 * 4)
+
+/* Icons larger than this are taken as garbage */
+#define NET_WM_ICON_MAX_SIZE 4096
+
+typedef struct
 {
-  *width = 0;
-  *height = 0;
+  int    width;
+  int    height;
+  gulong offset; /* of the pixels, in items from the property start */
+} IconImage;
 
-  while (nitems > 0)
-    {
-      int w, h;
+/* Decoded icons by content hash, shared between the windows using the
+ * same icon; the surfaces remove themselves when destroyed.
+ */
+static GHashTable *icon_surfaces = NULL;
+static cairo_user_data_key_t icon_surface_hash_key;
+
+static gboolean
+get_icon_header (gulong    *header,
+                 gulong     offset,
+                 gulong     nitems,
+                 IconImage *image)
+{
+  gulong w, h;
 
-      if (nitems < 3)
-        return FALSE; /* no space for w, h */
+  if (nitems - offset < 3)
+    return FALSE; /* no space for w, h */
 
-      w = data[0];
-      h = data[1];
+  w = header[0];
+  h = header[1];
 
-      if (nitems < ((gulong)(w * h) + 2))
-        return FALSE; /* not enough data */
+  if (w > NET_WM_ICON_MAX_SIZE || h > NET_WM_ICON_MAX_SIZE)
+    return FALSE;
 
-      *width = MAX (w, *width);
-      *height = MAX (h, *height);
+  if (nitems - offset < (w * h) + 2)
+    return FALSE; /* not enough data */
 
-      data += (w * h) + 2;
-      nitems -= (w * h) + 2;
-    }
+  image->width = w;
+  image->height = h;
+  image->offset = offset + 2;
 
   return TRUE;
 }
 
-static gboolean
-find_best_size (gulong  *data,
-                gulong   nitems,
-                int      ideal_width,
-                int      ideal_height,
-                int     *width,
-                int     *height,
-                gulong **start)
+static int
+find_best_size (IconImage *images,
+                int        n_images,
+                int        ideal_width,
+                int        ideal_height)
 {
   int best_w;
   int best_h;
-  gulong *best_start;
+  int best;
   int max_width, max_height;
+  int i;
 
-  *width = 0;
-  *height = 0;
-  *start = NULL;
-
-  if (!find_largest_sizes (data, nitems, &max_width, &max_height))
-    return FALSE;
+  max_width = 0;
+  max_height = 0;
+  for (i = 0; i < n_images; i++)
+    {
+      max_width = MAX (images[i].width, max_width);
+      max_height = MAX (images[i].height, max_height);
+    }
 
   if (ideal_width < 0)
     ideal_width = max_width;
@@ -92,25 +108,19 @@ find_best_size (gulong  *data,
 
   best_w = 0;
   best_h = 0;
-  best_start = NULL;
+  best = -1;
 
-  while (nitems > 0)
+  for (i = 0; i < n_images; i++)
     {
       int w, h;
       gboolean replace;
 
       replace = FALSE;
 
-      if (nitems < 3)
-        return FALSE; /* no space for w, h */
-
-      w = data[0];
-      h = data[1];
-
-      if (nitems < ((gulong)(w * h) + 2))
-        break; /* not enough data */
+      w = images[i].width;
+      h = images[i].height;
 
-      if (best_start == NULL)
+      if (best < 0)
         {
           replace = TRUE;
         }
@@ -140,24 +150,29 @@ find_best_size (gulong  *data,
 
       if (replace)
         {
-          best_start = data + 2;
+          best = i;
           best_w = w;
           best_h = h;
         }
-
-      data += (w * h) + 2;
-      nitems -= (w * h) + 2;
     }
 
-  if (best_start)
-    {
-      *start = best_start;
-      *width = best_w;
-      *height = best_h;
-      return TRUE;
-    }
-  else
-    return FALSE;
+  return best;
+}
+
+static guint
+hash_argbdata (gulong *argb_data, int w, int h)
+{
+  guint hash = 5381;
+  gulong i;
+
+  hash = hash * 33 + w;
+  hash = hash * 33 + h;
+
+  for (i = 0; i < (gulong) w * h; i++)
+    hash = hash * 33 + (uint32_t) argb_data[i];
+
+  /* Zero can't be stored as surface user data */
+  return hash != 0 ? hash : 1;
 }
 
 static cairo_surface_t *
@@ -188,14 +203,79 @@ argbdata_to_surface (gulong *argb_data, int w, int h)
 }
 
 static gboolean
-read_rgb_icon (MetaDisplay      *display,
-               Window            xwindow,
-               int               ideal_width,
-               int               ideal_height,
-               int               ideal_mini_width,
-               int               ideal_mini_height,
-               cairo_surface_t **icon,
-               cairo_surface_t **mini_icon)
+surface_has_argbdata (cairo_surface_t *surface,
+                      gulong          *argb_data,
+                      int              w,
+                      int              h)
+{
+  int y, x, stride;
+  uint32_t *data;
+
+  if (cairo_image_surface_get_width (surface) != w ||
+      cairo_image_surface_get_height (surface) != h)
+    return FALSE;
+
+  stride = cairo_image_surface_get_stride (surface) / sizeof (uint32_t);
+  data = (uint32_t *) cairo_image_surface_get_data (surface);
+
+  for (y = 0; y < h; y++)
+    {
+      for (x = 0; x < w; x++)
+        {
+          if (data[y * stride + x] != (uint32_t) argb_data[y * w + x])
+            return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static void
+icon_surface_destroyed (gpointer data)
+{
+  g_hash_table_remove (icon_surfaces, data);
+}
+
+static cairo_surface_t *
+get_icon_surface (gulong *argb_data,
+                  int     w,
+                  int     h,
+                  guint   hash)
+{
+  cairo_surface_t *surface;
+
+  if (icon_surfaces == NULL)
+    icon_surfaces = g_hash_table_new (NULL, NULL);
+
+  surface = g_hash_table_lookup (icon_surfaces, GUINT_TO_POINTER (hash));
+  if (surface && surface_has_argbdata (surface, argb_data, w, h))
+    return cairo_surface_reference (surface);
+
+  surface = argbdata_to_surface (argb_data, w, h);
+
+  /* On a hash collision, the new icon is just not shared */
+  if (!g_hash_table_contains (icon_surfaces, GUINT_TO_POINTER (hash)))
+    {
+      g_hash_table_insert (icon_surfaces, GUINT_TO_POINTER (hash), surface);
+      cairo_surface_set_user_data (surface, &icon_surface_hash_key,
+                                   GUINT_TO_POINTER (hash),
+                                   icon_surface_destroyed);
+    }
+
+  return surface;
+}
+
+/* Gets @length items of _NET_WM_ICON from @offset, and the length of
+ * the whole property in @total_items. With @n_items, fewer items are
+ * fine and their number is returned there.
+ */
+static gulong *
+get_net_wm_icon_items (MetaDisplay *display,
+                       Window       xwindow,
+                       gulong       offset,
+                       gulong       length,
+                       gulong      *n_items,
+                       gulong      *total_items)
 {
   Atom type;
   int format;
@@ -203,11 +283,6 @@ read_rgb_icon (MetaDisplay      *display,
   gulong bytes_after;
   int result, err;
   guchar *data;
-  gulong *best;
-  int w, h;
-  gulong *best_mini;
-  int mini_w, mini_h;
-  gulong *data_as_long;
 
   meta_error_trap_push (display);
   type = None;
@@ -215,45 +290,170 @@ read_rgb_icon (MetaDisplay      *display,
   result = XGetWindowProperty (display->xdisplay,
 			       xwindow,
                                display->atom__NET_WM_ICON,
-			       0, G_MAXLONG,
+			       offset, length,
 			       False, XA_CARDINAL, &type, &format, &nitems,
 			       &bytes_after, &data);
   err = meta_error_trap_pop_with_return (display);
 
   if (err != Success ||
       result != Success)
-    return FALSE;
+    return NULL;
 
-  if (type != XA_CARDINAL)
+  if (type != XA_CARDINAL || format != 32 || nitems == 0 ||
+      (n_items == NULL && nitems != length))
     {
       XFree (data);
-      return FALSE;
+      return NULL;
     }
 
-  data_as_long = (gulong *)data;
+  if (n_items)
+    *n_items = nitems;
+  if (total_items)
+    *total_items = offset + nitems + bytes_after / 4;
+
+  return (gulong *) data;
+}
+
+/* Gets @length items from @offset, out of the @n_data items fetched
+ * first when they are in there
+ */
+static gulong *
+get_icon_items (MetaDisplay *display,
+                Window       xwindow,
+                gulong      *data,
+                gulong       n_data,
+                gulong       offset,
+                gulong       length)
+{
+  if (offset + length <= n_data)
+    return data + offset;
+
+  return get_net_wm_icon_items (display, xwindow, offset, length, NULL, NULL);
+}
+
+static void
+free_icon_items (gulong *items,
+                 gulong  n_data,
+                 gulong  offset,
+                 gulong  length)
+{
+  if (items && offset + length > n_data)
+    XFree (items);
+}
 
-  if (!find_best_size (data_as_long, nitems,
-                       ideal_width, ideal_height,
-                       &w, &h, &best))
+static gboolean
+read_rgb_icon (MetaDisplay      *display,
+               Window            xwindow,
+               MetaIconCache    *icon_cache,
+               int               ideal_width,
+               int               ideal_height,
+               int               ideal_mini_width,
+               int               ideal_mini_height,
+               cairo_surface_t **icon,
+               cairo_surface_t **mini_icon)
+{
+  gulong *data, *header;
+  gulong *pixels, *mini_pixels;
+  gulong n_data, nitems, offset;
+  GArray *images;
+  IconImage *best, *best_mini;
+  int best_index, best_mini_index;
+  gulong length, mini_length;
+
+  *icon = NULL;
+  *mini_icon = NULL;
+
+  /* This is the whole property when it is small, otherwise its start
+   * and the length of the rest.
+   */
+  data = get_net_wm_icon_items (display, xwindow,
+                                0, NET_WM_ICON_FETCH_ALL_MAX_ITEMS,
+                                &n_data, &nitems);
+  if (data == NULL)
+    return FALSE;
+
+  images = g_array_new (FALSE, FALSE, sizeof (IconImage));
+
+  offset = 0;
+  while (offset < nitems)
     {
-      XFree (data);
-      return FALSE;
+      IconImage image;
+      gboolean valid;
+
+      header = get_icon_items (display, xwindow, data, n_data, offset, 2);
+      valid = header && get_icon_header (header, offset, nitems, &image);
+      free_icon_items (header, n_data, offset, 2);
+
+      if (!valid)
+        {
+          g_array_free (images, TRUE);
+          XFree (data);
+          return FALSE;
+        }
+
+      g_array_append_val (images, image);
+      offset = image.offset + (gulong) image.width * image.height;
     }
 
-  if (!find_best_size (data_as_long, nitems,
-                       ideal_mini_width, ideal_mini_height,
-                       &mini_w, &mini_h, &best_mini))
+  best_index = find_best_size ((IconImage *) images->data, images->len,
+                               ideal_width, ideal_height);
+  best_mini_index = find_best_size ((IconImage *) images->data, images->len,
+                                    ideal_mini_width, ideal_mini_height);
+  if (best_index < 0 || best_mini_index < 0)
     {
+      g_array_free (images, TRUE);
       XFree (data);
       return FALSE;
     }
 
-  *icon = argbdata_to_surface (best, w, h);
-  *mini_icon = argbdata_to_surface (best_mini, mini_w, mini_h);
+  best = &g_array_index (images, IconImage, best_index);
+  best_mini = &g_array_index (images, IconImage, best_mini_index);
+  length = (gulong) best->width * best->height;
+  mini_length = (gulong) best_mini->width * best_mini->height;
+
+  pixels = get_icon_items (display, xwindow, data, n_data,
+                           best->offset, length);
+  if (best_mini_index == best_index)
+    mini_pixels = pixels;
+  else
+    mini_pixels = get_icon_items (display, xwindow, data, n_data,
+                                  best_mini->offset, mini_length);
+
+  /* Clients updating the property with the same icon over and over
+   * again should not cost a decode and a redraw each time, so compare
+   * with the images we last read.
+   */
+  if (pixels && mini_pixels &&
+      (icon_cache->origin != USING_NET_WM_ICON ||
+       icon_cache->net_wm_icon == NULL ||
+       !surface_has_argbdata (icon_cache->net_wm_icon, pixels,
+                              best->width, best->height) ||
+       !surface_has_argbdata (icon_cache->net_wm_mini_icon, mini_pixels,
+                              best_mini->width, best_mini->height)))
+    {
+      *icon = get_icon_surface (pixels, best->width, best->height,
+                                hash_argbdata (pixels,
+                                               best->width, best->height));
+      *mini_icon = get_icon_surface (mini_pixels,
+                                     best_mini->width, best_mini->height,
+                                     hash_argbdata (mini_pixels,
+                                                    best_mini->width,
+                                                    best_mini->height));
+
+      g_clear_pointer (&icon_cache->net_wm_icon, cairo_surface_destroy);
+      g_clear_pointer (&icon_cache->net_wm_mini_icon, cairo_surface_destroy);
+      icon_cache->net_wm_icon = cairo_surface_reference (*icon);
+      icon_cache->net_wm_mini_icon = cairo_surface_reference (*mini_icon);
+    }
 
+  free_icon_items (pixels, n_data, best->offset, length);
+  if (mini_pixels != pixels)
+    free_icon_items (mini_pixels, n_data, best_mini->offset, mini_length);
+
+  g_array_free (images, TRUE);
   XFree (data);
 
-  return TRUE;
+  return pixels != NULL && mini_pixels != NULL;
 }
 
 static void
@@ -444,6 +644,15 @@ meta_icon_cache_init (MetaIconCache *icon_cache)
   icon_cache->wm_hints_dirty = TRUE;
   icon_cache->kwm_win_icon_dirty = TRUE;
   icon_cache->net_wm_icon_dirty = TRUE;
+  icon_cache->net_wm_icon = NULL;
+  icon_cache->net_wm_mini_icon = NULL;
+}
+
+void
+meta_icon_cache_free (MetaIconCache *icon_cache)
+{
+  g_clear_pointer (&icon_cache->net_wm_icon, cairo_surface_destroy);
+  g_clear_pointer (&icon_cache->net_wm_mini_icon, cairo_surface_destroy);
 }
 
 void
@@ -514,11 +723,15 @@ meta_read_icons (MetaScreen       *screen,
     {
       icon_cache->net_wm_icon_dirty = FALSE;
 
-      if (read_rgb_icon (screen->display, xwindow,
+      if (read_rgb_icon (screen->display, xwindow, icon_cache,
                          ideal_width, ideal_height,
                          ideal_mini_width, ideal_mini_height,
                          iconp, mini_iconp))
         {
+          /* No new surfaces if the icon did not change */
+          if (*iconp == NULL)
+            return FALSE;
+
           icon_cache->origin = USING_NET_WM_ICON;
           return TRUE;
         }
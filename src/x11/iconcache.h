@@ -48,9 +48,13 @@ struct _MetaIconCache
   guint wm_hints_dirty : 1;
   guint kwm_win_icon_dirty : 1;
   guint net_wm_icon_dirty : 1;
+  /* The images last read from _NET_WM_ICON */
+  cairo_surface_t *net_wm_icon;
+  cairo_surface_t *net_wm_mini_icon;
 };
 
 void           meta_icon_cache_init                 (MetaIconCache *icon_cache);
+void           meta_icon_cache_free                 (MetaIconCache *icon_cache);
 void           meta_icon_cache_property_changed     (MetaIconCache *icon_cache,
                                                      MetaDisplay   *display,
                                                      Atom           atom);
@@ -169,6 +169,37 @@ meta_window_load_initial_properties (MetaWindow *window)
   g_free (values);
 }
 
+void
+meta_display_prefetch_initial_window_properties (MetaDisplay *display,
+                                                 Window       xwindow,
+                                                 gboolean     override_redirect)
+{
+  int i, j;
+  MetaPropValue *values;
+
+  values = g_new0 (MetaPropValue, display->n_prop_hooks);
+
+  j = 0;
+  for (i = 0; i < display->n_prop_hooks; i++)
+    {
+      MetaWindowPropHooks *hooks = &display->prop_hooks_table[i];
+
+      /* Same as init_prop_value(), which needs a MetaWindow */
+      if (!(hooks->flags & LOAD_INIT) ||
+          hooks->type == META_PROP_VALUE_INVALID ||
+          (override_redirect && !(hooks->flags & INCLUDE_OR)))
+        continue;
+
+      values[j].type = hooks->type;
+      values[j].atom = hooks->property;
+      ++j;
+    }
+
+  meta_prop_prefetch_values (display, xwindow, values, j);
+
+  g_free (values);
+}
+
 /* Fill in the MetaPropValue used to get the value of "property" */
 static void
 init_prop_value (MetaWindow          *window,
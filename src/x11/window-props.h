@@ -59,6 +59,20 @@ void meta_window_reload_property_from_xwindow (MetaWindow      *window,
  */
 void meta_window_load_initial_properties (MetaWindow *window);
 
+/**
+ * meta_display_prefetch_initial_window_properties:
+ * @display:           The display.
+ * @xwindow:           The X handle for the window.
+ * @override_redirect: Whether the window is override-redirect.
+ *
+ * Sends the requests for the properties loaded by
+ * meta_window_load_initial_properties() ahead of creating the window,
+ * without waiting for the replies.
+ */
+void meta_display_prefetch_initial_window_properties (MetaDisplay *display,
+                                                      Window       xwindow,
+                                                      gboolean     override_redirect);
+
 /**
  * meta_display_init_window_prop_hooks:
  * @display:  The display.
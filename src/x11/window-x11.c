@@ -619,6 +619,8 @@ meta_window_x11_unmanage (MetaWindow *window)
 
   meta_display_unregister_x_window (window->display, window->xwindow);
 
+  meta_icon_cache_free (&priv->icon_cache);
+
   /* Put back anything we messed up */
   if (priv->border_width != 0)
     XSetWindowBorderWidth (window->display->xdisplay,
@@ -2866,6 +2868,262 @@ is_our_xwindow (MetaDisplay       *display,
   return FALSE;
 }
 
+static gulong
+get_window_event_mask (XWindowAttributes *attrs)
+{
+  gulong event_mask;
+
+  event_mask = PropertyChangeMask;
+  if (attrs->override_redirect)
+    event_mask |= StructureNotifyMask;
+
+  return event_mask;
+}
+
+static gboolean
+xcb_to_window_attributes (MetaDisplay                       *display,
+                          xcb_get_window_attributes_reply_t *attributes,
+                          xcb_get_geometry_reply_t          *geometry,
+                          XWindowAttributes                 *attrs)
+{
+  int i;
+
+  attrs->x = geometry->x;
+  attrs->y = geometry->y;
+  attrs->width = geometry->width;
+  attrs->height = geometry->height;
+  attrs->border_width = geometry->border_width;
+  attrs->depth = geometry->depth;
+  attrs->root = geometry->root;
+
+  attrs->visual = _XVIDtoVisual (display->xdisplay, attributes->visual);
+  attrs->class = attributes->_class;
+  attrs->bit_gravity = attributes->bit_gravity;
+  attrs->win_gravity = attributes->win_gravity;
+  attrs->backing_store = attributes->backing_store;
+  attrs->backing_planes = attributes->backing_planes;
+  attrs->backing_pixel = attributes->backing_pixel;
+  attrs->save_under = attributes->save_under;
+  attrs->colormap = attributes->colormap;
+  attrs->map_installed = attributes->map_is_installed;
+  attrs->map_state = attributes->map_state;
+  attrs->all_event_masks = attributes->all_event_masks;
+  attrs->your_event_mask = attributes->your_event_mask;
+  attrs->do_not_propagate_mask = attributes->do_not_propagate_mask;
+  attrs->override_redirect = attributes->override_redirect;
+
+  /* Same as XGetWindowAttributes() */
+  attrs->screen = NULL;
+  for (i = 0; i < ScreenCount (display->xdisplay); i++)
+    {
+      if (ScreenOfDisplay (display->xdisplay, i)->root == attrs->root)
+        {
+          attrs->screen = ScreenOfDisplay (display->xdisplay, i);
+          break;
+        }
+    }
+
+  return attrs->screen != NULL;
+}
+
+static gboolean
+get_window_attributes (MetaDisplay       *display,
+                       Window             xwindow,
+                       XWindowAttributes *attrs)
+{
+  gpointer prefetched;
+
+  if (display->prefetched_window_attributes &&
+      g_hash_table_lookup_extended (display->prefetched_window_attributes,
+                                    GUINT_TO_POINTER (xwindow),
+                                    NULL, &prefetched))
+    {
+      if (prefetched == NULL)
+        return FALSE;
+
+      *attrs = *(XWindowAttributes *) prefetched;
+      return TRUE;
+    }
+
+  return XGetWindowAttributes (display->xdisplay, xwindow, attrs);
+}
+
+/**
+ * meta_window_x11_prefetch:
+ * @display: a #MetaDisplay
+ * @xwindows: (array length=n_xwindows): the windows about to be managed
+ * @n_xwindows: the number of @xwindows
+ *
+ * Gets everything meta_window_x11_new() reads from the server for
+ * @xwindows, pipelining the requests for all the windows so that it
+ * takes a few round trips instead of several per window. This is used
+ * when managing the existing windows at startup; the replies are kept
+ * until meta_window_x11_clear_prefetch().
+ */
+void
+meta_window_x11_prefetch (MetaDisplay  *display,
+                          const Window *xwindows,
+                          int           n_xwindows)
+{
+  MetaScreen *screen = display->screen;
+  xcb_connection_t *xcb_conn = XGetXCBConnection (display->xdisplay);
+  xcb_get_window_attributes_cookie_t *attributes_cookies;
+  xcb_get_geometry_cookie_t *geometry_cookies;
+  gboolean *candidates;
+  int i;
+
+  meta_window_x11_clear_prefetch (display);
+
+  /* The windows can go away at any point, see meta_window_x11_new() */
+  meta_error_trap_push (display);
+
+  display->prefetched_window_attributes =
+    g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+  /* Get the attributes of all the windows */
+  attributes_cookies = g_new (xcb_get_window_attributes_cookie_t, n_xwindows);
+  geometry_cookies = g_new (xcb_get_geometry_cookie_t, n_xwindows);
+
+  for (i = 0; i < n_xwindows; i++)
+    {
+      attributes_cookies[i] = xcb_get_window_attributes (xcb_conn, xwindows[i]);
+      geometry_cookies[i] = xcb_get_geometry (xcb_conn, xwindows[i]);
+    }
+
+  candidates = g_new0 (gboolean, n_xwindows);
+
+  for (i = 0; i < n_xwindows; i++)
+    {
+      xcb_get_window_attributes_reply_t *attributes;
+      xcb_get_geometry_reply_t *geometry;
+      xcb_generic_error_t *error = NULL;
+      XWindowAttributes *attrs = NULL;
+
+      attributes = xcb_get_window_attributes_reply (xcb_conn,
+                                                    attributes_cookies[i],
+                                                    &error);
+      g_clear_pointer (&error, free);
+      geometry = xcb_get_geometry_reply (xcb_conn, geometry_cookies[i], &error);
+      g_clear_pointer (&error, free);
+
+      if (attributes && geometry)
+        {
+          attrs = g_new (XWindowAttributes, 1);
+          if (!xcb_to_window_attributes (display, attributes, geometry, attrs))
+            g_clear_pointer (&attrs, g_free);
+        }
+
+      free (attributes);
+      free (geometry);
+
+      g_hash_table_insert (display->prefetched_window_attributes,
+                           GUINT_TO_POINTER (xwindows[i]), attrs);
+
+      /* Windows meta_window_x11_new() would give up on right away */
+      candidates[i] = (attrs != NULL &&
+                       attrs->root == screen->xroot &&
+                       !meta_display_xwindow_is_a_no_focus_window (display,
+                                                                   xwindows[i]) &&
+                       !is_our_xwindow (display, screen, xwindows[i], attrs));
+    }
+
+  g_free (attributes_cookies);
+  g_free (geometry_cookies);
+
+  /* Only the unviewable windows with a WM_STATE are managed; most
+   * unviewable windows are toolkit internals, so check before asking
+   * for anything else.
+   */
+  for (i = 0; i < n_xwindows; i++)
+    {
+      XWindowAttributes *attrs;
+      MetaPropValue value = { 0 };
+
+      if (!candidates[i])
+        continue;
+
+      attrs = g_hash_table_lookup (display->prefetched_window_attributes,
+                                   GUINT_TO_POINTER (xwindows[i]));
+      if (attrs->map_state == IsViewable)
+        continue;
+
+      value.type = META_PROP_VALUE_CARDINAL;
+      value.atom = display->atom_WM_STATE;
+      value.required_type = display->atom_WM_STATE;
+      meta_prop_prefetch_values (display, xwindows[i], &value, 1);
+    }
+
+  for (i = 0; i < n_xwindows; i++)
+    {
+      XWindowAttributes *attrs;
+      uint32_t state;
+
+      if (!candidates[i])
+        continue;
+
+      attrs = g_hash_table_lookup (display->prefetched_window_attributes,
+                                   GUINT_TO_POINTER (xwindows[i]));
+      if (attrs->map_state == IsViewable)
+        continue;
+
+      if (!(meta_prop_get_cardinal_with_atom_type (display, xwindows[i],
+                                                   display->atom_WM_STATE,
+                                                   display->atom_WM_STATE,
+                                                   &state) &&
+            (state == IconicState || state == NormalState)))
+        candidates[i] = FALSE;
+    }
+
+  /* Select for property changes before asking for the properties, as
+   * meta_window_x11_new() does, so that no change is missed between
+   * this and managing the window.
+   */
+  for (i = 0; i < n_xwindows; i++)
+    {
+      XWindowAttributes *attrs;
+
+      if (!candidates[i])
+        continue;
+
+      attrs = g_hash_table_lookup (display->prefetched_window_attributes,
+                                   GUINT_TO_POINTER (xwindows[i]));
+
+      XSelectInput (display->xdisplay, xwindows[i],
+                    attrs->your_event_mask | get_window_event_mask (attrs));
+
+      if (attrs->map_state != IsViewable)
+        {
+          MetaPropValue value = { 0 };
+
+          value.type = META_PROP_VALUE_CARDINAL;
+          value.atom = display->atom_WM_STATE;
+          value.required_type = display->atom_WM_STATE;
+          meta_prop_prefetch_values (display, xwindows[i], &value, 1);
+        }
+
+      meta_display_prefetch_initial_window_properties (display, xwindows[i],
+                                                       attrs->override_redirect);
+    }
+
+  meta_error_trap_pop (display);
+
+  g_free (candidates);
+}
+
+/**
+ * meta_window_x11_clear_prefetch:
+ * @display: a #MetaDisplay
+ *
+ * Drops the replies from meta_window_x11_prefetch() which were not used.
+ */
+void
+meta_window_x11_clear_prefetch (MetaDisplay *display)
+{
+  g_clear_pointer (&display->prefetched_window_attributes,
+                   g_hash_table_destroy);
+  meta_prop_clear_prefetched_values (display);
+}
+
 #ifdef WITH_VERBOSE_MODE
 static const char*
 wm_state_to_string (int state)
@@ -2914,7 +3172,7 @@ meta_window_x11_new (MetaDisplay       *display,
    * so we must be careful with X error handling.
    */
 
-  if (!XGetWindowAttributes (display->xdisplay, xwindow, &attrs))
+  if (!get_window_attributes (display, xwindow, &attrs))
     {
       meta_verbose ("Failed to get attributes for window 0x%lx\n",
                     xwindow);
@@ -2972,9 +3230,7 @@ meta_window_x11_new (MetaDisplay       *display,
 
   meta_error_trap_push (display);
 
-  event_mask = PropertyChangeMask;
-  if (attrs.override_redirect)
-    event_mask |= StructureNotifyMask;
+  event_mask = get_window_event_mask (&attrs);
 
   /* If the window is from this client (a menu, say) we need to augment
    * the event mask, not replace it. For windows from other clients,
@@ -46,6 +46,11 @@ MetaWindow * meta_window_x11_new           (MetaDisplay        *display,
                                             gboolean            must_be_viewable,
                                             MetaCompEffect      effect);
 
+void         meta_window_x11_prefetch       (MetaDisplay        *display,
+                                            const Window       *xwindows,
+                                            int                 n_xwindows);
+void         meta_window_x11_clear_prefetch (MetaDisplay        *display);
+
 void meta_window_x11_set_net_wm_state            (MetaWindow *window);
 void meta_window_x11_set_wm_state                (MetaWindow *window);
 void meta_window_x11_set_allowed_actions_hint    (MetaWindow *window);
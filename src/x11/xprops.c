@@ -224,6 +224,51 @@ async_get_property_finish (xcb_connection_t          *xcb_conn,
   return (results->prop != NULL);
 }
 
+/* A GetProperty request sent by meta_prop_prefetch_values() whose
+ * reply was not read yet
+ */
+typedef struct
+{
+  Atom                      xatom;
+  Atom                      required_type;
+  xcb_get_property_cookie_t cookie;
+} PrefetchedProperty;
+
+static gboolean
+take_prefetched_property (MetaDisplay               *display,
+                          Window                     xwindow,
+                          Atom                       xatom,
+                          Atom                       required_type,
+                          xcb_get_property_cookie_t *cookie)
+{
+  GArray *properties;
+  guint i;
+
+  if (display->prefetched_properties == NULL)
+    return FALSE;
+
+  properties = g_hash_table_lookup (display->prefetched_properties,
+                                    GUINT_TO_POINTER (xwindow));
+  if (properties == NULL)
+    return FALSE;
+
+  for (i = 0; i < properties->len; i++)
+    {
+      PrefetchedProperty *property =
+        &g_array_index (properties, PrefetchedProperty, i);
+
+      if (property->xatom == xatom &&
+          property->required_type == required_type)
+        {
+          *cookie = property->cookie;
+          g_array_remove_index_fast (properties, i);
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
 static gboolean
 get_property (MetaDisplay        *display,
               Window              xwindow,
@@ -243,7 +288,9 @@ get_property (MetaDisplay        *display,
   results->bytes_after = 0;
   results->format = 0;
 
-  cookie = async_get_property (xcb_conn, xwindow, xatom, req_type);
+  if (!take_prefetched_property (display, xwindow, xatom, req_type, &cookie))
+    cookie = async_get_property (xcb_conn, xwindow, xatom, req_type);
+
   return async_get_property_finish (xcb_conn, cookie, results);
 }
 
@@ -851,13 +898,132 @@ latin1_to_utf8 (const char *text)
   return g_string_free (str, FALSE);
 }
 
+static Atom
+get_required_type (MetaDisplay       *display,
+                   MetaPropValueType  type)
+{
+  switch (type)
+    {
+    case META_PROP_VALUE_INVALID:
+      return None;
+    case META_PROP_VALUE_UTF8_LIST:
+    case META_PROP_VALUE_UTF8:
+      return display->atom_UTF8_STRING;
+    case META_PROP_VALUE_STRING:
+    case META_PROP_VALUE_STRING_AS_UTF8:
+      return XA_STRING;
+    case META_PROP_VALUE_MOTIF_HINTS:
+      return AnyPropertyType;
+    case META_PROP_VALUE_CARDINAL_LIST:
+    case META_PROP_VALUE_CARDINAL:
+      return XA_CARDINAL;
+    case META_PROP_VALUE_WINDOW:
+      return XA_WINDOW;
+    case META_PROP_VALUE_ATOM_LIST:
+      return XA_ATOM;
+    case META_PROP_VALUE_TEXT_PROPERTY:
+      return AnyPropertyType;
+    case META_PROP_VALUE_WM_HINTS:
+      return XA_WM_HINTS;
+    case META_PROP_VALUE_CLASS_HINT:
+      return XA_STRING;
+    case META_PROP_VALUE_SIZE_HINTS:
+      return XA_WM_SIZE_HINTS;
+    case META_PROP_VALUE_SYNC_COUNTER:
+    case META_PROP_VALUE_SYNC_COUNTER_LIST:
+      return XA_CARDINAL;
+    }
+
+  return None;
+}
+
+/**
+ * meta_prop_prefetch_values:
+ * @display: a #MetaDisplay
+ * @xwindow: the window to get the properties of
+ * @values: the properties to get, with type and atom initialized
+ * @n_values: the number of @values
+ *
+ * Sends the GetProperty requests for @values without waiting for the
+ * replies. A later meta_prop_get_values() for the same window and
+ * properties then uses these replies instead of asking the server
+ * again, so the properties of many windows can be fetched with a single
+ * round trip. Unused replies are dropped by
+ * meta_prop_clear_prefetched_values().
+ */
+void
+meta_prop_prefetch_values (MetaDisplay         *display,
+                           Window               xwindow,
+                           const MetaPropValue *values,
+                           int                  n_values)
+{
+  xcb_connection_t *xcb_conn = XGetXCBConnection (display->xdisplay);
+  GArray *properties;
+  int i;
+
+  if (display->prefetched_properties == NULL)
+    display->prefetched_properties =
+      g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_array_unref);
+
+  properties = g_hash_table_lookup (display->prefetched_properties,
+                                    GUINT_TO_POINTER (xwindow));
+  if (properties == NULL)
+    {
+      properties = g_array_new (FALSE, FALSE, sizeof (PrefetchedProperty));
+      g_hash_table_insert (display->prefetched_properties,
+                           GUINT_TO_POINTER (xwindow), properties);
+    }
+
+  for (i = 0; i < n_values; i++)
+    {
+      PrefetchedProperty property;
+
+      if (values[i].atom == None || values[i].type == META_PROP_VALUE_INVALID)
+        continue;
+
+      property.xatom = values[i].atom;
+      property.required_type = values[i].required_type;
+      if (property.required_type == None)
+        property.required_type = get_required_type (display, values[i].type);
+
+      property.cookie = async_get_property (xcb_conn, xwindow,
+                                            property.xatom,
+                                            property.required_type);
+      g_array_append_val (properties, property);
+    }
+}
+
+void
+meta_prop_clear_prefetched_values (MetaDisplay *display)
+{
+  xcb_connection_t *xcb_conn = XGetXCBConnection (display->xdisplay);
+  GHashTableIter iter;
+  gpointer value;
+
+  if (display->prefetched_properties == NULL)
+    return;
+
+  g_hash_table_iter_init (&iter, display->prefetched_properties);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      GArray *properties = value;
+      guint i;
+
+      for (i = 0; i < properties->len; i++)
+        xcb_discard_reply (xcb_conn,
+                           g_array_index (properties, PrefetchedProperty, i).cookie.sequence);
+    }
+
+  g_clear_pointer (&display->prefetched_properties, g_hash_table_destroy);
+}
+
 void
 meta_prop_get_values (MetaDisplay   *display,
                       Window         xwindow,
                       MetaPropValue *values,
                       int            n_values)
 {
-  int i;
+  int i, n_requested = 0;
   xcb_get_property_cookie_t *tasks;
   xcb_connection_t *xcb_conn = XGetXCBConnection (display->xdisplay);
 
@@ -875,66 +1041,39 @@ meta_prop_get_values (MetaDisplay   *display,
   i = 0;
   while (i < n_values)
     {
-      if (values[i].required_type == None)
+      if (values[i].type == META_PROP_VALUE_INVALID)
         {
-          switch (values[i].type)
-            {
-            case META_PROP_VALUE_INVALID:
-              /* This means we don't really want a value, e.g. got
-               * property notify on an atom we don't care about.
-               */
-              if (values[i].atom != None)
-                meta_bug ("META_PROP_VALUE_INVALID requested in %s\n", G_STRFUNC);
-              break;
-            case META_PROP_VALUE_UTF8_LIST:
-            case META_PROP_VALUE_UTF8:
-              values[i].required_type = display->atom_UTF8_STRING;
-              break;
-            case META_PROP_VALUE_STRING:
-            case META_PROP_VALUE_STRING_AS_UTF8:
-              values[i].required_type = XA_STRING;
-              break;
-            case META_PROP_VALUE_MOTIF_HINTS:
-              values[i].required_type = AnyPropertyType;
-              break;
-            case META_PROP_VALUE_CARDINAL_LIST:
-            case META_PROP_VALUE_CARDINAL:
-              values[i].required_type = XA_CARDINAL;
-              break;
-            case META_PROP_VALUE_WINDOW:
-              values[i].required_type = XA_WINDOW;
-              break;
-            case META_PROP_VALUE_ATOM_LIST:
-              values[i].required_type = XA_ATOM;
-              break;
-            case META_PROP_VALUE_TEXT_PROPERTY:
-              values[i].required_type = AnyPropertyType;
-              break;
-            case META_PROP_VALUE_WM_HINTS:
-              values[i].required_type = XA_WM_HINTS;
-              break;
-            case META_PROP_VALUE_CLASS_HINT:
-              values[i].required_type = XA_STRING;
-              break;
-            case META_PROP_VALUE_SIZE_HINTS:
-              values[i].required_type = XA_WM_SIZE_HINTS;
-              break;
-            case META_PROP_VALUE_SYNC_COUNTER:
-            case META_PROP_VALUE_SYNC_COUNTER_LIST:
-	      values[i].required_type = XA_CARDINAL;
-              break;
-            }
+          /* This means we don't really want a value, e.g. got
+           * property notify on an atom we don't care about.
+           */
+          if (values[i].atom != None)
+            meta_bug ("META_PROP_VALUE_INVALID requested in %s\n", G_STRFUNC);
+        }
+      else if (values[i].required_type == None)
+        {
+          values[i].required_type = get_required_type (display, values[i].type);
         }
 
-      if (values[i].atom != None)
-        tasks[i] = async_get_property (xcb_conn, xwindow, values[i].atom, values[i].required_type);
+      if (values[i].atom != None &&
+          !take_prefetched_property (display, xwindow,
+                                     values[i].atom, values[i].required_type,
+                                     &tasks[i]))
+        {
+          tasks[i] = async_get_property (xcb_conn, xwindow, values[i].atom, values[i].required_type);
+          ++n_requested;
+        }
       ++i;
     }
 
-  /* Get replies for all our tasks */
-  meta_topic (META_DEBUG_SYNC, "Syncing to get %d GetProperty replies in %s\n",
-              n_values, G_STRFUNC);
-  XSync (display->xdisplay, False);
+  /* Get replies for all our tasks; prefetched requests were sent
+   * already, so there is no need to sync for them.
+   */
+  if (n_requested > 0)
+    {
+      meta_topic (META_DEBUG_SYNC, "Syncing to get %d GetProperty replies in %s\n",
+                  n_requested, G_STRFUNC);
+      XSync (display->xdisplay, False);
+    }
 
   /* Collect results, should arrive in order requested */
   i = 0;
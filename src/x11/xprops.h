@@ -191,6 +191,13 @@ void meta_prop_get_values (MetaDisplay   *display,
 void meta_prop_free_values (MetaPropValue *values,
                             int            n_values);
 
+void meta_prop_prefetch_values (MetaDisplay         *display,
+                                Window               xwindow,
+                                const MetaPropValue *values,
+                                int                  n_values);
+
+void meta_prop_clear_prefetched_values (MetaDisplay *display);
+
 #endif
 
 